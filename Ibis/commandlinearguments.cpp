@@ -10,13 +10,45 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 =========================================================================*/
 #include "commandlinearguments.h"
 
+#include <cstring>
 #include <iostream>
 
 CommandLineArguments::CommandLineArguments()
-    : m_viewerOnly( false ), m_loadPrevConfig( false ), m_loadDefaultConfig( false ), m_loadConfigFile( false )
+    : m_viewerOnly( false ), m_loadPrevConfig( false ), m_loadDefaultConfig( false ), m_loadConfigFile( false ),
+      m_batchMode( false ), m_quitAfterOperations( false )
 {
 }
 
+bool CommandLineArguments::IsBatchMode( int argc, char ** argv )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( argv[i], "-b" ) == 0 || strcmp( argv[i], "--batch" ) == 0 ) return true;
+    }
+    return false;
+}
+
+void CommandLineArguments::PrintUsage()
+{
+    std::cerr << "Usage: ibis [-v] [-l|-d|-f config] [--scene scene.xml] [--run Plugin.Operation[:name=value,...]]..."
+              << std::endl
+              << "            [--quit] [files...]" << std::endl
+              << "       ibis --batch [--scene scene.xml] [--run Plugin.Operation[:name=value,...]]..." << std::endl
+              << "            [--save-scene output.xml] [files...]" << std::endl;
+}
+
+bool CommandLineArguments::GetOptionValue( QStringList & args, int & i, QString & value )
+{
+    if( args.size() > i + 1 && !args[i + 1].startsWith( '-' ) )
+    {
+        value = args[i + 1];
+        ++i;
+        return true;
+    }
+    std::cerr << "Error: expecting a value after " << args[i].toUtf8().data() << " option" << std::endl;
+    return false;
+}
+
 bool CommandLineArguments::ParseArguments( QStringList & args )
 {
     for( int i = 1; i < args.size(); ++i )
@@ -48,6 +80,24 @@ bool CommandLineArguments::ParseArguments( QStringList & args )
         }
         else if( arg == "-v" )
             m_viewerOnly = true;
+        else if( arg == "-b" || arg == "--batch" )
+            m_batchMode = true;
+        else if( arg == "--scene" )
+        {
+            if( !GetOptionValue( args, i, m_sceneFile ) ) return false;
+        }
+        else if( arg == "--run" )
+        {
+            QString operation;
+            if( !GetOptionValue( args, i, operation ) ) return false;
+            m_batchOperations.push_back( operation );
+        }
+        else if( arg == "--quit" )
+            m_quitAfterOperations = true;
+        else if( arg == "--save-scene" )
+        {
+            if( !GetOptionValue( args, i, m_outputSceneFile ) ) return false;
+        }
         else
             m_loadFileNames.push_back( arg );
     }
@@ -26,13 +26,32 @@ public:
     QString GetConfigFile() { return m_configFile; }
     QStringList GetDataFilesToLoad() { return m_loadFileNames; }
 
+    // Batch mode: no window, run operations and exit
+    bool GetBatchMode() { return m_batchMode; }
+    QString GetSceneFile() { return m_sceneFile; }
+    QStringList GetBatchOperations() { return m_batchOperations; }
+    QString GetOutputSceneFile() { return m_outputSceneFile; }
+    // Without batch mode, scene and operations are run once the main window is shown
+    bool GetQuitAfterOperations() { return m_quitAfterOperations; }
+
+    // Look for the batch flag before QApplication is created
+    static bool IsBatchMode( int argc, char ** argv );
+    static void PrintUsage();
+
 protected:
+    bool GetOptionValue( QStringList & args, int & i, QString & value );
+
     bool m_viewerOnly;
     bool m_loadPrevConfig;
     bool m_loadDefaultConfig;
     bool m_loadConfigFile;
     QString m_configFile;
     QStringList m_loadFileNames;
+    bool m_batchMode;
+    QString m_sceneFile;
+    QStringList m_batchOperations;
+    QString m_outputSceneFile;
+    bool m_quitAfterOperations;
 };
 
 #endif
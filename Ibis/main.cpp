@@ -16,11 +16,31 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QFile>
 #include <QMessageBox>
 #include <QTimer>
+#include <iostream>
 
 #include "application.h"
 #include "commandlinearguments.h"
 #include "mainwindow.h"
 
+// Run plugin operations without window and GL context, return the status of Application::RunBatch
+int RunBatch( QApplication & a )
+{
+    CommandLineArguments cmdArgs;
+    QStringList args = a.arguments();
+    if( !cmdArgs.ParseArguments( args ) )
+    {
+        CommandLineArguments::PrintUsage();
+        return Application::BatchInvalidArguments;
+    }
+
+    Application::CreateInstance( true, true );
+    Application::GetInstance().LoadPlugins();
+    int ret = Application::GetInstance().RunBatch( cmdArgs.GetSceneFile(), cmdArgs.GetDataFilesToLoad(),
+                                                   cmdArgs.GetBatchOperations(), cmdArgs.GetOutputSceneFile() );
+    Application::DeleteInstance();
+    return ret;
+}
+
 int main( int argc, char ** argv )
 {
     // Disable VTK warnings unless not wanted
@@ -28,6 +48,15 @@ int main( int argc, char ** argv )
     vtkObject::SetGlobalWarningDisplay( 0 );
 #endif
 
+    // Batch mode doesn't need a display, widgets created by plugins are never shown
+    if( CommandLineArguments::IsBatchMode( argc, argv ) )
+    {
+        qputenv( "QT_QPA_PLATFORM", "offscreen" );
+        QApplication a( argc, argv );
+        Q_INIT_RESOURCE( IbisLib );
+        return RunBatch( a );
+    }
+
     // Set default format for render windows - Warning: has to be done before QApplication instanciation
     QSurfaceFormat::setDefaultFormat( QVTKRenderWidget::defaultFormat() );
 
@@ -35,21 +64,32 @@ int main( int argc, char ** argv )
     QApplication a( argc, argv );
     Q_INIT_RESOURCE( IbisLib );
 
-    // Warning : IBIS IS NOT APPROVED FOR CLINICAL USE.
-    if( !QFile::exists( QDir::homePath() + QString( "/.ibis/no-clinical-warning.txt" ) ) )
-        QMessageBox::warning( nullptr, "WARNING!", QString( "The Ibis platform is not approved for clinical use." ) );
-
     // On Mac, we always do Viewer-mode only without command-line params for now
     // Parse command-line arguments
     CommandLineArguments cmdArgs;
     QStringList args = a.arguments();
     cmdArgs.ParseArguments( args );
+    if( !cmdArgs.GetOutputSceneFile().isEmpty() )
+        std::cerr << "Warning: --save-scene is only used with --batch, it is ignored." << std::endl;
+
+    // Warning : IBIS IS NOT APPROVED FOR CLINICAL USE.
+    // Scripted runs that quit by themselves (e.g. benchmarks) can't dismiss a message box, print it instead.
+    if( !QFile::exists( QDir::homePath() + QString( "/.ibis/no-clinical-warning.txt" ) ) )
+    {
+        QString clinicalWarning( "The Ibis platform is not approved for clinical use." );
+        if( cmdArgs.GetQuitAfterOperations() )
+            std::cerr << "WARNING! " << clinicalWarning.toUtf8().data() << std::endl;
+        else
+            QMessageBox::warning( nullptr, "WARNING!", clinicalWarning );
+    }
 
     // Create unique instance of application
     Application::CreateInstance( cmdArgs.GetViewerOnly() );
 
     // Tell the application to load files specified on the command line immediately after startup
     Application::GetInstance().SetInitialDataFiles( cmdArgs.GetDataFilesToLoad() );
+    Application::GetInstance().SetInitialScene( cmdArgs.GetSceneFile() );
+    Application::GetInstance().SetStartupOperations( cmdArgs.GetBatchOperations(), cmdArgs.GetQuitAfterOperations() );
 
     // Load plugins
     Application::GetInstance().LoadPlugins();
@@ -61,7 +101,9 @@ int main( int argc, char ** argv )
     }
 
     // Create main window
+    Application::GetInstance().GetStartupProfiler()->BeginSection( "Main window" );
     MainWindow * mw = new MainWindow( 0 );
+    Application::GetInstance().GetStartupProfiler()->EndSection();
     Application::GetInstance().SetMainWindow( mw );
     Application::GetInstance().LoadWindowSettings();
     mw->setAttribute( Qt::WA_DeleteOnClose );
@@ -11,15 +11,13 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "ibishardwareIGSIO.h"
 
 #include <igtlioImageConverter.h>
-#include <igtlioImageDevice.h>
 #include <igtlioLogic.h>
 #include <igtlioStatusDevice.h>
 #include <igtlioTransformConverter.h>
-#include <igtlioTransformDevice.h>
 #include <igtlioVideoConverter.h>
-#include <igtlioVideoDevice.h>
 #include <vtkEventQtSlotConnect.h>
 #include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
 #include <vtkPLYReader.h>
 #include <vtkTimerLog.h>
 #include <vtkTransform.h>
@@ -27,6 +25,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QDir>
 #include <QMenu>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QSettings>
 
 #include "cameraobject.h"
@@ -38,7 +37,6 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "pointerobject.h"
 #include "polydataobject.h"
 #include "qIGTLIOClientWidget.h"
-#include "qIGTLIOLogicController.h"
 #include "usprobeobject.h"
 
 #undef SendMessage
@@ -48,8 +46,9 @@ const QString IbisHardwareIGSIO::PlusServerExecutable          = "PlusServerExec
 
 IbisHardwareIGSIO::IbisHardwareIGSIO()
 {
-    m_logicController           = nullptr;
     m_logic                     = nullptr;
+    m_acquisitionThread         = nullptr;
+    m_sampleMatrix              = vtkSmartPointer<vtkMatrix4x4>::New();
     m_clientWidget              = nullptr;
     m_logicCallbacks            = vtkSmartPointer<vtkEventQtSlotConnect>::New();
     m_settingsWidget            = nullptr;
@@ -80,13 +79,16 @@ void IbisHardwareIGSIO::AddSettingsMenuEntries( QMenu * menu )
 
 void IbisHardwareIGSIO::Init()
 {
-    m_logicController = new qIGTLIOLogicController;
-    m_logic           = vtkSmartPointer<igtlioLogic>::New();
-    m_logicController->setLogic( m_logic );
-    m_logicCallbacks->Connect( m_logic, igtlioLogic::NewDeviceEvent, this,
-                               SLOT( OnDeviceNew( vtkObject *, unsigned long, void *, void * ) ) );
-    m_logicCallbacks->Connect( m_logic, igtlioLogic::RemovedDeviceEvent, this,
-                               SLOT( OnDeviceRemoved( vtkObject *, unsigned long, void *, void * ) ) );
+    m_logic = vtkSmartPointer<igtlioLogic>::New();
+
+    // The acquisition thread replaces the periodic processing of qIGTLIOLogicController,
+    // the logic is only processed on the GUI thread while the client widget is open.
+    m_acquisitionThread = new IGSIOAcquisitionThread( m_logic );
+    connect( m_acquisitionThread, SIGNAL( DeviceAdded( igtlioDevicePointer ) ), this,
+             SLOT( OnDeviceNew( igtlioDevicePointer ) ) );
+    connect( m_acquisitionThread, SIGNAL( DeviceRemoved( igtlioDevicePointer ) ), this,
+             SLOT( OnDeviceRemoved( igtlioDevicePointer ) ) );
+    m_acquisitionThread->start( QThread::TimeCriticalPriority );
 
     // Initialize with last config file
     if( m_autoStartLastConfig ) StartConfig( m_lastIbisPlusConfigFile );
@@ -105,9 +107,10 @@ void IbisHardwareIGSIO::StartConfig( QString configFile )
     // Instanciate Ibis scene objects specified in config file
     for( int i = 0; i < in.GetNumberOfTools(); ++i )
     {
-        Tool * newTool       = new Tool;
-        newTool->sceneObject = InstanciateSceneObjectFromType( in.GetToolName( i ), in.GetToolType( i ) );
-        newTool->toolModel   = InstanciateToolModel( in.GetToolModelFile( i ) );
+        Tool * newTool              = new Tool;
+        newTool->sceneObject        = InstanciateSceneObjectFromType( in.GetToolName( i ), in.GetToolType( i ) );
+        newTool->toolModel          = InstanciateToolModel( in.GetToolModelFile( i ) );
+        newTool->acquisitionChannel = m_acquisitionThread->AddChannel();
         ReadToolConfig( in.GetToolParamFile( i ), newTool->sceneObject );
         m_tools.append( newTool );
         GetIbisAPI()->AddObject( newTool->sceneObject );
@@ -144,49 +147,71 @@ void IbisHardwareIGSIO::ClearConfig()
         delete tool;
     }
     m_tools.clear();
+    m_acquisitionThread->ClearChannels();
     m_deviceToolAssociations.clear();
     ShutDownLocalServers();
 }
 
 void IbisHardwareIGSIO::Update()
 {
-    // Update everything
-    m_logic->PeriodicProcess();
+    // The logic is processed on the GUI thread while qIGTLIOClientWidget uses it
+    if( m_acquisitionThread->IsPaused() ) m_acquisitionThread->ProcessLogic();
 
-    // Push images, transforms and states to the TrackedSceneObjects
+    // Push every image, transform and state received by the acquisition thread since
+    // the last tick to the TrackedSceneObjects, in the order they were received.
+    IGSIOAcquisitionThread::Sample sample;
     foreach( Tool * tool, m_tools )
     {
-        if( tool->transformDevice )
+        bool received = false;
+        while( m_acquisitionThread->PopSample( tool->acquisitionChannel, sample ) )
         {
-            if( tool->transformDevice->GetDeviceType() == igtlioImageConverter::GetIGTLTypeName() )
-            {
-                igtlioImageDevice * imageDevice = igtlioImageDevice::SafeDownCast( tool->transformDevice );
-                tool->sceneObject->SetInputMatrix( imageDevice->GetContent().transform );
-            }
-            else if( tool->transformDevice->GetDeviceType() == igtlioTransformConverter::GetIGTLTypeName() )
-            {
-                igtlioTransformDevice * transformDevice = igtlioTransformDevice::SafeDownCast( tool->transformDevice );
-                tool->sceneObject->SetInputMatrix( transformDevice->GetContent().transform );
-            }
-            tool->sceneObject->SetTimestamp( tool->transformDevice->GetTimestamp() );
-            tool->sceneObject->SetState( ComputeToolStatus( tool->transformDevice, tool ) );
+            ApplySampleToTool( sample, tool );
+            received = true;
         }
-        if( tool->imageDevice )
+
+        // No new sample: status may still change (e.g. tool becomes missing)
+        if( !received )
         {
-            // simtodo : We should not have to do this every frame. Check UsProbeObject and CameraObject pipeline logic.
-            AssignDeviceImageToTool( tool->imageDevice, tool );
+            if( tool->transformDevice ) tool->sceneObject->SetState( ComputeToolStatus( tool ) );
+            tool->sceneObject->MarkModified();
         }
-        tool->sceneObject->MarkModified();
     }
 }
 
+void IbisHardwareIGSIO::ApplySampleToTool( IGSIOAcquisitionThread::Sample & sample, Tool * tool )
+{
+    if( sample.hasTransform )
+    {
+        m_sampleMatrix->DeepCopy( sample.matrix );
+        tool->sceneObject->SetInputMatrix( m_sampleMatrix );
+        tool->sceneObject->SetTimestamp( sample.timestamp );
+        tool->lastStatus = sample.status;
+        if( sample.timestamp > tool->lastTimeStamp )
+        {
+            tool->lastTimeStamp             = sample.timestamp;
+            tool->lastTimeStampModifiedTime = vtkTimerLog::GetUniversalTime();
+        }
+        tool->sceneObject->SetState( ComputeToolStatus( tool ) );
+    }
+    if( sample.image )
+    {
+        // The sample owns its copy of the image, it stays valid until the next sample is assigned
+        AssignImageToTool( sample.image, tool );
+        sample.image = nullptr;
+    }
+    tool->sceneObject->MarkModified();
+    tool->sceneObject->MarkSampleReceived();
+}
+
 bool IbisHardwareIGSIO::ShutDown()
 {
     WriteToolConfig();
     ClearConfig();
 
-    delete m_logicController;
-    m_logicController           = nullptr;
+    m_acquisitionThread->Stop();
+    m_acquisitionThread->wait();
+    delete m_acquisitionThread;
+    m_acquisitionThread         = nullptr;
     m_logic                     = nullptr;
     m_currentIbisPlusConfigFile = "";
 
@@ -228,6 +253,9 @@ void IbisHardwareIGSIO::OpenSettingsWidget()
 {
     if( !m_clientWidget )
     {
+        // The widget accesses the logic and observes its events without locking, the acquisition
+        // thread is paused until the widget is closed and the logic is processed in Update().
+        m_acquisitionThread->SetPaused( true );
         m_clientWidget = new qIGTLIOClientWidget;
         m_clientWidget->setLogic( m_logic );
         m_clientWidget->setGeometry( 0, 0, 859, 811 );
@@ -239,7 +267,11 @@ void IbisHardwareIGSIO::OpenSettingsWidget()
     m_clientWidget->show();
 }
 
-void IbisHardwareIGSIO::OnSettingsWidgetClosed() { m_clientWidget = nullptr; }
+void IbisHardwareIGSIO::OnSettingsWidgetClosed()
+{
+    m_clientWidget = nullptr;
+    if( m_acquisitionThread ) m_acquisitionThread->SetPaused( false );
+}
 
 void IbisHardwareIGSIO::OpenConfigFileWidget()
 {
@@ -255,9 +287,8 @@ void IbisHardwareIGSIO::OpenConfigFileWidget()
 
 void IbisHardwareIGSIO::OnConfigFileWidgetClosed() { m_settingsWidget = nullptr; }
 
-void IbisHardwareIGSIO::OnDeviceNew( vtkObject *, unsigned long, void *, void * callData )
+void IbisHardwareIGSIO::OnDeviceNew( igtlioDevicePointer device )
 {
-    igtlioDevicePointer device = reinterpret_cast<igtlioDevice *>( callData );
     QString toolName, toolPart;
     QString deviceName( device->GetDeviceName().c_str() );
     std::cout << "New device: " << deviceName.toUtf8().data() << std::endl;
@@ -269,23 +300,23 @@ void IbisHardwareIGSIO::OnDeviceNew( vtkObject *, unsigned long, void *, void *
     std::cout << "----> Connected to tool ( " << toolName.toUtf8().data() << " ), part ( " << toolPart.toUtf8().data()
               << " )" << std::endl;
 
-    // Assign image data of new device to the video input of the scene object
+    // Image data of the device will be sent to the video input of the scene object
+    Tool * tool = m_tools[toolIndex];
     if( toolPart == "ImageAndTransform" || toolPart == "Image" )
     {
-        AssignDeviceImageToTool( device, m_tools[toolIndex] );
-        m_tools[toolIndex]->imageDevice = device;
+        tool->imageDevice = device;
     }
 
     // Specify the device should be used to recover transform on every update
     if( toolPart == "ImageAndTransform" || toolPart == "Transform" )
     {
-        m_tools[toolIndex]->transformDevice = device;
+        tool->transformDevice = device;
     }
+    m_acquisitionThread->SetChannelDevices( tool->acquisitionChannel, tool->transformDevice, tool->imageDevice );
 }
 
-void IbisHardwareIGSIO::OnDeviceRemoved( vtkObject *, unsigned long, void *, void * callData )
+void IbisHardwareIGSIO::OnDeviceRemoved( igtlioDevicePointer device )
 {
-    igtlioDevice * device = reinterpret_cast<igtlioDevice *>( callData );
     QString toolName, toolPart;
     m_deviceToolAssociations.ToolAndPartFromDevice( QString( device->GetDeviceName().c_str() ), toolName, toolPart );
     if( toolName.isEmpty() ) return;
@@ -300,6 +331,8 @@ void IbisHardwareIGSIO::OnDeviceRemoved( vtkObject *, unsigned long, void *, voi
     {
         m_tools[toolIndex]->transformDevice = nullptr;
     }
+    m_acquisitionThread->SetChannelDevices( m_tools[toolIndex]->acquisitionChannel,
+                                            m_tools[toolIndex]->transformDevice, m_tools[toolIndex]->imageDevice );
 }
 
 void IbisHardwareIGSIO::InitPlugin()
@@ -349,14 +382,17 @@ bool IbisHardwareIGSIO::LaunchLocalServer( QString plusConfigFile )
 
 void IbisHardwareIGSIO::Connect( std::string ip, int port, bool start )
 {
+    QMutexLocker lock( m_acquisitionThread->GetLogicMutex() );
     igtlioConnectorPointer c = m_logic->CreateConnector();
     c->SetTypeClient( ip, port );
     if( start )
     {
         c->Start();
     }
+    // ConnectedEvent is fired by PeriodicProcess in the acquisition thread, the handler only talks to the connector
     m_logicCallbacks->Connect( c, igtlioConnector::ConnectedEvent, this,
-                               SLOT( OnConnectionEstablished( vtkObject *, unsigned long, void *, void * ) ) );
+                               SLOT( OnConnectionEstablished( vtkObject *, unsigned long, void *, void * ) ), nullptr,
+                               0.0, Qt::DirectConnection );
 }
 
 void IbisHardwareIGSIO::OnConnectionEstablished( vtkObject * caller, unsigned long, void *, void * )
@@ -381,6 +417,7 @@ void IbisHardwareIGSIO::OnConnectionEstablished( vtkObject * caller, unsigned lo
 
 void IbisHardwareIGSIO::DisconnectAllServers()
 {
+    QMutexLocker lock( m_acquisitionThread->GetLogicMutex() );
     for( int i = 0; i < m_logic->GetNumberOfConnectors(); ++i )
     {
         m_logic->GetConnector( static_cast<unsigned>( i ) )->Stop();
@@ -411,34 +448,13 @@ TrackerToolState StatusStringToState( const std::string & status )
     return Undefined;
 }
 
-std::string GetMetaData( igtlioDevicePointer dev, const std::string & key )
-{
-    for( igtl::MessageBase::MetaDataMap::const_iterator iter = dev->GetMetaData().begin();
-         iter != dev->GetMetaData().end(); ++iter )
-    {
-        if( iter->first.find( key ) != std::string::npos )
-        {
-            return iter->second.second.c_str();
-        }
-    }
-    return std::string( "" );
-}
-
-TrackerToolState IbisHardwareIGSIO::ComputeToolStatus( igtlioDevicePointer dev, Tool * t )
+TrackerToolState IbisHardwareIGSIO::ComputeToolStatus( Tool * t )
 {
     // First, try to find a status in the metadata
-    std::string statusString = GetMetaData( dev, "Status" );
-    if( !statusString.empty() ) return StatusStringToState( statusString );
+    if( !t->lastStatus.empty() ) return StatusStringToState( t->lastStatus );
 
     // If status is not found in metadata, use timestamps to guess
-    double newTimeStamp   = dev->GetTimestamp();
-    bool timeStampChanged = newTimeStamp > t->lastTimeStamp;
-    double now            = vtkTimerLog::GetUniversalTime();
-    if( timeStampChanged )
-    {
-        t->lastTimeStamp             = newTimeStamp;
-        t->lastTimeStampModifiedTime = now;
-    }
+    double now                           = vtkTimerLog::GetUniversalTime();
     double timeSinceLastTimeStampChanged = now - t->lastTimeStampModifiedTime;
 
     if( timeSinceLastTimeStampChanged < MaxTimeBetweenTransformSamples ) return Ok;
@@ -452,26 +468,8 @@ int IbisHardwareIGSIO::FindToolByName( QString name )
     return -1;
 }
 
-void IbisHardwareIGSIO::AssignDeviceImageToTool( igtlioDevicePointer device, Tool * tool )
+void IbisHardwareIGSIO::AssignImageToTool( vtkImageData * imageContent, Tool * tool )
 {
-    vtkImageData * imageContent = nullptr;
-    if( IsDeviceImage( device ) )
-    {
-        igtlioImageDevicePointer imageDev = igtlioImageDevice::SafeDownCast( device );
-        if( !( imageDev->GetContent().image == nullptr ) )
-        {
-            imageContent = imageDev->GetContent().image;
-            // OpenIGTLink specifications has origin as center of image
-            double origin[3] = { 0., 0., 0. };
-            imageContent->SetOrigin( origin );
-        }
-    }
-    else if( IsDeviceVideo( device ) )
-    {
-        igtlioVideoDevicePointer videoDev = igtlioVideoDevice::SafeDownCast( device );
-        imageContent                      = videoDev->GetContent().image;
-    }
-
     if( tool->sceneObject->IsA( "CameraObject" ) )
     {
         vtkSmartPointer<CameraObject> cam = CameraObject::SafeDownCast( tool->sceneObject );
@@ -15,12 +15,12 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include "configio.h"
 #include "hardwaremodule.h"
+#include "igsioacquisitionthread.h"
 
 class igtlioLogic;
 class igtlioConnector;
 
 class QMenu;
-class qIGTLIOLogicController;
 class qIGTLIOClientWidget;
 class PlusServerInterface;
 class vtkEventQtSlotConnect;
@@ -87,8 +87,8 @@ private slots:
     void OnSettingsWidgetClosed();
     void OpenConfigFileWidget();
     void OnConfigFileWidgetClosed();
-    void OnDeviceNew( vtkObject *, unsigned long, void *, void * );
-    void OnDeviceRemoved( vtkObject *, unsigned long, void *, void * );
+    void OnDeviceNew( igtlioDevicePointer device );
+    void OnDeviceRemoved( igtlioDevicePointer device );
     void OnConnectionEstablished( vtkObject *, unsigned long, void *, void * );
 
 protected:
@@ -104,6 +104,7 @@ protected:
     {
         Tool()
         {
+            acquisitionChannel        = -1;
             lastTimeStamp             = 0.0;
             lastTimeStampModifiedTime = 0.0;
         }
@@ -111,18 +112,21 @@ protected:
         vtkSmartPointer<PolyDataObject> toolModel;
         igtlioDevicePointer transformDevice;
         igtlioDevicePointer imageDevice;
+        int acquisitionChannel;  // Channel of the acquisition thread that samples the devices
 
         // timestamps used to compute tool status when not in Metadata
         double lastTimeStamp;              // The timestamp of the last message we received
         double lastTimeStampModifiedTime;  // The last time the timestamp has changed
+        std::string lastStatus;            // Status found in the metadata of the last message
     };
     typedef QList<Tool *> toolList;
     toolList m_tools;
 
     // Utility functions
-    TrackerToolState ComputeToolStatus( igtlioDevicePointer dev, Tool * t );
+    TrackerToolState ComputeToolStatus( Tool * t );
     int FindToolByName( QString name );
-    void AssignDeviceImageToTool( igtlioDevicePointer device, Tool * tool );
+    void ApplySampleToTool( IGSIOAcquisitionThread::Sample & sample, Tool * tool );
+    void AssignImageToTool( vtkImageData * image, Tool * tool );
     TrackedSceneObject * InstanciateSceneObjectFromType( QString objectName, QString objectType );
     vtkSmartPointer<PolyDataObject> InstanciateToolModel( QString filename );
     void ReadToolConfig( QString filename, vtkSmartPointer<TrackedSceneObject> tool );
@@ -138,7 +142,10 @@ protected:
     vtkSmartPointer<igtlioLogic> m_logic;
     vtkSmartPointer<vtkEventQtSlotConnect> m_logicCallbacks;
     QList<vtkSmartPointer<PlusServerInterface> > m_plusLaunchers;
-    qIGTLIOLogicController * m_logicController;
+
+    // Polls the logic and samples the tool devices independently of the GUI clock
+    IGSIOAcquisitionThread * m_acquisitionThread;
+    vtkSmartPointer<vtkMatrix4x4> m_sampleMatrix;
 
     bool m_autoStartLastConfig;
 
@@ -0,0 +1,200 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "igsioacquisitionthread.h"
+
+#include <igtlioImageConverter.h>
+#include <igtlioImageDevice.h>
+#include <igtlioLogic.h>
+#include <igtlioTransformConverter.h>
+#include <igtlioTransformDevice.h>
+#include <igtlioVideoConverter.h>
+#include <igtlioVideoDevice.h>
+#include <vtkEventQtSlotConnect.h>
+#include <vtkMatrix4x4.h>
+
+#include <QMutexLocker>
+
+#include "instrumentation.h"
+
+static std::string GetMetaData( igtlioDevice * dev, const std::string & key )
+{
+    for( igtl::MessageBase::MetaDataMap::const_iterator iter = dev->GetMetaData().begin();
+         iter != dev->GetMetaData().end(); ++iter )
+    {
+        if( iter->first.find( key ) != std::string::npos )
+        {
+            return iter->second.second.c_str();
+        }
+    }
+    return std::string( "" );
+}
+
+IGSIOAcquisitionThread::IGSIOAcquisitionThread( igtlioLogic * logic, QObject * parent )
+    : QThread( parent ),
+      m_stopRequested( false ),
+      m_paused( false ),
+      m_pollingPeriod( 1000 ),
+      m_numberOfDroppedSamples( 0 )
+{
+    qRegisterMetaType<igtlioDevicePointer>( "igtlioDevicePointer" );
+    setObjectName( "IGSIO acquisition" );
+
+    m_logic          = logic;
+    m_logicCallbacks = vtkSmartPointer<vtkEventQtSlotConnect>::New();
+
+    // Device events are fired from PeriodicProcess in the acquisition thread. The slots have
+    // to run there too, the device could be gone by the time a queued call is executed.
+    m_logicCallbacks->Connect( m_logic, igtlioLogic::NewDeviceEvent, this,
+                               SLOT( OnDeviceNew( vtkObject *, unsigned long, void *, void * ) ), nullptr, 0.0,
+                               Qt::DirectConnection );
+    m_logicCallbacks->Connect( m_logic, igtlioLogic::RemovedDeviceEvent, this,
+                               SLOT( OnDeviceRemoved( vtkObject *, unsigned long, void *, void * ) ), nullptr, 0.0,
+                               Qt::DirectConnection );
+}
+
+IGSIOAcquisitionThread::~IGSIOAcquisitionThread()
+{
+    Stop();
+    wait();
+    m_logicCallbacks->Disconnect();
+}
+
+int IGSIOAcquisitionThread::AddChannel()
+{
+    QMutexLocker lock( &m_logicMutex );
+    m_channels.push_back( std::unique_ptr<Channel>( new Channel ) );
+    return static_cast<int>( m_channels.size() ) - 1;
+}
+
+void IGSIOAcquisitionThread::SetChannelDevices( int channel, igtlioDevicePointer transformDevice,
+                                                igtlioDevicePointer imageDevice )
+{
+    QMutexLocker lock( &m_logicMutex );
+    Q_ASSERT( channel >= 0 && channel < static_cast<int>( m_channels.size() ) );
+    m_channels[channel]->transformDevice = transformDevice;
+    m_channels[channel]->imageDevice     = imageDevice;
+}
+
+void IGSIOAcquisitionThread::ClearChannels()
+{
+    QMutexLocker lock( &m_logicMutex );
+    m_channels.clear();
+}
+
+bool IGSIOAcquisitionThread::PopSample( int channel, Sample & sample )
+{
+    Q_ASSERT( channel >= 0 && channel < static_cast<int>( m_channels.size() ) );
+    return m_channels[channel]->samples.Pop( sample );
+}
+
+void IGSIOAcquisitionThread::OnDeviceNew( vtkObject *, unsigned long, void *, void * callData )
+{
+    // The smart pointer keeps the device alive until the signal has been delivered
+    igtlioDevicePointer device = reinterpret_cast<igtlioDevice *>( callData );
+    emit DeviceAdded( device );
+}
+
+void IGSIOAcquisitionThread::OnDeviceRemoved( vtkObject *, unsigned long, void *, void * callData )
+{
+    igtlioDevicePointer device = reinterpret_cast<igtlioDevice *>( callData );
+    emit DeviceRemoved( device );
+}
+
+void IGSIOAcquisitionThread::SetPaused( bool paused )
+{
+    // Wait for the current iteration of the thread to finish before the caller uses the logic
+    QMutexLocker lock( &m_logicMutex );
+    m_paused = paused;
+}
+
+void IGSIOAcquisitionThread::ProcessLogic()
+{
+    IBIS_INSTRUMENT_SCOPE( "IGSIO acquisition" );
+    QMutexLocker lock( &m_logicMutex );
+    m_logic->PeriodicProcess();
+    CaptureSamples();
+}
+
+void IGSIOAcquisitionThread::run()
+{
+    while( !m_stopRequested )
+    {
+        {
+            // The flag is checked under the lock, SetPaused( true ) returns after the last iteration
+            QMutexLocker lock( &m_logicMutex );
+            if( !m_paused ) ProcessLogic();
+        }
+        usleep( static_cast<unsigned long>( m_pollingPeriod ) );
+    }
+}
+
+void IGSIOAcquisitionThread::CaptureSamples()
+{
+    for( size_t i = 0; i < m_channels.size(); ++i )
+    {
+        Channel * channel = m_channels[i].get();
+        if( channel->transformDevice || channel->imageDevice ) CaptureSample( channel );
+    }
+}
+
+void IGSIOAcquisitionThread::CaptureSample( Channel * channel )
+{
+    // A new sample is produced only when the device providing the pose (or image if there is no pose) is updated
+    igtlioDevice * clockDevice = channel->transformDevice ? channel->transformDevice : channel->imageDevice;
+    if( clockDevice->GetMTime() <= channel->lastModifiedTime ) return;
+    channel->lastModifiedTime = clockDevice->GetMTime();
+
+    Sample sample;
+    sample.timestamp = clockDevice->GetTimestamp();
+
+    if( igtlioDevice * dev = channel->transformDevice )
+    {
+        vtkMatrix4x4 * matrix = nullptr;
+        if( dev->GetDeviceType() == igtlioImageConverter::GetIGTLTypeName() )
+            matrix = igtlioImageDevice::SafeDownCast( dev )->GetContent().transform;
+        else if( dev->GetDeviceType() == igtlioTransformConverter::GetIGTLTypeName() )
+            matrix = igtlioTransformDevice::SafeDownCast( dev )->GetContent().transform;
+        if( matrix )
+        {
+            vtkMatrix4x4::DeepCopy( sample.matrix, matrix );
+            sample.hasTransform = true;
+        }
+        sample.status = GetMetaData( dev, "Status" );
+    }
+
+    if( igtlioDevice * dev = channel->imageDevice )
+    {
+        // The device content is overwritten by the next PeriodicProcess, the GUI gets its own copy
+        vtkImageData * content = nullptr;
+        bool centeredOrigin    = false;
+        if( dev->GetDeviceType() == igtlioImageConverter::GetIGTLTypeName() )
+        {
+            content        = igtlioImageDevice::SafeDownCast( dev )->GetContent().image;
+            centeredOrigin = true;
+        }
+        else if( dev->GetDeviceType() == igtlioVideoConverter::GetIGTLTypeName() )
+            content = igtlioVideoDevice::SafeDownCast( dev )->GetContent().image;
+        if( content )
+        {
+            sample.image = vtkSmartPointer<vtkImageData>::New();
+            sample.image->DeepCopy( content );
+            // OpenIGTLink specifications has origin as center of image
+            if( centeredOrigin ) sample.image->SetOrigin( 0.0, 0.0, 0.0 );
+        }
+    }
+
+    if( !channel->samples.Push( std::move( sample ) ) )
+    {
+        ++m_numberOfDroppedSamples;
+        static const int droppedNameId = Instrumentation::GetInstance().RegisterName( "IGSIO dropped samples" );
+        Instrumentation::GetInstance().AddCounter( droppedNameId, m_numberOfDroppedSamples );
+    }
+}
@@ -0,0 +1,158 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef IGSIOACQUISITIONTHREAD_H
+#define IGSIOACQUISITIONTHREAD_H
+
+#include <igtlioDevice.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include <QRecursiveMutex>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+class igtlioLogic;
+class vtkEventQtSlotConnect;
+
+// Description:
+// Bounded lock-free queue with exactly one producer thread and one consumer thread.
+// Push returns false when the queue is full, the item is then dropped by the producer.
+template <class T, unsigned int Capacity>
+class IGSIOSampleRing
+{
+    static_assert( ( Capacity & ( Capacity - 1 ) ) == 0, "Capacity must be a power of 2" );
+
+public:
+    IGSIOSampleRing() : m_head( 0 ), m_tail( 0 ) {}
+
+    // Producer side
+    bool Push( T && item )
+    {
+        unsigned int head = m_head.load( std::memory_order_relaxed );
+        if( head - m_tail.load( std::memory_order_acquire ) == Capacity ) return false;
+        m_items[head & ( Capacity - 1 )] = std::move( item );
+        m_head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side
+    bool Pop( T & item )
+    {
+        unsigned int tail = m_tail.load( std::memory_order_relaxed );
+        if( tail == m_head.load( std::memory_order_acquire ) ) return false;
+        item = std::move( m_items[tail & ( Capacity - 1 )] );
+        m_tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+private:
+    T m_items[Capacity];
+    std::atomic<unsigned int> m_head;
+    std::atomic<unsigned int> m_tail;
+};
+
+// Description:
+// Runs the OpenIGTLinkIO logic (igtlioLogic::PeriodicProcess) in its own thread, at a rate that
+// does not depend on the load of the GUI thread. Each channel corresponds to a tool and watches
+// a transform device and/or an image device. Every time the content of a channel changes, a
+// sample with a copy of the pose, the status and the image is queued in the channel's ring.
+// The GUI thread pops samples in HardwareModule::Update().
+// igtlioLogic events are fired by the acquisition thread: device creation and removal are
+// forwarded with the DeviceAdded/DeviceRemoved signals (queued to the receiver's thread).
+// Any other access to the logic from another thread has to be done while holding GetLogicMutex().
+// Code that can not lock the mutex, like qIGTLIOClientWidget, can only use the logic while the
+// thread is paused (SetPaused): the owner of the logic then calls ProcessLogic() from its own thread.
+class IGSIOAcquisitionThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Sample
+    {
+        Sample() : timestamp( 0.0 ), hasTransform( false ) {}
+        double timestamp;
+        bool hasTransform;
+        double matrix[16];
+        std::string status;  // Status found in device metadata, empty if none
+        vtkSmartPointer<vtkImageData> image;
+    };
+
+    // About 2.5 secs of data at 100 Hz
+    static const unsigned int SampleRingCapacity = 256;
+
+    IGSIOAcquisitionThread( igtlioLogic * logic, QObject * parent = nullptr );
+    ~IGSIOAcquisitionThread();
+
+    void SetPollingPeriod( int microseconds ) { m_pollingPeriod = microseconds; }
+    int GetPollingPeriod() { return m_pollingPeriod; }
+
+    // Ask the thread to finish, call wait() after that.
+    void Stop() { m_stopRequested = true; }
+
+    QRecursiveMutex * GetLogicMutex() { return &m_logicMutex; }
+
+    // While paused, the thread does not touch the logic and ProcessLogic() has to be called by
+    // the owner. The logic events are then fired in the thread calling ProcessLogic().
+    void SetPaused( bool paused );
+    bool IsPaused() { return m_paused; }
+    void ProcessLogic();
+
+    // Channels are created, modified and cleared by the consumer thread only
+    int AddChannel();
+    void SetChannelDevices( int channel, igtlioDevicePointer transformDevice, igtlioDevicePointer imageDevice );
+    void ClearChannels();
+
+    // Returns false if there is no new sample for this channel
+    bool PopSample( int channel, Sample & sample );
+
+    // Number of samples dropped because the GUI thread did not pop them fast enough
+    unsigned int GetNumberOfDroppedSamples() { return m_numberOfDroppedSamples; }
+
+signals:
+
+    void DeviceAdded( igtlioDevicePointer device );
+    void DeviceRemoved( igtlioDevicePointer device );
+
+private slots:
+
+    void OnDeviceNew( vtkObject *, unsigned long, void *, void * );
+    void OnDeviceRemoved( vtkObject *, unsigned long, void *, void * );
+
+protected:
+    void run() override;
+
+    struct Channel
+    {
+        Channel() : lastModifiedTime( 0 ) {}
+        igtlioDevicePointer transformDevice;
+        igtlioDevicePointer imageDevice;
+        vtkMTimeType lastModifiedTime;
+        IGSIOSampleRing<Sample, SampleRingCapacity> samples;
+    };
+
+    void CaptureSamples();
+    void CaptureSample( Channel * channel );
+
+    vtkSmartPointer<igtlioLogic> m_logic;
+    vtkSmartPointer<vtkEventQtSlotConnect> m_logicCallbacks;
+    QRecursiveMutex m_logicMutex;
+    std::vector<std::unique_ptr<Channel> > m_channels;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_paused;
+    std::atomic<int> m_pollingPeriod;
+    std::atomic<unsigned int> m_numberOfDroppedSamples;
+};
+
+#endif
@@ -14,6 +14,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkClipPolyData.h>
 #include <vtkCutter.h>
 #include <vtkDoubleArray.h>
+#include <vtkMNIOBJWriter.h>
 #include <vtkPassThrough.h>
 #include <vtkPlane.h>
 #include <vtkPlanes.h>
@@ -129,11 +130,22 @@ void AbstractPolyDataObject::Serialize( Serializer * ser )
     }
 }
 
-void AbstractPolyDataObject::SavePolyData( QString & fileName )
+void AbstractPolyDataObject::SavePolyData( QString & fileName, bool binary )
 {
+    if( fileName.endsWith( ".obj", Qt::CaseInsensitive ) )
+    {
+        vtkSmartPointer<vtkMNIOBJWriter> writer = vtkSmartPointer<vtkMNIOBJWriter>::New();
+        writer->SetFileName( fileName.toUtf8().data() );
+        writer->SetInputData( this->PolyData );
+        writer->GetProperty()->DeepCopy( this->Property );
+        writer->SetBinary( binary );
+        writer->Write();
+        return;
+    }
     vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
     writer->SetFileName( fileName.toUtf8().data() );
     writer->SetInputData( this->PolyData );
+    if( binary ) writer->SetFileTypeToBinary();
     writer->Update();
     writer->Write();
 }
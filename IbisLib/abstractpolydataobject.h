@@ -103,8 +103,8 @@ public:
     void SetClippingPlanesOrientation( int plane, bool positive );
     /** Get the orientation of clipping planes. */
     bool GetClippingPlanesOrientation( int plane );
-    /** Save PolyData in a file. */
-    void SavePolyData( QString & fileName );
+    /** Save PolyData in a file, MNI .obj if the file name ends with .obj, vtk otherwise. */
+    void SavePolyData( QString & fileName, bool binary = false );
 
 public slots:
 
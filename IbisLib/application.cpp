@@ -11,8 +11,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "application.h"
 
 #include <QApplication>
+#include <QDialog>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QLibrary>
 #include <QMenu>
@@ -23,6 +25,8 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QRect>
 #include <QSettings>
 #include <QTimer>
+#include <algorithm>
+#include <iostream>
 
 #include "cameraobject.h"
 #include "filereader.h"
@@ -35,12 +39,14 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "ibisplugin.h"
 #include "ibispreferences.h"
 #include "imageobject.h"
+#include "instrumentation.h"
 #include "lookuptablemanager.h"
 #include "mainwindow.h"
 #include "objectplugininterface.h"
 #include "pointerobject.h"
 #include "pointsobject.h"
 #include "polydataobject.h"
+#include "renderscheduler.h"
 #include "scenemanager.h"
 #include "sceneobject.h"
 #include "serializer.h"
@@ -95,6 +101,9 @@ void ApplicationSettings::LoadSettings( QSettings & settings )
     VolumeRendererEnabled                  = settings.value( "VolumeRendererEnabled", false ).toBool();
     ShowMINCConversionWarning              = settings.value( "ShowMINCConversionWarning", true ).toBool();
     UpdateFrequency                        = settings.value( "UpdateFrequency", 15.0 ).toDouble();
+    RenderFrameRate                        = settings.value( "RenderFrameRate", 60.0 ).toDouble();
+    TractogramStreamlineStep               = settings.value( "TractogramStreamlineStep", 1 ).toInt();
+    TractogramPointStep                    = settings.value( "TractogramPointStep", 1 ).toInt();
 }
 
 void ApplicationSettings::SaveSettings( QSettings & settings )
@@ -125,55 +134,72 @@ void ApplicationSettings::SaveSettings( QSettings & settings )
     settings.setValue( "TripleCutPlaneDisplayInterpolationType", TripleCutPlaneDisplayInterpolationType );
     settings.setValue( "ShowMINCConversionWarning", ShowMINCConversionWarning );
     settings.setValue( "UpdateFrequency", UpdateFrequency );
+    settings.setValue( "RenderFrameRate", RenderFrameRate );
+    settings.setValue( "TractogramStreamlineStep", TractogramStreamlineStep );
+    settings.setValue( "TractogramPointStep", TractogramPointStep );
 }
 
 Application::Application()
 {
-    m_mainWindow                = nullptr;
-    m_sceneManager              = nullptr;
-    m_viewerOnly                = false;
-    m_fileReader                = nullptr;
-    m_fileOpenProgressDialog    = nullptr;
-    m_progressDialogUpdateTimer = nullptr;
-    m_ibisAPI                   = nullptr;
-    m_updateManager             = nullptr;
-    m_lookupTableManager        = nullptr;
-    m_preferences               = nullptr;
+    m_mainWindow                 = nullptr;
+    m_sceneManager               = nullptr;
+    m_viewerOnly                 = false;
+    m_headless                   = false;
+    m_modalDialogWatcher         = nullptr;
+    m_quitAfterStartupOperations = false;
+    m_fileReader                 = nullptr;
+    m_fileOpenProgressDialog     = nullptr;
+    m_progressDialogUpdateTimer  = nullptr;
+    m_ibisAPI                    = nullptr;
+    m_updateManager              = nullptr;
+    m_renderScheduler            = nullptr;
+    m_lookupTableManager         = nullptr;
+    m_preferences                = nullptr;
 }
 
 void Application::SetMainWindow( MainWindow * mw )
 {
     m_mainWindow = mw;
     // Create UI elements from the plugins
+    StartupProfiler::ScopedSection section( &m_startupProfiler, "Plugins user interface" );
     m_mainWindow->CreatePluginsUi();
 }
 
 void Application::LoadWindowSettings()
 {
     Q_ASSERT( m_mainWindow );
+    StartupProfiler::ScopedSection section( &m_startupProfiler, "Window settings" );
     QSettings settings( m_appOrganisation, m_appName );
     m_mainWindow->LoadSettings( settings );
     // Apply settings to scene
     this->ApplyApplicationSettings();
 }
 
-void Application::Init( bool viewerOnly )
+void Application::Init( bool viewerOnly, bool headless )
 {
-    m_viewerOnly = viewerOnly;
+    m_viewerOnly = viewerOnly || headless;
+    m_headless   = headless;
 
     // Create the object that will manage the 3D scene in the visualizer
+    m_startupProfiler.BeginSection( "Scene manager" );
     m_sceneManager = SceneManager::New();
+    m_startupProfiler.EndSection();
 
     // Load application settings
+    m_startupProfiler.BeginSection( "Application settings" );
     QSettings settings( m_appOrganisation, m_appName );
     m_settings.LoadSettings( settings );
 
     // Load custom paths and other preferences
     m_preferences = new IbisPreferences;
     m_preferences->LoadSettings( settings );
+    m_startupProfiler.EndSection();
 
     m_updateManager = UpdateManager::New();
 
+    m_renderScheduler = new RenderScheduler;
+    m_renderScheduler->SetTargetFrameRate( m_settings.RenderFrameRate );
+
     m_lookupTableManager = new LookupTableManager;
 
     // Get instance of the hardware module
@@ -189,6 +215,14 @@ void Application::Init( bool viewerOnly )
 
     // Create programming interface for plugins
     m_ibisAPI = new IbisAPI( this );
+
+    // Nobody can answer message boxes in headless mode: print and dismiss them
+    if( m_headless )
+    {
+        m_modalDialogWatcher = new QTimer( this );
+        connect( m_modalDialogWatcher, SIGNAL( timeout() ), this, SLOT( DismissModalDialogs() ) );
+        m_modalDialogWatcher->start( 100 );
+    }
 }
 
 Application::~Application()
@@ -206,6 +240,7 @@ Application::~Application()
 
     delete m_ibisAPI;
     m_sceneManager->Destroy();
+    delete m_renderScheduler;
 
     delete m_lookupTableManager;
 
@@ -280,7 +315,7 @@ void Application::SaveSettings()
     QSettings settings( m_appOrganisation, m_appName );
     m_settings.SaveSettings( settings );
     m_preferences->SaveSettings( settings );
-    m_mainWindow->SaveSettings( settings );
+    if( m_mainWindow ) m_mainWindow->SaveSettings( settings );
 
     // Save plugins settings
     settings.beginGroup( "Plugins" );
@@ -293,13 +328,13 @@ void Application::SaveSettings()
     settings.endGroup();
 }
 
-void Application::CreateInstance( bool viewerOnly )
+void Application::CreateInstance( bool viewerOnly, bool headless )
 {
     // Make sure the application hasn't been created yet
     Q_ASSERT( !m_uniqueInstance );
 
     m_uniqueInstance = new Application;
-    m_uniqueInstance->Init( viewerOnly );
+    m_uniqueInstance->Init( viewerOnly, headless );
 }
 
 void Application::DeleteInstance()
@@ -330,6 +365,13 @@ void Application::OnStartMainLoop()
     m_sceneManager->OnStartMainLoop();
 }
 
+void Application::FinishStartup()
+{
+    QString logFile = GetConfigDirectory() + "startup.log";
+    if( !m_startupProfiler.Finish( logFile ) )
+        std::cerr << "Can't write startup profile to " << logFile.toUtf8().data() << std::endl;
+}
+
 void Application::AddGlobalEventHandler( GlobalEventHandler * h ) { m_globalEventHandlers.push_back( h ); }
 
 void Application::RemoveGlobalEventHandler( GlobalEventHandler * h )
@@ -354,7 +396,11 @@ void Application::InitHardware()
 
     // Init hardware
     foreach( HardwareModule * module, m_hardwareModules )
+    {
+        StartupProfiler::ScopedSection section( &m_startupProfiler, "Hardware " + module->GetPluginName() );
+        ActivatePlugin( module );
         module->Init();
+    }
 
     if( m_hardwareModules.size() > 0 )
     {
@@ -440,6 +486,7 @@ void Application::OpenFiles( OpenFileParams * params, bool addToScene )
     m_fileReader = new FileReader;
     m_fileReader->SetParams( params );
     m_fileReader->SetIbisAPI( m_ibisAPI );
+    m_fileReader->SetTractogramSubsampling( m_settings.TractogramStreamlineStep, m_settings.TractogramPointStep );
     for( int i = 0; i < params->filesParams.size(); ++i )
     {
         OpenFileParams::SingleFileParam & cur = params->filesParams[i];
@@ -469,25 +516,30 @@ void Application::OpenFiles( OpenFileParams * params, bool addToScene )
 
     m_fileReader->start();
 
-    // Create a progress dialog and a timer to update it
-    m_fileOpenProgressDialog    = new QProgressDialog( tr( "" ), tr( "Cancel" ), 0, 100 );
-    m_progressDialogUpdateTimer = new QTimer;
-    connect( m_progressDialogUpdateTimer, SIGNAL( timeout() ), this, SLOT( OpenFilesProgress() ) );
-    m_progressDialogUpdateTimer->start( 100 );
-
-    // Launch the modal progress dialog while reader thread is working
-    m_fileOpenProgressDialog->exec();
-
-    // Stop timer
-    m_progressDialogUpdateTimer->stop();
-    delete m_progressDialogUpdateTimer;
-    m_progressDialogUpdateTimer = nullptr;
+    bool canceled = false;
+    if( !m_headless )
+    {
+        // Create a progress dialog and a timer to update it
+        m_fileOpenProgressDialog    = new QProgressDialog( tr( "" ), tr( "Cancel" ), 0, 100 );
+        m_progressDialogUpdateTimer = new QTimer;
+        connect( m_progressDialogUpdateTimer, SIGNAL( timeout() ), this, SLOT( OpenFilesProgress() ) );
+        m_progressDialogUpdateTimer->start( 100 );
+
+        // Launch the modal progress dialog while reader thread is working
+        m_fileOpenProgressDialog->exec();
+        canceled = m_fileOpenProgressDialog->wasCanceled();
+
+        // Stop timer
+        m_progressDialogUpdateTimer->stop();
+        delete m_progressDialogUpdateTimer;
+        m_progressDialogUpdateTimer = nullptr;
+    }
 
     // Make sure the reading thread finished
     m_fileReader->wait();
 
     // Commit the changes if the operation didn't get cancelled
-    if( !m_fileOpenProgressDialog->wasCanceled() )
+    if( !canceled )
     {
         // Process warnings generated during reading
         const QStringList & warnings = m_fileReader->GetWarnings();
@@ -499,7 +551,7 @@ void Application::OpenFiles( OpenFileParams * params, bool addToScene )
                 message += warnings[i];
                 message += QString( "\n" );
             }
-            QMessageBox::warning( nullptr, "Error", message );
+            this->Warning( "Error", message );
         }
 
         int initialNumberOfImageObjects = GetSceneManager()->GetNumberOfImageObjects();
@@ -661,12 +713,13 @@ QString Application::GetFileNameOpen( const QString & caption, const QString & d
     return filename;
 }
 
-QString Application::GetFileNameSave( const QString & caption, const QString & dir, const QString & filter )
+QString Application::GetFileNameSave( const QString & caption, const QString & dir, const QString & filter,
+                                      QString * selectedFilter )
 {
     Q_ASSERT_X( m_mainWindow, "Application::GetFileNameSave()", "MainWindow was not set" );
-    bool running = PreModalDialog();
-    QString filename =
-        QFileDialog::getSaveFileName( m_mainWindow, caption, dir, filter, nullptr, QFileDialog::DontUseNativeDialog );
+    bool running     = PreModalDialog();
+    QString filename = QFileDialog::getSaveFileName( m_mainWindow, caption, dir, filter, selectedFilter,
+                                                     QFileDialog::DontUseNativeDialog );
     if( running ) PostModalDialog();
     return filename;
 }
@@ -754,11 +807,178 @@ int Application::LaunchModalDialog( QDialog * d )
 
 void Application::Warning( const QString & title, const QString & text )
 {
+    if( m_headless )
+    {
+        std::cerr << title.toUtf8().data() << ": " << text.toUtf8().data() << std::endl;
+        return;
+    }
     bool running = PreModalDialog();
     QMessageBox::warning( m_mainWindow, title, text );
     if( running ) PostModalDialog();
 }
 
+void Application::DismissModalDialogs()
+{
+    QWidget * modal = QApplication::activeModalWidget();
+    if( !modal ) return;
+    QMessageBox * messageBox = qobject_cast<QMessageBox *>( modal );
+    QString text             = messageBox ? messageBox->text() : QString( "dialog dismissed" );
+    std::cerr << modal->windowTitle().toUtf8().data() << ": " << text.toUtf8().data() << std::endl;
+    QDialog * dialog = qobject_cast<QDialog *>( modal );
+    if( dialog )
+        dialog->reject();
+    else
+        modal->close();
+}
+
+int Application::RunBatch( const QString & sceneFile, const QStringList & dataFiles, const QStringList & operations,
+                           const QString & outputScene )
+{
+    Q_ASSERT_X( m_headless, "Application::RunBatch()", "Batch processing needs a headless application" );
+
+    if( !sceneFile.isEmpty() )
+    {
+        if( !QFileInfo( sceneFile ).isReadable() )
+        {
+            std::cerr << "Error: can't read scene " << sceneFile.toUtf8().data() << std::endl;
+            return BatchLoadFailed;
+        }
+        QString fileName( sceneFile );
+        if( !m_sceneManager->LoadScene( fileName, false ) )
+        {
+            std::cerr << "Error: can't load scene " << sceneFile.toUtf8().data() << std::endl;
+            return BatchLoadFailed;
+        }
+    }
+
+    if( !dataFiles.isEmpty() )
+    {
+        OpenFileParams params;
+        params.SetAllFileNames( dataFiles );
+        this->OpenFiles( &params );
+        for( int i = 0; i < params.filesParams.size(); ++i )
+        {
+            if( !params.filesParams[i].loadedObject )
+            {
+                std::cerr << "Error: can't load " << params.filesParams[i].fileName.toUtf8().data() << std::endl;
+                return BatchLoadFailed;
+            }
+        }
+    }
+
+    int status = RunOperations( operations );
+    if( status != BatchSuccess ) return status;
+
+    if( !outputScene.isEmpty() )
+    {
+        QApplication::processEvents();
+        QString fileName( outputScene );
+        m_sceneManager->SaveScene( fileName );
+        if( !QFileInfo::exists( fileName ) )
+        {
+            std::cerr << "Error: can't save scene " << fileName.toUtf8().data() << std::endl;
+            return BatchSaveFailed;
+        }
+    }
+    return BatchSuccess;
+}
+
+int Application::RunOperations( const QStringList & operations )
+{
+    for( int i = 0; i < operations.size(); ++i )
+    {
+        // Deliver notifications queued by the previous step, there is no main loop in batch mode
+        QApplication::processEvents();
+
+        // Plugin.Operation[:name=value,name=value...]
+        QString pluginAndOperation = operations[i].section( ':', 0, 0 );
+        QString pluginName         = pluginAndOperation.section( '.', 0, 0 );
+        QString operationName      = pluginAndOperation.section( '.', 1 );
+        if( pluginName.isEmpty() || operationName.isEmpty() )
+        {
+            std::cerr << "Error: invalid operation " << operations[i].toUtf8().data() << std::endl;
+            return BatchInvalidArguments;
+        }
+        QMap<QString, QString> args;
+        QStringList argList = operations[i].section( ':', 1 ).split( ',', Qt::SkipEmptyParts );
+        for( int a = 0; a < argList.size(); ++a )
+        {
+            int separator = argList[a].indexOf( '=' );
+            if( separator < 1 )
+            {
+                std::cerr << "Error: expecting name=value, got " << argList[a].toUtf8().data() << std::endl;
+                return BatchInvalidArguments;
+            }
+            args[argList[a].left( separator ).trimmed()] = argList[a].mid( separator + 1 ).trimmed();
+        }
+
+        std::cout << "Running " << pluginAndOperation.toUtf8().data() << "..." << std::endl;
+        QElapsedTimer timer;
+        timer.start();
+        if( !this->RunBatchOperation( pluginName, operationName, args ) )
+        {
+            std::cerr << "Error: " << pluginAndOperation.toUtf8().data() << " failed" << std::endl;
+            return BatchOperationFailed;
+        }
+        std::cout << pluginAndOperation.toUtf8().data() << " done in " << timer.elapsed() / 1000.0 << " secs"
+                  << std::endl;
+    }
+    return BatchSuccess;
+}
+
+void Application::SetStartupOperations( const QStringList & operations, bool quitWhenDone )
+{
+    m_startupOperations          = operations;
+    m_quitAfterStartupOperations = quitWhenDone;
+
+    // Unattended run: print and dismiss message boxes like in headless mode, from the initial scene load on
+    if( m_quitAfterStartupOperations && !m_modalDialogWatcher )
+    {
+        m_modalDialogWatcher = new QTimer( this );
+        connect( m_modalDialogWatcher, SIGNAL( timeout() ), this, SLOT( DismissModalDialogs() ) );
+        m_modalDialogWatcher->start( 100 );
+    }
+}
+
+void Application::RunStartupOperations()
+{
+    if( m_startupOperations.isEmpty() && !m_quitAfterStartupOperations ) return;
+
+    int status = RunOperations( m_startupOperations );
+    m_startupOperations.clear();
+    if( m_quitAfterStartupOperations ) QApplication::exit( status );
+}
+
+bool Application::CancelStartupOperations( int status )
+{
+    m_startupOperations.clear();
+    if( !m_quitAfterStartupOperations ) return false;
+    m_quitAfterStartupOperations = false;
+    QApplication::exit( status );
+    return true;
+}
+
+bool Application::RunBatchOperation( const QString & pluginName, const QString & operation,
+                                     const QMap<QString, QString> & args )
+{
+    IbisPlugin * plugin = GetPluginByName( pluginName );
+    if( !plugin )
+    {
+        this->Warning( "Batch", QString( "Unknown plugin %1" ).arg( pluginName ) );
+        return false;
+    }
+    if( !plugin->GetBatchOperations().contains( operation ) )
+    {
+        QString supported = plugin->GetBatchOperations().join( ", " );
+        this->Warning( "Batch", QString( "Plugin %1 has no operation %2. Supported operations: %3" )
+                                    .arg( pluginName )
+                                    .arg( operation )
+                                    .arg( supported.isEmpty() ? QString( "none" ) : supported ) );
+        return false;
+    }
+    return plugin->RunBatchOperation( operation, args );
+}
+
 void Application::OpenFilesProgress()
 {
     double progress = m_fileReader->GetProgress();
@@ -778,8 +998,13 @@ void Application::OpenFilesProgress()
 
 void Application::TickIbisClock()
 {
-    foreach( HardwareModule * module, m_hardwareModules )
-        module->Update();
+    {
+        IBIS_INSTRUMENT_SCOPE( "Hardware update" );
+        foreach( HardwareModule * module, m_hardwareModules )
+            module->Update();
+    }
+    // Propagate the transforms modified by hardware before clients react to the tick
+    m_sceneManager->UpdateWorldTransforms();
     emit IbisClockTick();
 }
 
@@ -795,8 +1020,21 @@ void Application::SetUpdateFrequency( double fps )
     m_updateManager->SetUpdatePeriod( static_cast<int>( 1000.0 / fps ) );
 }
 
+void Application::SetRenderFrameRate( double fps )
+{
+    m_settings.RenderFrameRate = fps;
+    m_renderScheduler->SetTargetFrameRate( fps );
+}
+
+void Application::SetTractogramSubsampling( int streamlineStep, int pointStep )
+{
+    m_settings.TractogramStreamlineStep = std::max( 1, streamlineStep );
+    m_settings.TractogramPointStep      = std::max( 1, pointStep );
+}
+
 void Application::LoadPlugins()
 {
+    StartupProfiler::ScopedSection pluginsSection( &m_startupProfiler, "Plugins" );
     QSettings settings( m_appOrganisation, m_appName );
     settings.beginGroup( "Plugins" );
     foreach( QObject * plugin, QPluginLoader::staticInstances() )
@@ -804,14 +1042,24 @@ void Application::LoadPlugins()
         IbisPlugin * p = qobject_cast<IbisPlugin *>( plugin );
         if( p )
         {
+            // Only settings are needed to build the plugin menus, InitPlugin is called on first use
+            StartupProfiler::ScopedSection section( &m_startupProfiler, "Plugin settings " + p->GetPluginName() );
             p->SetIbisAPI( m_ibisAPI );
             p->BaseLoadSettings( settings );
-            p->InitPlugin();
         }
     }
     settings.endGroup();
 }
 
+void Application::ActivatePlugin( IbisPlugin * p )
+{
+    Q_ASSERT( p );
+    if( p->m_activated ) return;
+    StartupProfiler::ScopedSection section( &m_startupProfiler, "Plugin activation " + p->GetPluginName() );
+    p->m_activated = true;
+    p->InitPlugin();
+}
+
 void Application::SerializePlugins( Serializer * ser )
 {
     ser->BeginSection( "Plugins" );
@@ -820,6 +1068,7 @@ void Application::SerializePlugins( Serializer * ser )
         IbisPlugin * p = qobject_cast<IbisPlugin *>( plugin );
         if( p )
         {
+            if( ser->IsReader() ) ActivatePlugin( p );
             ::Serialize( ser, p->GetPluginName().toUtf8().data(), p );
         }
     }
@@ -838,6 +1087,7 @@ IbisPlugin * Application::GetPluginByName( QString name )
             break;
         }
     }
+    if( ret ) ActivatePlugin( ret );
     return ret;
 }
 
@@ -880,6 +1130,7 @@ SceneObject * Application::GetGlobalObjectInstance( const QString & className )
         IbisPlugin * p = qobject_cast<IbisPlugin *>( plugin );
         if( p && p->GetPluginType() == IbisPluginTypeGlobalObject )
         {
+            ActivatePlugin( p );
             GlobalObjectPluginInterface * objectPlugin = GlobalObjectPluginInterface::SafeDownCast( p );
             SceneObject * globalObj                    = objectPlugin->GetGlobalObjectInstance();
             if( globalObj->IsA( className.toUtf8().data() ) )
@@ -899,6 +1150,7 @@ void Application::GetAllGlobalObjectInstances( QList<SceneObject *> & allInstanc
         IbisPlugin * p = qobject_cast<IbisPlugin *>( plugin );
         if( p && p->GetPluginType() == IbisPluginTypeGlobalObject )
         {
+            ActivatePlugin( p );
             GlobalObjectPluginInterface * objectPlugin = GlobalObjectPluginInterface::SafeDownCast( p );
             allInstances.push_back( objectPlugin->GetGlobalObjectInstance() );
         }
@@ -959,6 +1211,9 @@ void Application::GetAllGeneratorPlugins( QList<GeneratorPluginInterface *> & al
 
 QProgressDialog * Application::StartProgress( int max, const QString & caption )
 {
+    // There is no dialog in headless mode. UpdateProgress and StopProgress accept a null pointer, code that uses
+    // the dialog directly (e.g. setLabelText, wasCanceled) must check it if it can run from a batch operation.
+    if( m_headless ) return nullptr;
     QProgressDialog * progressDialog = new QProgressDialog( caption, tr( "Cancel" ), 0, max );
     progressDialog->setLabelText( caption );
     progressDialog->show();
@@ -983,6 +1238,11 @@ void Application::UpdateProgress( QProgressDialog * progressDialog, int current
 
 void Application::ShowMinc1Warning( bool cando )
 {
+    if( m_headless )
+    {
+        if( !cando ) std::cerr << "Error: mincconvert not found, MINC1 files can't be read." << std::endl;
+        return;
+    }
     QMessageBox msgBox;
     msgBox.setStandardButtons( QMessageBox::Ok );
     if( cando )
@@ -1002,7 +1262,7 @@ void Application::ShowMinc1Warning( bool cando )
     }
 }
 
-void Application::LoadScene( QString fileName ) { m_sceneManager->LoadScene( fileName ); }
+bool Application::LoadScene( QString fileName ) { return m_sceneManager->LoadScene( fileName ); }
 
 void Application::SaveScene( QString fileName ) { m_sceneManager->SaveScene( fileName ); }
 
@@ -1021,9 +1281,17 @@ int Application::GetNumberOfComponents( QString filename )
         return false;
     }
     int n = m_fileReader->GetNumberOfComponents( filename );
+    if( !m_fileReader->GetWarnings().isEmpty() ) this->Warning( "Error", m_fileReader->GetWarnings().join( "\n" ) );
     delete m_fileReader;
     return n;
 }
+
+bool Application::GetImageFileInfo( QString filename, ImageFileInfo & info )
+{
+    FileReader reader;
+    return reader.GetImageFileInfo( filename, info );
+}
+
 bool Application::GetGrayFrame( QString filename, IbisItkUnsignedChar3ImageType::Pointer itkImage )
 {
     Q_ASSERT( itkImage );
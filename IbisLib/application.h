@@ -13,21 +13,25 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include <QColor>
 #include <QDockWidget>
+#include <QMap>
 #include <QObject>
 #include <QPoint>
 #include <QSize>
 #include <QString>
+#include <QStringList>
 #include <vector>
 
 #include "globaleventhandler.h"
 #include "ibisitkvtkconverter.h"
 #include "ibistypes.h"
 #include "serializer.h"
+#include "startupprofiler.h"
 
 // forward declarations
 class QSettings;
 class HardwareModule;
 class UpdateManager;
+class RenderScheduler;
 class SceneManager;
 class IbisAPI;
 class SceneObject;
@@ -38,6 +42,7 @@ class ToolPluginInterface;
 class ObjectPluginInterface;
 class GeneratorPluginInterface;
 class OpenFileParams;
+class ImageFileInfo;
 class FileReader;
 class LookupTableManager;
 class QProgressDialog;
@@ -102,7 +107,11 @@ struct ApplicationSettings
     int TripleCutPlaneDisplayInterpolationType;
     bool VolumeRendererEnabled;
     double UpdateFrequency;
+    double RenderFrameRate;
     bool ShowMINCConversionWarning;
+    /** Subsampling of tractograms on load, see FileReader::SetTractogramSubsampling() */
+    int TractogramStreamlineStep;
+    int TractogramPointStep;
     QList<QString> PluginsWithOpenWidget;
     QList<QString> PluginsWithOpenTab;
 };
@@ -115,7 +124,7 @@ class Application : public QObject
 public:
     ~Application();
 
-    static void CreateInstance( bool viewerOnly );
+    static void CreateInstance( bool viewerOnly, bool headless = false );
     static void DeleteInstance();
     /** Get pointer to the unique application instance. */
     static Application & GetInstance();
@@ -161,8 +170,53 @@ public:
     void RemoveToolObjectsFromScene();
     ///@}
 
+    /** @name  Startup Profiling
+     *   @brief Time spent in each startup step, written to startup.log in the config directory.
+     *
+     * */
+    ///@{
+    StartupProfiler * GetStartupProfiler() { return &m_startupProfiler; }
+    /** Write the startup profile, called once the main loop has started and initial files are loaded. */
+    void FinishStartup();
+    ///@}
+
     /** Check if the application is in a viewer mode - no tracking. */
     bool IsViewerOnly() { return m_viewerOnly; }
+    /** Check if the application runs without main window and GL context, see RunBatch. */
+    bool IsHeadless() { return m_headless; }
+
+    /** @name  Batch Processing
+     *   @brief Run plugin operations without user interface.
+     *
+     * */
+    ///@{
+    enum BatchStatus
+    {
+        BatchSuccess = 0,
+        BatchInvalidArguments,
+        BatchLoadFailed,
+        BatchOperationFailed,
+        BatchSaveFailed
+    };
+    /** Load a scene and/or data files, run the operations in order and save the scene.
+     *  Each operation is written as Plugin.Operation[:name=value,name=value...].
+     *  Returns a BatchStatus to be used as exit code, processing stops at the first failure. */
+    int RunBatch( const QString & sceneFile, const QStringList & dataFiles, const QStringList & operations,
+                  const QString & outputScene );
+    /** Parse and run the operations in order, see RunBatch. Returns a BatchStatus. */
+    int RunOperations( const QStringList & operations );
+    /** Operations to run with the user interface once startup is finished (e.g. benchmarks).
+     *  If quitWhenDone is true, the application exits with the BatchStatus of the operations. */
+    void SetStartupOperations( const QStringList & operations, bool quitWhenDone );
+    /** Run the startup operations, called by the main window after the initial scene and files are loaded. */
+    void RunStartupOperations();
+    /** Don't run the startup operations, e.g. when the initial scene can't be loaded. Returns true if the
+     *  application exits with status because quitWhenDone was set. */
+    bool CancelStartupOperations( int status );
+    /** Run operation of the plugin pluginName, see IbisPlugin::RunBatchOperation. */
+    bool RunBatchOperation( const QString & pluginName, const QString & operation,
+                            const QMap<QString, QString> & args );
+    ///@}
 
     /** @name  Version
      *   @brief Information on application and git version.
@@ -205,13 +259,37 @@ public:
     double GetUpdateFrequency() { return GetSettings()->UpdateFrequency; }
     ///@}
 
+    /** @name  Rendering
+     *   @brief Views are rendered by the render scheduler, at most once per frame.
+     *
+     * */
+    ///@{
+    RenderScheduler * GetRenderScheduler() { return m_renderScheduler; }
+    void SetRenderFrameRate( double fps );
+    double GetRenderFrameRate() { return GetSettings()->RenderFrameRate; }
+    ///@}
+
+    /** @name  Tractograms
+     *   @brief Subsampling of the tractograms opened after the call, see FileReader::SetTractogramSubsampling().
+     *
+     * */
+    ///@{
+    void SetTractogramSubsampling( int streamlineStep, int pointStep );
+    int GetTractogramStreamlineStep() { return GetSettings()->TractogramStreamlineStep; }
+    int GetTractogramPointStep() { return GetSettings()->TractogramPointStep; }
+    ///@}
+
     /** @name  Plugins
      *   @brief Plugin  and global objects management.
      *
      * */
     ///@{
+    /** Give plugins access to the API and load their settings. Plugins are activated later, on first use. */
     void LoadPlugins();
+    /** Call InitPlugin the first time a plugin is used, does nothing if the plugin is already activated. */
+    void ActivatePlugin( IbisPlugin * p );
     void SerializePlugins( Serializer * ser );
+    /** Find a plugin by name and activate it. */
     IbisPlugin * GetPluginByName( QString name );
     void ActivatePluginByName( const char * name, bool active );
     ObjectPluginInterface * GetObjectPluginByName( QString className );
@@ -234,6 +312,9 @@ public:
     void SetInitialDataFiles( const QStringList & files ) { m_initialDataFiles = files; }
     /** Get names of data files loaded on application start, typically specified on the command line. */
     const QStringList & GetInitialDataFiles() { return m_initialDataFiles; }
+    /** Set a scene to load when the application starts up, before the initial data files. */
+    void SetInitialScene( const QString & sceneFile ) { m_initialScene = sceneFile; }
+    const QString & GetInitialScene() { return m_initialScene; }
     /** Open any file of a supported format .
      *  Following file types are supported:
      * Minc file: *.mnc *.mnc2 *.mnc.gz *.MNC *.MNC2 *.MNC.GZ;
@@ -241,9 +322,12 @@ public:
      * Object file *.obj PLY file *.ply;
      * Tag file *.tag;
      * VTK file: *.vtk *.vtp;
-     * FIB file *.fib.
+     * Tractogram file *.fib *.trk *.tck.
      */
     void OpenFiles( OpenFileParams * params, bool addToScene = true );
+    /** Read the description of an image from the header of the file, voxels are not read. MINC1 files are described
+     *  only when a converted copy is already cached. */
+    bool GetImageFileInfo( QString filename, ImageFileInfo & info );
     /** Open a transform file, supported format *xfm, and possibly set as a local transform of obj */
     bool OpenTransformFile( const char * filename, SceneObject * obj = 0 );
     /** Open a transform file, supported format *xfm, and store in a 4x4 matrix. */
@@ -280,8 +364,9 @@ public:
     ///@{
     QString GetFileNameOpen( const QString & caption = QString(), const QString & dir = QString(),
                              const QString & filter = QString() );
+    /** selectedFilter, if given, receives the filter chosen by the user. */
     QString GetFileNameSave( const QString & caption = QString(), const QString & dir = QString(),
-                             const QString & filter = QString() );
+                             const QString & filter = QString(), QString * selectedFilter = nullptr );
     QString GetExistingDirectory( const QString & caption = QString(), const QString & dir = QString() );
     bool GetOpenFileSequence( QStringList & filenames, QString extension, const QString & caption, const QString & dir,
                               const QString & filter );
@@ -300,8 +385,8 @@ public:
      *
      * */
     ///@{
-    /** Load saved scene. */
-    void LoadScene( QString fileName );
+    /** Load saved scene. Returns false if the scene can't be loaded, the user has been told why. */
+    bool LoadScene( QString fileName );
     /** Save current scene. */
     void SaveScene( QString fileName );
     ///@}
@@ -325,6 +410,7 @@ public slots:
 private slots:
 
     void OpenFilesProgress();
+    void DismissModalDialogs();
 
 signals:
 
@@ -335,7 +421,7 @@ signals:
     void IbisClockTick();
 
 private:
-    void Init( bool viewerOnly );
+    void Init( bool viewerOnly, bool headless );
     Application();
     static Application * m_uniqueInstance;
 
@@ -355,6 +441,7 @@ private:
     SceneManager * m_sceneManager;
     IbisAPI * m_ibisAPI;
     UpdateManager * m_updateManager;
+    RenderScheduler * m_renderScheduler;
     QList<HardwareModule *> m_hardwareModules;
     LookupTableManager * m_lookupTableManager;
     QList<GlobalEventHandler *> m_globalEventHandlers;
@@ -362,10 +449,19 @@ private:
     ApplicationSettings m_settings;
     IbisPreferences * m_preferences;
 
+    StartupProfiler m_startupProfiler;
+
     // Data file to load when the application starts up (typically specified on the command line)
     QStringList m_initialDataFiles;
+    QString m_initialScene;
+
+    // Operations to run once the main loop has started (typically specified on the command line)
+    QStringList m_startupOperations;
+    bool m_quitAfterStartupOperations;
 
     bool m_viewerOnly;
+    bool m_headless;
+    QTimer * m_modalDialogWatcher;
 
     static const QString m_appName;
     static const QString m_appOrganisation;
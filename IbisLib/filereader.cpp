@@ -12,6 +12,9 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "filereader.h"
 
 #include <itkImageIOFactory.h>
+#include <vtkCellArray.h>
+#include <vtkCellArrayIterator.h>
+#include <vtkCellData.h>
 #include <vtkDataObjectReader.h>
 #include <vtkErrorCode.h>
 #include <vtkEventQtSlotConnect.h>
@@ -19,21 +22,34 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkMNIOBJReader.h>
 #include <vtkOBJReader.h>
 #include <vtkPLYReader.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataReader.h>
 #include <vtkProperty.h>
 #include <vtkSmartPointer.h>
 #include <vtkStructuredPointsReader.h>
 #include <vtkTagReader.h>
+#include <vtkTractogramReader.h>
 #include <vtkTransform.h>
 #include <vtkXMLPolyDataReader.h>
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QProcess>
+#include <QSemaphore>
 #include <QStringList>
+#include <QUuid>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "ibisapi.h"
 #include "imageobject.h"
@@ -46,12 +62,15 @@ const QString FileReader::MINCToolsPathVarName = "MINCToolsDirectory";
 FileReader::FileReader( QObject * parent ) : QThread( parent )
 
 {
-    m_currentFileIndex  = 0;
-    m_progress          = 0.0;
-    m_selfAllocParams   = false;
-    m_params            = nullptr;
-    m_fileProgressEvent = vtkEventQtSlotConnect::New();
-    m_ibisAPI           = nullptr;
+    m_currentFileIndex         = 0;
+    m_progress                 = 0.0;
+    m_numberOfWorkers          = std::max( 1, QThread::idealThreadCount() );
+    m_tractogramStreamlineStep = 1;
+    m_tractogramPointStep      = 1;
+    m_selfAllocParams          = false;
+    m_params                   = nullptr;
+    m_fileProgressEvent        = vtkEventQtSlotConnect::New();
+    m_ibisAPI                  = nullptr;
 }
 
 FileReader::~FileReader()
@@ -175,6 +194,67 @@ bool FileReader::IsMINC1( QString fileName )
     return false;
 }
 
+// Converted files are kept in a cache directory between sessions. The name of a converted file is built from a key
+// of the absolute path of the MINC1 file and a key of its size and modification time, so a file is converted again
+// only when it changes.
+static QString MINC2CacheDirectory()
+{
+    QString dirname( QDir::homePath() );
+    dirname.append( "/.ibis/tmp/minc2/" );
+    return dirname;
+}
+
+static QString MINC2CacheKey( const QString & text )
+{
+    QByteArray hash = QCryptographicHash::hash( text.toUtf8(), QCryptographicHash::Sha1 );
+    return QString( hash.toHex().left( 12 ) );
+}
+
+// Name of the converted file in the cache directory, pathKey is shared by all versions of the input file
+static QString MINC2CacheFileName( const QString & inputFileName, bool isVideoFrame, QString & pathKey )
+{
+    QFileInfo fi( inputFileName );
+    pathKey            = MINC2CacheKey( fi.absoluteFilePath() + ( isVideoFrame ? "|frame" : "|image" ) );
+    QString versionKey = MINC2CacheKey( QString( "%1|%2" )
+                                            .arg( fi.size() )
+                                            .arg( fi.lastModified().toMSecsSinceEpoch() ) );
+    return QString( "%1_%2_%3.mnc" ).arg( fi.completeBaseName() ).arg( pathKey ).arg( versionKey );
+}
+
+// The cache is pruned once per session, before the first conversion: files unused for MINC2CacheMaximumAge days are
+// removed, then the least recently used files until the cache is smaller than MINC2CacheMaximumSize. A cached file
+// is marked as used by setting its modification time when it is found in the cache.
+static const int MINC2CacheMaximumAge     = 30;
+static const qint64 MINC2CacheMaximumSize = qint64( 2 ) << 30;
+static std::once_flag minc2CachePruned;
+
+static void PruneMINC2Cache()
+{
+    QDir cacheDir( MINC2CacheDirectory() );
+    QFileInfoList files = cacheDir.entryInfoList( QDir::Files, QDir::Time | QDir::Reversed );  // oldest first
+    QDateTime oldest    = QDateTime::currentDateTime().addDays( -MINC2CacheMaximumAge );
+    qint64 totalSize    = 0;
+    foreach( QFileInfo file, files ) totalSize += file.size();
+    foreach( QFileInfo file, files )
+    {
+        if( file.lastModified() >= oldest && totalSize <= MINC2CacheMaximumSize ) break;
+        if( cacheDir.remove( file.fileName() ) ) totalSize -= file.size();
+    }
+}
+
+// Limit the number of mincconvert/minccalc processes running at the same time, files are converted by concurrent
+// readers.
+static QSemaphore mincToolsSlots( std::max( 1, QThread::idealThreadCount() ) );
+
+static bool RunMINCTool( const QString & program, const QStringList & arguments, int msecs = 30000 )
+{
+    QProcess process;
+    process.start( program, arguments );
+    bool ok = process.waitForStarted( msecs );
+    if( ok ) ok = process.waitForFinished( msecs );
+    return ok && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
 bool FileReader::ConvertMINC1toMINC2( QString & inputileName, QString & outputileName, bool isVideoFrame )
 {
     if( m_mincconvert.isEmpty() )
@@ -183,76 +263,94 @@ bool FileReader::ConvertMINC1toMINC2( QString & inputileName, QString & outputil
         tmp.append( inputileName + " is of MINC1 type and needs to be converted to MINC2.\n" +
                     "Tool mincconvert was not found in standard paths on your file system.\n" +
                     "Please convert using command: \nmincconvert -2 <input> <output>" );
-        QMessageBox::critical( 0, "Error", tmp, QMessageBox::Ok );
+        this->ReportWarning( tmp );
         return false;
     }
-    QString dirname( QDir::homePath() );
-    dirname.append( "/.ibis/tmp/" );
+    if( isVideoFrame && m_minccalc.isEmpty() )
+    {
+        QString tmp( "File " );
+        tmp.append( inputileName + " is an acquired frame of MINC1 type and needs to be converted to MINC2.\n" +
+                    "Tool minccalc was not found in standard paths on your file system.\n" );
+        this->ReportWarning( tmp );
+        return false;
+    }
+    QString dirname = MINC2CacheDirectory();
     QDir tmpDir( dirname );
-    bool ok = true;
-    if( !tmpDir.exists() ) ok = tmpDir.mkdir( dirname );
-    if( !ok )
+    if( !tmpDir.exists() && !tmpDir.mkpath( dirname ) )
     {
         QString tmp( "Cannot create directory: " );
         tmp.append( dirname );
         this->ReportWarning( tmp );
         return false;
     }
-    outputileName.append( dirname );
-    QFileInfo fi( inputileName );
-    outputileName.append( fi.fileName() );
-    QString program( m_mincconvert );
-    QStringList arguments;
-    ok = false;
-    if( !isVideoFrame )
-    {
-        arguments << "-2" << inputileName << outputileName << "-clobber";
-        QProcess * convertProcess = new QProcess( 0 );
-        convertProcess->start( program, arguments );
-        ok = convertProcess->waitForStarted();
-        if( ok ) ok = convertProcess->waitForFinished();
-        delete convertProcess;
-        return ok;
+
+    std::call_once( minc2CachePruned, PruneMINC2Cache );
+
+    QString pathKey;
+    QString cachedName = MINC2CacheFileName( inputileName, isVideoFrame, pathKey );
+    outputileName      = dirname + cachedName;
+
+    // Already converted in this or a previous session
+    QFileInfo cached( outputileName );
+    if( cached.exists() && cached.size() > 0 )
+    {
+        QFile cachedFile( outputileName );
+        if( cachedFile.open( QIODevice::ReadWrite ) )
+            cachedFile.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+        return true;
     }
-    else
+
+    // Convert to names unique to this conversion, then move the result in place so that concurrent readers never see
+    // a partially written file.
+    QString uniqueName = dirname + QUuid::createUuid().toString( QUuid::Id128 );
+    QString convertedFile( uniqueName + ".mnc" );
+    QString scaledFile( uniqueName + "_scaled.mnc" );
+    bool ok = false;
     {
-        QFileInfo fi( outputileName );
-        QString dirname( fi.absolutePath() );
-        QDir tmpDir( dirname );
-        QString tempFile( dirname );
-        tempFile.append( "/tempfile.mnc" );
-        arguments << "-2" << inputileName << tempFile << "-clobber";
-        QProcess * convertProcess = new QProcess( 0 );
-        convertProcess->start( program, arguments );
-        ok = convertProcess->waitForStarted( 5000 );
-        if( ok ) ok = convertProcess->waitForFinished( 5000 );
-        delete convertProcess;
-        if( ok )
+        mincToolsSlots.acquire();
+        QSemaphoreReleaser slot( mincToolsSlots );
+        QStringList arguments;
+        arguments << "-2" << inputileName << convertedFile << "-clobber";
+        if( !isVideoFrame )
+        {
+            ok = RunMINCTool( m_mincconvert, arguments );
+        }
+        else
         {
-            if( !m_minccalc.isEmpty() )
+            ok = RunMINCTool( m_mincconvert, arguments, 5000 );
+            if( ok )
             {
-                program = m_minccalc;
                 arguments.clear();
                 arguments << "-express"
-                          << "A[0]*255" << tempFile << outputileName << "-clobber";
-                QProcess * calcProcess = new QProcess( 0 );
-                calcProcess->start( program, arguments );
-                ok = calcProcess->waitForStarted();
-                if( ok ) ok = calcProcess->waitForFinished();
-                delete calcProcess;
-                tmpDir.remove( tempFile );
-            }
-            else
-            {
-                QString tmp( "File " );
-                tmp.append( inputileName + " is an acquired frame of MINC1 type and needs to be converted to MINC2.\n" +
-                            "Tool minccalc was not found in standard paths on your file system.\n" );
-                QMessageBox::critical( 0, "Error", tmp, QMessageBox::Ok );
-                return false;
+                          << "A[0]*255" << convertedFile << scaledFile << "-clobber";
+                ok = RunMINCTool( m_minccalc, arguments );
+                tmpDir.remove( convertedFile );
+                convertedFile = scaledFile;
             }
         }
-        return ok;
     }
+    if( ok )
+    {
+        // Another reader may have converted the same file in the meantime
+        if( !QFile::rename( convertedFile, outputileName ) )
+        {
+            tmpDir.remove( convertedFile );
+            ok = QFile::exists( outputileName );
+        }
+    }
+    else
+    {
+        tmpDir.remove( convertedFile );
+    }
+    if( !ok ) return false;
+
+    // Remove conversions of previous versions of the file
+    QStringList stale = tmpDir.entryList( QStringList() << QString( "*_%1_*.mnc" ).arg( pathKey ), QDir::Files );
+    foreach( QString name, stale )
+    {
+        if( name != cachedName ) tmpDir.remove( name );
+    }
+    return true;
 }
 
 void FileReader::SetParams( OpenFileParams * params ) { m_params = params; }
@@ -283,6 +381,26 @@ void FileReader::run()
     m_currentFileIndex = 0;
     m_progress         = 0.0;
     m_warnings.clear();
+    if( m_numberOfWorkers > 1 && m_params->filesParams.size() > 1 )
+        ReadFilesConcurrently();
+    else
+        ReadFilesSequentially();
+
+    // Push all read objects to main thread to be able to create connections without having to worry about type of
+    // connection. Objects read by workers have already been pushed by the worker that created them.
+    QThread * mainThread = QApplication::instance()->thread();
+    for( int i = 0; i < m_params->filesParams.size(); ++i )
+    {
+        OpenFileParams::SingleFileParam & param = m_params->filesParams[i];
+        if( param.loadedObject ) param.loadedObject->moveToThread( mainThread );
+        if( param.secondaryObject ) param.secondaryObject->moveToThread( mainThread );
+    }
+
+    m_progress = 1.0;
+}
+
+void FileReader::ReadFilesSequentially()
+{
     for( int i = 0; i < m_params->filesParams.size(); ++i )
     {
         OpenFileParams::SingleFileParam & param = m_params->filesParams[i];
@@ -292,18 +410,70 @@ void FileReader::run()
         if( readObjects.size() > 0 ) param.loadedObject = readObjects[0];
         if( readObjects.size() > 1 ) param.secondaryObject = readObjects[1];
     }
+}
 
-    // Push all read objects to main thread to be able to create connections without having to worry about type of
-    // connection
-    QThread * mainThread = QApplication::instance()->thread();
-    for( int i = 0; i < m_params->filesParams.size(); ++i )
+void FileReader::ReadFilesConcurrently()
+{
+    // Each file gets its own reader: progress callbacks, warnings and current file index are per reader
+    int numberOfFiles = m_params->filesParams.size();
+    std::vector<std::unique_ptr<OpenFileParams> > workerParams( numberOfFiles );
+    std::vector<std::unique_ptr<FileReader> > workers( numberOfFiles );
+    for( int i = 0; i < numberOfFiles; ++i )
     {
-        OpenFileParams::SingleFileParam & param = m_params->filesParams[i];
-        if( param.loadedObject ) param.loadedObject->moveToThread( mainThread );
-        if( param.secondaryObject ) param.secondaryObject->moveToThread( mainThread );
+        workerParams[i].reset( new OpenFileParams );
+        workerParams[i]->filesParams.push_back( m_params->filesParams[i] );
+        workers[i].reset( new FileReader );
+        workers[i]->SetParams( workerParams[i].get() );
+        workers[i]->SetNumberOfWorkers( 1 );
+        workers[i]->m_mincconvert = m_mincconvert;
+        workers[i]->m_minccalc    = m_minccalc;
+        workers[i]->SetTractogramSubsampling( m_tractogramStreamlineStep, m_tractogramPointStep );
     }
 
-    m_progress = 1.0;
+    std::vector<bool> finished( numberOfFiles, false );
+    int nextWorker     = 0;
+    int runningWorkers = 0;
+    int firstRunning   = 0;
+    while( firstRunning < numberOfFiles )
+    {
+        for( ; nextWorker < numberOfFiles && runningWorkers < m_numberOfWorkers; ++nextWorker )
+        {
+            workers[nextWorker]->start();
+            ++runningWorkers;
+        }
+
+        // Files may finish in any order, don't block on the oldest one for too long
+        workers[firstRunning]->wait( 50 );
+
+        double progress = 0.0;
+        for( int i = 0; i < nextWorker; ++i )
+        {
+            if( !finished[i] && workers[i]->isFinished() )
+            {
+                finished[i] = true;
+                --runningWorkers;
+            }
+            progress += workers[i]->GetProgress();
+        }
+        while( firstRunning < numberOfFiles && finished[firstRunning] ) ++firstRunning;
+        m_currentFileIndex = std::min( firstRunning, numberOfFiles - 1 );
+        m_progress         = progress / numberOfFiles;
+    }
+
+    // Gather results in input order
+    for( int i = 0; i < numberOfFiles; ++i )
+    {
+        OpenFileParams::SingleFileParam & result = workerParams[i]->filesParams[0];
+        m_params->filesParams[i].loadedObject    = result.loadedObject;
+        m_params->filesParams[i].secondaryObject = result.secondaryObject;
+        m_warnings.append( workers[i]->GetWarnings() );
+    }
+}
+
+void FileReader::SetTractogramSubsampling( int streamlineStep, int pointStep )
+{
+    m_tractogramStreamlineStep = std::max( 1, streamlineStep );
+    m_tractogramPointStep      = std::max( 1, pointStep );
 }
 
 QString FileReader::GetCurrentlyReadFile()
@@ -338,6 +508,7 @@ bool FileReader::OpenFile( QList<SceneObject *> & readObjects, QString filename,
     if( QFile::exists( filename ) )
     {
         QString fileToOpen( filename );
+        QString objectName( dataObjectName );
         QString fileMINC2;
         if( this->IsMINC1( filename ) )
         {
@@ -346,27 +517,36 @@ bool FileReader::OpenFile( QList<SceneObject *> & readObjects, QString filename,
                 QString tmp( "File " );
                 tmp.append( filename + " is  of MINC1 type and needs to be converted to MINC2.\n" +
                             "Open Settings/Preferences and set path to the directory containing MINC tools.\n" );
-                QMessageBox::critical( 0, "Error", tmp, QMessageBox::Ok );
+                this->ReportWarning( tmp );
                 return false;
             }
             if( this->ConvertMINC1toMINC2( filename, fileMINC2, true ) )
                 fileToOpen = fileMINC2;
             else
                 return false;
+            // name of the cached file is not meaningful
+            if( objectName.isEmpty() ) objectName = QFileInfo( filename ).fileName();
         }
-        // Try reading using ITK ( all itk supported formats )
+        // Try reading using ITK ( all itk supported formats ), only files with a valid image header are decoded
         bool fileOpened = false;
-        if( isLabel )
-        {
-            fileOpened = OpenItkLabelFile( readObjects, fileToOpen, dataObjectName );
-        }
-        else
+        ImageFileInfo info;
+        if( this->GetImageFileInfo( fileToOpen, info ) )
         {
-            fileOpened = OpenItkFile( readObjects, fileToOpen, dataObjectName );
+            if( isLabel )
+            {
+                fileOpened = OpenItkLabelFile( readObjects, fileToOpen, objectName );
+            }
+            else
+            {
+                if( info.numberOfComponents > 1 )
+                    this->ReportWarning( QString( "%1 has %2 components per pixel, it is loaded as a grayscale image." )
+                                             .arg( QFileInfo( filename ).fileName() )
+                                             .arg( info.numberOfComponents ) );
+                fileOpened = OpenItkFile( readObjects, fileToOpen, objectName );
+            }
         }
 
-        // temporary files cannot be removed before the end of the session - remove on exit from the application or on
-        // load scene
+        // converted MINC1 files are kept in the conversion cache, they are reused when the same file is opened again
         if( fileOpened ) return true;
 
         // try tag file
@@ -402,7 +582,7 @@ bool FileReader::OpenFile( QList<SceneObject *> & readObjects, QString filename,
             if( OpenPlyFile( readObjects, filename, dataObjectName ) ) return true;
         }
 
-        // try tractogram fib / vtk format
+        // try tractogram fib / trk / tck format
         if( OpenFIBFile( readObjects, filename, dataObjectName ) ) return true;
 
         // try vtp
@@ -439,6 +619,23 @@ bool FileReader::OpenFile( QList<SceneObject *> & readObjects, QString filename,
 typedef itk::ImageIOBase IOBase;
 typedef itk::SmartPointer<IOBase> IOBasePointer;
 
+// libminc and HDF5, used by the ITK MINC and HDF5 image IOs, are not thread safe. Concurrent readers
+// create their IO under this lock (HDF5ImageIO::CanReadFile opens any file with HDF5) and keep it while
+// they read a file with one of these IOs.
+static QMutex hdf5Mutex;
+
+static bool UsesHDF5( IOBase * io )
+{
+    return io && ( strcmp( io->GetNameOfClass(), "MINCImageIO" ) == 0 ||
+                   strcmp( io->GetNameOfClass(), "HDF5ImageIO" ) == 0 );
+}
+
+static IOBasePointer CreateImageIO( const QString & filename )
+{
+    QMutexLocker lock( &hdf5Mutex );
+    return itk::ImageIOFactory::CreateImageIO( filename.toUtf8().data(), itk::CommonEnums::IOFileMode::ReadMode );
+}
+
 void FileReader::PrintMetadata( itk::MetaDataDictionary & dict )
 {
     // let's write some meta information if there is any
@@ -465,10 +662,18 @@ bool FileReader::OpenItkFile( QList<SceneObject *> & readObjects, QString filena
     // try to read
     typedef itk::ImageFileReader<IbisItkFloat3ImageType> ReaderType;
     ReaderType::Pointer reader = ReaderType::New();
+    IOBasePointer io           = CreateImageIO( filename );
+    if( !io )
+    {
+        ReportWarning( tr( "Unsupported image file format: %1" ).arg( filename ) );
+        return false;
+    }
+    reader->SetImageIO( io );
     reader->SetFileName( filename.toUtf8().data() );
 
     try
     {
+        QMutexLocker lock( UsesHDF5( io ) ? &hdf5Mutex : nullptr );
         reader->Update();
     }
     catch( itk::ExceptionObject & err )
@@ -481,6 +686,7 @@ bool FileReader::OpenItkFile( QList<SceneObject *> & readObjects, QString filena
 
     IbisItkFloat3ImageType::Pointer itkImage = reader->GetOutput();
     ImageObject * image                      = ImageObject::New();
+    image->SetProgressiveLoading( true );
     SetObjectName( image, dataObjectName, filename );
     if( image->SetItkImage( itkImage ) )
     {
@@ -501,10 +707,18 @@ bool FileReader::OpenItkLabelFile( QList<SceneObject *> & readObjects, QString f
     // try to read
     typedef itk::ImageFileReader<IbisItkUnsignedChar3ImageType> ReaderType;
     ReaderType::Pointer reader = ReaderType::New();
+    IOBasePointer io           = CreateImageIO( filename );
+    if( !io )
+    {
+        ReportWarning( tr( "Unsupported image file format: %1" ).arg( filename ) );
+        return false;
+    }
+    reader->SetImageIO( io );
     reader->SetFileName( filename.toUtf8().data() );
 
     try
     {
+        QMutexLocker lock( UsesHDF5( io ) ? &hdf5Mutex : nullptr );
         reader->Update();
     }
     catch( itk::ExceptionObject & err )
@@ -542,6 +756,13 @@ bool FileReader::OpenObjFile( QList<SceneObject *> & readObjects, QString filena
     reader->Update();
     m_fileProgressEvent->Disconnect( reader );
 
+    // Let the next readers try files that are not MNI objects after all
+    if( reader->GetErrorCode() != vtkErrorCode::NoError || reader->GetOutput()->GetNumberOfPoints() == 0 )
+    {
+        reader->Delete();
+        return false;
+    }
+
     PolyDataObject * object = PolyDataObject::New();
     object->SetPolyData( reader->GetOutput() );
     object->SetColor( reader->GetProperty()->GetColor() );
@@ -654,39 +875,107 @@ bool FileReader::OpenVTKFile( QList<SceneObject *> & readObjects, QString filena
     return res;
 }
 
-bool FileReader::OpenFIBFile( QList<SceneObject *> & readObjects, QString filename, const QString & dataObjectName )
+// Keep one line out of streamlineStep and one point out of pointStep along lines, like vtkTractogramReader
+// does while reading. The last point of a line is always kept, attributes of the kept points and lines are copied.
+static vtkSmartPointer<vtkPolyData> SubsampleStreamlines( vtkPolyData * input, int streamlineStep, int pointStep )
 {
-    vtkDataObjectReader * reader = vtkDataObjectReader::New();
-    reader->SetFileName( filename.toUtf8().data() );
-    reader->Update();
-    m_fileProgressEvent->Disconnect( reader );
+    vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+    if( !input->GetPoints() || !input->GetLines() ) return output;
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataType( input->GetPoints()->GetDataType() );
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    output->GetPointData()->CopyAllocate( input->GetPointData() );
+    output->GetCellData()->CopyAllocate( input->GetCellData() );
+
+    // cell ids of lines come after the vertices
+    vtkIdType firstLineId = input->GetNumberOfVerts();
+    std::vector<vtkIdType> kept;
+    auto it = vtk::TakeSmartPointer( input->GetLines()->NewIterator() );
+    for( it->GoToFirstCell(); !it->IsDoneWithTraversal(); it->GoToNextCell() )
+    {
+        if( it->GetCurrentCellId() % streamlineStep != 0 ) continue;
+        vtkIdType nb;
+        const vtkIdType * ids;
+        it->GetCurrentCell( nb, ids );
+        kept.clear();
+        for( vtkIdType j = 0; j < nb; j += pointStep )
+        {
+            vtkIdType pointId = points->InsertNextPoint( input->GetPoint( ids[j] ) );
+            output->GetPointData()->CopyData( input->GetPointData(), ids[j], pointId );
+            kept.push_back( pointId );
+        }
+        if( nb > 0 && ( nb - 1 ) % pointStep != 0 )
+        {
+            vtkIdType pointId = points->InsertNextPoint( input->GetPoint( ids[nb - 1] ) );
+            output->GetPointData()->CopyData( input->GetPointData(), ids[nb - 1], pointId );
+            kept.push_back( pointId );
+        }
+        vtkIdType lineId = lines->InsertNextCell( static_cast<vtkIdType>( kept.size() ), kept.data() );
+        output->GetCellData()->CopyData( input->GetCellData(), firstLineId + it->GetCurrentCellId(), lineId );
+    }
+    output->SetPoints( points );
+    output->SetLines( lines );
+    output->Squeeze();
+    return output;
+}
 
-    bool res = false;
+bool FileReader::OpenFIBFile( QList<SceneObject *> & readObjects, QString filename, const QString & dataObjectName )
+{
+    if( !filename.endsWith( QString( ".fib" ) ) && !filename.endsWith( QString( ".trk" ) ) &&
+        !filename.endsWith( QString( ".tck" ) ) )
+        return false;
 
-    if( reader->GetErrorCode() == vtkErrorCode::NoError )
+    // Streaming reader, streamlines are decoded in parallel to float points
+    vtkSmartPointer<vtkTractogramReader> tractogramReader = vtkSmartPointer<vtkTractogramReader>::New();
+    if( tractogramReader->CanReadFile( filename.toUtf8().data() ) )
     {
-        if( filename.endsWith( QString( ".fib" ) ) && reader->IsFilePolyData() )
-        {
-            vtkPolyDataReader * polyReader = vtkPolyDataReader::New();
-            polyReader->SetFileName( filename.toUtf8().data() );
+        tractogramReader->SetFileName( filename.toUtf8().data() );
+        tractogramReader->SetStreamlineStep( m_tractogramStreamlineStep );
+        tractogramReader->SetPointStep( m_tractogramPointStep );
 
-            m_fileProgressEvent->Connect( polyReader, vtkCommand::ProgressEvent, this,
-                                          SLOT( OnReaderProgress( vtkObject *, unsigned long ) ), 0, 0.0,
-                                          Qt::DirectConnection );
-            polyReader->Update();
-            m_fileProgressEvent->Disconnect( polyReader );
+        m_fileProgressEvent->Connect( tractogramReader, vtkCommand::ProgressEvent, this,
+                                      SLOT( OnReaderProgress( vtkObject *, unsigned long ) ), 0, 0.0,
+                                      Qt::DirectConnection );
+        tractogramReader->Update();
+        m_fileProgressEvent->Disconnect( tractogramReader );
 
+        if( tractogramReader->GetOutput()->GetNumberOfLines() > 0 )
+        {
             TractogramObject * object = TractogramObject::New();
-            object->SetPolyData( polyReader->GetOutput() );
+            object->SetPolyData( tractogramReader->GetOutput() );
             SetObjectName( object, dataObjectName, filename );
             readObjects.push_back( object );
-            res = true;
-
-            polyReader->Delete();
+            return true;
         }
     }
-    reader->Delete();
-    return res;
+    if( !filename.endsWith( QString( ".fib" ) ) ) return false;
+
+    // Legacy vtk files with sections the streaming reader doesn't support, e.g. attributes (HasAttributes).
+    // IsFilePolyData only reads the header.
+    vtkSmartPointer<vtkDataObjectReader> reader = vtkSmartPointer<vtkDataObjectReader>::New();
+    reader->SetFileName( filename.toUtf8().data() );
+    if( !reader->IsFilePolyData() ) return false;
+
+    vtkSmartPointer<vtkPolyDataReader> polyReader = vtkSmartPointer<vtkPolyDataReader>::New();
+    polyReader->SetFileName( filename.toUtf8().data() );
+
+    m_fileProgressEvent->Connect( polyReader, vtkCommand::ProgressEvent, this,
+                                  SLOT( OnReaderProgress( vtkObject *, unsigned long ) ), 0, 0.0,
+                                  Qt::DirectConnection );
+    polyReader->Update();
+    m_fileProgressEvent->Disconnect( polyReader );
+    if( polyReader->GetErrorCode() != vtkErrorCode::NoError ) return false;
+
+    TractogramObject * object = TractogramObject::New();
+    if( m_tractogramStreamlineStep > 1 || m_tractogramPointStep > 1 )
+        object->SetPolyData(
+            SubsampleStreamlines( polyReader->GetOutput(), m_tractogramStreamlineStep, m_tractogramPointStep ) );
+    else
+        object->SetPolyData( polyReader->GetOutput() );
+    SetObjectName( object, dataObjectName, filename );
+    readObjects.push_back( object );
+    return true;
 }
 
 bool FileReader::OpenVTPFile( QList<SceneObject *> & readObjects, QString filename, const QString & dataObjectName )
@@ -847,7 +1136,7 @@ int FileReader::GetNumberOfComponents( QString filename )
             QString tmp( "File " );
             tmp.append( filename + " is an acquired frame of MINC1 type and needs to be converted to MINC2.\n" +
                         "Open Settings/Preferences and set path to the directory containing MINC tools.\n" );
-            QMessageBox::critical( 0, "Error", tmp, QMessageBox::Ok );
+            this->ReportWarning( tmp );
             return 0;
         }
         if( this->ConvertMINC1toMINC2( filename, fileMINC2, true ) )
@@ -855,15 +1144,58 @@ int FileReader::GetNumberOfComponents( QString filename )
         else
             return 0;
     }
-    IOBasePointer io = itk::ImageIOFactory::CreateImageIO( fileToRead.toUtf8().data(), itk::CommonEnums::IOFileMode::ReadMode );
+    ImageFileInfo info;
+    if( !this->GetImageFileInfo( fileToRead, info ) ) throw itk::ExceptionObject( "Unsupported image file type" );
+    return static_cast<int>( info.numberOfComponents );
+}
 
-    if( !io ) throw itk::ExceptionObject( "Unsupported image file type" );
+bool FileReader::GetImageFileInfo( QString filename, ImageFileInfo & info )
+{
+    QString fileToRead( filename );
+    if( this->IsMINC1( filename ) )
+    {
+        // The header of a MINC1 file can only be read from a MINC2 copy, look for one in the conversion cache
+        fileToRead.clear();
+        bool frameModes[2] = { true, false };
+        for( bool isVideoFrame : frameModes )
+        {
+            QString pathKey;
+            QString cachedFile = MINC2CacheDirectory() + MINC2CacheFileName( filename, isVideoFrame, pathKey );
+            if( QFileInfo( cachedFile ).size() > 0 )
+            {
+                fileToRead = cachedFile;
+                break;
+            }
+        }
+        if( fileToRead.isEmpty() ) return false;
+    }
 
-    io->SetFileName( ( fileToRead.toUtf8().data() ) );
-    io->ReadImageInformation();
+    IOBasePointer io = CreateImageIO( fileToRead );
+    if( !io ) return false;
+    try
+    {
+        QMutexLocker lock( UsesHDF5( io ) ? &hdf5Mutex : nullptr );
+        io->SetFileName( fileToRead.toUtf8().data() );
+        io->ReadImageInformation();
+    }
+    catch( itk::ExceptionObject & err )
+    {
+        std::cerr << err << std::endl;
+        return false;
+    }
 
-    size_t nc = io->GetNumberOfComponents();
-    return static_cast<int>( nc );
+    info.dimension = io->GetNumberOfDimensions();
+    for( unsigned int i = 0; i < 3 && i < info.dimension; ++i )
+    {
+        info.size[i]    = io->GetDimensions( i );
+        info.spacing[i] = io->GetSpacing( i );
+        info.origin[i]  = io->GetOrigin( i );
+        for( unsigned int j = 0; j < 3 && j < info.dimension; ++j ) info.direction[j][i] = io->GetDirection( i )[j];
+    }
+    info.numberOfComponents = io->GetNumberOfComponents();
+    info.componentType      = QString::fromStdString( IOBase::GetComponentTypeAsString( io->GetComponentType() ) );
+    info.pixelType          = QString::fromStdString( IOBase::GetPixelTypeAsString( io->GetPixelType() ) );
+    return true;
 }
 
 #include "itkImage.h"
@@ -873,10 +1205,18 @@ bool FileReader::GetGrayFrame( QString filename, IbisItkUnsignedChar3ImageType::
 {
     typedef itk::ImageFileReader<IbisItkUnsignedChar3ImageType> ReaderType;
     ReaderType::Pointer reader = ReaderType::New();
+    IOBasePointer io           = CreateImageIO( filename );
+    if( !io )
+    {
+        ReportWarning( tr( "Unsupported image file format: %1" ).arg( filename ) );
+        return false;
+    }
+    reader->SetImageIO( io );
     reader->SetFileName( filename.toUtf8().data() );
 
     try
     {
+        QMutexLocker lock( UsesHDF5( io ) ? &hdf5Mutex : nullptr );
         reader->Update();
     }
     catch( itk::ExceptionObject & err )
@@ -911,10 +1251,18 @@ bool FileReader::GetRGBFrame( QString filename, IbisRGBImageType::Pointer itkIma
 {
     typedef itk::ImageFileReader<IbisRGBImageType> ReaderType;
     ReaderType::Pointer reader = ReaderType::New();
+    IOBasePointer io           = CreateImageIO( filename );
+    if( !io )
+    {
+        ReportWarning( tr( "Unsupported image file format: %1" ).arg( filename ) );
+        return false;
+    }
+    reader->SetImageIO( io );
     reader->SetFileName( filename.toUtf8().data() );
 
     try
     {
+        QMutexLocker lock( UsesHDF5( io ) ? &hdf5Mutex : nullptr );
         reader->Update();
     }
     catch( itk::ExceptionObject & err )
@@ -18,6 +18,8 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QStringList>
 #include <QThread>
 
+#include <algorithm>
+
 #include "ibisitkvtkconverter.h"
 
 class SceneManager;
@@ -30,6 +32,7 @@ class ImageObject;
 class PointsObject;
 class IbisAPI;
 class OpenFileParams;
+class ImageFileInfo;
 
 /**
  * @class   FileReader
@@ -45,12 +48,16 @@ class OpenFileParams;
  * PLY file *.ply\n
  * Tag file *.tag\n
  * VTK file: *.vtk *.vtp\n
- * FIB file *.fib
+ * Tractogram file: *.fib *.trk *.tck
  *
  * The data is used to create a corresponding SceneObject.
  * Minc and Nifti are represented as ImageObject.
  * Object, PLY, VTK and VTP are represented as PolyDataObject.
- * FIB is represented as a TractogramObject.
+ * Tractograms (FIB, TrackVis and MRtrix) are represented as a TractogramObject, streamlines can be
+ * subsampled while reading, see SetTractogramSubsampling().
+ *
+ * When several files are opened, they are read concurrently by up to GetNumberOfWorkers() threads.
+ * Read objects are always returned in the order of the input files.
  *
  * @sa
  * IbisAPI OpenFileParams SceneManager PointsObject SceneObject ImageObject TractogramObject
@@ -77,6 +84,13 @@ public:
     const QStringList & GetWarnings() { return m_warnings; }
     /** Return reading progress as a fraction between 0 and 1. */
     double GetProgress() { return m_progress; }
+
+    /** Maximum number of files read at the same time, default is QThread::idealThreadCount(). */
+    void SetNumberOfWorkers( int n ) { m_numberOfWorkers = std::max( 1, n ); }
+    int GetNumberOfWorkers() { return m_numberOfWorkers; }
+    /** Keep one streamline out of streamlineStep and one point out of pointStep along streamlines when
+     *  reading tractograms, default is 1, 1: all streamlines and points. */
+    void SetTractogramSubsampling( int streamlineStep, int pointStep );
     /** Return the name of currently processed file. */
     QString GetCurrentlyReadFile();
 
@@ -94,10 +108,17 @@ public:
     /** Is the file of MINC1 type? */
     bool IsMINC1( QString fileName );
     /** Convert MINC1 file to MINC2 file using mincconvert, if it is a frame from US acquisition, additionaly use
-     * mincalc. */
+     * mincalc. Converted files are cached in ~/.ibis/tmp/minc2, keyed by path, size and modification time of the
+     * MINC1 file, and are converted again only when the file changes. Files unused for 30 days are removed from the
+     * cache, which is also kept under 2 GB. A limited number of conversions run at the same time. */
     bool ConvertMINC1toMINC2( QString & inputileName, QString & outputileName, bool isVideoFrame = false );
     ///@}
 
+    /** Read dimensions, spacing, orientation and pixel type from the header of an image file (MINC2, NIfTI, MetaImage,
+     *  NRRD and other formats supported by ITK) without reading voxels. A MINC1 file is described from its cached
+     *  MINC2 conversion, false is returned if it was never converted. */
+    bool GetImageFileInfo( QString filename, ImageFileInfo & info );
+
     /** Return one or two PointsObjects loaded from a tag file. */
     bool GetPointsDataFromTagFile( QString filename, PointsObject * pts1, PointsObject * pts2 );
 
@@ -127,6 +148,11 @@ protected:
 
     void run();
 
+    /** Read all files one after the other in the reader thread. */
+    void ReadFilesSequentially();
+    /** Read each file with its own single file FileReader, m_numberOfWorkers at a time. */
+    void ReadFilesConcurrently();
+
     bool OpenFile( QList<SceneObject *> & readObjects, QString filename, const QString & dataObjectName = "",
                    bool isLabel = false );
     bool OpenItkFile( QList<SceneObject *> & readObjects, QString filename, const QString & dataObjectName = "" );
@@ -153,6 +179,15 @@ protected:
     double m_progress;
     ///@}
 
+    /** Maximum number of files read concurrently */
+    int m_numberOfWorkers;
+
+    ///@{
+    /** Tractogram subsampling */
+    int m_tractogramStreamlineStep;
+    int m_tractogramPointStep;
+    ///@}
+
     ///@{
     /** define stuff to read */
     bool m_selfAllocParams;
@@ -0,0 +1,121 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "instrumentationwidget.h"
+
+#include <QCheckBox>
+#include <QDir>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include "application.h"
+#include "instrumentation.h"
+
+InstrumentationWidget::InstrumentationWidget( QWidget * parent ) : QWidget( parent )
+{
+    setWindowTitle( "Performance Statistics" );
+
+    m_recordCheckBox = new QCheckBox( tr( "Record" ), this );
+    m_recordCheckBox->setChecked( Instrumentation::GetInstance().IsEnabled() );
+    connect( m_recordCheckBox, SIGNAL( toggled( bool ) ), this, SLOT( OnRecordToggled( bool ) ) );
+    QPushButton * resetButton = new QPushButton( tr( "Reset" ), this );
+    connect( resetButton, SIGNAL( clicked() ), this, SLOT( OnResetClicked() ) );
+    QPushButton * exportButton = new QPushButton( tr( "Export Trace..." ), this );
+    connect( exportButton, SIGNAL( clicked() ), this, SLOT( OnExportClicked() ) );
+    m_droppedLabel = new QLabel( this );
+
+    QHBoxLayout * buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget( m_recordCheckBox );
+    buttonLayout->addWidget( resetButton );
+    buttonLayout->addWidget( exportButton );
+    buttonLayout->addStretch();
+    buttonLayout->addWidget( m_droppedLabel );
+
+    QStringList headers;
+    headers << "Name" << "Count" << "Last (ms)" << "Average (ms)" << "Max (ms)" << "Total (ms)" << "Value";
+    m_table = new QTableWidget( 0, headers.size(), this );
+    m_table->setHorizontalHeaderLabels( headers );
+    m_table->horizontalHeader()->setSectionResizeMode( 0, QHeaderView::Stretch );
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    m_table->setSelectionMode( QAbstractItemView::NoSelection );
+
+    QVBoxLayout * layout = new QVBoxLayout( this );
+    layout->addLayout( buttonLayout );
+    layout->addWidget( m_table );
+    resize( 700, 300 );
+
+    m_timer = new QTimer( this );
+    connect( m_timer, SIGNAL( timeout() ), this, SLOT( UpdateUI() ) );
+    m_timer->start( 500 );
+    UpdateUI();
+}
+
+InstrumentationWidget::~InstrumentationWidget() {}
+
+void InstrumentationWidget::UpdateUI()
+{
+    Instrumentation & instr = Instrumentation::GetInstance();
+    instr.Collect();
+    QVector<Instrumentation::Statistics> stats = instr.GetStatistics();
+
+    int row = 0;
+    for( int i = 0; i < stats.size(); ++i )
+    {
+        const Instrumentation::Statistics & s = stats[i];
+        if( s.count == 0 ) continue;
+        QStringList values;
+        values << instr.GetName( i ) << QString::number( s.count );
+        if( s.isCounter )
+            values << "" << "" << "" << "" << QString::number( s.lastValue );
+        else
+            values << QString::number( s.lastTime, 'f', 3 ) << QString::number( s.averageTime, 'f', 3 )
+                   << QString::number( s.maximumTime, 'f', 3 ) << QString::number( s.totalTime, 'f', 1 ) << "";
+
+        if( row >= m_table->rowCount() ) m_table->insertRow( row );
+        for( int col = 0; col < values.size(); ++col )
+        {
+            QTableWidgetItem * item = m_table->item( row, col );
+            if( !item )
+            {
+                item = new QTableWidgetItem;
+                m_table->setItem( row, col, item );
+            }
+            item->setText( values[col] );
+        }
+        ++row;
+    }
+    m_table->setRowCount( row );
+    m_droppedLabel->setText( QString( "Dropped events: %1" ).arg( instr.GetNumberOfDroppedEvents() ) );
+}
+
+void InstrumentationWidget::OnRecordToggled( bool on ) { Instrumentation::GetInstance().SetEnabled( on ); }
+
+void InstrumentationWidget::OnResetClicked()
+{
+    Instrumentation::GetInstance().Reset();
+    UpdateUI();
+}
+
+void InstrumentationWidget::OnExportClicked()
+{
+    QString dir = Application::GetInstance().GetSettings()->WorkingDirectory;
+    if( dir.isEmpty() ) dir = QDir::homePath();
+    QString fileName = Application::GetInstance().GetFileNameSave( tr( "Export Trace" ), dir + "/ibis_trace.json",
+                                                                   tr( "Chrome trace files (*.json)" ) );
+    if( fileName.isEmpty() ) return;
+    if( !Instrumentation::GetInstance().ExportChromeTrace( fileName ) )
+        Application::GetInstance().Warning( "Export Trace", QString( "Can't write trace to %1" ).arg( fileName ) );
+}
@@ -0,0 +1,47 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef INSTRUMENTATIONWIDGET_H
+#define INSTRUMENTATIONWIDGET_H
+
+#include <QObject>
+#include <QWidget>
+
+class QCheckBox;
+class QLabel;
+class QTableWidget;
+class QTimer;
+
+// Description:
+// Live statistics of the instrumented timers and counters, see Instrumentation.
+// Events are collected twice per second while the widget is open.
+class InstrumentationWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit InstrumentationWidget( QWidget * parent = 0 );
+    ~InstrumentationWidget();
+
+private slots:
+
+    void UpdateUI();
+    void OnRecordToggled( bool on );
+    void OnResetClicked();
+    void OnExportClicked();
+
+private:
+    QCheckBox * m_recordCheckBox;
+    QLabel * m_droppedLabel;
+    QTableWidget * m_table;
+    QTimer * m_timer;
+};
+
+#endif
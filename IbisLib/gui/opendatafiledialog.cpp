@@ -34,8 +34,9 @@ void OpenDataFileDialog::BrowsePushButtonClicked()
 {
     QString filter =
         tr( "All valid files(*.mnc *.mnc2 *.mnc.gz *.MNC *.MNC2 *.MNC.GZ *.nii *.obj *.ply *.tag *.vtk *.vtp "
-            "*.fib);;Minc file (*.mnc *.mnc2 *.mnc.gz *.MNC *.MNC2 *.MNC.GZ);;Nifti file (*.nii);;Object file "
-            "(*.obj);;PLY file (*.ply);;Tag file (*.tag);;VTK file (*.vtk);;VTP file (*.vtp);;FIB file (*.fib)" );
+            "*.fib *.trk *.tck);;Minc file (*.mnc *.mnc2 *.mnc.gz *.MNC *.MNC2 *.MNC.GZ);;Nifti file (*.nii);;Object "
+            "file (*.obj);;PLY file (*.ply);;Tag file (*.tag);;VTK file (*.vtk);;VTP file (*.vtp);;Tractogram file "
+            "(*.fib *.trk *.tck)" );
     QStringList inputFiles = QFileDialog::getOpenFileNames( this, tr( "Open Files" ), m_fileParams->lastVisitedDir,
                                                             filter, nullptr, QFileDialog::DontUseNativeDialog );
     for( int i = 0; i < inputFiles.size(); ++i )
@@ -151,6 +151,14 @@ void WorldObjectSettingsWidget::UpdateUi()
         ui->updateMaxFrequencySlider->setValue( updateFrequencyIndex );
         ui->updateMaxFrequencySlider->blockSignals( false );
         ui->fpsLineEdit->setText( UpdateFrequencyStrings[updateFrequencyIndex] );
+
+        ui->streamlineStepSpinBox->blockSignals( true );
+        ui->streamlineStepSpinBox->setValue( m_worldObject->GetTractogramStreamlineStep() );
+        ui->streamlineStepSpinBox->blockSignals( false );
+
+        ui->pointStepSpinBox->blockSignals( true );
+        ui->pointStepSpinBox->setValue( m_worldObject->GetTractogramPointStep() );
+        ui->pointStepSpinBox->blockSignals( false );
     }
 }
 
@@ -169,6 +177,16 @@ void WorldObjectSettingsWidget::on_updateMaxFrequencySlider_valueChanged( int va
     UpdateUi();
 }
 
+void WorldObjectSettingsWidget::on_streamlineStepSpinBox_valueChanged( int value )
+{
+    m_worldObject->SetTractogramSubsampling( value, m_worldObject->GetTractogramPointStep() );
+}
+
+void WorldObjectSettingsWidget::on_pointStepSpinBox_valueChanged( int value )
+{
+    m_worldObject->SetTractogramSubsampling( m_worldObject->GetTractogramStreamlineStep(), value );
+}
+
 void WorldObjectSettingsWidget::on_viewFollowsReferenceCheckBox_toggled( bool checked )
 {
     m_worldObject->Set3DViewFollowsReferenceVolume( checked );
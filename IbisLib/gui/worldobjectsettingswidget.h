@@ -46,6 +46,8 @@ private slots:
     void on_changeCursorColorButton_clicked();
     void on_showAxesCheckBox_toggled( bool );
     void on_showCursorCheckBox_toggled( bool );
+    void on_streamlineStepSpinBox_valueChanged( int value );
+    void on_pointStepSpinBox_valueChanged( int value );
 
 private:
     void UpdateUi();
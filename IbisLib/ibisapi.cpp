@@ -74,6 +74,16 @@ void IbisAPI::SetCurrentObject( SceneObject * cur ) { m_sceneManager->SetCurrent
 
 SceneObject * IbisAPI::GetObjectByID( int id ) { return m_sceneManager->GetObjectByID( id ); }
 
+SceneObject * IbisAPI::GetObjectByName( const QString & name )
+{
+    const QList<SceneObject *> & allObjects = m_sceneManager->GetAllObjects();
+    for( int i = 0; i < allObjects.size(); ++i )
+    {
+        if( allObjects[i]->GetName() == name ) return allObjects[i];
+    }
+    return nullptr;
+}
+
 void IbisAPI::RemoveObjectByID( int id ) { m_sceneManager->RemoveObjectById( id ); }
 
 SceneObject * IbisAPI::GetSceneRoot() { return m_sceneManager->GetSceneRoot(); }
@@ -130,6 +140,11 @@ void IbisAPI::GetAllObjectsOfType( const char * typeName, QList<SceneObject *> &
     return m_sceneManager->GetAllObjectsOfType( typeName, all );
 }
 
+QList<SceneObject *> IbisAPI::GetObjectsOfType( const char * typeName )
+{
+    return m_sceneManager->GetObjectsOfType( typeName );
+}
+
 void IbisAPI::GetAllCameraObjects( QList<CameraObject *> & all ) { return m_sceneManager->GetAllCameraObjects( all ); }
 
 View * IbisAPI::GetViewByID( int id ) { return m_sceneManager->GetViewByID( id ); }
@@ -216,6 +231,8 @@ void IbisAPI::Warning( const QString & title, const QString & text ) { m_applica
 
 bool IbisAPI::IsViewerOnly() { return m_application->IsViewerOnly(); }
 
+bool IbisAPI::IsHeadless() { return m_application->IsHeadless(); }
+
 QString IbisAPI::GetWorkingDirectory() { return m_application->GetSettings()->WorkingDirectory; }
 
 QString IbisAPI::GetConfigDirectory() { return m_application->GetConfigDirectory(); }
@@ -240,6 +257,12 @@ ToolPluginInterface * IbisAPI::GetToolPluginByName( QString name )
     return m_application->GetToolPluginByName( name );
 }
 
+bool IbisAPI::RunBatchOperation( const QString & pluginName, const QString & operation,
+                                 const QMap<QString, QString> & args )
+{
+    return m_application->RunBatchOperation( pluginName, operation, args );
+}
+
 ObjectPluginInterface * IbisAPI::GetObjectPluginByName( QString className )
 {
     return m_application->GetObjectPluginByName( className );
@@ -266,6 +289,11 @@ bool IbisAPI::OpenTransformFile( const QString & filename, SceneObject * obj )
 
 void IbisAPI::OpenFiles( OpenFileParams * params, bool addToScene ) { m_application->OpenFiles( params, addToScene ); }
 
+bool IbisAPI::GetImageFileInfo( const QString & filename, ImageFileInfo & info )
+{
+    return m_application->GetImageFileInfo( filename, info );
+}
+
 void IbisAPI::SetMainWindowFullscreen( bool f )
 {
     MainWindow * mw = m_application->GetMainWindow();
@@ -77,6 +77,31 @@ public:
     SceneObject * defaultParent;
 };
 
+/** Image description read from the header of an image file, without reading voxels. Sizes, spacing, origin and
+ *  direction are given for the first 3 dimensions, the other dimensions are set to 1 and identity. */
+class ImageFileInfo
+{
+public:
+    ImageFileInfo() : dimension( 0 ), numberOfComponents( 0 )
+    {
+        for( int i = 0; i < 3; ++i )
+        {
+            size[i]    = 1;
+            spacing[i] = 1.0;
+            origin[i]  = 0.0;
+            for( int j = 0; j < 3; ++j ) direction[i][j] = ( i == j ) ? 1.0 : 0.0;
+        }
+    }
+    unsigned int dimension;
+    unsigned long long size[3];
+    double spacing[3];
+    double origin[3];
+    double direction[3][3];  // columns are the directions of the image axes
+    unsigned int numberOfComponents;
+    QString componentType;  // ITK component type: "unsigned_char", "short", "float", ...
+    QString pixelType;      // ITK pixel type: "scalar", "rgb", "rgba", "vector", ...
+};
+
 /**
  * @class   IbisAPI
  * @brief   interface to Application and SceneManager, to be used in ibis plugins
@@ -138,6 +163,10 @@ public:
      * Return object with a given Id
      */
     SceneObject * GetObjectByID( int id );
+    /**
+     * Return the first object with a given name, nullptr if there is none
+     */
+    SceneObject * GetObjectByName( const QString & name );
     /**
      * Remove object with a given Id
      */
@@ -214,6 +243,10 @@ public:
      * Return a list of all objects of a given type.
      */
     void GetAllObjectsOfType( const char * typeName, QList<SceneObject *> & all );
+    /**
+     * Return objects of a given type, the list is implicitly shared and only copied if the scene changes.
+     */
+    QList<SceneObject *> GetObjectsOfType( const char * typeName );
 
     /**
      * Get a View using its id.
@@ -304,6 +337,11 @@ public:
      *  ibis can be run without tracking, in a viewer mode.
      */
     bool IsViewerOnly();
+    /**
+     *  Check if ibis runs in batch mode, without main window.
+     *  Dialogs and progress dialogs are not available in that mode.
+     */
+    bool IsHeadless();
     /**
      * @{
      * Manage directories and files
@@ -329,6 +367,11 @@ public:
     ObjectPluginInterface * GetObjectPluginByName( QString className );
     SceneObject * GetGlobalObjectInstance( const QString & className );
     /** @}*/
+    /**
+     * Run a batch operation of a plugin, see IbisPlugin::RunBatchOperation
+     */
+    bool RunBatchOperation( const QString & pluginName, const QString & operation,
+                            const QMap<QString, QString> & args );
     /**
      * @{
      * Handle events in plugins
@@ -344,6 +387,8 @@ public:
     bool OpenTransformFile( const QString & filename, vtkMatrix4x4 * mat );
     bool OpenTransformFile( const QString & filename, SceneObject * obj = 0 );
     void OpenFiles( OpenFileParams * params, bool addToScene = true );
+    /** Read dimensions, spacing, orientation and pixel type of an image file without loading the image. */
+    bool GetImageFileInfo( const QString & filename, ImageFileInfo & info );
     /** @}*/
     /**
      * @{
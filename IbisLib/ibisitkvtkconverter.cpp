@@ -1,103 +1,101 @@
 #include "ibisitkvtkconverter.h"
 
+#include <itkCommand.h>
+#include <vtkCallbackCommand.h>
+#include <vtkDataArray.h>
 #include <vtkImageData.h>
-#include <vtkImageImport.h>
 #include <vtkImageLuminance.h>
 #include <vtkImageShiftScale.h>
 #include <vtkMath.h>
+#include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 #include <vtkTransform.h>
 
-template <class TInputImage>
-IbisItkVTKImageExport<TInputImage>::IbisItkVTKImageExport()
+#include <cstring>
+
+// Called when VTK scalars sharing the buffer of an ITK image are deleted
+static void ReleaseItkPixelContainer( vtkObject *, unsigned long, void * clientData, void * )
 {
-    for( int i = 0; i < 3; ++i ) vtkOrigin[i] = 0.0;
+    static_cast<itk::Object *>( clientData )->UnRegister();
 }
 
-template <class TInputImage>
-double * IbisItkVTKImageExport<TInputImage>::OriginCallback()
+// Called when an ITK pixel container sharing the buffer of VTK scalars is deleted
+static void ReleaseVtkScalars( itk::Object *, const itk::EventObject &, void * clientData )
 {
-    // run base class
-    double * orig = itk::VTKImageExport<TInputImage>::OriginCallback();
+    static_cast<vtkDataArray *>( clientData )->UnRegister( nullptr );
+}
 
-    // Get inverse of the dir cosine matrix
-    InputImagePointer input                    = this->GetInput();
-    itk::Matrix<double, 3, 3> dir_cos          = input->GetDirection();
-    vnl_matrix_fixed<double, 3, 3> inv_dir_cos = dir_cos.GetTranspose();
+IbisItkVtkConverter::IbisItkVtkConverter() { this->ItkToVtkOutput = vtkImageData::New(); }
 
-    // Transform the origin back to the way vtk sees it
-    vnl_vector_fixed<double, 3> origin;
-    vnl_vector_fixed<double, 3> o_origin;
-    for( int j = 0; j < 3; j++ ) o_origin[j] = orig[j];
-    origin = inv_dir_cos * o_origin;
+IbisItkVtkConverter::~IbisItkVtkConverter() { this->ItkToVtkOutput->Delete(); }
 
-    for( int i = 0; i < 3; ++i ) vtkOrigin[i] = origin[i];
-
-    return vtkOrigin;
+vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisItkFloat3ImageType::Pointer img, vtkTransform * tr,
+                                                               bool deepCopy )
+{
+    return this->ImportItkImage( img.GetPointer(), VTK_FLOAT, 1, tr, deepCopy );
 }
 
-IbisItkVtkConverter::IbisItkVtkConverter() { this->ItkToVtkImporter = 0; }
-
-IbisItkVtkConverter::~IbisItkVtkConverter()
+vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisRGBImageType::Pointer img, vtkTransform * tr,
+                                                               bool deepCopy )
 {
-    if( ItkToVtkImporter ) this->ItkToVtkImporter->Delete();
+    return this->ImportItkImage( img.GetPointer(), VTK_UNSIGNED_CHAR, 3, tr, deepCopy );
 }
 
-vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisItkFloat3ImageType::Pointer img, vtkTransform * tr )
+vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisItkUnsignedChar3ImageType::Pointer img,
+                                                               vtkTransform * tr, bool deepCopy )
 {
-    if( !this->ItkToVtkExporter )
-    {
-        this->ItkToVtkExporter = ItkExporterType::New();
-        BuildVtkImport( this->ItkToVtkExporter );
-    }
-    this->ItkToVtkExporter->SetInput( img );
-    this->ItkToVtkImporter->Update();
-    if( tr ) this->GetImageTransformFromDirectionCosines( img->GetDirection(), tr );
-    return this->ItkToVtkImporter->GetOutput();
+    return this->ImportItkImage( img.GetPointer(), VTK_UNSIGNED_CHAR, 1, tr, deepCopy );
 }
 
-vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisRGBImageType::Pointer img, vtkTransform * tr )
+template <class TImage>
+vtkImageData * IbisItkVtkConverter::ImportItkImage( TImage * img, int scalarType, int numberOfComponents,
+                                                    vtkTransform * tr, bool deepCopy )
 {
-    if( !this->ItkRGBImageToVtkExporter )
+    if( !img ) return nullptr;
+
+    typedef typename TImage::PixelType PixelType;
+    const typename TImage::RegionType & region = img->GetBufferedRegion();
+    const vtkIdType numberOfPixels             = region.GetNumberOfPixels();
+    int extent[6];
+    for( int i = 0; i < 3; ++i )
     {
-        this->ItkRGBImageToVtkExporter = ItkRGBImageExporterType::New();
-        BuildVtkImport( this->ItkRGBImageToVtkExporter );
+        extent[2 * i]     = region.GetIndex()[i];
+        extent[2 * i + 1] = extent[2 * i] + static_cast<int>( region.GetSize()[i] ) - 1;
     }
-    this->ItkRGBImageToVtkExporter->SetInput( img );
-    this->ItkToVtkImporter->Update();
-    if( tr ) this->GetImageTransformFromDirectionCosines( img->GetDirection(), tr );
-    return this->ItkToVtkImporter->GetOutput();
-}
 
-vtkImageData * IbisItkVtkConverter::ConvertItkImageToVtkImage( IbisItkUnsignedChar3ImageType::Pointer img,
-                                                               vtkTransform * tr )
-{
-    if( !this->ItkToVtkUnsignedChar3lExporter )
+    // Transform the origin back to the way vtk sees it, the rotation is returned in tr
+    vnl_matrix_fixed<double, 3, 3> inv_dir_cos = img->GetDirection().GetTranspose();
+    vnl_vector_fixed<double, 3> o_origin;
+    for( int j = 0; j < 3; j++ ) o_origin[j] = img->GetOrigin()[j];
+    vnl_vector_fixed<double, 3> origin = inv_dir_cos * o_origin;
+
+    vtkSmartPointer<vtkDataArray> scalars;
+    scalars.TakeReference( vtkDataArray::CreateDataArray( scalarType ) );
+    scalars->SetNumberOfComponents( numberOfComponents );
+    if( deepCopy )
     {
-        this->ItkToVtkUnsignedChar3lExporter = IbisItkUnsignedChar3ExporterType::New();
-        BuildVtkImport( this->ItkToVtkUnsignedChar3lExporter );
+        scalars->SetNumberOfTuples( numberOfPixels );
+        memcpy( scalars->GetVoidPointer( 0 ), img->GetBufferPointer(), numberOfPixels * sizeof( PixelType ) );
+    }
+    else
+    {
+        // The scalars use the buffer of the pixel container and hold a reference to it until they are deleted
+        itk::Object * container = img->GetPixelContainer();
+        container->Register();
+        scalars->SetVoidArray( img->GetBufferPointer(), numberOfPixels * numberOfComponents, 1 );
+        vtkSmartPointer<vtkCallbackCommand> releaseContainer = vtkSmartPointer<vtkCallbackCommand>::New();
+        releaseContainer->SetClientData( container );
+        releaseContainer->SetCallback( ReleaseItkPixelContainer );
+        scalars->AddObserver( vtkCommand::DeleteEvent, releaseContainer );
     }
-    this->ItkToVtkUnsignedChar3lExporter->SetInput( img );
-    this->ItkToVtkImporter->Update();
-    if( tr ) this->GetImageTransformFromDirectionCosines( img->GetDirection(), tr );
-    return this->ItkToVtkImporter->GetOutput();
-}
 
-void IbisItkVtkConverter::BuildVtkImport( itk::VTKImageExportBase * exporter )
-{
-    this->ItkToVtkImporter = vtkImageImport::New();
-    this->ItkToVtkImporter->SetUpdateInformationCallback( exporter->GetUpdateInformationCallback() );
-    this->ItkToVtkImporter->SetPipelineModifiedCallback( exporter->GetPipelineModifiedCallback() );
-    this->ItkToVtkImporter->SetWholeExtentCallback( exporter->GetWholeExtentCallback() );
-    this->ItkToVtkImporter->SetSpacingCallback( exporter->GetSpacingCallback() );
-    this->ItkToVtkImporter->SetOriginCallback( exporter->GetOriginCallback() );
-    this->ItkToVtkImporter->SetScalarTypeCallback( exporter->GetScalarTypeCallback() );
-    this->ItkToVtkImporter->SetNumberOfComponentsCallback( exporter->GetNumberOfComponentsCallback() );
-    this->ItkToVtkImporter->SetPropagateUpdateExtentCallback( exporter->GetPropagateUpdateExtentCallback() );
-    this->ItkToVtkImporter->SetUpdateDataCallback( exporter->GetUpdateDataCallback() );
-    this->ItkToVtkImporter->SetDataExtentCallback( exporter->GetDataExtentCallback() );
-    this->ItkToVtkImporter->SetBufferPointerCallback( exporter->GetBufferPointerCallback() );
-    this->ItkToVtkImporter->SetCallbackUserData( exporter->GetCallbackUserData() );
+    this->ItkToVtkOutput->SetExtent( extent );
+    this->ItkToVtkOutput->SetSpacing( img->GetSpacing()[0], img->GetSpacing()[1], img->GetSpacing()[2] );
+    this->ItkToVtkOutput->SetOrigin( origin[0], origin[1], origin[2] );
+    this->ItkToVtkOutput->GetPointData()->SetScalars( scalars );
+    this->ItkToVtkOutput->Modified();
+    if( tr ) this->GetImageTransformFromDirectionCosines( img->GetDirection(), tr );
+    return this->ItkToVtkOutput;
 }
 
 #include <assert.h>
@@ -120,39 +118,23 @@ void GetMatRow( vtkMatrix4x4 * mat, int rowIndex, double row[4] )
     row[3] = mat->GetElement( rowIndex, 3 );
 }
 
-bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisItkFloat3ImageType::Pointer itkOutputImage, vtkImageData * img,
-                                                     vtkMatrix4x4 * imageMatrix )
+template <class TImage>
+bool IbisItkVtkConverter::ImportVtkImage( TImage * itkOutputImage, vtkImageData * image, vtkDataArray * scalars,
+                                          vtkMatrix4x4 * imageMatrix, bool deepCopy )
 {
-    if( !itkOutputImage ) return false;
+    typedef typename TImage::PixelType PixelType;
+    typedef typename TImage::PixelContainer PixelContainerType;
 
-    itkOutputImage->Initialize();
-    int numberOfScalarComponents                       = img->GetNumberOfScalarComponents();
-    vtkImageData * grayImage                           = img;
-    vtkSmartPointer<vtkImageLuminance> luminanceFilter = vtkSmartPointer<vtkImageLuminance>::New();
-    if( numberOfScalarComponents > 1 )
-    {
-        luminanceFilter->SetInputData( img );
-        luminanceFilter->Update();
-        grayImage = luminanceFilter->GetOutput();
-    }
-    vtkImageData * image                        = grayImage;
-    vtkSmartPointer<vtkImageShiftScale> shifter = vtkSmartPointer<vtkImageShiftScale>::New();
-    if( img->GetScalarType() != VTK_FLOAT )
-    {
-        shifter->SetOutputScalarType( VTK_FLOAT );
-        shifter->SetClampOverflow( 1 );
-        shifter->SetInputData( grayImage );
-        shifter->SetShift( 0 );
-        shifter->SetScale( 1.0 );
-        shifter->Update();
-        image = shifter->GetOutput();
-    }
+    int * dimensions            = image->GetDimensions();
+    const size_t numberOfPixels = size_t( dimensions[0] ) * dimensions[1] * dimensions[2];
+    if( !scalars ||
+        size_t( scalars->GetDataSize() ) * scalars->GetDataTypeSize() < numberOfPixels * sizeof( PixelType ) )
+        return false;
 
-    int * dimensions = img->GetDimensions();
-    IbisItkFloat3ImageType::SizeType size;
-    IbisItkFloat3ImageType::IndexType start;
-    IbisItkFloat3ImageType::RegionType region;
-    const long unsigned int numberOfPixels = dimensions[0] * dimensions[1] * dimensions[2];
+    itkOutputImage->Initialize();
+    typename TImage::SizeType size;
+    typename TImage::IndexType start;
+    typename TImage::RegionType region;
     for( int i = 0; i < 3; i++ )
     {
         size[i] = dimensions[i];
@@ -195,127 +177,70 @@ bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisItkFloat3ImageType::Poi
     itkOutputImage->SetSpacing( step );
     itkOutputImage->SetOrigin( itkOrigin );
     itkOutputImage->SetDirection( dirCosine );
-    itkOutputImage->Allocate();
-    float * itkImageBuffer = itkOutputImage->GetBufferPointer();
-    memcpy( itkImageBuffer, image->GetScalarPointer(), numberOfPixels * sizeof( float ) );
+
+    PixelType * buffer = static_cast<PixelType *>( scalars->GetVoidPointer( 0 ) );
+    if( deepCopy )
+    {
+        itkOutputImage->Allocate();
+        memcpy( itkOutputImage->GetBufferPointer(), buffer, numberOfPixels * sizeof( PixelType ) );
+        return true;
+    }
+
+    // The pixel container uses the buffer of the scalars and holds a reference to them until it is deleted
+    typename PixelContainerType::Pointer container = PixelContainerType::New();
+    container->SetImportPointer( buffer, numberOfPixels, false );
+    scalars->Register( nullptr );
+    itk::CStyleCommand::Pointer releaseScalars = itk::CStyleCommand::New();
+    releaseScalars->SetClientData( scalars );
+    releaseScalars->SetCallback( ReleaseVtkScalars );
+    container->AddObserver( itk::DeleteEvent(), releaseScalars );
+    itkOutputImage->SetPixelContainer( container );
     return true;
 }
 
-bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisRGBImageType::Pointer itkOutputImage, vtkImageData * image,
-                                                     vtkMatrix4x4 * imageMatrix )
+bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisItkFloat3ImageType::Pointer itkOutputImage, vtkImageData * img,
+                                                     vtkMatrix4x4 * imageMatrix, bool deepCopy )
 {
     if( !itkOutputImage ) return false;
 
-    itkOutputImage->Initialize();
-    int * dimensions = image->GetDimensions();
-    IbisItkFloat3ImageType::SizeType size;
-    IbisItkFloat3ImageType::IndexType start;
-    IbisItkFloat3ImageType::RegionType region;
-    const long unsigned int numberOfPixels = dimensions[0] * dimensions[1] * dimensions[2];
-    for( int i = 0; i < 3; i++ )
+    int numberOfScalarComponents                       = img->GetNumberOfScalarComponents();
+    vtkImageData * grayImage                           = img;
+    vtkSmartPointer<vtkImageLuminance> luminanceFilter = vtkSmartPointer<vtkImageLuminance>::New();
+    if( numberOfScalarComponents > 1 )
     {
-        size[i] = dimensions[i];
+        luminanceFilter->SetInputData( img );
+        luminanceFilter->Update();
+        grayImage = luminanceFilter->GetOutput();
     }
-
-    start.Fill( 0 );
-    region.SetIndex( start );
-    region.SetSize( size );
-    itkOutputImage->SetRegions( region );
-
-    itk::Matrix<double, 3, 3> dirCosine;
-    itk::Vector<double, 3> origin;
-    itk::Vector<double, 3> itkOrigin;
-    // set direction cosines
-    vtkMatrix4x4 * tmpMat = vtkMatrix4x4::New();
-    vtkMatrix4x4::Transpose( imageMatrix, tmpMat );
-    double step[3], mincStartPoint[3], dirCos[3][3];
-    for( int i = 0; i < 3; i++ )
+    vtkImageData * image                        = grayImage;
+    vtkSmartPointer<vtkImageShiftScale> shifter = vtkSmartPointer<vtkImageShiftScale>::New();
+    if( img->GetScalarType() != VTK_FLOAT )
     {
-        double row[4];
-        GetMatRow( tmpMat, i, row );
-        step[i] = vtkMath::Dot( row, row );
-        step[i] = sqrt( step[i] );
-        for( int j = 0; j < 3; j++ )
-        {
-            dirCos[i][j]    = tmpMat->GetElement( i, j ) / step[i];
-            dirCosine[j][i] = dirCos[i][j];
-        }
+        shifter->SetOutputScalarType( VTK_FLOAT );
+        shifter->SetClampOverflow( 1 );
+        shifter->SetInputData( grayImage );
+        shifter->SetShift( 0 );
+        shifter->SetScale( 1.0 );
+        shifter->Update();
+        image = shifter->GetOutput();
     }
 
-    double rotation[3][3];
-    vtkMath::Transpose3x3( dirCos, rotation );
-    double row3[4];
-    GetMatRow( tmpMat, 3, row3 );
-    vtkMath::LinearSolve3x3( rotation, row3, mincStartPoint );
-    tmpMat->Delete();
-
-    for( int i = 0; i < 3; i++ ) origin[i] = mincStartPoint[i];
-    itkOrigin = dirCosine * origin;
-    itkOutputImage->SetSpacing( step );
-    itkOutputImage->SetOrigin( itkOrigin );
-    itkOutputImage->SetDirection( dirCosine );
+    return this->ImportVtkImage( itkOutputImage.GetPointer(), img, image->GetPointData()->GetScalars(), imageMatrix,
+                                 deepCopy );
+}
 
-    itkOutputImage->Allocate();
-    RGBPixelType * itkImageBuffer = itkOutputImage->GetBufferPointer();
-    memcpy( itkImageBuffer, image->GetScalarPointer(), numberOfPixels * sizeof( RGBPixelType ) );
-    return true;
+bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisRGBImageType::Pointer itkOutputImage, vtkImageData * image,
+                                                     vtkMatrix4x4 * imageMatrix, bool deepCopy )
+{
+    if( !itkOutputImage ) return false;
+    return this->ImportVtkImage( itkOutputImage.GetPointer(), image, image->GetPointData()->GetScalars(), imageMatrix,
+                                 deepCopy );
 }
 
 bool IbisItkVtkConverter::ConvertVtkImageToItkImage( IbisItkUnsignedChar3ImageType::Pointer itkOutputImage,
-                                                     vtkImageData * image, vtkMatrix4x4 * imageMatrix )
+                                                     vtkImageData * image, vtkMatrix4x4 * imageMatrix, bool deepCopy )
 {
     if( !itkOutputImage ) return false;
-
-    itkOutputImage->Initialize();
-    IbisItkUnsignedChar3ImageType::SizeType size;
-    IbisItkUnsignedChar3ImageType::IndexType start;
-    IbisItkUnsignedChar3ImageType::RegionType region;
-    int * dimensions                       = image->GetDimensions();
-    const long unsigned int numberOfPixels = dimensions[0] * dimensions[1] * dimensions[2];
-    for( int i = 0; i < 3; i++ )
-    {
-        size[i] = dimensions[i];
-    }
-
-    start.Fill( 0 );
-    region.SetIndex( start );
-    region.SetSize( size );
-    itkOutputImage->SetRegions( region );
-
-    itk::Matrix<double, 3, 3> dirCosine;
-    itk::Vector<double, 3> origin;
-    itk::Vector<double, 3> itkOrigin;
-    // set direction cosines
-    vtkMatrix4x4 * tmpMat = vtkMatrix4x4::New();
-    vtkMatrix4x4::Transpose( imageMatrix, tmpMat );
-    double step[3], mincStartPoint[3], dirCos[3][3];
-    for( int i = 0; i < 3; i++ )
-    {
-        double row[4];
-        GetMatRow( tmpMat, i, row );
-        step[i] = vtkMath::Dot( row, row );
-        step[i] = sqrt( step[i] );
-        for( int j = 0; j < 3; j++ )
-        {
-            dirCos[i][j]    = tmpMat->GetElement( i, j ) / step[i];
-            dirCosine[j][i] = dirCos[i][j];
-        }
-    }
-
-    double rotation[3][3];
-    vtkMath::Transpose3x3( dirCos, rotation );
-    double row3[4];
-    GetMatRow( tmpMat, 3, row3 );
-    vtkMath::LinearSolve3x3( rotation, row3, mincStartPoint );
-    tmpMat->Delete();
-
-    for( int i = 0; i < 3; i++ ) origin[i] = mincStartPoint[i];
-    itkOrigin = dirCosine * origin;
-    itkOutputImage->SetSpacing( step );
-    itkOutputImage->SetOrigin( itkOrigin );
-    itkOutputImage->SetDirection( dirCosine );
-    itkOutputImage->Allocate();
-    unsigned char * itkImageBuffer = itkOutputImage->GetBufferPointer();
-    memcpy( itkImageBuffer, image->GetScalarPointer(), numberOfPixels * sizeof( unsigned char ) );
-    return true;
+    return this->ImportVtkImage( itkOutputImage.GetPointer(), image, image->GetPointData()->GetScalars(), imageMatrix,
+                                 deepCopy );
 }
@@ -4,7 +4,6 @@
 #include <itkImage.h>
 #include <itkImageRegionIterator.h>
 #include <itkRGBPixel.h>
-#include <itkVTKImageExport.h>
 #include <vtkObject.h>
 
 typedef itk::RGBPixel<unsigned char> RGBPixelType;
@@ -13,31 +12,15 @@ typedef itk::Image<float, 3> IbisItkFloat3ImageType;
 typedef itk::Image<unsigned char, 3> IbisItkUnsignedChar3ImageType;
 typedef itk::ImageRegionIterator<IbisItkFloat3ImageType> IbisItkFloat3ImageIteratorType;
 
-//// Reimplement origin callback from itk::VTKImageExport to take dir cosines into account correctly
-template <class TInputImage>
-class IbisItkVTKImageExport : public itk::VTKImageExport<TInputImage>
-{
-public:
-    typedef IbisItkVTKImageExport<TInputImage> Self;
-    typedef itk::SmartPointer<Self> Pointer;
-    typedef TInputImage InputImageType;
-    itkNewMacro( Self );
-
-protected:
-    typedef typename InputImageType::Pointer InputImagePointer;
-    IbisItkVTKImageExport();
-    double * OriginCallback() override;
-    double vtkOrigin[3];
-};
-typedef IbisItkVTKImageExport<IbisItkFloat3ImageType> ItkExporterType;
-typedef IbisItkVTKImageExport<IbisRGBImageType> ItkRGBImageExporterType;
-typedef IbisItkVTKImageExport<IbisItkUnsignedChar3ImageType> IbisItkUnsignedChar3ExporterType;
-
-class vtkImageImport;
 class vtkImageData;
+class vtkDataArray;
 class vtkTransform;
 class vtkMatrix4x4;
 
+// IbisItkVtkConverter converts images between ITK and VTK without copying pixels: the VTK and ITK images share the
+// same buffer. The converted image keeps a reference to the owner of the buffer, the ITK pixel container or the VTK
+// scalars, so the buffer lives as long as one of the images uses it. The image orientation is converted on metadata
+// only. Pass deepCopy = true to get an image with its own copy of the pixels.
 class IbisItkVtkConverter : public vtkObject
 {
 public:
@@ -48,24 +31,33 @@ public:
         IbisItkVtkConverter();
     virtual ~IbisItkVtkConverter();
 
-    vtkImageData * ConvertItkImageToVtkImage( IbisItkFloat3ImageType::Pointer img, vtkTransform * tr = nullptr );
-    vtkImageData * ConvertItkImageToVtkImage( IbisRGBImageType::Pointer img, vtkTransform * tr = nullptr );
-    vtkImageData * ConvertItkImageToVtkImage( IbisItkUnsignedChar3ImageType::Pointer img, vtkTransform * tr = nullptr );
+    // The returned image belongs to the converter, it is updated in place by the next conversion to VTK. tr is set
+    // to the rotation of the ITK image direction.
+    vtkImageData * ConvertItkImageToVtkImage( IbisItkFloat3ImageType::Pointer img, vtkTransform * tr = nullptr,
+                                              bool deepCopy = false );
+    vtkImageData * ConvertItkImageToVtkImage( IbisRGBImageType::Pointer img, vtkTransform * tr = nullptr,
+                                              bool deepCopy = false );
+    vtkImageData * ConvertItkImageToVtkImage( IbisItkUnsignedChar3ImageType::Pointer img, vtkTransform * tr = nullptr,
+                                              bool deepCopy = false );
 
+    // Multi-component images are converted to luminance and other scalar types to float before the float conversion,
+    // the ITK image then shares the buffer of the converted scalars.
     bool ConvertVtkImageToItkImage( IbisItkFloat3ImageType::Pointer itkOutputImage, vtkImageData * image,
-                                    vtkMatrix4x4 * imageMatrix );
+                                    vtkMatrix4x4 * imageMatrix, bool deepCopy = false );
     bool ConvertVtkImageToItkImage( IbisRGBImageType::Pointer itkOutputImage, vtkImageData * image,
-                                    vtkMatrix4x4 * imageMatrix );
+                                    vtkMatrix4x4 * imageMatrix, bool deepCopy = false );
     bool ConvertVtkImageToItkImage( IbisItkUnsignedChar3ImageType::Pointer itkOutputImage, vtkImageData * image,
-                                    vtkMatrix4x4 * imageMatrix );
+                                    vtkMatrix4x4 * imageMatrix, bool deepCopy = false );
 
 protected:
-    void BuildVtkImport( itk::VTKImageExportBase * exporter );
+    template <class TImage>
+    vtkImageData * ImportItkImage( TImage * img, int scalarType, int numberOfComponents, vtkTransform * tr,
+                                   bool deepCopy );
+    template <class TImage>
+    bool ImportVtkImage( TImage * itkOutputImage, vtkImageData * image, vtkDataArray * scalars,
+                         vtkMatrix4x4 * imageMatrix, bool deepCopy );
 
-    ItkExporterType::Pointer ItkToVtkExporter;
-    ItkRGBImageExporterType::Pointer ItkRGBImageToVtkExporter;
-    IbisItkUnsignedChar3ExporterType::Pointer ItkToVtkUnsignedChar3lExporter;
-    vtkImageImport * ItkToVtkImporter;
+    vtkImageData * ItkToVtkOutput;
 
 private:
     void GetImageTransformFromDirectionCosines( itk::Matrix<double, 3, 3> dirCosines, vtkTransform * tr );
@@ -16,7 +16,11 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 ObjectSerializationMacro( IbisPlugin );
 
-IbisPlugin::IbisPlugin() { m_ibisAPI = 0; }
+IbisPlugin::IbisPlugin()
+{
+    m_ibisAPI   = 0;
+    m_activated = false;
+}
 
 void IbisPlugin::BaseLoadSettings( QSettings & s )
 {
@@ -11,8 +11,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #ifndef IBISPLUGIN_H
 #define IBISPLUGIN_H
 
+#include <QMap>
 #include <QObject>
 #include <QString>
+#include <QStringList>
 
 #include "ibistypes.h"
 #include "serializer.h"
@@ -44,6 +46,8 @@ public:
     vtkTypeMacro( IbisPlugin, vtkObject );
 
     IbisAPI * GetIbisAPI() { return m_ibisAPI; }
+    /** Check if InitPlugin has been called, see Application::ActivatePlugin. */
+    bool IsActivated() { return m_activated; }
 
     virtual QString GetPluginName()         = 0;
     virtual IbisPluginTypes GetPluginType() = 0;
@@ -62,6 +66,17 @@ public:
     virtual void SceneFinishedSaving() {}
     ///@}
 
+    /** @name Batch Processing
+     *  @brief Operations that can be run without user interface, e.g. ibis --batch --run Plugin.Operation
+     */
+    ///@{
+    /** Names of the operations accepted by RunBatchOperation. */
+    virtual QStringList GetBatchOperations() { return QStringList(); }
+    /** Run an operation on the current scene with named arguments. Errors should be reported
+     * with IbisAPI::Warning. Return false if the operation failed. */
+    virtual bool RunBatchOperation( const QString & operation, const QMap<QString, QString> & args ) { return false; }
+    ///@}
+
 signals:
 
     void PluginModified();
@@ -70,8 +85,9 @@ protected:
     IbisPlugin();
     virtual ~IbisPlugin() {}
 
-    /** Give a chance to plugin to initialize things right after construction
-     * but with a valid pointer to m_ibiAPI and after settings have been loaded.
+    /** Give a chance to plugin to initialize things with a valid pointer to m_ibiAPI and after settings
+     * have been loaded. Plugins are activated on demand: this function is called the first time the plugin
+     * is used (its tab is shown, its object is created, it is looked up by name...), not at startup.
      * This function can be overriden by every plugin to initialize its internal data. */
     virtual void InitPlugin() {}
 
@@ -93,6 +109,7 @@ private:
     friend class Application;
 
     IbisAPI * m_ibisAPI;
+    bool m_activated;
 
     friend class IbisAPI;
 
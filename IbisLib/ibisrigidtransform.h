@@ -0,0 +1,245 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef IBISRIGIDTRANSFORM_H
+#define IBISRIGIDTRANSFORM_H
+
+#include <cmath>
+#include <cstddef>
+
+// Description:
+// Header-only conversions between the representations of rigid transforms used in Ibis.
+// Matrices are 4x4 row-major arrays of 16 values, the layout of vtkMatrix4x4::GetData().
+// Euler angles follow itk::Euler3DTransform (R = Rz * Rx * Ry, radians) and rigid
+// parameters are the 6 parameters of itk::Euler3DTransform (angles, then translation)
+// for a given center of rotation. Quaternions are stored as (w, x, y, z).
+// None of these functions allocate, so they can be used in optimizer iterations, and
+// the batched versions process contiguous arrays of poses.
+class IbisRigidTransform
+{
+public:
+    template <class T>
+    static void EulerToMatrix( const T angles[3], T matrix[16] )
+    {
+        const T cx = std::cos( angles[0] ), sx = std::sin( angles[0] );
+        const T cy = std::cos( angles[1] ), sy = std::sin( angles[1] );
+        const T cz = std::cos( angles[2] ), sz = std::sin( angles[2] );
+
+        matrix[0]  = cz * cy - sz * sx * sy;
+        matrix[1]  = -sz * cx;
+        matrix[2]  = cz * sy + sz * sx * cy;
+        matrix[3]  = 0;
+        matrix[4]  = sz * cy + cz * sx * sy;
+        matrix[5]  = cz * cx;
+        matrix[6]  = sz * sy - cz * sx * cy;
+        matrix[7]  = 0;
+        matrix[8]  = -cx * sy;
+        matrix[9]  = sx;
+        matrix[10] = cx * cy;
+        matrix[11] = 0;
+        matrix[12] = 0;
+        matrix[13] = 0;
+        matrix[14] = 0;
+        matrix[15] = 1;
+    }
+
+    // Only the rotation part of matrix is used
+    template <class T>
+    static void MatrixToEuler( const T matrix[16], T angles[3] )
+    {
+        angles[0] = std::asin( Clamp( matrix[9] ) );
+        const T A = std::cos( angles[0] );
+        if( std::fabs( A ) > T( 0.00005 ) )
+        {
+            angles[1] = std::atan2( -matrix[8] / A, matrix[10] / A );
+            angles[2] = std::atan2( -matrix[1] / A, matrix[5] / A );
+        }
+        else
+        {
+            angles[1] = std::atan2( matrix[4], matrix[0] );
+            angles[2] = 0;
+        }
+    }
+
+    // params = ( angleX, angleY, angleZ, tx, ty, tz ) with offset = t + center - R * center
+    template <class T>
+    static void MatrixToRigidParameters( const T matrix[16], const T center[3], T params[6] )
+    {
+        MatrixToEuler( matrix, params );
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+            params[i + 3] = matrix[4 * i + 3] - center[i];
+            for( unsigned int j = 0; j < 3; ++j ) params[i + 3] += matrix[4 * i + j] * center[j];
+        }
+    }
+
+    template <class T>
+    static void RigidParametersToMatrix( const T params[6], const T center[3], T matrix[16] )
+    {
+        EulerToMatrix( params, matrix );
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+            matrix[4 * i + 3] = params[i + 3] + center[i];
+            for( unsigned int j = 0; j < 3; ++j ) matrix[4 * i + 3] -= matrix[4 * i + j] * center[j];
+        }
+    }
+
+    template <class T>
+    static void MatrixToQuaternion( const T matrix[16], T quaternion[4] )
+    {
+        const T trace = matrix[0] + matrix[5] + matrix[10];
+        if( trace > 0 )
+        {
+            const T s     = T( 0.5 ) / std::sqrt( trace + 1 );
+            quaternion[0] = T( 0.25 ) / s;
+            quaternion[1] = ( matrix[9] - matrix[6] ) * s;
+            quaternion[2] = ( matrix[2] - matrix[8] ) * s;
+            quaternion[3] = ( matrix[4] - matrix[1] ) * s;
+        }
+        else if( matrix[0] > matrix[5] && matrix[0] > matrix[10] )
+        {
+            const T s     = 2 * std::sqrt( 1 + matrix[0] - matrix[5] - matrix[10] );
+            quaternion[0] = ( matrix[9] - matrix[6] ) / s;
+            quaternion[1] = T( 0.25 ) * s;
+            quaternion[2] = ( matrix[1] + matrix[4] ) / s;
+            quaternion[3] = ( matrix[2] + matrix[8] ) / s;
+        }
+        else if( matrix[5] > matrix[10] )
+        {
+            const T s     = 2 * std::sqrt( 1 + matrix[5] - matrix[0] - matrix[10] );
+            quaternion[0] = ( matrix[2] - matrix[8] ) / s;
+            quaternion[1] = ( matrix[1] + matrix[4] ) / s;
+            quaternion[2] = T( 0.25 ) * s;
+            quaternion[3] = ( matrix[6] + matrix[9] ) / s;
+        }
+        else
+        {
+            const T s     = 2 * std::sqrt( 1 + matrix[10] - matrix[0] - matrix[5] );
+            quaternion[0] = ( matrix[4] - matrix[1] ) / s;
+            quaternion[1] = ( matrix[2] + matrix[8] ) / s;
+            quaternion[2] = ( matrix[6] + matrix[9] ) / s;
+            quaternion[3] = T( 0.25 ) * s;
+        }
+    }
+
+    template <class T>
+    static constexpr void QuaternionToMatrix( const T quaternion[4], T matrix[16] )
+    {
+        const T w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+        const T n = w * w + x * x + y * y + z * z;
+        const T s = n > 0 ? 2 / n : 0;
+
+        matrix[0]  = 1 - s * ( y * y + z * z );
+        matrix[1]  = s * ( x * y - w * z );
+        matrix[2]  = s * ( x * z + w * y );
+        matrix[4]  = s * ( x * y + w * z );
+        matrix[5]  = 1 - s * ( x * x + z * z );
+        matrix[6]  = s * ( y * z - w * x );
+        matrix[8]  = s * ( x * z - w * y );
+        matrix[9]  = s * ( y * z + w * x );
+        matrix[10] = 1 - s * ( x * x + y * y );
+        matrix[3]  = 0;
+        matrix[7]  = 0;
+        matrix[11] = 0;
+        matrix[12] = 0;
+        matrix[13] = 0;
+        matrix[14] = 0;
+        matrix[15] = 1;
+    }
+
+    // out = a * b, out may be a or b
+    template <class T>
+    static constexpr void Compose( const T a[16], const T b[16], T out[16] )
+    {
+        T result[16] = {};
+        for( unsigned int i = 0; i < 4; ++i )
+        {
+            for( unsigned int j = 0; j < 4; ++j )
+            {
+                for( unsigned int k = 0; k < 4; ++k ) result[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+            }
+        }
+        for( unsigned int i = 0; i < 16; ++i ) out[i] = result[i];
+    }
+
+    // Inverse of a rigid matrix: transposed rotation and rotated negative translation. out may be matrix.
+    template <class T>
+    static constexpr void InvertRigid( const T matrix[16], T out[16] )
+    {
+        T result[16] = {};
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+            for( unsigned int j = 0; j < 3; ++j ) result[4 * i + j] = matrix[4 * j + i];
+        }
+        for( unsigned int i = 0; i < 3; ++i )
+        {
+            for( unsigned int j = 0; j < 3; ++j ) result[4 * i + 3] -= result[4 * i + j] * matrix[4 * j + 3];
+        }
+        result[15] = 1;
+        for( unsigned int i = 0; i < 16; ++i ) out[i] = result[i];
+    }
+
+    template <class T>
+    static constexpr void TransformPoint( const T matrix[16], const T in[3], T out[3] )
+    {
+        const T x = in[0], y = in[1], z = in[2];
+        for( unsigned int i = 0; i < 3; ++i )
+            out[i] = matrix[4 * i] * x + matrix[4 * i + 1] * y + matrix[4 * i + 2] * z + matrix[4 * i + 3];
+    }
+
+    // Batched versions: count poses stored contiguously (16 values per matrix, 6 per parameter set, 4 per quaternion)
+    template <class T>
+    static void MatricesToRigidParameters( const T * matrices, std::size_t count, const T center[3], T * params )
+    {
+        for( std::size_t n = 0; n < count; ++n ) MatrixToRigidParameters( matrices + 16 * n, center, params + 6 * n );
+    }
+
+    template <class T>
+    static void RigidParametersToMatrices( const T * params, std::size_t count, const T center[3], T * matrices )
+    {
+        for( std::size_t n = 0; n < count; ++n ) RigidParametersToMatrix( params + 6 * n, center, matrices + 16 * n );
+    }
+
+    template <class T>
+    static void MatricesToQuaternions( const T * matrices, std::size_t count, T * quaternions )
+    {
+        for( std::size_t n = 0; n < count; ++n ) MatrixToQuaternion( matrices + 16 * n, quaternions + 4 * n );
+    }
+
+    template <class T>
+    static constexpr void QuaternionsToMatrices( const T * quaternions, std::size_t count, T * matrices )
+    {
+        for( std::size_t n = 0; n < count; ++n ) QuaternionToMatrix( quaternions + 4 * n, matrices + 16 * n );
+    }
+
+    // out[n] = left * poses[n]
+    template <class T>
+    static constexpr void ComposeLeft( const T left[16], const T * poses, std::size_t count, T * out )
+    {
+        for( std::size_t n = 0; n < count; ++n ) Compose( left, poses + 16 * n, out + 16 * n );
+    }
+
+    // out[n] = poses[n] * right
+    template <class T>
+    static constexpr void ComposeRight( const T * poses, const T right[16], std::size_t count, T * out )
+    {
+        for( std::size_t n = 0; n < count; ++n ) Compose( poses + 16 * n, right, out + 16 * n );
+    }
+
+private:
+    // asin() argument may slightly exceed 1 because of rounding errors
+    template <class T>
+    static constexpr T Clamp( T value )
+    {
+        return value > 1 ? T( 1 ) : ( value < -1 ? T( -1 ) : value );
+    }
+};
+
+#endif
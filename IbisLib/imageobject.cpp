@@ -32,7 +32,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkVolumeProperty.h>
 
 #include <QMessageBox>
+#include <QThread>
+#include <cmath>
 #include <sstream>
+#include <vector>
 
 #include "application.h"
 #include "imageobjectsettingsdialog.h"
@@ -47,6 +50,47 @@ ObjectSerializationMacro( ImageObject );
 
 const int ImageObject::NumberOfBinsInHistogram = 256;
 
+// Images with more voxels are shown at a lower resolution first when progressive loading is on
+const double ImageObject::PreviewMaxNumberOfVoxels = 128.0 * 128.0 * 128.0;
+
+// Prepare the full resolution image of a progressively loaded ImageObject: the vtkImageData shares the buffer of the
+// ITK image, its scalar range and histogram are computed in this thread.
+class ImageObject::FullResolutionLoader : public QThread
+{
+public:
+    FullResolutionLoader( IbisItkFloat3ImageType::Pointer image ) : m_itkImage( image ) {}
+
+    vtkImageData * GetImage() { return m_image; }
+    vtkImageAccumulate * GetHistogramComputer() { return m_histogramComputer; }
+
+protected:
+    void run() override
+    {
+        IbisItkVtkConverter * converter = IbisItkVtkConverter::New();
+        m_image                         = vtkSmartPointer<vtkImageData>::New();
+        m_image->ShallowCopy( converter->ConvertItkImageToVtkImage( m_itkImage ) );
+        converter->Delete();
+
+        // The range is cached in the scalars, it is shared with the image of the ImageObject
+        double range[2];
+        m_image->GetScalarRange( range );
+        m_histogramComputer = vtkSmartPointer<vtkImageAccumulate>::New();
+        m_histogramComputer->SetInputData( m_image );
+        ImageObject::SetupHistogramComputer( m_histogramComputer, m_image );
+    }
+
+    IbisItkFloat3ImageType::Pointer m_itkImage;
+    vtkSmartPointer<vtkImageData> m_image;
+    vtkSmartPointer<vtkImageAccumulate> m_histogramComputer;
+};
+
+// Map the scalar range of the image to the unsigned char range used for volume rendering
+static void SetupVolumeShiftScale( vtkImageShiftScale * shiftScale, double range[2] )
+{
+    shiftScale->SetShift( -range[0] );
+    shiftScale->SetScale( 255.0 / ( range[1] - range[0] ) );
+}
+
 ImageObject::PerViewElements::PerViewElements()
 {
     this->outlineActor = 0;
@@ -69,6 +113,9 @@ ImageObject::ImageObject()
     this->intensityFactor   = 1.0;
     this->HistogramComputer = vtkSmartPointer<vtkImageAccumulate>::New();
 
+    m_progressiveLoading   = false;
+    m_fullResolutionLoader = nullptr;
+
     m_showVolumeClippingBox    = false;
     m_volumeRenderingBounds[0] = 0.0;
     m_volumeRenderingBounds[1] = 1.0;
@@ -118,7 +165,11 @@ ImageObject::ImageObject()
     this->ItktovtkConverter = IbisItkVtkConverter::New();
 }
 
-ImageObject::~ImageObject() { this->ItktovtkConverter->Delete(); }
+ImageObject::~ImageObject()
+{
+    this->StopFullResolutionLoader();
+    this->ItktovtkConverter->Delete();
+}
 
 #include "serializerhelper.h"
 
@@ -201,7 +252,11 @@ void ImageObject::Export()
     this->SaveImageData( saveName );
 }
 
-void ImageObject::ObjectAddedToScene() { this->SetupInCutPlanes(); }
+void ImageObject::ObjectAddedToScene()
+{
+    this->SetupInCutPlanes();
+    if( m_previewItkImage ) this->StartFullResolutionLoader();
+}
 
 bool ImageObject::IsLabelImage()
 {
@@ -247,13 +302,19 @@ bool ImageObject::SanityCheck( IbisItkUnsignedChar3ImageType::Pointer image )
 bool ImageObject::SetItkImage( IbisItkFloat3ImageType::Pointer image )
 {
     if( !SanityCheck( image ) ) return false;
-    this->ItkImage = image;
+    this->StopFullResolutionLoader();
+    this->ItkImage    = image;
+    m_previewItkImage = nullptr;
     if( this->ItkImage )
     {
-        vtkTransform * rotTrans = vtkTransform::New();
-        this->SetInternalImage( this->ItktovtkConverter->ConvertItkImageToVtkImage( this->ItkImage, rotTrans ) );
+        // Show a preview of large images, the full resolution image replaces it once the object is in the scene
+        if( m_progressiveLoading ) m_previewItkImage = this->BuildPreview( this->ItkImage );
+        IbisItkFloat3ImageType::Pointer shownImage = m_previewItkImage ? m_previewItkImage : this->ItkImage;
+        vtkTransform * rotTrans                    = vtkTransform::New();
+        this->SetInternalImage( this->ItktovtkConverter->ConvertItkImageToVtkImage( shownImage, rotTrans ) );
         this->SetLocalTransform( rotTrans );
         rotTrans->Delete();
+        if( m_previewItkImage && this->GetManager() ) this->StartFullResolutionLoader();
     }
     return true;
 }
@@ -261,6 +322,8 @@ bool ImageObject::SetItkImage( IbisItkFloat3ImageType::Pointer image )
 bool ImageObject::SetItkLabelImage( IbisItkUnsignedChar3ImageType::Pointer image )
 {
     if( !SanityCheck( image ) ) return false;
+    this->StopFullResolutionLoader();
+    m_previewItkImage   = nullptr;
     this->ItkLabelImage = image;
     if( this->ItkLabelImage )
     {
@@ -279,11 +342,12 @@ void ImageObject::SetImage( vtkImageData * image, vtkTransform * transform )
         return;
     }
 
-    // Convert vtkImageData to ItkImage and SetItkImage to ensure consistency
+    // Convert vtkImageData to ItkImage and SetItkImage to ensure consistency. The pixels are copied, the caller
+    // may reuse the buffer of image after this call.
     vtkMatrix4x4 * mat = vtkMatrix4x4::New();
     if( transform ) transform->GetMatrix( mat );
     IbisItkFloat3ImageType::Pointer itkImage = IbisItkFloat3ImageType::New();
-    this->ItktovtkConverter->ConvertVtkImageToItkImage( itkImage, image, mat );
+    this->ItktovtkConverter->ConvertVtkImageToItkImage( itkImage, image, mat, true );
     this->SetItkImage( itkImage );
     mat->Delete();
 }
@@ -314,18 +378,136 @@ void ImageObject::SetInternalImage( vtkImageData * image )
 void ImageObject::SetupHistogramComputer()
 {
     if( !this->Image ) return;
+    SetupHistogramComputer( this->HistogramComputer, this->Image );
+}
 
-    Q_ASSERT_X( this->NumberOfBinsInHistogram > 0, "ImageObject::SetupHistogramComputer()",
+void ImageObject::SetupHistogramComputer( vtkImageAccumulate * histogram, vtkImageData * image )
+{
+    Q_ASSERT_X( NumberOfBinsInHistogram > 0, "ImageObject::SetupHistogramComputer()",
                 "Number of bins has to be > 0." );
 
+    double range[2];
+    image->GetScalarRange( range );
+    double binSize = ( range[1] - range[0] ) / NumberOfBinsInHistogram;
+
+    histogram->SetComponentOrigin( range[0], 0, 0 );
+    histogram->SetComponentExtent( 0, NumberOfBinsInHistogram - 1, 0, 0, 0, 0 );
+    histogram->SetComponentSpacing( binSize, 1, 1 );
+    histogram->Update();
+}
+
+// Subsample the image with nearest neighbours so that it has at most PreviewMaxNumberOfVoxels. The first and last
+// voxels along each axis are kept, the preview has the same origin, direction and bounds as the image.
+IbisItkFloat3ImageType::Pointer ImageObject::BuildPreview( IbisItkFloat3ImageType::Pointer image )
+{
+    IbisItkFloat3ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    double numberOfVoxels                 = double( size[0] ) * double( size[1] ) * double( size[2] );
+    if( numberOfVoxels <= PreviewMaxNumberOfVoxels ) return nullptr;
+
+    // Only axes with more than one voxel are subsampled. Keeping the last voxel can add one voxel per axis,
+    // the factor is increased until the preview fits.
+    int numberOfAxes   = 0;
+    size_t largestAxis = 1;
+    for( int i = 0; i < 3; ++i )
+    {
+        if( size[i] > 1 ) ++numberOfAxes;
+        largestAxis = std::max<size_t>( largestAxis, size[i] );
+    }
+    size_t factor = static_cast<size_t>(
+        std::ceil( std::pow( numberOfVoxels / PreviewMaxNumberOfVoxels, 1.0 / std::max( 1, numberOfAxes ) ) ) );
+    IbisItkFloat3ImageType::SizeType previewSize;
+    for( ;; ++factor )
+    {
+        for( int i = 0; i < 3; ++i )
+            previewSize[i] = size[i] > 1 ? std::max<size_t>( 2, ( size[i] - 1 ) / factor + 1 ) : 1;
+        double previewNumberOfVoxels = double( previewSize[0] ) * double( previewSize[1] ) * double( previewSize[2] );
+        if( previewNumberOfVoxels <= PreviewMaxNumberOfVoxels || factor >= largestAxis ) break;
+    }
+
+    IbisItkFloat3ImageType::SpacingType previewSpacing = image->GetSpacing();
+    std::vector<size_t> sampledIndices[3];
+    for( int i = 0; i < 3; ++i )
+    {
+        double step = previewSize[i] > 1 ? double( size[i] - 1 ) / ( previewSize[i] - 1 ) : 1.0;
+        previewSpacing[i] *= step;
+        sampledIndices[i].resize( previewSize[i] );
+        for( size_t j = 0; j < previewSize[i]; ++j )
+            sampledIndices[i][j] = static_cast<size_t>( std::lround( j * step ) );
+    }
+
+    IbisItkFloat3ImageType::Pointer preview = IbisItkFloat3ImageType::New();
+    IbisItkFloat3ImageType::RegionType region;
+    region.SetSize( previewSize );
+    preview->SetRegions( region );
+    preview->SetOrigin( image->GetOrigin() );
+    preview->SetSpacing( previewSpacing );
+    preview->SetDirection( image->GetDirection() );
+    preview->Allocate();
+
+    const float * in = image->GetBufferPointer();
+    float * out      = preview->GetBufferPointer();
+    for( size_t z = 0; z < previewSize[2]; ++z )
+    {
+        for( size_t y = 0; y < previewSize[1]; ++y )
+        {
+            const float * row = in + ( sampledIndices[2][z] * size[1] + sampledIndices[1][y] ) * size[0];
+            for( size_t x = 0; x < previewSize[0]; ++x ) *out++ = row[sampledIndices[0][x]];
+        }
+    }
+    return preview;
+}
+
+void ImageObject::StartFullResolutionLoader()
+{
+    if( m_fullResolutionLoader || !this->ItkImage ) return;
+    m_fullResolutionLoader = new FullResolutionLoader( this->ItkImage );
+    connect( m_fullResolutionLoader, SIGNAL( finished() ), this, SLOT( ShowFullResolution() ) );
+    m_fullResolutionLoader->start();
+}
+
+void ImageObject::StopFullResolutionLoader()
+{
+    if( !m_fullResolutionLoader ) return;
+    m_fullResolutionLoader->disconnect( this );
+    m_fullResolutionLoader->wait();
+    delete m_fullResolutionLoader;
+    m_fullResolutionLoader = nullptr;
+}
+
+void ImageObject::ShowFullResolution()
+{
+    if( !m_previewItkImage ) return;
+    if( !m_fullResolutionLoader ) this->StartFullResolutionLoader();
+    m_fullResolutionLoader->disconnect( this );
+    m_fullResolutionLoader->wait();
+
+    // Views keep a pointer to Image, replace its content
+    double previewRange[2];
+    this->Image->GetScalarRange( previewRange );
+    this->Image->ShallowCopy( m_fullResolutionLoader->GetImage() );
+    this->HistogramComputer = m_fullResolutionLoader->GetHistogramComputer();
+    this->HistogramComputer->SetInputData( this->Image );
+    delete m_fullResolutionLoader;
+    m_fullResolutionLoader = nullptr;
+    m_previewItkImage      = nullptr;
+
     double range[2];
     this->Image->GetScalarRange( range );
-    double binSize = ( range[1] - range[0] ) / this->NumberOfBinsInHistogram;
+    if( this->lutRange[0] == previewRange[0] && this->lutRange[1] == previewRange[1] && this->Lut )
+    {
+        this->lutRange[0] = range[0];
+        this->lutRange[1] = range[1];
+        this->ChooseColorTable( this->lutIndex );
+    }
 
-    this->HistogramComputer->SetComponentOrigin( range[0], 0, 0 );
-    this->HistogramComputer->SetComponentExtent( 0, this->NumberOfBinsInHistogram - 1, 0, 0, 0, 0 );
-    this->HistogramComputer->SetComponentSpacing( binSize, 1, 1 );
-    this->HistogramComputer->Update();
+    ImageObjectViewAssociation::iterator it = this->imageObjectInstances.begin();
+    for( ; it != this->imageObjectInstances.end(); ++it )
+    {
+        PerViewElements * pv = ( *it ).second;
+        if( pv->volumeShiftScale ) SetupVolumeShiftScale( pv->volumeShiftScale, range );
+    }
+
+    emit ObjectModified();
 }
 
 void ImageObject::SetupInCutPlanes()
@@ -542,12 +724,10 @@ void ImageObject::Setup3DRepresentation( View * view )
     volumeMapper->CroppingOn();
     vtkSmartPointer<vtkImageShiftScale> volumeShiftScale = vtkSmartPointer<vtkImageShiftScale>::New();
     volumeShiftScale->SetOutputScalarTypeToUnsignedChar();
-    volumeShiftScale->SetInputData( this->GetImage() );
+    volumeShiftScale->SetInputData( this->Image );
     double imageScalarRange[2];
-    this->GetImage()->GetScalarRange( imageScalarRange );
-    volumeShiftScale->SetShift( -imageScalarRange[0] );
-    double scale = 255.0 / ( imageScalarRange[1] - imageScalarRange[0] );
-    volumeShiftScale->SetScale( scale );
+    this->Image->GetScalarRange( imageScalarRange );
+    SetupVolumeShiftScale( volumeShiftScale, imageScalarRange );
     volumeMapper->SetInputConnection( volumeShiftScale->GetOutputPort() );
     vtkSmartPointer<vtkVolume> volume = vtkSmartPointer<vtkVolume>::New();
     volume->SetMapper( volumeMapper );
@@ -575,6 +755,7 @@ void ImageObject::Setup3DRepresentation( View * view )
     PerViewElements * elem           = new PerViewElements;
     elem->outlineActor               = outActor;
     elem->volume                     = volume;
+    elem->volumeShiftScale           = volumeShiftScale;
     elem->volumeClippingWidget       = volumeClippingWidget;
     this->imageObjectInstances[view] = elem;
 
@@ -694,7 +875,7 @@ void ImageObject::SetLutRange( double r[2] )
     emit ObjectModified();
 }
 
-void ImageObject::GetImageScalarRange( double * range ) { this->Image->GetScalarRange( range ); }
+void ImageObject::GetImageScalarRange( double * range ) { this->GetImage()->GetScalarRange( range ); }
 
 int ImageObject::GetNumberOfScalarComponents()
 {
@@ -708,7 +889,7 @@ void ImageObject::GetBounds( double bounds[6] ) { this->Image->GetBounds( bounds
 
 void ImageObject::GetCenter( double center[3] ) { this->Image->GetCenter( center ); }
 
-double * ImageObject::GetSpacing() { return this->Image->GetSpacing(); }
+double * ImageObject::GetSpacing() { return this->GetImage()->GetSpacing(); }
 
 void ImageObject::SetIntensityFactor( double factor )
 {
@@ -799,6 +980,14 @@ vtkVolumeProperty * ImageObject::GetVolumeProperty() { return m_volumeProperty;
 
 vtkScalarsToColors * ImageObject::GetLut() { return Lut; }
 
-vtkImageData * ImageObject::GetImage() { return Image; }
+vtkImageData * ImageObject::GetImage()
+{
+    if( m_previewItkImage ) this->ShowFullResolution();
+    return Image;
+}
 
-vtkImageAccumulate * ImageObject::GetHistogramComputer() { return HistogramComputer; }
+vtkImageAccumulate * ImageObject::GetHistogramComputer()
+{
+    if( m_previewItkImage ) this->ShowFullResolution();
+    return HistogramComputer;
+}
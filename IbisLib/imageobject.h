@@ -34,6 +34,7 @@ class vtkImageImport;
 class vtkBoxWidget2;
 class vtkScalarsToColors;
 class vtkImageAccumulate;
+class vtkImageShiftScale;
 class vtkVolumeProperty;
 class vtkImageData;
 
@@ -57,6 +58,10 @@ class vtkImageData;
  * Image data is kept in the class as: vtkImageData *Image\n
  * and as an ITK image:\n
  *    IbisItkFloat3ImageType::Pointer ItkImage  or  IbisItkUnsignedChar3ImageType::Pointer ItkLabelImage;
+ *
+ * With progressive loading, a large image is first shown at a lower resolution. The full resolution image is
+ * prepared in a separate thread once the object is in the scene and replaces the preview in the same vtkImageData,
+ * views are updated when it is ready. GetImage() always returns the full resolution image.
 
  *
  *  @sa SceneObject SceneManager LookupTableManager vtkImageData
@@ -80,8 +85,16 @@ public:
     void SaveImageData( QString & name );
     /** Check if this is a label image. */
     bool IsLabelImage();
-    /** Return image data, VTK format. */
+    /** Return image data, VTK format. If a preview is shown, wait for the full resolution image. */
     vtkImageData * GetImage();
+    /** Return image data shown in views, it may be a preview while the full resolution image is prepared. */
+    vtkImageData * GetDisplayImage() { return this->Image; }
+    /** Show a lower resolution preview of large images set with SetItkImage() until the full resolution image is
+     *  ready. Default is off. */
+    void SetProgressiveLoading( bool on ) { m_progressiveLoading = on; }
+    bool GetProgressiveLoading() { return m_progressiveLoading; }
+    /** Is a preview of the image shown? */
+    bool IsShowingPreview() { return m_previewItkImage.IsNotNull(); }
     /** Set ITK image, all except labels. */
     bool SetItkImage( IbisItkFloat3ImageType::Pointer image );
     /** Set ITK image for labels. */
@@ -165,6 +178,8 @@ signals:
 protected slots:
 
     void OnVolumeClippingBoxModified( vtkObject * caller );
+    /** Replace the preview by the full resolution image. */
+    void ShowFullResolution();
 
 protected:
     virtual void Hide() override;
@@ -182,6 +197,17 @@ protected:
 
     // Setup histogram properties after new image is set.
     void SetupHistogramComputer();
+    static void SetupHistogramComputer( vtkImageAccumulate * histogram, vtkImageData * image );
+
+    // Progressive loading
+    class FullResolutionLoader;
+    IbisItkFloat3ImageType::Pointer BuildPreview( IbisItkFloat3ImageType::Pointer image );
+    void StartFullResolutionLoader();
+    void StopFullResolutionLoader();
+    static const double PreviewMaxNumberOfVoxels;
+    bool m_progressiveLoading;
+    IbisItkFloat3ImageType::Pointer m_previewItkImage;
+    FullResolutionLoader * m_fullResolutionLoader;
 
     IbisItkVtkConverter * ItktovtkConverter;
     IbisItkFloat3ImageType::Pointer ItkImage;
@@ -221,6 +247,7 @@ protected:
         ~PerViewElements();
         vtkSmartPointer<vtkActor> outlineActor;
         vtkSmartPointer<vtkVolume> volume;
+        vtkSmartPointer<vtkImageShiftScale> volumeShiftScale;
         vtkSmartPointer<vtkBoxWidget2> volumeClippingWidget;
     };
 
@@ -0,0 +1,279 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "instrumentation.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+
+static QString JsonEscape( const QString & s )
+{
+    QString ret;
+    for( int i = 0; i < s.size(); ++i )
+    {
+        QChar c = s[i];
+        if( c == '"' || c == '\\' )
+            ret += QString( "\\" ) + c;
+        else if( c.unicode() < 0x20 )
+            ret += QString( "\\u%1" ).arg( c.unicode(), 4, 16, QChar( '0' ) );
+        else
+            ret += c;
+    }
+    return ret;
+}
+
+Instrumentation::Statistics::Statistics()
+    : count( 0 ), lastTime( 0.0 ), averageTime( 0.0 ), maximumTime( 0.0 ), totalTime( 0.0 ), lastValue( 0.0 ),
+      isCounter( false )
+{
+}
+
+Instrumentation::ScopedTimer::ScopedTimer( int nameId ) : m_nameId( nameId ), m_start( -1 )
+{
+    Instrumentation & instr = Instrumentation::GetInstance();
+    if( instr.IsEnabled() ) m_start = instr.GetTime();
+}
+
+Instrumentation::ScopedTimer::~ScopedTimer()
+{
+    if( m_start < 0 ) return;
+    Instrumentation & instr = Instrumentation::GetInstance();
+    instr.AddTimer( m_nameId, m_start, instr.GetTime() - m_start );
+}
+
+bool Instrumentation::ThreadBuffer::Push( const Event & e )
+{
+    unsigned int h = head.load( std::memory_order_relaxed );
+    if( h - tail.load( std::memory_order_acquire ) == Capacity ) return false;
+    events[h & ( Capacity - 1 )] = e;
+    head.store( h + 1, std::memory_order_release );
+    return true;
+}
+
+bool Instrumentation::ThreadBuffer::Pop( Event & e )
+{
+    unsigned int t = tail.load( std::memory_order_relaxed );
+    if( t == head.load( std::memory_order_acquire ) ) return false;
+    e = events[t & ( Capacity - 1 )];
+    tail.store( t + 1, std::memory_order_release );
+    return true;
+}
+
+Instrumentation & Instrumentation::GetInstance()
+{
+    static Instrumentation instance;
+    return instance;
+}
+
+Instrumentation::Instrumentation() : m_enabled( false ), m_droppedByFinishedThreads( 0 ), m_historySize( 500000 )
+{
+    m_clock.start();
+}
+
+int Instrumentation::RegisterName( const QString & name )
+{
+    QMutexLocker lock( &m_namesMutex );
+    QHash<QString, int>::const_iterator it = m_nameIds.constFind( name );
+    if( it != m_nameIds.constEnd() ) return it.value();
+    int id = m_names.size();
+    m_names.push_back( name );
+    m_nameIds[name] = id;
+    return id;
+}
+
+QString Instrumentation::GetName( int nameId )
+{
+    QMutexLocker lock( &m_namesMutex );
+    return m_names.value( nameId );
+}
+
+void Instrumentation::AddTimer( int nameId, qint64 start, qint64 duration )
+{
+    if( !IsEnabled() ) return;
+    Event e;
+    e.nameId   = nameId;
+    e.start    = start;
+    e.duration = duration;
+    e.value    = 0.0;
+    Record( e );
+}
+
+void Instrumentation::AddCounter( int nameId, double value )
+{
+    if( !IsEnabled() ) return;
+    Event e;
+    e.nameId   = nameId;
+    e.start    = GetTime();
+    e.duration = -1;
+    e.value    = value;
+    Record( e );
+}
+
+Instrumentation::ThreadBuffer * Instrumentation::GetThreadBuffer()
+{
+    // Releases the buffer when the thread finishes, Collect deletes it once drained
+    struct BufferOwner
+    {
+        ThreadBuffer * buffer = nullptr;
+        ~BufferOwner()
+        {
+            if( buffer ) buffer->released.store( true, std::memory_order_release );
+        }
+    };
+    static thread_local BufferOwner owner;
+    if( !owner.buffer )
+    {
+        std::unique_ptr<ThreadBuffer> newBuffer( new ThreadBuffer );
+        QString threadName;
+        QThread * thread = QThread::currentThread();
+        if( QCoreApplication::instance() && thread == QCoreApplication::instance()->thread() )
+            threadName = "Main";
+        else if( thread && !thread->objectName().isEmpty() )
+            threadName = thread->objectName();
+
+        QMutexLocker lock( &m_buffersMutex );
+        newBuffer->threadId = m_threadNames.size();
+        if( threadName.isEmpty() ) threadName = QString( "Thread %1" ).arg( newBuffer->threadId );
+        m_threadNames.push_back( threadName );
+        owner.buffer = newBuffer.get();
+        m_buffers.push_back( std::move( newBuffer ) );
+    }
+    return owner.buffer;
+}
+
+void Instrumentation::Record( const Event & e )
+{
+    ThreadBuffer * buffer = GetThreadBuffer();
+    Event threadEvent     = e;
+    threadEvent.threadId  = buffer->threadId;
+    if( !buffer->Push( threadEvent ) ) buffer->dropped.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void Instrumentation::Collect()
+{
+    std::vector<ThreadBuffer *> buffers;
+    {
+        QMutexLocker lock( &m_buffersMutex );
+        for( size_t i = 0; i < m_buffers.size(); ++i ) buffers.push_back( m_buffers[i].get() );
+    }
+    {
+        QMutexLocker lock( &m_namesMutex );
+        if( m_statistics.size() < m_names.size() ) m_statistics.resize( m_names.size() );
+    }
+
+    // Buffers released before the drain get no events after it
+    std::vector<bool> released( buffers.size() );
+    for( size_t i = 0; i < buffers.size(); ++i ) released[i] = buffers[i]->released.load( std::memory_order_acquire );
+
+    Event e;
+    for( size_t i = 0; i < buffers.size(); ++i )
+    {
+        while( buffers[i]->Pop( e ) )
+        {
+            // The name may have been registered after the resize above
+            if( e.nameId >= m_statistics.size() ) m_statistics.resize( e.nameId + 1 );
+            Statistics & stats = m_statistics[e.nameId];
+            stats.count++;
+            if( e.duration < 0 )
+            {
+                stats.isCounter = true;
+                stats.lastValue = e.value;
+            }
+            else
+            {
+                double time = e.duration * 1e-6;
+                stats.totalTime += time;
+                stats.lastTime    = time;
+                stats.averageTime = stats.totalTime / stats.count;
+                stats.maximumTime = std::max( stats.maximumTime, time );
+            }
+            m_history.push_back( e );
+        }
+    }
+
+    while( m_history.size() > static_cast<size_t>( std::max( m_historySize, 0 ) ) ) m_history.pop_front();
+
+    // Delete the drained buffers of finished threads, only Collect deletes buffers
+    QMutexLocker lock( &m_buffersMutex );
+    for( size_t i = 0; i < buffers.size(); ++i )
+    {
+        if( !released[i] ) continue;
+        std::vector<std::unique_ptr<ThreadBuffer> >::iterator it =
+            std::find_if( m_buffers.begin(), m_buffers.end(),
+                          [&]( const std::unique_ptr<ThreadBuffer> & b ) { return b.get() == buffers[i]; } );
+        m_droppedByFinishedThreads += ( *it )->dropped;
+        m_buffers.erase( it );
+    }
+}
+
+void Instrumentation::Reset()
+{
+    Collect();
+    m_statistics.fill( Statistics() );
+    m_history.clear();
+    QMutexLocker lock( &m_buffersMutex );
+    for( size_t i = 0; i < m_buffers.size(); ++i ) m_buffers[i]->dropped = 0;
+    m_droppedByFinishedThreads = 0;
+}
+
+unsigned int Instrumentation::GetNumberOfDroppedEvents()
+{
+    QMutexLocker lock( &m_buffersMutex );
+    unsigned int dropped = m_droppedByFinishedThreads;
+    for( size_t i = 0; i < m_buffers.size(); ++i ) dropped += m_buffers[i]->dropped;
+    return dropped;
+}
+
+bool Instrumentation::ExportChromeTrace( const QString & fileName )
+{
+    Collect();
+
+    QFile file( fileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) return false;
+    QTextStream stream( &file );
+
+    QStringList names;
+    {
+        QMutexLocker lock( &m_namesMutex );
+        names = m_names;
+    }
+    for( int i = 0; i < names.size(); ++i ) names[i] = JsonEscape( names[i] );
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Ibis\"}}";
+    {
+        QMutexLocker lock( &m_buffersMutex );
+        for( int i = 0; i < m_threadNames.size(); ++i )
+        {
+            stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+                   << ",\"args\":{\"name\":\"" << JsonEscape( m_threadNames[i] ) << "\"}}";
+        }
+    }
+
+    // Complete events (ph X) for timers, counter events (ph C) for counters, times in microseconds
+    for( std::deque<Event>::const_iterator it = m_history.begin(); it != m_history.end(); ++it )
+    {
+        const Event & e = *it;
+        stream << ",\n{\"name\":\"" << names.value( e.nameId ) << "\",\"cat\":\"ibis\",\"pid\":1,\"tid\":" << e.threadId
+               << ",\"ts\":" << QString::number( e.start * 1e-3, 'f', 3 );
+        if( e.duration >= 0 )
+            stream << ",\"ph\":\"X\",\"dur\":" << QString::number( e.duration * 1e-3, 'f', 3 ) << "}";
+        else
+            stream << ",\"ph\":\"C\",\"args\":{\"value\":" << QString::number( e.value, 'g', 10 ) << "}}";
+    }
+    stream << "\n]}\n";
+    stream.flush();
+    return file.error() == QFile::NoError;
+}
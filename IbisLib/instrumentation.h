@@ -0,0 +1,172 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * @class   Instrumentation
+ * @brief   Timers and counters for the hot paths of the application (Singleton)
+ *
+ * Events are recorded from any thread without locking: each thread writes in its own
+ * fixed size ring buffer, events are dropped when the ring is full. The ring of a thread is
+ * deleted by Collect() once the thread has finished and the ring is drained. Collect() is called
+ * from the GUI thread to move events from the rings to the statistics and to a bounded
+ * history that can be exported in the Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * Names are registered once and events refer to them by id. The IBIS_INSTRUMENT_SCOPE
+ * macro registers the name in a static variable and times the end of the current scope:
+ * @code
+ * void SceneManager::UpdateWorldTransforms()
+ * {
+ *     IBIS_INSTRUMENT_SCOPE( "Transform propagation" );
+ *     ...
+ * }
+ * @endcode
+ *
+ * Recording is disabled by default, disabled timers only cost a test of an atomic flag.
+ *
+ * @sa InstrumentationWidget
+ */
+class Instrumentation
+{
+public:
+    /** Timer: duration >= 0, counter: duration < 0 and value is set. Times in nanoseconds. */
+    struct Event
+    {
+        int nameId;
+        int threadId;
+        qint64 start;
+        qint64 duration;
+        double value;
+    };
+
+    struct Statistics
+    {
+        Statistics();
+        int count;
+        double lastTime;  // milliseconds
+        double averageTime;
+        double maximumTime;
+        double totalTime;
+        double lastValue;  // counters only
+        bool isCounter;
+    };
+
+    /** Times a scope, use with IBIS_INSTRUMENT_SCOPE. */
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer( int nameId );
+        ~ScopedTimer();
+
+    private:
+        int m_nameId;
+        qint64 m_start;
+    };
+
+    static Instrumentation & GetInstance();
+
+    void SetEnabled( bool enabled ) { m_enabled.store( enabled, std::memory_order_relaxed ); }
+    bool IsEnabled() { return m_enabled.load( std::memory_order_relaxed ); }
+
+    /** Get the id of a name, registering it if needed. Thread safe but locks, ids should be kept. */
+    int RegisterName( const QString & name );
+    QString GetName( int nameId );
+
+    /** Nanoseconds since the instrumentation was created. */
+    qint64 GetTime() { return m_clock.nsecsElapsed(); }
+
+    /** @name Producer side
+     *  @brief Can be called from any thread, do nothing when disabled.
+     */
+    ///@{
+    void AddTimer( int nameId, qint64 start, qint64 duration );
+    void AddCounter( int nameId, double value );
+    ///@}
+
+    /** @name Consumer side
+     *  @brief Should be called from the GUI thread.
+     */
+    ///@{
+    /** Move events recorded by all threads to the statistics and history. */
+    void Collect();
+    /** Statistics indexed by name id, names without events have a count of 0. */
+    QVector<Statistics> GetStatistics() { return m_statistics; }
+    void Reset();
+    /** Number of events lost because a thread ring was full. */
+    unsigned int GetNumberOfDroppedEvents();
+    /** Maximum number of events kept for export, older events are discarded first. */
+    void SetHistorySize( int size ) { m_historySize = size; }
+    int GetHistorySize() { return m_historySize; }
+    /** Write the history in the Chrome trace event format (JSON), also read by Perfetto. */
+    bool ExportChromeTrace( const QString & fileName );
+    ///@}
+
+private:
+    Instrumentation();
+    Instrumentation( const Instrumentation & ) = delete;
+    Instrumentation & operator=( const Instrumentation & ) = delete;
+
+    // Single producer (the owning thread), single consumer (Collect) lock-free ring
+    struct ThreadBuffer
+    {
+        static const unsigned int Capacity = 8192;
+        ThreadBuffer() : head( 0 ), tail( 0 ), dropped( 0 ), released( false ) {}
+        bool Push( const Event & e );
+        bool Pop( Event & e );
+        int threadId;
+        Event events[Capacity];
+        std::atomic<unsigned int> head;
+        std::atomic<unsigned int> tail;
+        std::atomic<unsigned int> dropped;
+        // Set when the owning thread finishes, after its last Push
+        std::atomic<bool> released;
+    };
+
+    ThreadBuffer * GetThreadBuffer();
+    void Record( const Event & e );
+
+    std::atomic<bool> m_enabled;
+    QElapsedTimer m_clock;
+
+    QMutex m_namesMutex;
+    QStringList m_names;
+    QHash<QString, int> m_nameIds;
+
+    // Buffers of finished threads are deleted by Collect once drained. Names are kept for the
+    // events of these threads still in the history.
+    QMutex m_buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer> > m_buffers;
+    QStringList m_threadNames;  // indexed by thread id
+    unsigned int m_droppedByFinishedThreads;
+
+    QVector<Statistics> m_statistics;
+    std::deque<Event> m_history;
+    int m_historySize;
+};
+
+#define IBIS_INSTRUMENT_SCOPE( name )                                                            \
+    static const int ibisInstrumentNameId = Instrumentation::GetInstance().RegisterName( name ); \
+    Instrumentation::ScopedTimer ibisInstrumentTimer( ibisInstrumentNameId )
+
+#endif
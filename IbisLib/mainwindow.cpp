@@ -27,6 +27,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QSettings>
 #include <QSplitter>
 #include <QStatusBar>
+#include <iostream>
 
 #include "aboutbicigns.h"
 #include "aboutpluginswidget.h"
@@ -36,6 +37,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "ibisapi.h"
 #include "ibisconfig.h"
 #include "imageobject.h"
+#include "instrumentationwidget.h"
 #include "objectplugininterface.h"
 #include "opendatafiledialog.h"
 #include "pointsobject.h"
@@ -151,6 +153,7 @@ MainWindow::MainWindow( QWidget * parent )
     helpMenu->addAction( tr( "About..." ), this, SLOT( about() ) );
     QAction * aboutPluginAction = helpMenu->addAction( tr( "About Plugins..." ), this, SLOT( AboutPlugins() ) );
     aboutPluginAction->setMenuRole( QAction::ApplicationSpecificRole );
+    helpMenu->addAction( tr( "Performance Statistics..." ), this, SLOT( PerformanceStatistics() ) );
 
     // -----------------------------------------
     // Create left panel
@@ -188,6 +191,7 @@ MainWindow::MainWindow( QWidget * parent )
     m_rightPanel = new QTabWidget( this );
     m_rightPanel->setTabsClosable( true );
     connect( m_rightPanel, SIGNAL( tabCloseRequested( int ) ), this, SLOT( PluginTabClosed( int ) ) );
+    connect( m_rightPanel, SIGNAL( currentChanged( int ) ), this, SLOT( PluginTabChanged( int ) ) );
 
     // -----------------------------------------
     // Create main splitter
@@ -223,12 +227,28 @@ MainWindow::MainWindow( QWidget * parent )
 
 void MainWindow::OnStartMainLoop()
 {
-    // Open all files specified before init (command-line)
+    // Open the scene and all files specified before init (command-line)
+    StartupProfiler * profiler = Application::GetInstance().GetStartupProfiler();
+    profiler->BeginSection( "Scene restore" );
+    QString sceneFile = Application::GetInstance().GetInitialScene();
+    if( !sceneFile.isEmpty() && !Application::GetInstance().LoadScene( sceneFile ) )
+    {
+        // Operations of the command line would run on the wrong scene
+        std::cerr << "Error: can't load scene " << sceneFile.toUtf8().data() << std::endl;
+        if( Application::GetInstance().CancelStartupOperations( Application::BatchLoadFailed ) )
+        {
+            profiler->EndSection();
+            return;
+        }
+    }
     OpenFileParams params;
     params.SetAllFileNames( Application::GetInstance().GetInitialDataFiles() );
     OpenFiles( &params );
+    profiler->EndSection();
 
     Application::GetInstance().OnStartMainLoop();
+    Application::GetInstance().FinishStartup();
+    Application::GetInstance().RunStartupOperations();
 }
 
 void MainWindow::CreatePluginsUi()
@@ -248,7 +268,14 @@ void MainWindow::CreatePluginsUi()
             connect( action, SIGNAL( toggled( bool ) ), this, SLOT( ToolPluginsMenuActionToggled( bool ) ) );
             m_pluginMenu->addAction( action );
             m_pluginActions[toolPlugin] = action;
-            if( toolPlugin->GetSettings().active ) action->toggle();
+            if( toolPlugin->GetSettings().active )
+            {
+                // Plugin tabs are only created when shown
+                if( toolPlugin->GetSettings().tab )
+                    AddPluginTabPlaceholder( action, toolPlugin );
+                else
+                    action->toggle();
+            }
         }
     }
     connect( &( Application::GetInstance() ), SIGNAL( QueryActivatePluginSignal( ToolPluginInterface *, bool ) ), this,
@@ -300,6 +327,15 @@ void MainWindow::AboutPlugins()
     w->show();
 }
 
+void MainWindow::PerformanceStatistics()
+{
+    InstrumentationWidget * w = new InstrumentationWidget;
+    w->setAttribute( Qt::WA_DeleteOnClose, true );
+    w->setWindowFlags( Qt::WindowStaysOnTopHint | Qt::WindowTitleHint | Qt::WindowCloseButtonHint |
+                       Qt::CustomizeWindowHint );
+    w->show();
+}
+
 void MainWindow::fileOpenFile()
 {
     // Get filenames
@@ -584,6 +620,10 @@ void MainWindow::ToggleToolPlugin( ToolPluginInterface * toolPlugin, bool isOn )
 {
     QAction * action = m_pluginActions[toolPlugin];
     if( action->isChecked() != isOn ) action->toggle();
+
+    // Make sure the plugin tab exists
+    QWidget * tab = m_pluginTabs.value( action );
+    if( isOn && m_pluginTabPlaceholders.contains( tab ) ) m_rightPanel->setCurrentWidget( tab );
 }
 
 void MainWindow::ToolPluginsMenuActionToggled( bool isOn )
@@ -606,6 +646,7 @@ void MainWindow::ToolPluginsMenuActionToggled( bool isOn )
                 UpdateMainSplitter();
             }
             toolPlugin->GetSettings().active = true;
+            toolPlugin->GetSettings().tab    = true;
         }
         else
         {
@@ -619,6 +660,7 @@ void MainWindow::ToolPluginsMenuActionToggled( bool isOn )
                 connect( pluginWidget, SIGNAL( destroyed() ), this, SLOT( FloatingPluginWidgetClosed() ) );
                 m_pluginWidgets[action]          = pluginWidget;
                 toolPlugin->GetSettings().active = true;
+                toolPlugin->GetSettings().tab    = false;
                 if( toolPlugin->GetSettings().winSize != QSize( -1, -1 ) )
                 {
                     pluginWidget->resize( toolPlugin->GetSettings().winSize );
@@ -698,10 +740,11 @@ void MainWindow::ClosePluginTab( QAction * action, int index )
     QString pluginName               = action->data().toString();
     ToolPluginInterface * toolPlugin = Application::GetInstance().GetToolPluginByName( pluginName );
     Q_ASSERT_X( toolPlugin, "MainWindow::ClosePluginTab()", "Plugin doesn't exist but should." );
-    if( !toolPlugin->WidgetAboutToClose() ) return;
+    QWidget * w     = m_rightPanel->widget( index );
+    bool neverShown = m_pluginTabPlaceholders.remove( w );
+    if( !neverShown && !toolPlugin->WidgetAboutToClose() ) return;
 
     // remove tab
-    QWidget * w = m_rightPanel->widget( index );
     m_rightPanel->removeTab( index );
 
     // close the widget to destroy it
@@ -717,6 +760,59 @@ void MainWindow::ClosePluginTab( QAction * action, int index )
     toolPlugin->GetSettings().active = false;
 }
 
+void MainWindow::AddPluginTabPlaceholder( QAction * action, ToolPluginInterface * toolPlugin )
+{
+    QWidget * placeholder = new QWidget;
+    placeholder->setAttribute( Qt::WA_DeleteOnClose );
+    m_pluginTabPlaceholders.insert( placeholder );
+    m_pluginTabs[action] = placeholder;
+
+    // check the action without creating the plugin widget
+    action->blockSignals( true );
+    action->setChecked( true );
+    action->blockSignals( false );
+
+    m_rightPanel->addTab( placeholder, toolPlugin->GetMenuEntryString() );
+    if( m_pluginTabs.size() == 1 ) UpdateMainSplitter();
+}
+
+void MainWindow::PluginTabChanged( int tabIndex )
+{
+    QWidget * placeholder = m_rightPanel->widget( tabIndex );
+    if( !placeholder || !m_pluginTabPlaceholders.contains( placeholder ) ) return;
+    m_pluginTabPlaceholders.remove( placeholder );
+
+    // First time the tab is shown: activate the plugin and create the real tab
+    QAction * action                 = m_pluginTabs.key( placeholder );
+    ToolPluginInterface * toolPlugin = Application::GetInstance().GetToolPluginByName( action->data().toString() );
+    Q_ASSERT_X( toolPlugin, "MainWindow::PluginTabChanged()", "Plugin doesn't exist but should." );
+    QWidget * pluginWidget = toolPlugin->CreateTab();
+
+    m_rightPanel->blockSignals( true );
+    m_rightPanel->removeTab( tabIndex );
+    if( pluginWidget )
+    {
+        pluginWidget->setAttribute( Qt::WA_DeleteOnClose );
+        m_pluginTabs[action] = pluginWidget;
+        m_rightPanel->insertTab( tabIndex, pluginWidget, toolPlugin->GetMenuEntryString() );
+        m_rightPanel->setCurrentIndex( tabIndex );
+    }
+    else
+        m_pluginTabs.remove( action );
+    m_rightPanel->blockSignals( false );
+    placeholder->close();
+
+    // The plugin doesn't provide a tab anymore, try the floating widget
+    if( !pluginWidget )
+    {
+        if( m_pluginTabs.size() == 0 ) UpdateMainSplitter();
+        action->blockSignals( true );
+        action->setChecked( false );
+        action->blockSignals( false );
+        action->setChecked( true );
+    }
+}
+
 void MainWindow::ObjectPluginsMenuActionTriggered()
 {
     QAction * action          = qobject_cast<QAction *>( sender() );
@@ -770,7 +866,9 @@ void MainWindow::closeEvent( QCloseEvent * event )
     Application::GetInstance().GetAllToolPlugins( allTools );
     foreach( ToolPluginInterface * toolPlugin, allTools )
     {
-        if( toolPlugin->IsPluginActive() ) toolPlugin->WidgetAboutToClose();
+        // plugins that were restored but never shown have no widget
+        QWidget * tab = m_pluginTabs.value( m_pluginActions.value( toolPlugin ) );
+        if( toolPlugin->IsPluginActive() && !m_pluginTabPlaceholders.contains( tab ) ) toolPlugin->WidgetAboutToClose();
     }
 
     // Close all open windows appart from the main window
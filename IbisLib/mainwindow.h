@@ -15,6 +15,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QMainWindow>
 #include <QMap>
 #include <QObject>
+#include <QSet>
 
 #include "serializer.h"
 
@@ -65,6 +66,7 @@ private slots:
 
     void about();
     void AboutPlugins();
+    void PerformanceStatistics();
     void fileOpenFile();
     void fileExportFile();
     void fileImportUsAcquisition();
@@ -96,6 +98,7 @@ private slots:
     void ToolPluginsMenuActionToggled( bool );
     void FloatingPluginWidgetClosed();
     void PluginTabClosed( int tabIndex );
+    void PluginTabChanged( int tabIndex );
     void ObjectPluginsMenuActionTriggered();
     void GeneratePluginsMenuActionTriggered();
     void MainSplitterMoved( int pos, int index );
@@ -109,6 +112,7 @@ protected:
                                bool checked );
     void closeEvent( QCloseEvent * event );
     void ClosePluginTab( QAction * action, int index );
+    void AddPluginTabPlaceholder( QAction * action, ToolPluginInterface * toolPlugin );
     void UpdateMainSplitter();
 
     // Handling of Drag and Drop
@@ -143,6 +147,8 @@ protected:
     typedef QMap<QAction *, QWidget *> PluginWidgetMap;
     PluginWidgetMap m_pluginWidgets;
     PluginWidgetMap m_pluginTabs;
+    // Empty tabs of plugins restored at startup, the plugin tab is created when the tab is first shown
+    QSet<QWidget *> m_pluginTabPlaceholders;
 
     typedef QMap<ToolPluginInterface *, QAction *> PluginActionMap;
     PluginActionMap m_pluginActions;
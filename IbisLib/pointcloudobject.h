@@ -55,6 +55,7 @@ public:
     vtkGetObjectMacro( Property, vtkProperty );
 
     void SetPointCloudArray( vtkPoints * pointCloudArray );
+    vtkPoints * GetPointCloudArray() { return m_PointCloudArray; }
 
 signals:
 
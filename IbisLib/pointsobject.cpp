@@ -23,6 +23,9 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QFileDialog>
 #include <QMessageBox>
 
+#include <algorithm>
+#include <vector>
+
 #include "application.h"
 #include "ibisconfig.h"
 #include "pointcolorwidget.h"
@@ -84,13 +87,22 @@ void PointsObject::Serialize( Serializer * ser )
     ::Serialize( ser, "LineToPointerColor", m_lineToPointerColor, 3 );
     ::Serialize( ser, "Opacity", m_opacity );
     ::Serialize( ser, "SelectedPointIndex", m_selectedPointIndex );
-    int numberOfPoints;
+    int numberOfPoints = 0;
     double coords[3];
     QString pointName, timeStamp( "n/a" );
     if( !ser->IsReader() )
     {
         numberOfPoints = m_pointCoordinates->GetNumberOfPoints();
         ::Serialize( ser, "NumberOfPoints", numberOfPoints );
+        // Large point sets: coordinates of all points in a single binary array
+        bool coordinatesArray = ser->IsBinaryArray( 3 * numberOfPoints );
+        if( coordinatesArray )
+        {
+            std::vector<double> allCoords( 3 * numberOfPoints );
+            for( int i = 0; i < numberOfPoints; i++ ) m_pointCoordinates->GetPoint( i, &allCoords[3 * i] );
+            double * allCoordsData = allCoords.data();
+            ::Serialize( ser, "AllPointCoordinates", allCoordsData, 3 * numberOfPoints );
+        }
         for( int i = 0; i < numberOfPoints; i++ )
         {
             pointName = m_pointNames.at( i );
@@ -99,7 +111,7 @@ void PointsObject::Serialize( Serializer * ser )
             QString sectionName = QString( "Point_%1" ).arg( i );
             ser->BeginSection( sectionName.toUtf8().data() );
             ::Serialize( ser, "PointName", pointName );
-            ::Serialize( ser, "PointCoordinates", coords, 3 );
+            if( !coordinatesArray ) ::Serialize( ser, "PointCoordinates", coords, 3 );
             ::Serialize( ser, "PointTimeStamp", timeStamp );
             ser->EndSection();
         }
@@ -113,16 +125,36 @@ void PointsObject::Serialize( Serializer * ser )
         m_pointNames.clear();
         m_timeStamps.clear();
         m_pointCoordinates->Reset();
-        for( int i = 0; i < numberOfPoints; i++ )
+        std::vector<double> allCoords( 3 * std::max( numberOfPoints, 0 ) );
+        double * allCoordsData = allCoords.data();
+        bool coordinatesArray =
+            numberOfPoints > 0 && ::Serialize( ser, "AllPointCoordinates", allCoordsData, 3 * numberOfPoints );
+        // Points are only added once all coordinates have been read: when AllPointCoordinates is in the
+        // scene but its data file is missing or unreadable, there are no per point coordinates either.
+        QStringList pointNames, timeStamps;
+        bool coordinatesRead = true;
+        for( int i = 0; i < numberOfPoints && coordinatesRead; i++ )
         {
             QString sectionName = QString( "Point_%1" ).arg( i );
             ser->BeginSection( sectionName.toUtf8().data() );
             ::Serialize( ser, "PointName", pointName );
-            ::Serialize( ser, "PointCoordinates", coords, 3 );
+            if( !coordinatesArray )
+                coordinatesRead = ::Serialize( ser, "PointCoordinates", &allCoords[3 * i], 3 );
             ::Serialize( ser, "PointTimeStamp", timeStamp );
             ser->EndSection();
-            this->AddPointLocal( coords, pointName, timeStamp );
+            pointNames.push_back( pointName );
+            timeStamps.push_back( timeStamp );
         }
+        if( !coordinatesRead )
+        {
+            QString message =
+                QString( "Can't read the point coordinates of %1, no points were loaded." ).arg( this->Name );
+            Application::GetInstance().Warning( "Error", message );
+            numberOfPoints       = 0;
+            m_selectedPointIndex = InvalidPointIndex;
+        }
+        for( int i = 0; i < numberOfPoints; i++ )
+            this->AddPointLocal( &allCoords[3 * i], pointNames[i], timeStamps[i] );
         if( numberOfPoints > 0 && m_selectedPointIndex == InvalidPointIndex ) m_selectedPointIndex = 0;
 
         if( m_selectedPointIndex != InvalidPointIndex ) this->SetSelectedPoint( m_selectedPointIndex );
@@ -109,8 +109,18 @@ void PolyDataObject::Export()
     QString fullName( this->GetManager()->GetSceneDirectory() );
     fullName.append( "/" );
     fullName.append( surfaceName );
-    QString saveName = Application::GetInstance().GetFileNameSave( tr( "Save Object" ), fullName, tr( "*.vtk" ) );
+    QString vtkFilter       = tr( "VTK (*.vtk)" );
+    QString mniFilter       = tr( "MNI obj (*.obj)" );
+    QString mniBinaryFilter = tr( "MNI obj binary (*.obj)" );
+    QString selectedFilter  = vtkFilter;
+    QString saveName        = Application::GetInstance().GetFileNameSave(
+        tr( "Save Object" ), fullName, vtkFilter + ";;" + mniFilter + ";;" + mniBinaryFilter, &selectedFilter );
     if( saveName.isEmpty() ) return;
+    if( selectedFilter != vtkFilter && !saveName.endsWith( ".obj", Qt::CaseInsensitive ) )
+    {
+        if( saveName.endsWith( ".vtk", Qt::CaseInsensitive ) ) saveName.chop( 4 );
+        saveName.append( ".obj" );
+    }
     if( QFile::exists( saveName ) )
     {
         int ret =
@@ -118,7 +128,7 @@ void PolyDataObject::Export()
                                   QMessageBox::No, QMessageBox::No );
         if( ret == QMessageBox::No ) return;
     }
-    this->SavePolyData( saveName );
+    this->SavePolyData( saveName, selectedFilter == mniBinaryFilter );
 }
 
 void PolyDataObject::CreateSettingsWidgets( QWidget * parent, QVector<QWidget *> * widgets )
@@ -0,0 +1,119 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "renderscheduler.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+
+#include "instrumentation.h"
+#include "view.h"
+
+RenderScheduler::ViewStatistics::ViewStatistics()
+    : numberOfRequests( 0 ), numberOfRenders( 0 ), lastRenderTime( 0.0 ), averageRenderTime( 0.0 ),
+      maximumRenderTime( 0.0 )
+{
+}
+
+RenderScheduler::RenderScheduler()
+{
+    m_timer = new QTimer( this );
+    m_timer->setSingleShot( true );
+    m_timer->setTimerType( Qt::PreciseTimer );
+    connect( m_timer, SIGNAL( timeout() ), this, SLOT( RenderFrame() ) );
+    m_targetFramePeriod     = 1000.0 / 60.0;
+    m_nextFrameTime         = 0.0;
+    m_numberOfFrames        = 0;
+    m_numberOfSkippedFrames = 0;
+    m_clock.start();
+}
+
+RenderScheduler::~RenderScheduler() {}
+
+void RenderScheduler::SetTargetFrameRate( double fps )
+{
+    if( fps > 0.0 ) m_targetFramePeriod = 1000.0 / fps;
+}
+
+void RenderScheduler::RequestRender( View * view )
+{
+    m_statistics[view].numberOfRequests++;
+    if( !m_dirtyViews.contains( view ) ) m_dirtyViews.push_back( view );
+    ScheduleFrame();
+}
+
+void RenderScheduler::RemoveView( View * view )
+{
+    m_dirtyViews.removeAll( view );
+    m_statistics.remove( view );
+    m_instrumentationNameIds.remove( view );
+}
+
+void RenderScheduler::ResetStatistics()
+{
+    m_statistics.clear();
+    m_numberOfFrames        = 0;
+    m_numberOfSkippedFrames = 0;
+}
+
+void RenderScheduler::ScheduleFrame()
+{
+    if( m_timer->isActive() || m_dirtyViews.isEmpty() ) return;
+    double now   = m_clock.nsecsElapsed() * 1e-6;
+    double delay = std::max( 0.0, m_nextFrameTime - now );
+    m_timer->start( static_cast<int>( std::ceil( delay ) ) );
+}
+
+void RenderScheduler::RenderFrame()
+{
+    IBIS_INSTRUMENT_SCOPE( "Render frame" );
+    Instrumentation & instr = Instrumentation::GetInstance();
+    double frameStart       = m_clock.nsecsElapsed() * 1e-6;
+
+    // Views invalidated while rendering this frame go to the next one
+    QList<View *> views;
+    views.swap( m_dirtyViews );
+    QElapsedTimer renderTimer;
+    foreach( View * view, views )
+    {
+        qint64 instrumentationStart = instr.GetTime();
+        renderTimer.start();
+        if( !view->Render() ) continue;  // rendering disabled, the view will ask again when enabled
+        double renderTime = renderTimer.nsecsElapsed() * 1e-6;
+        if( instr.IsEnabled() )
+        {
+            if( !m_instrumentationNameIds.contains( view ) )
+                m_instrumentationNameIds[view] = instr.RegisterName( "Render " + view->GetName() );
+            instr.AddTimer( m_instrumentationNameIds[view], instrumentationStart,
+                            instr.GetTime() - instrumentationStart );
+        }
+
+        ViewStatistics & stats = m_statistics[view];
+        stats.numberOfRenders++;
+        stats.lastRenderTime    = renderTime;
+        stats.averageRenderTime =
+            stats.averageRenderTime + ( renderTime - stats.averageRenderTime ) / stats.numberOfRenders;
+        stats.maximumRenderTime = std::max( stats.maximumRenderTime, renderTime );
+    }
+    ++m_numberOfFrames;
+
+    // Pace the next frame on the frame grid, skipping the slots already missed
+    double frameEnd = m_clock.nsecsElapsed() * 1e-6;
+    int missed      = static_cast<int>( ( frameEnd - frameStart ) / m_targetFramePeriod );
+    m_nextFrameTime = frameStart + ( missed + 1 ) * m_targetFramePeriod;
+
+    m_numberOfSkippedFrames += missed;
+    static const int skippedFramesNameId = instr.RegisterName( "Skipped frames" );
+    instr.AddCounter( skippedFramesNameId, m_numberOfSkippedFrames );
+
+    ScheduleFrame();
+}
@@ -0,0 +1,81 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+
+class QTimer;
+class View;
+
+// Description:
+// Renders the views that need it at most once per frame. View::NotifyNeedRender()
+// only marks the view as dirty and asks the scheduler for a frame: all requests
+// received before the frame starts are coalesced and only dirty views are rendered.
+// Frames are paced to the target frame rate. When rendering a frame takes longer
+// than the frame period, the frames that could not be rendered in time are skipped
+// instead of being queued. The scheduler is independent from the UpdateManager, so
+// hardware updates (IbisClockTick) keep their own rate whatever the rendering load.
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct ViewStatistics
+    {
+        ViewStatistics();
+        int numberOfRequests;  // calls to RequestRender, including coalesced ones
+        int numberOfRenders;
+        double lastRenderTime;  // milliseconds
+        double averageRenderTime;
+        double maximumRenderTime;
+    };
+
+    RenderScheduler();
+    ~RenderScheduler();
+
+    void SetTargetFrameRate( double fps );
+    double GetTargetFrameRate() { return 1000.0 / m_targetFramePeriod; }
+
+    /** Ask for view to be rendered in the next frame. */
+    void RequestRender( View * view );
+    /** Forget a view that is about to be deleted. */
+    void RemoveView( View * view );
+
+    /** Render time statistics of a view, in milliseconds. */
+    ViewStatistics GetViewStatistics( View * view ) { return m_statistics.value( view ); }
+    /** Number of frames skipped because rendering was slower than the target frame rate. */
+    int GetNumberOfSkippedFrames() { return m_numberOfSkippedFrames; }
+    int GetNumberOfFrames() { return m_numberOfFrames; }
+    void ResetStatistics();
+
+private slots:
+
+    void RenderFrame();
+
+private:
+    void ScheduleFrame();
+
+    QTimer * m_timer;
+    QElapsedTimer m_clock;
+    double m_targetFramePeriod;  // milliseconds
+    double m_nextFrameTime;      // milliseconds on m_clock
+    QList<View *> m_dirtyViews;
+    QMap<View *, ViewStatistics> m_statistics;
+    QMap<View *, int> m_instrumentationNameIds;  // "Render <view name>" timers, see Instrumentation
+    int m_numberOfFrames;
+    int m_numberOfSkippedFrames;
+};
+
+#endif
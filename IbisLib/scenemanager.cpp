@@ -15,6 +15,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkInteractorStyleImage.h>
 #include <vtkInteractorStyleJoystickCamera.h>
 #include <vtkInteractorStyleTerrain.h>
+#include <vtkMatrix4x4.h>
 #include <vtkMultiImagePlaneWidget.h>
 #include <vtkTransform.h>
 
@@ -24,15 +25,20 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPluginLoader>
+#include <QTimer>
 #include <algorithm>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 #include "application.h"
 #include "cameraobject.h"
 #include "filereader.h"
 #include "hardwaremodule.h"
 #include "ibisapi.h"
+#include "ibisrigidtransform.h"
 #include "imageobject.h"
+#include "instrumentation.h"
 #include "mainwindow.h"
 #include "objectplugininterface.h"
 #include "objecttreewidget.h"
@@ -109,6 +115,9 @@ void SceneManager::Init()
     m_referenceTransform    = vtkTransform::New();
     m_invReferenceTransform = vtkTransform::New();
 
+    m_transformOrderValid         = false;
+    m_worldTransformUpdatePending = false;
+
     // Root
     m_sceneRoot = WorldObject::New();
     m_sceneRoot->SetObjectManagedBySystem( true );
@@ -120,6 +129,7 @@ void SceneManager::Init()
     m_sceneRoot->ObjectID = m_nextSystemObjectID--;
 
     AllObjects.push_back( m_sceneRoot );
+    this->IndexObject( m_sceneRoot );
     m_sceneRoot->Register( this );
 
     // Cut planes
@@ -179,6 +189,13 @@ void SceneManager::Clear()
     disconnect( this, SIGNAL( ReferenceObjectChanged() ), this->MainCutPlanes, SLOT( AdjustAllImages() ) );
     this->RemoveAllSceneObjects();
     Q_ASSERT_X( AllObjects.size() == 0, "SceneManager::~SceneManager()", "Objects are left in the global list." );
+    m_objectsById.clear();
+    m_objectsByType.clear();
+    m_transformNodes.clear();
+    m_worldMatrices.clear();
+    m_transformNodeIndex.clear();
+    m_dirtyTransformObjects.clear();
+    m_transformOrderValid = false;
     m_sceneRoot->Delete();
     m_sceneRoot           = nullptr;
     m_currentObject       = nullptr;
@@ -240,7 +257,7 @@ void SceneManager::RemoveAllChildrenObjects( SceneObject * obj )
     }
 }
 
-void SceneManager::LoadScene( QString & fileName, bool interactive )
+bool SceneManager::LoadScene( QString & fileName, bool interactive )
 {
     this->SetRenderingEnabled( false );
 
@@ -256,7 +273,14 @@ void SceneManager::LoadScene( QString & fileName, bool interactive )
     SerializerReader reader;
     reader.SetFilename( fileName.toUtf8().data() );
     reader.SetSupportedVersion( this->SupportedSceneSaveVersion );
-    reader.Start();
+    if( !reader.Start() )
+    {
+        QString message = "Can't read scene file " + fileName + "\n";
+        QMessageBox::warning( nullptr, "Error", message, QMessageBox::Ok );
+        SetRenderingEnabled( true );
+        this->LoadingScene = false;
+        return false;
+    }
     reader.BeginSection( "SaveScene" );
     reader.ReadVersionFromFile();
     if( reader.FileVersionNewerThanSupported() )
@@ -268,7 +292,7 @@ void SceneManager::LoadScene( QString & fileName, bool interactive )
         QMessageBox::warning( nullptr, "Error", message, QMessageBox::Ok );
         SetRenderingEnabled( true );
         this->LoadingScene = false;
-        return;
+        return false;
     }
     else if( reader.FileVersionIsLowerThan( QString::number( 6.0 ) ) )
     {
@@ -277,7 +301,7 @@ void SceneManager::LoadScene( QString & fileName, bool interactive )
         QMessageBox::warning( nullptr, "Error", message, QMessageBox::Ok );
         SetRenderingEnabled( true );
         this->LoadingScene = false;
-        return;
+        return false;
     }
     int numberOfSceneObjects;
     ::Serialize( &reader, "NumberOfSceneObjects", numberOfSceneObjects );
@@ -310,7 +334,8 @@ void SceneManager::LoadScene( QString & fileName, bool interactive )
     if( ::Serialize( &reader, "CutPlanesCursorColor_b", color ) ) cursorColor.setBlue( color );
     this->SetCursorColor( cursorColor );
 
-    Application::GetInstance().GetMainWindow()->Serialize( &reader );
+    // There is no main window in batch mode
+    if( MainWindow * mainWindow = Application::GetInstance().GetMainWindow() ) mainWindow->Serialize( &reader );
     Application::GetInstance().SerializePlugins( &reader );
 
     reader.EndSection();
@@ -330,6 +355,7 @@ void SceneManager::LoadScene( QString & fileName, bool interactive )
 
     SetRenderingEnabled( true );
     this->LoadingScene = false;
+    return true;
 }
 
 void SceneManager::NewScene()
@@ -376,9 +402,11 @@ void SceneManager::SaveScene( QString & fileName )
     int numberOfSceneObjects = listedObjects.count();
     m_sceneLoadSaveProgressDialog =
         Application::GetInstance().StartProgress( numberOfSceneObjects + 3, tr( "Saving Scene..." ) );
-    m_sceneLoadSaveProgressDialog->setCancelButton( nullptr );
+    if( m_sceneLoadSaveProgressDialog ) m_sceneLoadSaveProgressDialog->setCancelButton( nullptr );
     SerializerWriter writer;
     writer.SetFilename( fileName.toUtf8().data() );
+    // Bulk numeric data (large point sets...) goes to a binary file next to the scene
+    writer.SetBinaryArrayThreshold( 1024 );
     writer.Start();
     writer.BeginSection( "SaveScene" );
     QString version( IBIS_SCENE_SAVE_VERSION );
@@ -403,7 +431,7 @@ void SceneManager::SaveScene( QString & fileName )
     color = this->GetCursorColor().blue();
     ::Serialize( &writer, "CutPlanesCursorColor_b", color );
 
-    Application::GetInstance().GetMainWindow()->Serialize( &writer );
+    if( MainWindow * mainWindow = Application::GetInstance().GetMainWindow() ) mainWindow->Serialize( &writer );
     Application::GetInstance().SerializePlugins( &writer );
 
     writer.EndSection();
@@ -494,7 +522,7 @@ void SceneManager::PostSceneRead( int n )
     for( int i = 0; i < this->AllObjects.size(); ++i )
     {
         if( this->AllObjects[i]->GetObjectID() > m_nextObjectID ) m_nextObjectID = this->AllObjects[i]->GetObjectID();
-        if( !this->UpdateProgress( n + i + 1 ) ) return;
+        if( m_sceneLoadSaveProgressDialog && !this->UpdateProgress( n + i + 1 ) ) return;
     }
     m_nextObjectID++;
 }
@@ -667,6 +695,7 @@ void SceneManager::AddObjectUsingID( SceneObject * object, SceneObject * attachT
             id = m_nextObjectID++;
     }
     object->AddToScene( this, id );
+    this->IndexObject( object );
 
     // Attach object to the hierarchy
     attachTo->AddChild( object );
@@ -832,6 +861,7 @@ void SceneManager::RemoveObject( SceneObject * object )
 
     // remove the object from the global list
     this->AllObjects.removeAt( indexAll );
+    this->UnindexObject( object, objId );
 
     if( object->IsListable() ) emit FinishRemovingObject();
 
@@ -843,6 +873,10 @@ void SceneManager::RemoveObject( SceneObject * object )
 
 void SceneManager::ChangeParent( SceneObject * object, SceneObject * newParent, int newChildIndex )
 {
+    // Id and class do not depend on the parent, indices stay valid, but not the order of transforms
+    Q_ASSERT( m_objectsById.value( object->GetObjectID() ) == object );
+    m_transformOrderValid = false;
+
     SceneObject * curParent = object->GetParent();
     int position            = object->GetObjectListableIndex();
 
@@ -857,92 +891,194 @@ void SceneManager::ChangeParent( SceneObject * object, SceneObject * newParent,
 
 void SceneManager::GetAllImageObjects( QList<ImageObject *> & objects )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        ImageObject * obj = ImageObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) objects.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "ImageObject" ) ) objects.push_back( static_cast<ImageObject *>( obj ) );
 }
 
 void SceneManager::GetAllPolydataObjects( QList<PolyDataObject *> & objects )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        PolyDataObject * obj = PolyDataObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) objects.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "PolyDataObject" ) )
+        objects.push_back( static_cast<PolyDataObject *>( obj ) );
 }
 
 void SceneManager::GetAllPointsObjects( QList<PointsObject *> & objects )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        PointsObject * obj = PointsObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) objects.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "PointsObject" ) )
+        objects.push_back( static_cast<PointsObject *>( obj ) );
 }
 
 void SceneManager::GetAllCameraObjects( QList<CameraObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        CameraObject * obj = CameraObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) all.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "CameraObject" ) ) all.push_back( static_cast<CameraObject *>( obj ) );
 }
 
 void SceneManager::GetAllUSAcquisitionObjects( QList<USAcquisitionObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        USAcquisitionObject * obj = USAcquisitionObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) all.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "USAcquisitionObject" ) )
+        all.push_back( static_cast<USAcquisitionObject *>( obj ) );
 }
 
 void SceneManager::GetAllUsProbeObjects( QList<UsProbeObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        UsProbeObject * obj = UsProbeObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) all.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "UsProbeObject" ) ) all.push_back( static_cast<UsProbeObject *>( obj ) );
 }
 
 void SceneManager::GetAllPointerObjects( QList<PointerObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
-    {
-        PointerObject * obj = PointerObject::SafeDownCast( this->AllObjects[i] );
-        if( obj ) all.push_back( obj );
-    }
+    for( SceneObject * obj : GetObjectsOfType( "PointerObject" ) ) all.push_back( static_cast<PointerObject *>( obj ) );
 }
 
 void SceneManager::GetAllTrackedObjects( QList<TrackedSceneObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
+    for( SceneObject * obj : GetObjectsOfType( "TrackedSceneObject" ) )
     {
-        TrackedSceneObject * obj = TrackedSceneObject::SafeDownCast( this->AllObjects[i] );
-        if( obj && obj->IsDrivenByHardware() ) all.push_back( obj );
+        TrackedSceneObject * tracked = static_cast<TrackedSceneObject *>( obj );
+        if( tracked->IsDrivenByHardware() ) all.push_back( tracked );
     }
 }
 
 void SceneManager::GetAllObjectsOfType( const char * typeName, QList<SceneObject *> & all )
 {
-    for( int i = 0; i < this->AllObjects.size(); ++i )
+    all.append( GetObjectsOfType( typeName ) );
+}
+
+SceneManager::ObjectList SceneManager::GetObjectsOfType( const char * typeName )
+{
+    QByteArray key( typeName );
+    auto it = m_objectsByType.find( key );
+    if( it == m_objectsByType.end() )
     {
-        if( this->AllObjects[i]->IsA( typeName ) ) all.push_back( this->AllObjects[i] );
+        // First request for this type, following additions and removals will keep it up to date
+        ObjectList objects;
+        for( int i = 0; i < this->AllObjects.size(); ++i )
+        {
+            if( this->AllObjects[i]->IsA( typeName ) ) objects.push_back( this->AllObjects[i] );
+        }
+        it = m_objectsByType.insert( key, objects );
     }
+    return it.value();
 }
 
 SceneObject * SceneManager::GetObjectByID( int id )
 {
     if( id == SceneManager::InvalidId ) return nullptr;
-    for( int i = 0; i < this->AllObjects.size(); ++i )
+    return m_objectsById.value( id, nullptr );
+}
+
+void SceneManager::IndexObject( SceneObject * object )
+{
+    m_objectsById.insert( object->GetObjectID(), object );
+    m_transformOrderValid = false;
+    for( auto it = m_objectsByType.begin(); it != m_objectsByType.end(); ++it )
     {
-        if( this->AllObjects[i]->GetObjectID() == id ) return this->AllObjects[i];
+        if( object->IsA( it.key().constData() ) ) it.value().push_back( object );
+    }
+}
+
+void SceneManager::ReassignObjectID( SceneObject * object, int objectId )
+{
+    if( m_objectsById.value( object->GetObjectID() ) == object ) m_objectsById.remove( object->GetObjectID() );
+    object->SetObjectID( objectId );
+    if( object->GetManager() == this && objectId != SceneManager::InvalidId ) m_objectsById.insert( objectId, object );
+}
+
+void SceneManager::UnindexObject( SceneObject * object, int objectId )
+{
+    if( m_objectsById.value( objectId ) == object ) m_objectsById.remove( objectId );
+    for( auto it = m_objectsByType.begin(); it != m_objectsByType.end(); ++it ) it.value().removeOne( object );
+    m_dirtyTransformObjects.remove( object );
+    m_transformOrderValid = false;
+}
+
+void SceneManager::MarkWorldTransformDirty( SceneObject * object )
+{
+    m_dirtyTransformObjects.insert( object );
+
+    // Changes made outside of a clock tick are coalesced until control returns to the event loop
+    if( !m_worldTransformUpdatePending )
+    {
+        m_worldTransformUpdatePending = true;
+        QTimer::singleShot( 0, this, SLOT( UpdateWorldTransforms() ) );
     }
-    return nullptr;
+}
+
+void SceneManager::RebuildTransformOrder()
+{
+    // Keep the matrices computed so far, they are used to detect changes
+    std::vector<TransformNode> nodes;
+    std::vector<double> matrices;
+    QHash<SceneObject *, int> nodeIndex;
+    nodes.reserve( this->AllObjects.size() );
+    matrices.reserve( 16 * this->AllObjects.size() );
+
+    // Depth first traversal, the parent of a node is always visited before the node
+    std::vector<TransformNode> stack;
+    stack.push_back( { m_sceneRoot, -1 } );
+    while( !stack.empty() )
+    {
+        TransformNode node = stack.back();
+        stack.pop_back();
+        int index = static_cast<int>( nodes.size() );
+        nodes.push_back( node );
+        nodeIndex.insert( node.object, index );
+
+        auto previous = m_transformNodeIndex.find( node.object );
+        if( previous != m_transformNodeIndex.end() )
+        {
+            const double * m = &m_worldMatrices[16 * previous.value()];
+            matrices.insert( matrices.end(), m, m + 16 );
+        }
+        else  // never computed, NaN makes sure it is seen as changed
+            matrices.insert( matrices.end(), 16, std::numeric_limits<double>::quiet_NaN() );
+
+        for( int i = node.object->GetNumberOfChildren() - 1; i >= 0; --i )
+            stack.push_back( { node.object->GetChild( i ), index } );
+    }
+
+    m_transformNodes.swap( nodes );
+    m_worldMatrices.swap( matrices );
+    m_transformNodeIndex.swap( nodeIndex );
+    m_transformOrderValid = true;
+}
+
+void SceneManager::UpdateWorldTransforms()
+{
+    m_worldTransformUpdatePending = false;
+    if( m_dirtyTransformObjects.isEmpty() ) return;
+    IBIS_INSTRUMENT_SCOPE( "Transform propagation" );
+    if( !m_transformOrderValid ) RebuildTransformOrder();
+
+    // Slots called during notification may modify other transforms, they will be processed by the next update
+    QSet<SceneObject *> dirtyObjects;
+    dirtyObjects.swap( m_dirtyTransformObjects );
+
+    // Recompute the world matrix of dirty objects and of the descendants of objects whose world matrix changed.
+    // Clean subtrees are skipped: their cached matrix is still valid.
+    std::vector<unsigned char> changed( m_transformNodes.size(), 0 );
+    QList<vtkSmartPointer<SceneObject> > notified;
+    for( size_t i = 0; i < m_transformNodes.size(); ++i )
+    {
+        const TransformNode & node = m_transformNodes[i];
+        bool dirty                 = dirtyObjects.contains( node.object );
+        if( !dirty && ( node.parentIndex < 0 || !changed[node.parentIndex] ) ) continue;
+
+        double world[16];
+        const double * local = node.object->GetLocalTransform()->GetMatrix()->GetData();
+        if( node.parentIndex >= 0 )
+            IbisRigidTransform::Compose( &m_worldMatrices[16 * node.parentIndex], local, world );
+        else
+            std::copy( local, local + 16, world );
+
+        double * cached = &m_worldMatrices[16 * i];
+        changed[i]      = !std::equal( world, world + 16, cached );
+        if( changed[i] ) std::copy( world, world + 16, cached );
+
+        // Objects explicitly marked are always notified, e.g. when added to the scene
+        if( dirty || changed[i] ) notified.push_back( node.object );
+    }
+
+    // One notification per object and per update, parents first
+    for( int i = 0; i < notified.size(); ++i ) notified[i]->NotifyWorldTransformChanged();
+    if( !notified.isEmpty() ) emit WorldTransformsUpdated();
 }
 
 void SceneManager::SetCurrentObject( SceneObject * obj )
@@ -998,7 +1134,7 @@ bool SceneManager::CanBeReference( SceneObject * obj ) { return obj->IsA( "Image
 void SceneManager::GetReferenceBounds( double bounds[6] )
 {
     if( m_referenceDataObject )
-        m_referenceDataObject->GetImage()->GetBounds( bounds );
+        m_referenceDataObject->GetBounds( bounds );
     else
     {
         bounds[0] = 0.0;
@@ -1321,9 +1457,7 @@ void SceneManager::GetAllUserObjects( QList<SceneObject *> & list )
 
 int SceneManager::GetNumberOfImageObjects()
 {
-    QList<ImageObject *> allImageObjects;
-    GetAllImageObjects( allImageObjects );
-    return allImageObjects.size();
+    return GetObjectsOfType( "ImageObject" ).size();
 }
 
 void SceneManager::GetAllListableNonTrackedObjects( QList<SceneObject *> & list )
@@ -1362,6 +1496,63 @@ void SceneManager::ObjectReader( Serializer * ser, bool interactive )
     ser->BeginSection( "ObjectList" );
     SceneObject * parentObject;
 
+    // Objects whose data is stored in a separate file (images, surfaces, tractograms...) make up most of
+    // the time spent loading a scene. These files are independent, so they are decoded concurrently, a few
+    // objects ahead, while objects are attached to the scene in order on the main thread, which guarantees
+    // a parent always exists before its children.
+    struct ScenePayload
+    {
+        OpenFileParams params;
+        FileReader reader;
+    };
+    std::vector<std::unique_ptr<ScenePayload> > payloads( std::max( numberOfSceneObjects, 0 ) );
+    for( i = 0; i < numberOfSceneObjects; i++ )
+    {
+        QString sectionName = QString( "ObjectInScene_%1" ).arg( i );
+        ser->BeginSection( sectionName.toUtf8().data() );
+        ::Serialize( ser, "ObjectClass", className );
+        ::Serialize( ser, "FullFileName", filePath );
+        if( !filePath.isEmpty() && filePath.at( 0 ) == '.' ) filePath.replace( 0, 1, this->GetSceneDirectory() );
+        if( !filePath.isEmpty() && QString::compare( filePath, "none" ) )
+        {
+            bool labelImage = false;
+            if( className == "ImageObject" )
+            {
+                ::Serialize( ser, "LabelImage", labelImage );
+            }
+            payloads[i].reset( new ScenePayload );
+            payloads[i]->params.AddInputFile( filePath );
+            payloads[i]->params.filesParams[0].isLabel = labelImage;
+            payloads[i]->reader.SetParams( &payloads[i]->params );
+        }
+        ser->EndSection();
+    }
+
+    const int maxRunningPayloads = std::max( 1, QThread::idealThreadCount() );
+    int nextPayload              = 0;
+    int runningPayloads          = 0;
+    auto startPayloads           = [&]() {
+        for( ; nextPayload < numberOfSceneObjects && runningPayloads < maxRunningPayloads; ++nextPayload )
+        {
+            if( payloads[nextPayload] )
+            {
+                payloads[nextPayload]->reader.start();
+                ++runningPayloads;
+            }
+        }
+    };
+    auto abortPayloads = [&]() {
+        for( size_t p = 0; p < payloads.size(); ++p )
+        {
+            if( !payloads[p] ) continue;
+            payloads[p]->reader.wait();
+            QList<SceneObject *> readObjects;
+            payloads[p]->reader.GetReadObjects( readObjects );
+            for( int o = 0; o < readObjects.size(); ++o ) readObjects[o]->Delete();
+        }
+    };
+    startPayloads();
+
     for( i = 0; i < numberOfSceneObjects; i++ )
     {
         QString sectionName = QString( "ObjectInScene_%1" ).arg( i );
@@ -1379,30 +1570,23 @@ void SceneManager::ObjectReader( Serializer * ser, bool interactive )
                 parentObject = this->GetSceneRoot();
             }
         }
-        if( filePath.at( 0 ) == '.' ) filePath.replace( 0, 1, this->GetSceneDirectory() );
 
-        // If there is a path, we open a file
-        QStringList fileToOpen;
-        fileToOpen.clear();
-        if( !filePath.isEmpty() && QString::compare( filePath, "none" ) )
+        // If there is a path, the object was read from its file by a payload reader
+        if( payloads[i] )
         {
-            fileToOpen.append( filePath );
-            FileReader * fileReader = new FileReader;
-            bool labelImage         = false;
-            if( className == "ImageObject" )
-            {
-                ::Serialize( ser, "LabelImage", labelImage );
-            }
-            OpenFileParams params;
-            params.AddInputFile( filePath );
-            params.defaultParent = parentObject;
-            if( labelImage )
+            FileReader * fileReader = &payloads[i]->reader;
+            while( !fileReader->wait( 100 ) )
             {
-                params.filesParams[0].isLabel = true;
+                // Keep reporting progress and let the user cancel while the file is decoded
+                if( interactive && !this->UpdateProgress( i ) )
+                {
+                    abortPayloads();
+                    return;
+                }
             }
-            fileReader->SetParams( &params );
-            fileReader->start();
-            fileReader->wait();
+            --runningPayloads;
+            startPayloads();
+
             QList<SceneObject *> loadedObject;
             fileReader->GetReadObjects( loadedObject );
             const QStringList & warnings = fileReader->GetWarnings();
@@ -1427,7 +1611,7 @@ void SceneManager::ObjectReader( Serializer * ser, bool interactive )
                     QMessageBox::warning( nullptr, "Error", message );
                 }
             }
-            delete fileReader;
+            payloads[i].reset();
         }
         else
         {
@@ -1495,7 +1679,7 @@ void SceneManager::ObjectReader( Serializer * ser, bool interactive )
                     {
                         obj->Serialize( ser );
                         // ignore the id given by SceneManager
-                        obj->SetObjectID( oldId );
+                        this->ReassignObjectID( obj, oldId );
                         found = true;
                     }
                 }
@@ -1513,7 +1697,11 @@ void SceneManager::ObjectReader( Serializer * ser, bool interactive )
             }
         }
         ser->EndSection();
-        if( interactive && !this->UpdateProgress( i + 1 ) ) return;
+        if( interactive && !this->UpdateProgress( i + 1 ) )
+        {
+            abortPayloads();
+            return;
+        }
     }
     ser->EndSection();
     ser->BeginSection( "Plugins" );
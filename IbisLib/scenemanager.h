@@ -14,11 +14,14 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkObject.h>
 #include <vtkSmartPointer.h>
 
+#include <QByteArray>
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QObject>
 #include <QProgressDialog>
+#include <QSet>
 #include <QString>
 #include <algorithm>
 #include <vector>
@@ -42,8 +45,9 @@ class UsProbeObject;
 class PointerObject;
 class vtkInteractor;
 
-/** Scene file format version */
-#define IBIS_SCENE_SAVE_VERSION "6.0"
+/** Scene file format version.
+ *  6.1: coordinates of PointsObject are saved in the AllPointCoordinates binary array, 6.0 scenes are still read. */
+#define IBIS_SCENE_SAVE_VERSION "6.1"
 
 /**
  * @class   SceneManager
@@ -200,6 +204,9 @@ public slots:
     void SetCursorWorldPosition( double * );
     /** ClockTick is used to move the cutting planes to the pointer position when ibis is in navigation mode. */
     void ClockTick();
+    /** Recompute the world matrices of dirty subtrees and notify objects whose world transform changed.
+     * Called on every tick of the Ibis clock, and from the event loop when transforms change between ticks. */
+    void UpdateWorldTransforms();
 
 private slots:
 
@@ -234,6 +241,15 @@ public:
     void GetAllPointerObjects( QList<PointerObject *> & all );
     void GetAllTrackedObjects( QList<TrackedSceneObject *> & all );
     void GetAllObjectsOfType( const char * typeName, QList<SceneObject *> & all );
+    /** Objects of class typeName and its subclasses. The list is implicitly shared with the index,
+     * it is not copied unless the scene changes while it is in use. */
+    ObjectList GetObjectsOfType( const char * typeName );
+    /** Call f( T * ) for every object of class typeName and its subclasses. f must not add or remove objects. */
+    template <class T, class Function>
+    void ForEachObjectOfType( const char * typeName, Function f )
+    {
+        for( SceneObject * obj : GetObjectsOfType( typeName ) ) f( static_cast<T *>( obj ) );
+    }
     SceneObject * GetObjectByID( int id );
     SceneObject * GetCurrentObject() { return m_currentObject; }
     void SetCurrentObject( SceneObject * cur );
@@ -243,6 +259,15 @@ public:
     void GetChildrenListableNonTrackedObjects( SceneObject * obj, QList<SceneObject *> & );
     ///@}
 
+    /** @name  World transforms
+     *  @brief World transforms of the objects in the scene are propagated in batch, once per frame.
+     * */
+    ///@{
+    /** Tell the manager the world transform of object changed (local transform modified, new parent...).
+     * The object and its descendants are notified the next time UpdateWorldTransforms() runs. */
+    void MarkWorldTransformDirty( SceneObject * object );
+    ///@}
+
     /** @name  Reference object
      *  @brief ImageObject used as a reference for all other objects
      * */
@@ -358,7 +383,8 @@ public:
      *  @brief Load, Save, Read/Write scene files
      * */
     ///@{
-    void LoadScene( QString & fileName, bool interactive = true );
+    /** Returns false if the scene file can't be read or its version is not supported. */
+    bool LoadScene( QString & fileName, bool interactive = true );
     void SaveScene( QString & fileName );
     void NewScene();
     void ObjectReader( Serializer * ser, bool interactive );
@@ -423,10 +449,21 @@ signals:
     void ReferenceTransformChanged();
     void ReferenceObjectChanged();
     void ObjectAttributesChanged( SceneObject * );
+    /** Emitted once by UpdateWorldTransforms() when at least one world transform changed. */
+    void WorldTransformsUpdated();
 
 protected:
     void ValidatePointerObject();
 
+    /** Keep m_objectsById and m_objectsByType in sync with AllObjects. */
+    void IndexObject( SceneObject * object );
+    void UnindexObject( SceneObject * object, int objectId );
+    /** Change the id of an object already in the scene and re-key m_objectsById. */
+    void ReassignObjectID( SceneObject * object, int objectId );
+
+    /** Sort objects of the hierarchy so that parents come before their children. */
+    void RebuildTransformOrder();
+
     void InternalClearScene();
     void Init();
     void Clear();
@@ -483,6 +520,30 @@ protected:
 
     /** List of all the objects in the scene. */
     ObjectList AllObjects;
+    /** Objects of AllObjects indexed by id. */
+    QHash<int, SceneObject *> m_objectsById;
+    /** Objects of AllObjects indexed by class name (IsA), a type is indexed the first time it is requested. */
+    QHash<QByteArray, ObjectList> m_objectsByType;
+
+    /** @name  World transforms
+     *  @brief Flattened world matrices of all objects, in topological order.
+     * */
+    ///@{
+    struct TransformNode
+    {
+        SceneObject * object;
+        int parentIndex;  // -1 for the scene root
+    };
+    std::vector<TransformNode> m_transformNodes;
+    /** 16 values per node, row major, as in vtkMatrix4x4. */
+    std::vector<double> m_worldMatrices;
+    /** Position of each object in m_transformNodes. */
+    QHash<SceneObject *, int> m_transformNodeIndex;
+    /** Objects whose local transform or parent changed since the last update. */
+    QSet<SceneObject *> m_dirtyTransformObjects;
+    bool m_transformOrderValid;
+    bool m_worldTransformUpdatePending;
+    ///@}
 
     /** Version number saved in the scene xml file, used to verify if the scene is still supported,
      * some very old scenes cannot be loaded. */
@@ -178,12 +178,24 @@ QString SceneObject::GetSceneDataDirectoryForThisObject( QString baseDir )
 }
 
 void SceneObject::WorldTransformChanged()
+{
+    // Objects in the scene are notified by the scene manager, at most once per frame
+    if( this->Manager )
+    {
+        this->Manager->MarkWorldTransformDirty( this );
+        return;
+    }
+
+    this->NotifyWorldTransformChanged();
+    for( int i = 0; i < GetNumberOfChildren(); ++i ) this->Children[i]->WorldTransformChanged();
+}
+
+void SceneObject::NotifyWorldTransformChanged()
 {
     // give subclasses a chance to react
     this->InternalWorldTransformChanged();
 
     emit WorldTransformChangedSignal();
-    for( int i = 0; i < GetNumberOfChildren(); ++i ) this->Children[i]->WorldTransformChanged();
     emit ObjectModified();
 }
 
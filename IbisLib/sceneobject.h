@@ -283,7 +283,10 @@ protected:
 
     QString GetSceneDataDirectoryForThisObject( QString baseDir );
     virtual void InternalPostSceneRead() {}
+    /** Marks the world transform dirty in the scene manager, or notifies immediately if not in a scene. */
     virtual void WorldTransformChanged();
+    /** Called once per frame by SceneManager::UpdateWorldTransforms() if the world transform changed. */
+    void NotifyWorldTransformChanged();
     /** let subclass react to the change in transform */
     virtual void InternalWorldTransformChanged() {}
 
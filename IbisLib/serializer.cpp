@@ -0,0 +1,466 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "serializer.h"
+
+#include <QDir>
+#include <QXmlStreamReader>
+#include <QtEndian>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <type_traits>
+
+namespace
+{
+// Locale independent conversions. Doubles are written in the shortest form that reads back
+// to the same value, files written with 16 digits exponents are read as well.
+
+// Floating point std::to_chars/std::from_chars are missing from some standard libraries (e.g. Apple
+// libc++), __cpp_lib_to_chars is only defined when they are available. The fallback uses streams in
+// the classic locale and writes max_digits10 digits, which also reads back to the same value.
+template <class T>
+int FormatNumber( char * buffer, int size, T value )
+{
+#ifndef __cpp_lib_to_chars
+    if constexpr( std::is_floating_point<T>::value )
+    {
+        std::ostringstream stream;
+        stream.imbue( std::locale::classic() );
+        stream.precision( std::numeric_limits<T>::max_digits10 );
+        stream << value;
+        const std::string text = stream.str();
+        const int length       = std::min( size, static_cast<int>( text.size() ) );
+        memcpy( buffer, text.data(), length );
+        return length;
+    }
+    else
+#endif
+    {
+        std::to_chars_result res = std::to_chars( buffer, buffer + size, value );
+        return static_cast<int>( res.ptr - buffer );
+    }
+}
+
+// Parse the whole of [start, end), returns false if it is not a valid number
+template <class T>
+bool ParseToken( const char * start, const char * end, T & value )
+{
+#ifndef __cpp_lib_to_chars
+    if constexpr( std::is_floating_point<T>::value )
+    {
+        std::istringstream stream( std::string( start, end ) );
+        stream.imbue( std::locale::classic() );
+        stream >> value;
+        return !stream.fail() && stream.peek() == std::char_traits<char>::eof();
+    }
+    else
+#endif
+    {
+        std::from_chars_result res = std::from_chars( start, end, value );
+        return res.ec == std::errc() && res.ptr == end;
+    }
+}
+
+template <class T>
+void AppendNumbers( QByteArray & text, const T * values, int nbElements )
+{
+    char digits[32];
+    text.reserve( nbElements * 24 );
+    for( int i = 0; i < nbElements; ++i )
+    {
+        if( i > 0 ) text.append( ' ' );
+        text.append( digits, FormatNumber( digits, sizeof( digits ), values[i] ) );
+    }
+}
+
+inline bool IsSpace( char c ) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+// Parse the next space separated number from pos. Like QString::toInt/toDouble, an
+// invalid number gives 0. Returns false when there are no more numbers.
+template <class T>
+bool ParseNextNumber( const char *& pos, const char * end, T & value )
+{
+    while( pos < end && IsSpace( *pos ) ) ++pos;
+    if( pos == end ) return false;
+    const char * start = pos;
+    while( pos < end && !IsSpace( *pos ) ) ++pos;
+    if( *start == '+' ) ++start;
+    if( !ParseToken( start, pos, value ) ) value = T( 0 );
+    return true;
+}
+
+template <class T>
+T ParseNumber( const QByteArray & text )
+{
+    const char * pos = text.constData();
+    T value          = T( 0 );
+    ParseNextNumber( pos, pos + text.size(), value );
+    return value;
+}
+
+template <class T>
+void ParseNumbers( const QByteArray & text, T * values, int nbElements )
+{
+    const char * pos = text.constData();
+    const char * end = pos + text.size();
+    int i            = 0;
+    while( i < nbElements && ParseNextNumber( pos, end, values[i] ) ) ++i;
+}
+
+inline quint64 ChildKey( int parent, int nameId )
+{
+    return ( static_cast<quint64>( static_cast<quint32>( parent ) ) << 32 ) | static_cast<quint32>( nameId );
+}
+}  // namespace
+
+//========================================================================
+// SerializerWriter
+//========================================================================
+
+SerializerWriter::SerializerWriter() : m_depth( 0 ) {}
+
+SerializerWriter::~SerializerWriter() {}
+
+bool SerializerWriter::Start()
+{
+    m_file.setFileName( m_filename.c_str() );
+    if( !m_file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) return false;
+
+    m_stream.setDevice( &m_file );
+    m_stream.setAutoFormatting( true );
+    m_stream.setAutoFormattingIndent( 1 );
+    m_stream.writeStartDocument();
+    m_stream.writeDTD( "<!DOCTYPE configML>" );
+    m_stream.writeStartElement( "configuration" );
+    m_depth = 0;
+
+    // The data file is only created if an array is large enough, remove the one of a previous save
+    m_dataFile.setFileName( QString( m_filename.c_str() ) + ".data" );
+    if( m_dataFile.exists() ) m_dataFile.remove();
+    if( m_binaryArrayThreshold > 0 ) m_stream.writeAttribute( "dataFile", QFileInfo( m_dataFile ).fileName() );
+    return true;
+}
+
+bool SerializerWriter::Finish()
+{
+    if( !m_file.isOpen() ) return false;
+
+    while( m_depth > 0 ) EndSection();
+    m_stream.writeEndElement();
+    m_stream.writeEndDocument();
+    bool ok = !m_stream.hasError();
+    m_stream.setDevice( nullptr );
+    m_file.close();
+    if( m_dataFile.isOpen() )
+    {
+        ok = ok && m_dataFile.error() == QFile::NoError;
+        m_dataFile.close();
+    }
+    return ok;
+}
+
+bool SerializerWriter::BeginSection( const char * attrName )
+{
+    if( !m_file.isOpen() ) return false;
+    m_stream.writeStartElement( QString::fromUtf8( attrName ) );
+    ++m_depth;
+    return true;
+}
+
+void SerializerWriter::EndSection()
+{
+    // The root element is closed by Finish()
+    if( m_depth == 0 ) return;
+    m_stream.writeEndElement();
+    --m_depth;
+}
+
+bool SerializerWriter::WriteValue( const char * attrName, const QString & value )
+{
+    if( !m_file.isOpen() ) return false;
+    m_stream.writeEmptyElement( QString::fromUtf8( attrName ) );
+    m_stream.writeAttribute( "value", value );
+    return true;
+}
+
+bool SerializerWriter::Serialize( const char * attrName, int & value )
+{
+    char digits[16];
+    return WriteValue( attrName, QString::fromLatin1( digits, FormatNumber( digits, sizeof( digits ), value ) ) );
+}
+
+bool SerializerWriter::Serialize( const char * attrName, bool & value )
+{
+    return WriteValue( attrName, value ? QString( "1" ) : QString( "0" ) );
+}
+
+bool SerializerWriter::Serialize( const char * attrName, double & value )
+{
+    char digits[32];
+    return WriteValue( attrName, QString::fromLatin1( digits, FormatNumber( digits, sizeof( digits ), value ) ) );
+}
+
+bool SerializerWriter::Serialize( const char * attrName, std::string & value )
+{
+    return WriteValue( attrName, QString::fromUtf8( value.c_str() ) );
+}
+
+bool SerializerWriter::Serialize( const char * attrName, QString & value ) { return WriteValue( attrName, value ); }
+
+bool SerializerWriter::WriteBinaryArray( const char * attrName, const char * type, const void * values,
+                                         int elementSize, int nbElements )
+{
+    if( !m_file.isOpen() ) return false;
+    if( !m_dataFile.isOpen() && !m_dataFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) return false;
+
+    // Align arrays so they can be used in place once mapped
+    qint64 offset = m_dataFile.pos();
+    if( offset % 8 != 0 )
+    {
+        static const char padding[8] = { 0 };
+        m_dataFile.write( padding, 8 - offset % 8 );
+        offset = m_dataFile.pos();
+    }
+
+    qint64 size = static_cast<qint64>( elementSize ) * nbElements;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if( m_dataFile.write( static_cast<const char *>( values ), size ) != size ) return false;
+#else
+    QByteArray littleEndian( size, Qt::Uninitialized );
+    if( elementSize == 8 )
+        qToLittleEndian<quint64>( values, nbElements, littleEndian.data() );
+    else
+        qToLittleEndian<quint32>( values, nbElements, littleEndian.data() );
+    if( m_dataFile.write( littleEndian ) != size ) return false;
+#endif
+
+    m_stream.writeEmptyElement( QString::fromUtf8( attrName ) );
+    m_stream.writeAttribute( "type", type );
+    m_stream.writeAttribute( "offset", QString::number( offset ) );
+    m_stream.writeAttribute( "count", QString::number( nbElements ) );
+    return true;
+}
+
+bool SerializerWriter::Serialize( const char * attrName, int * value, int nbElements )
+{
+    if( IsBinaryArray( nbElements ) ) return WriteBinaryArray( attrName, "int32", value, sizeof( int ), nbElements );
+    QByteArray text;
+    AppendNumbers( text, value, nbElements );
+    return WriteValue( attrName, QString::fromLatin1( text ) );
+}
+
+bool SerializerWriter::Serialize( const char * attrName, double * value, int nbElements )
+{
+    if( IsBinaryArray( nbElements ) )
+        return WriteBinaryArray( attrName, "float64", value, sizeof( double ), nbElements );
+    QByteArray text;
+    AppendNumbers( text, value, nbElements );
+    return WriteValue( attrName, QString::fromLatin1( text ) );
+}
+
+//========================================================================
+// SerializerReader
+//========================================================================
+
+SerializerReader::SerializerReader() : m_currentNode( -1 ), m_data( nullptr ) {}
+
+SerializerReader::~SerializerReader() { Finish(); }
+
+bool SerializerReader::Start()
+{
+    Finish();
+    m_dataFile.setFileName( QString() );
+
+    QFile file( m_filename.c_str() );
+    if( !file.open( QIODevice::ReadOnly ) ) return false;
+
+    QXmlStreamReader xml( &file );
+    int current = -1;
+    while( !xml.atEnd() )
+    {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        if( token == QXmlStreamReader::StartElement )
+        {
+            int index = static_cast<int>( m_nodes.size() );
+            if( current < 0 )
+            {
+                if( xml.name() != QLatin1String( "configuration" ) ) return false;
+                QString dataFile = xml.attributes().value( "dataFile" ).toString();
+                if( !dataFile.isEmpty() ) m_dataFile.setFileName( QFileInfo( file ).dir().filePath( dataFile ) );
+            }
+            else
+            {
+                QByteArray name                     = xml.name().toUtf8();
+                QHash<QByteArray, int>::iterator it = m_nameIds.find( name );
+                if( it == m_nameIds.end() ) it = m_nameIds.insert( name, m_nameIds.size() );
+                // Keep the first element with a given name, like QDomNode::namedItem
+                quint64 key = ChildKey( current, it.value() );
+                if( !m_children.contains( key ) ) m_children.insert( key, index );
+            }
+
+            Node node;
+            node.parent                     = current;
+            QXmlStreamAttributes attributes = xml.attributes();
+            node.hasValue                   = attributes.hasAttribute( "value" );
+            if( node.hasValue ) node.value = attributes.value( "value" ).toUtf8();
+            node.dataType   = 0;
+            node.dataCount  = 0;
+            node.dataOffset = -1;
+            if( attributes.hasAttribute( "offset" ) )
+            {
+                node.dataType   = attributes.value( "type" ) == QLatin1String( "float64" ) ? 'd' : 'i';
+                node.dataCount  = attributes.value( "count" ).toInt();
+                node.dataOffset = attributes.value( "offset" ).toLongLong();
+            }
+            m_nodes.push_back( node );
+            current = index;
+        }
+        else if( token == QXmlStreamReader::EndElement )
+            current = m_nodes[current].parent;
+    }
+
+    if( xml.hasError() || m_nodes.empty() )
+    {
+        Finish();
+        return false;
+    }
+    m_currentNode = 0;
+    return true;
+}
+
+bool SerializerReader::Finish()
+{
+    m_nodes.clear();
+    m_nameIds.clear();
+    m_children.clear();
+    m_currentNode = -1;
+    if( m_data ) m_dataFile.unmap( m_data );
+    m_data = nullptr;
+    m_dataFile.close();
+    return true;
+}
+
+int SerializerReader::FindChild( const char * attrName )
+{
+    if( m_currentNode < 0 ) return -1;
+    int nameId = m_nameIds.value( QByteArray::fromRawData( attrName, static_cast<int>( strlen( attrName ) ) ), -1 );
+    if( nameId < 0 ) return -1;
+    return m_children.value( ChildKey( m_currentNode, nameId ), -1 );
+}
+
+const QByteArray * SerializerReader::FindValue( const char * attrName )
+{
+    int child = FindChild( attrName );
+    if( child < 0 || !m_nodes[child].hasValue ) return nullptr;
+    return &m_nodes[child].value;
+}
+
+bool SerializerReader::ReadBinaryArray( const Node & node, char type, void * values, int elementSize,
+                                        int nbElements )
+{
+    if( node.dataType != type ) return false;
+    if( !m_data )
+    {
+        if( !m_dataFile.open( QIODevice::ReadOnly ) ) return false;
+        m_data = m_dataFile.map( 0, m_dataFile.size() );
+        if( !m_data ) return false;
+    }
+    int count = std::min( node.dataCount, nbElements );
+    if( node.dataOffset < 0 || count < 0 ||
+        node.dataOffset + static_cast<qint64>( count ) * elementSize > m_dataFile.size() )
+        return false;
+
+    const uchar * source = m_data + node.dataOffset;
+    if( elementSize == 8 )
+        qFromLittleEndian<quint64>( source, count, values );
+    else
+        qFromLittleEndian<quint32>( source, count, values );
+    return true;
+}
+
+bool SerializerReader::BeginSection( const char * attrName )
+{
+    int child = FindChild( attrName );
+    if( child < 0 ) return false;
+    m_currentNode = child;
+    return true;
+}
+
+void SerializerReader::EndSection()
+{
+    if( m_currentNode > 0 ) m_currentNode = m_nodes[m_currentNode].parent;
+}
+
+bool SerializerReader::Serialize( const char * attrName, int & value )
+{
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    value = ParseNumber<int>( *text );
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, bool & value )
+{
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    value = ParseNumber<int>( *text ) != 0;
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, double & value )
+{
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    value = ParseNumber<double>( *text );
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, std::string & value )
+{
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    value = text->toStdString();
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, QString & value )
+{
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    value = QString::fromUtf8( *text );
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, int * value, int nbElements )
+{
+    int child = FindChild( attrName );
+    if( child >= 0 && m_nodes[child].dataType != 0 )
+        return ReadBinaryArray( m_nodes[child], 'i', value, sizeof( int ), nbElements );
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    ParseNumbers( *text, value, nbElements );
+    return true;
+}
+
+bool SerializerReader::Serialize( const char * attrName, double * value, int nbElements )
+{
+    int child = FindChild( attrName );
+    if( child >= 0 && m_nodes[child].dataType != 0 )
+        return ReadBinaryArray( m_nodes[child], 'd', value, sizeof( double ), nbElements );
+    const QByteArray * text = FindValue( attrName );
+    if( !text ) return false;
+    ParseNumbers( *text, value, nbElements );
+    return true;
+}
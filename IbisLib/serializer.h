@@ -11,11 +11,12 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #ifndef SERIALIZER_H
 #define SERIALIZER_H
 
-#include <QDomDocument>
+#include <QByteArray>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QStringList>
-#include <QTextStream>
+#include <QXmlStreamWriter>
 #include <map>
 #include <utility>
 #include <vector>
@@ -62,12 +63,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 class Serializer
 {
 public:
-    Serializer() : m_document( "configML" )
-    {
-        m_root = m_document.createElement( "configuration" );
-        m_document.appendChild( m_root );
-        m_currentNode = m_root;
-    }
+    Serializer() : m_binaryArrayThreshold( 0 ) {}
     virtual ~Serializer() {}
 
     /** Check if the currently used serializer is a reader. */
@@ -98,6 +94,21 @@ public:
     /** Find if Serializer version used to create currently read file is older than some other version. */
     bool FileVersionIsLowerThan( QString version ) { return QString::compare( m_versionFromFile, version ) < 0; }
 
+    /** @name Binary arrays
+     *  @brief Arrays with at least threshold elements are written in a binary data file next to the
+     *  xml file (file.xml.data) and referenced by offset. 0 (default) writes all arrays as text.
+     *  Readers handle both forms whatever the threshold.
+     */
+    ///@{
+    void SetBinaryArrayThreshold( int threshold ) { m_binaryArrayThreshold = threshold; }
+    int GetBinaryArrayThreshold() { return m_binaryArrayThreshold; }
+    /** Check if an array of nbElements will be written in the binary data file. */
+    bool IsBinaryArray( int nbElements )
+    {
+        return !IsReader() && m_binaryArrayThreshold > 0 && nbElements >= m_binaryArrayThreshold;
+    }
+    ///@}
+
     /** @name Reading and writing functions, defined respectively in SerializerReader and SerializerWriter
      */
     ///@{
@@ -130,291 +141,106 @@ protected:
     std::string m_filename;
     QString m_versionFromFile;
     QString m_supportedVersion;
-    QDomDocument m_document;
-    QDomElement m_root;
-    QDomNode m_currentNode;
+    int m_binaryArrayThreshold;
 };
 
 /**
  * @class   SerializerWriter
  * @brief   Write xml files to store the parameters of scenes, objects etc.
  *
+ * Elements are streamed to the file as they are serialized, the document is never built in memory.
+ * Numbers are written in the shortest form that reads back to the same value, independently of the locale.
+ * Large arrays are appended to the binary data file, see SetBinaryArrayThreshold().
  **/
 class SerializerWriter : public Serializer
 {
 public:
-    SerializerWriter() {}
-    ~SerializerWriter() {}
-
-    virtual int IsReader() override { return 0; } 
-
-    virtual bool Start() override
-    {
-        m_currentNode = m_root;
-        return true;
-    }
-
-    virtual bool Finish() override
-    {
-        QFile file( m_filename.c_str() );
-        if( !file.open( QIODevice::WriteOnly ) ) return false;
+    SerializerWriter();
+    ~SerializerWriter();
 
-        QTextStream ts( &file );
-        ts << m_document.toString();
+    virtual int IsReader() override { return 0; }
 
-        file.close();
-        return true;
-    }
-
-    virtual bool BeginSection( const char * attrName ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        m_currentNode    = m_currentNode.appendChild( elem );
-        return true;
-    }
+    virtual bool Start() override;
+    /** Close sections left open and the file, return false if the file could not be written. */
+    virtual bool Finish() override;
+    virtual bool BeginSection( const char * attrName ) override;
+    virtual void EndSection() override;
 
-    virtual void EndSection() override { m_currentNode = m_currentNode.parentNode(); }
+    virtual bool Serialize( const char * attrName, int & value ) override;
+    virtual bool Serialize( const char * attrName, bool & value ) override;
+    virtual bool Serialize( const char * attrName, double & value ) override;
+    virtual bool Serialize( const char * attrName, std::string & value ) override;
+    virtual bool Serialize( const char * attrName, QString & value ) override;
+    virtual bool Serialize( const char * attrName, int * value, int nbElements ) override;
+    virtual bool Serialize( const char * attrName, double * value, int nbElements ) override;
 
-    virtual bool Serialize( const char * attrName, int & value ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        elem.setAttribute( "value", QString::number( value ) );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, bool & value ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        elem.setAttribute( "value", QString::number( value ? 1 : 0 ) );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, double & value ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        elem.setAttribute( "value", QString::number( value, 'e', 16 ) );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, std::string & value ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        elem.setAttribute( "value", value.c_str() );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, QString & value ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        elem.setAttribute( "value", value );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, int * value, int nbElements ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        QString text;
-        for( int i = 0; i < nbElements; i++ )
-        {
-            text += QString::number( value[i] ) + " ";
-        }
-        elem.setAttribute( "value", text );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
-
-    virtual bool Serialize( const char * attrName, double * value, int nbElements ) override
-    {
-        QDomElement elem = m_document.createElement( attrName );
-        QString text;
-        for( int i = 0; i < nbElements; i++ )
-        {
-            text += QString::number( value[i], 'e', 16 ) + " ";
-        }
-        elem.setAttribute( "value", text );
-        m_currentNode.appendChild( elem );
-        return true;
-    }
+protected:
+    bool WriteValue( const char * attrName, const QString & value );
+    // Append values to the data file (little endian, 8 bytes aligned) and write a reference to them
+    bool WriteBinaryArray( const char * attrName, const char * type, const void * values, int elementSize,
+                           int nbElements );
+
+    QFile m_file;
+    QFile m_dataFile;
+    QXmlStreamWriter m_stream;
+    int m_depth;
 };
 
 /**
  * @class   SerializerReader
  * @brief   Read xml files to get the parameters of scenes, objects etc.
  *
+ * Objects read their attributes by name and in any order, so the file is parsed once in a
+ * compact table of elements (name id, parent and raw value) indexed by parent and name.
+ * Lookups are constant time, which keeps long lists (Element_0 ... Element_n) linear to read.
+ * The binary data file of large arrays is memory-mapped when the first one is read.
  **/
 class SerializerReader : public Serializer
 {
 public:
-    SerializerReader() {}
-    ~SerializerReader() {}
+    SerializerReader();
+    ~SerializerReader();
 
     virtual int IsReader() override { return 1; }
 
-    virtual bool Start() override
-    {
-        QFile file( m_filename.c_str() );
+    virtual bool Start() override;
+    virtual bool Finish() override;
+    virtual bool BeginSection( const char * attrName ) override;
+    virtual void EndSection() override;
 
-        if( !file.open( QIODevice::ReadOnly ) ) return false;
+    virtual bool Serialize( const char * attrName, int & value ) override;
+    virtual bool Serialize( const char * attrName, bool & value ) override;
+    virtual bool Serialize( const char * attrName, double & value ) override;
+    virtual bool Serialize( const char * attrName, std::string & value ) override;
+    virtual bool Serialize( const char * attrName, QString & value ) override;
+    virtual bool Serialize( const char * attrName, int * value, int nbElements ) override;
+    virtual bool Serialize( const char * attrName, double * value, int nbElements ) override;
 
-        if( !m_document.setContent( &file ) )
-        {
-            file.close();
-            return false;
-        }
-        file.close();
-
-        m_root = m_document.documentElement();
-        if( m_root.tagName() != "configuration" )
-        {
-            // manage error!!!
-            return false;
-        }
-        m_currentNode = m_root;
-        return true;
-    }
-
-    virtual bool Finish() override { return true; }
-
-    virtual bool BeginSection( const char * attrName ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            m_currentNode = variableNode;
-            return true;
-        }
-        return false;
-    }
-
-    virtual void EndSection() override { m_currentNode = m_currentNode.parentNode(); }
-
-    virtual bool Serialize( const char * attrName, int & value ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                value = variableValueString.toInt();
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, bool & value ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                value = variableValueString.toInt() == 0 ? false : true;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, double & value ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                value = variableValueString.toDouble();
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, std::string & value ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                value = variableValueString.toUtf8().data();
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, QString & value ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                value = variableValueString.toUtf8().data();
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, int * value, int nbElements ) override
-    {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                QStringList list            = variableValueString.split( ' ' );
-                QStringList::iterator it    = list.begin();
-                QStringList::iterator itEnd = list.end();
-                int i                       = 0;
-                while( it != itEnd && i < nbElements )
-                {
-                    value[i] = ( *it ).toInt();
-                    ++it;
-                    ++i;
-                }
-                return true;
-            }
-        }
-        return false;
-    }
-
-    virtual bool Serialize( const char * attrName, double * value, int nbElements ) override
+protected:
+    struct Node
     {
-        QDomNode variableNode = m_currentNode.namedItem( attrName );
-        if( !variableNode.isNull() )
-        {
-            QString variableValueString = variableNode.toElement().attribute( "value" );
-            if( !variableValueString.isNull() )
-            {
-                QStringList list            = variableValueString.split( ' ' );
-                QStringList::iterator it    = list.begin();
-                QStringList::iterator itEnd = list.end();
-                int i                       = 0;
-                while( it != itEnd && i < nbElements )
-                {
-                    value[i] = ( *it ).toDouble();
-                    ++it;
-                    ++i;
-                }
-                return true;
-            }
-        }
-        return false;
-    }
+        int parent;
+        bool hasValue;
+        QByteArray value;  // utf-8
+        char dataType;     // binary arrays: 'i' int32, 'd' float64, 0 for text
+        int dataCount;
+        qint64 dataOffset;
+    };
+
+    // Index of the first child of the current node named attrName, -1 if there is none
+    int FindChild( const char * attrName );
+    // Raw value of the child named attrName, nullptr if there is no such child or it has no value
+    const QByteArray * FindValue( const char * attrName );
+    // Copy up to nbElements values of a binary array from the mapped data file
+    bool ReadBinaryArray( const Node & node, char type, void * values, int elementSize, int nbElements );
+
+    std::vector<Node> m_nodes;
+    QHash<QByteArray, int> m_nameIds;
+    QHash<quint64, int> m_children;  // ( parent << 32 | name id ) -> node
+    int m_currentNode;
+
+    QFile m_dataFile;
+    uchar * m_data;
 };
 
 //========================================================================
@@ -0,0 +1,85 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#include "startupprofiler.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+StartupProfiler::ScopedSection::ScopedSection( StartupProfiler * profiler, const QString & name )
+    : m_profiler( profiler )
+{
+    m_profiler->BeginSection( name );
+}
+
+StartupProfiler::ScopedSection::~ScopedSection() { m_profiler->EndSection(); }
+
+StartupProfiler::StartupProfiler() { m_clock.start(); }
+
+void StartupProfiler::BeginSection( const QString & name )
+{
+    Section s;
+    s.name      = name;
+    s.depth     = m_openSections.size();
+    s.startTime = GetElapsedTime();
+    s.duration  = -1.0;
+    m_openSections.push_back( m_sections.size() );
+    m_sections.push_back( s );
+}
+
+void StartupProfiler::EndSection()
+{
+    Q_ASSERT_X( !m_openSections.isEmpty(), "StartupProfiler::EndSection()", "No section to end." );
+    Section & s = m_sections[m_openSections.takeLast()];
+    s.duration  = GetElapsedTime() - s.startTime;
+
+    // Startup is over, log activity as it happens
+    if( IsFinished() && s.depth == 0 ) AppendToLog( FormatSection( s ) );
+}
+
+bool StartupProfiler::Finish( const QString & logFileName )
+{
+    QFileInfo info( logFileName );
+    QDir().mkpath( info.absolutePath() );
+    QFile file( logFileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) return false;
+
+    QTextStream stream( &file );
+    stream << "Ibis startup profile - " << QDateTime::currentDateTime().toString( Qt::ISODate ) << "\n";
+    for( int i = 0; i < m_sections.size(); ++i )
+    {
+        if( m_sections[i].duration >= 0.0 ) stream << FormatSection( m_sections[i] ) << "\n";
+    }
+    stream << QString( "Total startup time: %1 ms\n" ).arg( GetElapsedTime(), 0, 'f', 1 );
+    stream << "After startup:\n";
+    file.close();
+
+    m_logFileName = logFileName;
+    return true;
+}
+
+double StartupProfiler::GetElapsedTime() { return m_clock.nsecsElapsed() / 1000000.0; }
+
+QString StartupProfiler::FormatSection( const Section & section )
+{
+    QString indent( section.depth * 2, QChar( ' ' ) );
+    return QString( "%1 ms  %2%3" ).arg( section.duration, 10, 'f', 1 ).arg( indent ).arg( section.name );
+}
+
+void StartupProfiler::AppendToLog( const QString & line )
+{
+    QFile file( m_logFileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text ) ) return;
+    QTextStream stream( &file );
+    stream << line << "\n";
+}
@@ -0,0 +1,67 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+// Description:
+// Records the time spent in each step of the application startup (settings, plugins,
+// hardware, main window, scene restore...). Sections can be nested. Finish() writes
+// the profile to a log file, sections ended after that (e.g. plugins activated on
+// first use) are appended to the same file as they complete.
+class StartupProfiler
+{
+public:
+    // Begins a section in the constructor and ends it in the destructor
+    class ScopedSection
+    {
+    public:
+        ScopedSection( StartupProfiler * profiler, const QString & name );
+        ~ScopedSection();
+
+    private:
+        StartupProfiler * m_profiler;
+    };
+
+    StartupProfiler();
+
+    void BeginSection( const QString & name );
+    void EndSection();
+
+    // Write the profile to logFileName. Returns false if the file can't be written.
+    bool Finish( const QString & logFileName );
+    bool IsFinished() { return !m_logFileName.isEmpty(); }
+
+    // Milliseconds elapsed since the profiler was created
+    double GetElapsedTime();
+
+private:
+    struct Section
+    {
+        QString name;
+        int depth;
+        double startTime;  // milliseconds
+        double duration;   // milliseconds, negative while the section is open
+    };
+
+    QString FormatSection( const Section & section );
+    void AppendToLog( const QString & line );
+
+    QElapsedTimer m_clock;
+    QList<Section> m_sections;
+    QList<int> m_openSections;
+    QString m_logFileName;
+};
+
+#endif
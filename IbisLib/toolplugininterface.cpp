@@ -19,6 +19,7 @@ void ToolPluginInterface::PluginTypeLoadSettings( QSettings & s )
     m_settings.winPos  = s.value( "WindowPosition", QPoint( 0, 0 ) ).toPoint();
     m_settings.winSize = s.value( "WindowSize", QSize( -1, -1 ) ).toSize();
     m_settings.active  = s.value( "Active", false ).toBool();
+    m_settings.tab     = s.value( "Tab", false ).toBool();
 }
 
 void ToolPluginInterface::PluginTypeSaveSettings( QSettings & s )
@@ -26,6 +27,7 @@ void ToolPluginInterface::PluginTypeSaveSettings( QSettings & s )
     s.setValue( "WindowPosition", m_settings.winPos );
     s.setValue( "WindowSize", m_settings.winSize );
     s.setValue( "Active", m_settings.active );
+    s.setValue( "Tab", m_settings.tab );
 }
 
 void ToolPluginInterface::Serialize( Serializer * ser ) {}
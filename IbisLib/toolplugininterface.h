@@ -46,10 +46,11 @@ public:
 
     struct Settings
     {
-        Settings() : winPos( 0, 0 ), winSize( -1, -1 ), active( false ) {}
+        Settings() : winPos( 0, 0 ), winSize( -1, -1 ), active( false ), tab( false ) {}
         QPoint winPos;
         QSize winSize;
         bool active;
+        bool tab;  // the plugin widget was a tab, it can be restored without creating it until it is shown
     };
 
     /** Plugin settings. */
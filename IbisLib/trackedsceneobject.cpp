@@ -7,6 +7,7 @@
 #include <vtkTransform.h>
 
 #include "hardwaremodule.h"
+#include "scenemanager.h"
 #include "serializerhelper.h"
 #include "view.h"
 
@@ -130,6 +131,8 @@ void TrackedSceneObject::SetState( TrackerToolState state )
 void TrackedSceneObject::SetInputMatrix( vtkMatrix4x4 * m )
 {
     m_transform->SetMatrix( m );
+    // The local transform concatenates m_transform, it does not fire ModifiedEvent by itself
+    if( GetManager() ) GetManager()->MarkWorldTransformDirty( this );
     emit ObjectModified();
 }
 
@@ -138,6 +141,8 @@ void TrackedSceneObject::SetInputTransform( vtkTransform * t ) { m_transform->Se
 void TrackedSceneObject::SetCalibrationMatrix( vtkMatrix4x4 * mat )
 {
     m_calibrationTransform->SetMatrix( mat );
+    // The local transform concatenates m_transform, it does not fire ModifiedEvent by itself
+    if( GetManager() ) GetManager()->MarkWorldTransformDirty( this );
     emit ObjectModified();
 }
 
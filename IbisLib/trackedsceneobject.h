@@ -56,6 +56,14 @@ public:
     void FreezeTransform();
     void UnFreezeTransform();
 
+    // Called by the hardware module every time a new pose/image sample has been applied to the object.
+    // Several samples can be received between 2 ticks of the Ibis clock.
+    void MarkSampleReceived() { emit SampleReceived(); }
+
+signals:
+
+    void SampleReceived();
+
 protected:
     virtual void InternalUpdateWorldTransform();
     virtual void ObjectAboutToBeRemovedFromScene() override;
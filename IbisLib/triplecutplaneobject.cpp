@@ -17,6 +17,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkTransform.h>
 
 #include "imageobject.h"
+#include "instrumentation.h"
 #include "scenemanager.h"
 #include "triplecutplaneobjectsettingswidget.h"
 #include "view.h"
@@ -188,14 +189,14 @@ void TripleCutPlaneObject::AddImage( int imageID )
     for( int i = 0; i < 3; ++i )
     {
         bool canInterpolate = !im->IsLabelImage();
-        this->Planes[i]->AddInput( im->GetImage(), im->GetLut(), im->GetWorldTransform(), canInterpolate );
-        this->Planes[i]->SetImageHidden( im->GetImage(), im->IsHidden() );
+        this->Planes[i]->AddInput( im->GetDisplayImage(), im->GetLut(), im->GetWorldTransform(), canInterpolate );
+        this->Planes[i]->SetImageHidden( im->GetDisplayImage(), im->IsHidden() );
         this->Planes[i]->SetBlendingMode( Images.size() - 1,
                                           BlendingModes[m_blendingModeIndices[Images.size() - 1]].mode );
         // First image is reference
         if( Images.size() == 1 )
         {
-            this->Planes[i]->SetBoundingVolume( im->GetImage(), im->GetWorldTransform() );
+            this->Planes[i]->SetBoundingVolume( im->GetDisplayImage(), im->GetWorldTransform() );
         }
     }
     this->UpdateAllPlanesVisibility();
@@ -239,10 +240,11 @@ void TripleCutPlaneObject::AdjustAllImages()
         {
             // first add reference object
             bool canInterpolate = !referenceObject->IsLabelImage();
-            this->Planes[j]->SetBoundingVolume( referenceObject->GetImage(), referenceObject->GetWorldTransform() );
-            this->Planes[j]->AddInput( referenceObject->GetImage(), referenceObject->GetLut(),
+            this->Planes[j]->SetBoundingVolume( referenceObject->GetDisplayImage(),
+                                                referenceObject->GetWorldTransform() );
+            this->Planes[j]->AddInput( referenceObject->GetDisplayImage(), referenceObject->GetLut(),
                                        referenceObject->GetWorldTransform(), canInterpolate );
-            this->Planes[j]->SetImageHidden( referenceObject->GetImage(), referenceObject->IsHidden() );
+            this->Planes[j]->SetImageHidden( referenceObject->GetDisplayImage(), referenceObject->IsHidden() );
             for( uint i = 0; i < Images.size(); ++i )
             {
                 ImageObject * im = ImageObject::SafeDownCast( this->GetManager()->GetObjectByID( Images[i] ) );
@@ -260,8 +262,9 @@ void TripleCutPlaneObject::AdjustAllImages()
                 if( im->GetObjectID() != refID )
                 {
                     bool canInterpolate = !im->IsLabelImage();
-                    this->Planes[j]->AddInput( im->GetImage(), im->GetLut(), im->GetWorldTransform(), canInterpolate );
-                    this->Planes[j]->SetImageHidden( im->GetImage(), im->IsHidden() );
+                    this->Planes[j]->AddInput( im->GetDisplayImage(), im->GetLut(), im->GetWorldTransform(),
+                                               canInterpolate );
+                    this->Planes[j]->SetImageHidden( im->GetDisplayImage(), im->IsHidden() );
                 }
             }
         }
@@ -310,14 +313,14 @@ void TripleCutPlaneObject::UpdateLut( int imageID )
     ImageObject * im = ImageObject::SafeDownCast( this->GetManager()->GetObjectByID( imageID ) );
     for( int i = 0; i < 3; ++i )
     {
-        this->Planes[i]->SetLookupTable( im->GetImage(), im->GetLut() );
+        this->Planes[i]->SetLookupTable( im->GetDisplayImage(), im->GetLut() );
     }
 }
 
 void TripleCutPlaneObject::SetImageHidden( int imageID )
 {
     ImageObject * im = ImageObject::SafeDownCast( this->GetManager()->GetObjectByID( imageID ) );
-    for( int i = 0; i < 3; ++i ) this->Planes[i]->SetImageHidden( im->GetImage(), im->IsHidden() );
+    for( int i = 0; i < 3; ++i ) this->Planes[i]->SetImageHidden( im->GetDisplayImage(), im->IsHidden() );
     this->MarkModified();
 }
 
@@ -566,6 +569,7 @@ void TripleCutPlaneObject::PlaneEndInteractionEvent( vtkObject * caller, unsigne
 
 void TripleCutPlaneObject::MarkModified()
 {
+    IBIS_INSTRUMENT_SCOPE( "Reslice" );
     for( int i = 0; i < 3; i++ )
     {
         this->Planes[i]->UpdateNormal();
@@ -45,6 +45,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "exportacquisitiondialog.h"
 #include "ibisconfig.h"
 #include "imageobject.h"
+#include "instrumentation.h"
 #include "lookuptablemanager.h"
 #include "serializerhelper.h"
 #include "trackedvideobuffer.h"
@@ -64,8 +65,9 @@ USAcquisitionObject::USAcquisitionObject()
 
     m_videoBuffer = new TrackedVideoBuffer( m_defaultImageSize[0], m_defaultImageSize[1] );
 
-    m_isRecording   = false;
-    m_baseDirectory = QDir::homePath() + "/" + IBIS_CONFIGURATION_SUBDIRECTORY + "/" + ACQ_BASE_DIR;
+    m_isRecording           = false;
+    m_lastRecordedTimestamp = -1.0;
+    m_baseDirectory         = QDir::homePath() + "/" + IBIS_CONFIGURATION_SUBDIRECTORY + "/" + ACQ_BASE_DIR;
 
     m_usDepth         = "9cm";
     m_acquisitionType = UsProbeObject::ACQ_B_MODE;
@@ -307,21 +309,26 @@ void USAcquisitionObject::ShowStaticSlices( PerViewElements & perView )
 void USAcquisitionObject::Record()
 {
     Q_ASSERT( !m_isRecording );
-    m_isRecording = true;
+    m_isRecording           = true;
+    m_lastRecordedTimestamp = -1.0;
 
     // Add the frame that was last captured by the system
     UsProbeObject * probe = UsProbeObject::SafeDownCast( GetManager()->GetObjectByID( m_usProbeObjectId ) );
     Q_ASSERT( probe );
     if( probe->IsOk() )
     {
+        probe->UpdateVideoInput();
         int * dims = probe->GetVideoOutput()->GetDimensions();
         this->SetFrameAndMaskSize( dims[0], dims[1] );
         m_videoBuffer->AddFrame( probe->GetVideoOutput(), probe->GetUncalibratedWorldTransform()->GetMatrix(),
                                  probe->GetLastTimestamp() );
+        m_lastRecordedTimestamp = probe->GetLastTimestamp();
     }
 
-    // Start watching the clock for updates
+    // Start watching the clock for updates. Hardware modules that deliver every received
+    // sample (SampleReceived) make it possible to record frames arriving faster than the clock.
     connect( &Application::GetInstance(), SIGNAL( IbisClockTick() ), this, SLOT( Updated() ) );
+    connect( probe, SIGNAL( SampleReceived() ), this, SLOT( RecordProbeFrame() ) );
 
     // Disable static slices
     this->SetEnableStaticSlices( false );
@@ -353,17 +360,26 @@ bool USAcquisitionObject::AddFrame( vtkImageData * image, vtkMatrix4x4 * mat, do
 
 void USAcquisitionObject::Updated()
 {
-    if( m_isRecording )
-    {
-        UsProbeObject * probe = UsProbeObject::SafeDownCast( GetManager()->GetObjectByID( m_usProbeObjectId ) );
-        Q_ASSERT( probe );
-        if( probe->IsOk() )
-        {
-            m_videoBuffer->AddFrame( probe->GetVideoOutput(), probe->GetUncalibratedWorldTransform()->GetMatrix(),
-                                     probe->GetLastTimestamp() );
-            emit ObjectModified();
-        }
-    }
+    if( m_isRecording ) RecordProbeFrame();
+}
+
+void USAcquisitionObject::RecordProbeFrame()
+{
+    if( !m_isRecording ) return;
+
+    UsProbeObject * probe = UsProbeObject::SafeDownCast( GetManager()->GetObjectByID( m_usProbeObjectId ) );
+    Q_ASSERT( probe );
+    if( !probe->IsOk() ) return;
+
+    // The same sample can be seen from both the clock tick and SampleReceived
+    double timestamp = probe->GetLastTimestamp();
+    if( timestamp >= 0 && timestamp == m_lastRecordedTimestamp ) return;
+
+    IBIS_INSTRUMENT_SCOPE( "US recording" );
+    probe->UpdateVideoInput();
+    m_videoBuffer->AddFrame( probe->GetVideoOutput(), probe->GetUncalibratedWorldTransform()->GetMatrix(), timestamp );
+    m_lastRecordedTimestamp = timestamp;
+    emit ObjectModified();
 }
 
 void USAcquisitionObject::UpdateMask()
@@ -385,6 +401,8 @@ void USAcquisitionObject::Stop()
     {
         m_isRecording = false;
         disconnect( &Application::GetInstance(), SIGNAL( IbisClockTick() ), this, SLOT( Updated() ) );
+        UsProbeObject * probe = UsProbeObject::SafeDownCast( GetManager()->GetObjectByID( m_usProbeObjectId ) );
+        if( probe ) disconnect( probe, SIGNAL( SampleReceived() ), this, SLOT( RecordProbeFrame() ) );
     }
 }
 
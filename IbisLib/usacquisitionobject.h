@@ -155,6 +155,7 @@ private slots:
 
     void Updated();
     void UpdateMask();
+    void RecordProbeFrame();
 
 protected:
     virtual void Hide() override;
@@ -162,6 +163,7 @@ protected:
     void ObjectAddedToScene() override;
     void UpdatePipeline();
     bool m_isRecording;
+    double m_lastRecordedTimestamp;
     QString m_baseDirectory;
 
     // Acquisition properties
@@ -26,6 +26,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "SVL.h"
 #include "application.h"
 #include "imageobject.h"
+#include "renderscheduler.h"
 #include "scenemanager.h"
 #include "sceneobject.h"
 #include "viewinteractor.h"
@@ -43,6 +44,7 @@ View::View()
     this->SetName( DefaultViewNames[THREED_VIEW_TYPE] );
     this->RenderWidget       = nullptr;
     this->m_renderingEnabled = true;
+    this->m_needsRender      = false;
     this->InteractorStyle    = vtkSmartPointer<vtkInteractorStyleTerrain>::New();
     this->Picker             = vtkCellPicker::New();
     this->Picker->SetTolerance( 0.005 );  // need some fluff
@@ -73,15 +75,14 @@ View::View()
     m_rightButtonDown    = false;
     m_backupWindowParent = nullptr;
     CurrentController    = nullptr;
-
-    connect( &Application::GetInstance(), SIGNAL( IbisClockTick() ), this, SLOT( EnableRendering() ) );
 }
 
 View::~View()
 {
     if( this->Picker ) this->Picker->Delete();
 
-    disconnect( &Application::GetInstance(), SIGNAL( IbisClockTick() ), this, SLOT( EnableRendering() ) );
+    RenderScheduler * scheduler = Application::GetInstance().GetRenderScheduler();
+    if( scheduler ) scheduler->RemoveView( this );
 }
 
 void View::Serialize( Serializer * ser )
@@ -184,7 +185,7 @@ void View::SetRenderingEnabled( bool b )
 {
     if( m_renderingEnabled == b ) return;
     m_renderingEnabled = b;
-    if( m_renderingEnabled ) NotifyNeedRender();
+    if( m_renderingEnabled && m_needsRender ) NotifyNeedRender();
 }
 
 vtkRenderWindowInteractor * View::GetInteractor() { return this->Interactor; }
@@ -275,6 +276,9 @@ vtkInteractorStyle * View::GetInteractorStyle() { return this->InteractorStyle;
 void View::ReleaseView()
 {
     if( CurrentController ) CurrentController->ReleaseControl( this );
+    RenderScheduler * scheduler = Application::GetInstance().GetRenderScheduler();
+    if( scheduler ) scheduler->RemoveView( this );
+    m_renderingEnabled = false;
     this->ReleaseAllObjects();
     this->Renderer->SetRenderWindow( 0 );
     this->OverlayRenderer->SetRenderWindow( 0 );
@@ -476,10 +480,22 @@ void View::SetViewAngle( double angle )
 
 void View::NotifyNeedRender()
 {
-    if( m_renderingEnabled )
-    {
+    m_needsRender = true;
+    if( !m_renderingEnabled ) return;
+
+    // Rendering is deferred to the next frame of the scheduler, where all requests are coalesced
+    RenderScheduler * scheduler = Application::GetInstance().GetRenderScheduler();
+    if( scheduler )
+        scheduler->RequestRender( this );
+    else
         this->DoVTKRender();
-    }
+}
+
+bool View::Render()
+{
+    if( !this->m_renderingEnabled || !this->Interactor ) return false;
+    this->DoVTKRender();
+    return true;
 }
 
 void View::EnableRendering() { this->SetRenderingEnabled( true ); }
@@ -529,7 +545,7 @@ void View::DoVTKRender()
     if( this->Interactor )
     {
         this->Interactor->Render();
-        this->SetRenderingEnabled( false );
+        m_needsRender = false;
     }
 }
 
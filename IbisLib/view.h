@@ -100,8 +100,11 @@ public:
      *  results in a Qt application. */
     void SetQtRenderWidget( QVTKRenderWidget * w );
 
-    /** Control rendering of the view */
+    /** Control rendering of the view. Render requests received while disabled are
+     *  executed when rendering is enabled again. */
     void SetRenderingEnabled( bool b );
+    /** Render now, bypassing the render scheduler. Returns false if rendering is disabled. */
+    bool Render();
 
     /** Get view interactor */
     vtkRenderWindowInteractor * GetInteractor();
@@ -166,8 +169,8 @@ public:
 
 public slots:
 
-    /** Notify the view that something it contains needs render. The view is then
-     *  going to emit a Modified event. */
+    /** Notify the view that something it contains needs render. The view is
+     *  rendered in the next frame of the render scheduler. */
     void NotifyNeedRender();
     /** Set enable render to true to refresh rendering */
     void EnableRendering();
@@ -201,6 +204,7 @@ protected:
     QString Name;
     QVTKRenderWidget * RenderWidget;
     bool m_renderingEnabled;
+    bool m_needsRender;
     vtkSmartPointer<vtkRenderWindowInteractor> Interactor;
     vtkSmartPointer<vtkRenderer> Renderer;
     vtkSmartPointer<vtkRenderer> OverlayRenderer;
@@ -154,6 +154,15 @@ void WorldObject::SetUpdateFrequency( double fps ) { Application::GetInstance().
 
 double WorldObject::GetUpdateFrequency() { return Application::GetInstance().GetUpdateFrequency(); }
 
+void WorldObject::SetTractogramSubsampling( int streamlineStep, int pointStep )
+{
+    Application::GetInstance().SetTractogramSubsampling( streamlineStep, pointStep );
+}
+
+int WorldObject::GetTractogramStreamlineStep() { return Application::GetInstance().GetTractogramStreamlineStep(); }
+
+int WorldObject::GetTractogramPointStep() { return Application::GetInstance().GetTractogramPointStep(); }
+
 QWidget * WorldObject::CreateSettingsDialog( QWidget * parent )
 {
     WorldObjectSettingsWidget * res = new WorldObjectSettingsWidget( parent );
@@ -110,6 +110,16 @@ public:
     double GetUpdateFrequency();
     ///@}
 
+    /** @name  Tractograms
+     *   @brief Set/Get subsampling of the tractograms opened after the call.
+     *
+     * */
+    ///@{
+    void SetTractogramSubsampling( int streamlineStep, int pointStep );
+    int GetTractogramStreamlineStep();
+    int GetTractogramPointStep();
+    ///@}
+
     virtual QWidget * CreateSettingsDialog( QWidget * parent ) override;
     virtual void CreateSettingsWidgets( QWidget * parent, QVector<QWidget *> * widgets ) override {}
 
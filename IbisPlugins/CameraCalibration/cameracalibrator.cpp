@@ -20,6 +20,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include <QFileInfo>
 #include <QProgressDialog>
+#include <QTextStream>
 #include <QtGlobal>
 
 #include "cameracalibrationplugininterface.h"
@@ -12,12 +12,26 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include "frameratetesterplugininterface.h"
 
+#include <vtkCamera.h>
+#include <vtkMath.h>
+#include <vtkRenderWindow.h>
 #include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
 
-#include <QMap>
+#include <QDateTime>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
 #include <QTimer>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include "frameratetesterwidget.h"
 #include "ibisapi.h"
 #include "view.h"
@@ -31,9 +45,14 @@ FrameRateTesterPluginInterface::FrameRateTesterPluginInterface()
     m_currentViewID      = THREED_VIEW_ID;
     m_time               = new QElapsedTimer;
     m_accumulatedFrames  = 0;
+    m_pathRecordingTimer = 0;
 }
 
-FrameRateTesterPluginInterface::~FrameRateTesterPluginInterface() { delete m_time; }
+FrameRateTesterPluginInterface::~FrameRateTesterPluginInterface()
+{
+    delete m_time;
+    delete m_pathRecordingTimer;
+}
 
 bool FrameRateTesterPluginInterface::CanRun() { return true; }
 
@@ -99,7 +118,7 @@ void FrameRateTesterPluginInterface::OnTimerTriggered()
     if( m_lastNumberOfFrames == 0 ) m_time->restart();
 
     // Render
-    GetIbisAPI()->GetViewByID( m_currentViewID )->NotifyNeedRender();
+    GetIbisAPI()->GetViewByID( m_currentViewID )->Render();
 
     // Increment stats
     m_lastPeriod = ( (double)m_time->elapsed() ) * 0.001;
@@ -122,3 +141,293 @@ void FrameRateTesterPluginInterface::SetRenderingEnabled( bool enabled )
         if( id != m_currentViewID ) GetIbisAPI()->GetViewByID( id )->SetRenderingEnabled( enabled );
     }
 }
+
+// Nearest-rank percentile of sorted values
+static double Percentile( const std::vector<double> & sortedValues, double percent )
+{
+    int rank = static_cast<int>( std::ceil( percent / 100.0 * sortedValues.size() ) ) - 1;
+    return sortedValues[std::min( std::max( rank, 0 ), static_cast<int>( sortedValues.size() ) - 1 )];
+}
+
+static QJsonObject LatencyStatistics( std::vector<double> times )
+{
+    QJsonObject stats;
+    if( times.empty() ) return stats;
+    std::sort( times.begin(), times.end() );
+    double total  = std::accumulate( times.begin(), times.end(), 0.0 );
+    stats["p50"]  = Percentile( times, 50.0 );
+    stats["p95"]  = Percentile( times, 95.0 );
+    stats["p99"]  = Percentile( times, 99.0 );
+    stats["mean"] = total / times.size();
+    stats["min"]  = times.front();
+    stats["max"]  = times.back();
+    return stats;
+}
+
+static QJsonArray ToJsonArray( const double v[3] ) { return QJsonArray() << v[0] << v[1] << v[2]; }
+
+static bool FromJsonArray( const QJsonValue & value, double v[3] )
+{
+    QJsonArray a = value.toArray();
+    if( a.size() != 3 ) return false;
+    for( int i = 0; i < 3; ++i ) v[i] = a[i].toDouble();
+    return true;
+}
+
+void FrameRateTesterPluginInterface::SetPathRecording( bool record )
+{
+    Q_ASSERT( record != IsPathRecording() );
+    if( record )
+    {
+        // Sample the 3D camera and the cursor at 30 Hz while the user interacts
+        m_path.clear();
+        m_pathRecordingTimer = new QTimer;
+        connect( m_pathRecordingTimer, SIGNAL( timeout() ), this, SLOT( OnPathRecordingTimerTriggered() ) );
+        m_pathRecordingTimer->start( 33 );
+    }
+    else
+    {
+        m_pathRecordingTimer->stop();
+        delete m_pathRecordingTimer;
+        m_pathRecordingTimer = 0;
+    }
+    emit PluginModified();
+}
+
+void FrameRateTesterPluginInterface::ClearPath()
+{
+    m_path.clear();
+    emit PluginModified();
+}
+
+void FrameRateTesterPluginInterface::OnPathRecordingTimerTriggered()
+{
+    PathFrame frame;
+    GetCurrentFrame( frame );
+    m_path.push_back( frame );
+    emit PeriodicSignal();
+}
+
+bool FrameRateTesterPluginInterface::LoadPath( const QString & fileName )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        GetIbisAPI()->Warning( "Frame Rate Tester", QString( "Can't read path file %1" ).arg( fileName ) );
+        return false;
+    }
+    QJsonArray frames = QJsonDocument::fromJson( file.readAll() ).object()["frames"].toArray();
+    std::vector<PathFrame> path( frames.size() );
+    for( int i = 0; i < frames.size(); ++i )
+    {
+        QJsonObject f = frames[i].toObject();
+        if( !FromJsonArray( f["position"], path[i].position ) ||
+            !FromJsonArray( f["focalPoint"], path[i].focalPoint ) || !FromJsonArray( f["viewUp"], path[i].viewUp ) ||
+            !FromJsonArray( f["cursor"], path[i].cursor ) )
+        {
+            GetIbisAPI()->Warning( "Frame Rate Tester", QString( "Invalid frame %1 in %2" ).arg( i ).arg( fileName ) );
+            return false;
+        }
+    }
+    if( path.empty() )
+    {
+        GetIbisAPI()->Warning( "Frame Rate Tester", QString( "No frame in path file %1" ).arg( fileName ) );
+        return false;
+    }
+    m_path = path;
+    emit PluginModified();
+    return true;
+}
+
+bool FrameRateTesterPluginInterface::SavePath( const QString & fileName )
+{
+    QJsonArray frames;
+    for( size_t i = 0; i < m_path.size(); ++i )
+    {
+        QJsonObject f;
+        f["position"]   = ToJsonArray( m_path[i].position );
+        f["focalPoint"] = ToJsonArray( m_path[i].focalPoint );
+        f["viewUp"]     = ToJsonArray( m_path[i].viewUp );
+        f["cursor"]     = ToJsonArray( m_path[i].cursor );
+        frames.append( f );
+    }
+    QJsonObject root;
+    root["frames"] = frames;
+
+    QFile file( fileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ||
+        file.write( QJsonDocument( root ).toJson() ) < 0 )
+    {
+        GetIbisAPI()->Warning( "Frame Rate Tester", QString( "Can't write path file %1" ).arg( fileName ) );
+        return false;
+    }
+    return true;
+}
+
+void FrameRateTesterPluginInterface::GenerateOrbitPath( int nbFrames )
+{
+    // One turn of the 3D camera around the focal point while the cursor sweeps the visible scene
+    PathFrame start;
+    GetCurrentFrame( start );
+    double bounds[6];
+    GetIbisAPI()->GetMain3DView()->GetRenderer()->ComputeVisiblePropBounds( bounds );
+    bool validBounds = bounds[0] <= bounds[1];
+
+    m_path.resize( std::max( nbFrames, 1 ) );
+    for( size_t i = 0; i < m_path.size(); ++i )
+    {
+        double t                               = static_cast<double>( i ) / m_path.size();
+        vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+        rotation->Translate( start.focalPoint );
+        rotation->RotateWXYZ( 360.0 * t, start.viewUp );
+        rotation->Translate( -start.focalPoint[0], -start.focalPoint[1], -start.focalPoint[2] );
+
+        PathFrame & frame = m_path[i];
+        rotation->TransformPoint( start.position, frame.position );
+        std::copy( start.focalPoint, start.focalPoint + 3, frame.focalPoint );
+        std::copy( start.viewUp, start.viewUp + 3, frame.viewUp );
+        double sweep = 0.8 * std::sin( 2.0 * vtkMath::Pi() * t );
+        for( int c = 0; c < 3; ++c )
+        {
+            double center   = validBounds ? 0.5 * ( bounds[2 * c] + bounds[2 * c + 1] ) : start.cursor[c];
+            double extent   = validBounds ? 0.5 * ( bounds[2 * c + 1] - bounds[2 * c] ) : 0.0;
+            frame.cursor[c] = center + sweep * extent;
+        }
+    }
+    emit PluginModified();
+}
+
+bool FrameRateTesterPluginInterface::RunBenchmark( const QString & outputFileName, int warmupFrames )
+{
+    IbisAPI * api = GetIbisAPI();
+    if( api->IsHeadless() )
+    {
+        api->Warning( "Frame Rate Tester", "Benchmark needs render windows, it can't run in batch mode." );
+        return false;
+    }
+    if( IsRunning() || IsPathRecording() )
+    {
+        api->Warning( "Frame Rate Tester", "Stop the frame rate test and path recording before the benchmark." );
+        return false;
+    }
+    if( m_path.empty() ) GenerateOrbitPath( 360 );
+
+    QList<View *> views = GetBenchmarkViews();
+    PathFrame initialFrame;
+    GetCurrentFrame( initialFrame );
+
+    // Frame latency: apply camera and cursor, then render all views. Times in ms.
+    std::vector<double> frameTimes;
+    std::vector<std::vector<double> > viewTimes( views.size() );
+    QElapsedTimer timer;
+    warmupFrames = std::max( warmupFrames, 0 );
+    for( int i = 0; i < warmupFrames + static_cast<int>( m_path.size() ); ++i )
+    {
+        timer.start();
+        ApplyFrame( m_path[i < warmupFrames ? i % m_path.size() : i - warmupFrames] );
+        for( int v = 0; v < views.size(); ++v )
+        {
+            qint64 viewStart = timer.nsecsElapsed();
+            if( !views[v]->Render() )
+            {
+                api->Warning( "Frame Rate Tester", QString( "Can't render view %1" ).arg( views[v]->GetName() ) );
+                ApplyFrame( initialFrame );
+                return false;
+            }
+            if( i >= warmupFrames ) viewTimes[v].push_back( ( timer.nsecsElapsed() - viewStart ) * 1e-6 );
+        }
+        if( i >= warmupFrames ) frameTimes.push_back( timer.nsecsElapsed() * 1e-6 );
+    }
+
+    ApplyFrame( initialFrame );
+    foreach( View * v, views )
+        v->NotifyNeedRender();
+
+    QJsonObject frameStats = LatencyStatistics( frameTimes );
+    QJsonObject viewsStats;
+    for( int v = 0; v < views.size(); ++v )
+    {
+        QJsonObject stats               = LatencyStatistics( viewTimes[v] );
+        int * size                      = views[v]->GetRenderer()->GetRenderWindow()->GetSize();
+        stats["width"]                  = size[0];
+        stats["height"]                 = size[1];
+        viewsStats[views[v]->GetName()] = stats;
+    }
+    QJsonArray rawFrameTimes;
+    for( size_t i = 0; i < frameTimes.size(); ++i ) rawFrameTimes.append( frameTimes[i] );
+
+    QJsonObject root;
+    root["benchmark"]      = QString( "FrameRateTester" );
+    root["gitHash"]        = api->GetGitHashShort();
+    root["date"]           = QDateTime::currentDateTime().toString( Qt::ISODate );
+    root["unit"]           = QString( "ms" );
+    root["warmupFrames"]   = warmupFrames;
+    root["numberOfFrames"] = static_cast<int>( frameTimes.size() );
+    root["frame"]          = frameStats;
+    root["views"]          = viewsStats;
+    root["frameTimes"]     = rawFrameTimes;
+
+    m_lastBenchmarkSummary = QString( "Frame latency (ms) p50: %1  p95: %2  p99: %3" )
+                                 .arg( frameStats["p50"].toDouble(), 0, 'f', 2 )
+                                 .arg( frameStats["p95"].toDouble(), 0, 'f', 2 )
+                                 .arg( frameStats["p99"].toDouble(), 0, 'f', 2 );
+    emit PluginModified();
+
+    QFile file( outputFileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ||
+        file.write( QJsonDocument( root ).toJson() ) < 0 )
+    {
+        api->Warning( "Frame Rate Tester", QString( "Can't write benchmark results to %1" ).arg( outputFileName ) );
+        return false;
+    }
+    return true;
+}
+
+bool FrameRateTesterPluginInterface::RunBatchOperation( const QString & operation,
+                                                        const QMap<QString, QString> & args )
+{
+    Q_ASSERT( operation == "Benchmark" );
+    if( !args.contains( "output" ) )
+    {
+        GetIbisAPI()->Warning( "Frame Rate Tester", "Benchmark needs an output file: output=results.json" );
+        return false;
+    }
+    if( args.contains( "path" ) )
+    {
+        if( !LoadPath( args["path"] ) ) return false;
+    }
+    else
+        GenerateOrbitPath( args.value( "frames", "360" ).toInt() );
+    return RunBenchmark( args["output"], args.value( "warmup", "10" ).toInt() );
+}
+
+void FrameRateTesterPluginInterface::GetCurrentFrame( PathFrame & frame )
+{
+    vtkCamera * cam = GetIbisAPI()->GetMain3DView()->GetRenderer()->GetActiveCamera();
+    cam->GetPosition( frame.position );
+    cam->GetFocalPoint( frame.focalPoint );
+    cam->GetViewUp( frame.viewUp );
+    GetIbisAPI()->GetCursorWorldPosition( frame.cursor );
+}
+
+void FrameRateTesterPluginInterface::ApplyFrame( const PathFrame & frame )
+{
+    vtkRenderer * ren = GetIbisAPI()->GetMain3DView()->GetRenderer();
+    vtkCamera * cam   = ren->GetActiveCamera();
+    cam->SetPosition( frame.position );
+    cam->SetFocalPoint( frame.focalPoint );
+    cam->SetViewUp( frame.viewUp );
+    ren->ResetCameraClippingRange();
+    double cursor[3] = { frame.cursor[0], frame.cursor[1], frame.cursor[2] };
+    GetIbisAPI()->SetCursorWorldPosition( cursor );
+}
+
+QList<View *> FrameRateTesterPluginInterface::GetBenchmarkViews()
+{
+    IbisAPI * api = GetIbisAPI();
+    QList<View *> views;
+    views << api->GetMain3DView() << api->GetMainSagittalView() << api->GetMainCoronalView()
+          << api->GetMainTransverseView();
+    views.removeAll( nullptr );
+    return views;
+}
@@ -13,11 +13,14 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #ifndef FRAMERATETESTERPLUGININTERFACE_H
 #define FRAMERATETESTERPLUGININTERFACE_H
 
+#include <vector>
+
 #include "toolplugininterface.h"
 
 // class vtkEventQtSlotConnect;
 class QTimer;
 class QElapsedTimer;
+class View;
 
 class FrameRateTesterPluginInterface : public ToolPluginInterface
 {
@@ -48,9 +51,38 @@ public:
     void SetCurrentViewId( int id );
     int GetCurrentViewID() { return m_currentViewID; }
 
+    // Description:
+    // Scripted benchmark: a camera and cursor path is replayed in the 4 views and the latency
+    // of every frame is measured. A path is recorded from the 3D view while the user interacts,
+    // saved and loaded as JSON. If no path is loaded, an orbit around the scene is generated.
+    // Results are written as JSON (percentiles of the frame and per view latencies) to compare
+    // rendering performance between releases. Can be run unattended with:
+    // ibis --scene ref.xml --run FrameRateTester.Benchmark:path=path.json,output=result.json --quit
+    struct PathFrame
+    {
+        double position[3];
+        double focalPoint[3];
+        double viewUp[3];
+        double cursor[3];
+    };
+    void SetPathRecording( bool record );
+    bool IsPathRecording() { return m_pathRecordingTimer != 0; }
+    int GetPathLength() { return static_cast<int>( m_path.size() ); }
+    void ClearPath();
+    bool LoadPath( const QString & fileName );
+    bool SavePath( const QString & fileName );
+    void GenerateOrbitPath( int nbFrames );
+    // Replay the path once after warmupFrames frames, false if views can't render or output can't be written
+    bool RunBenchmark( const QString & outputFileName, int warmupFrames );
+    QString GetLastBenchmarkSummary() { return m_lastBenchmarkSummary; }
+
+    virtual QStringList GetBatchOperations() override { return QStringList() << "Benchmark"; }
+    virtual bool RunBatchOperation( const QString & operation, const QMap<QString, QString> & args ) override;
+
 private slots:
 
     void OnTimerTriggered();
+    void OnPathRecordingTimerTriggered();
 
 signals:
 
@@ -58,6 +90,9 @@ signals:
 
 protected:
     void SetRenderingEnabled( bool enabled );
+    void GetCurrentFrame( PathFrame & frame );
+    void ApplyFrame( const PathFrame & frame );
+    QList<View *> GetBenchmarkViews();
 
     int m_numberOfFrames;
     QTimer * m_timer;
@@ -69,6 +104,10 @@ protected:
 
     // temp var used when running
     int m_accumulatedFrames;
+
+    std::vector<PathFrame> m_path;
+    QTimer * m_pathRecordingTimer;
+    QString m_lastBenchmarkSummary;
 };
 
 #endif
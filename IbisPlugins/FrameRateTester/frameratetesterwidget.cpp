@@ -78,6 +78,19 @@ void FrameRateTesterWidget::UpdateUi()
     ui->periodSpinBox->setValue( m_pluginInterface->GetNumberOfFrames() );
     ui->periodSpinBox->blockSignals( false );
 
+    // Benchmark
+    bool idle = !m_pluginInterface->IsRunning() && !m_pluginInterface->IsPathRecording();
+    ui->recordPathButton->blockSignals( true );
+    ui->recordPathButton->setChecked( m_pluginInterface->IsPathRecording() );
+    ui->recordPathButton->setText( m_pluginInterface->IsPathRecording() ? "Stop" : "Record" );
+    ui->recordPathButton->setEnabled( !m_pluginInterface->IsRunning() );
+    ui->recordPathButton->blockSignals( false );
+    ui->clearPathButton->setEnabled( idle );
+    ui->loadPathButton->setEnabled( idle );
+    ui->savePathButton->setEnabled( idle && m_pluginInterface->GetPathLength() > 0 );
+    ui->runBenchmarkButton->setEnabled( idle );
+    ui->benchmarkResultLabel->setText( m_pluginInterface->GetLastBenchmarkSummary() );
+
     UpdateStats();
 }
 
@@ -86,6 +99,10 @@ void FrameRateTesterWidget::UpdateStats()
     ui->lastPeriodLabel->setText( QString( "Period : %1" ).arg( m_pluginInterface->GetLastPeriod() ) );
     ui->numberOfFramesLabel->setText( QString( "Nb Frames : %1" ).arg( m_pluginInterface->GetLastNumberOfFrames() ) );
     ui->frameRateLabel->setText( QString( "Fps : %1" ).arg( m_pluginInterface->GetLastFrameRate() ) );
+    if( m_pluginInterface->GetPathLength() > 0 )
+        ui->pathLengthLabel->setText( QString( "Path : %1 frames" ).arg( m_pluginInterface->GetPathLength() ) );
+    else
+        ui->pathLengthLabel->setText( "Path : orbit around the scene" );
 }
 
 void FrameRateTesterWidget::on_currentViewComboBox_currentIndexChanged( int index )
@@ -106,3 +123,41 @@ void FrameRateTesterWidget::on_runButton_toggled( bool checked )
     Q_ASSERT( m_pluginInterface );
     m_pluginInterface->SetRunning( checked );
 }
+
+void FrameRateTesterWidget::on_recordPathButton_toggled( bool checked )
+{
+    Q_ASSERT( m_pluginInterface );
+    m_pluginInterface->SetPathRecording( checked );
+}
+
+void FrameRateTesterWidget::on_clearPathButton_clicked()
+{
+    Q_ASSERT( m_pluginInterface );
+    m_pluginInterface->ClearPath();
+}
+
+void FrameRateTesterWidget::on_loadPathButton_clicked()
+{
+    Q_ASSERT( m_pluginInterface );
+    IbisAPI * api    = m_pluginInterface->GetIbisAPI();
+    QString fileName = api->GetFileNameOpen( "Load Path", api->GetWorkingDirectory(), "Path files (*.json)" );
+    if( !fileName.isEmpty() ) m_pluginInterface->LoadPath( fileName );
+}
+
+void FrameRateTesterWidget::on_savePathButton_clicked()
+{
+    Q_ASSERT( m_pluginInterface );
+    IbisAPI * api = m_pluginInterface->GetIbisAPI();
+    QString fileName =
+        api->GetFileNameSave( "Save Path", api->GetWorkingDirectory() + "/path.json", "Path files (*.json)" );
+    if( !fileName.isEmpty() ) m_pluginInterface->SavePath( fileName );
+}
+
+void FrameRateTesterWidget::on_runBenchmarkButton_clicked()
+{
+    Q_ASSERT( m_pluginInterface );
+    IbisAPI * api    = m_pluginInterface->GetIbisAPI();
+    QString fileName = api->GetFileNameSave( "Save Benchmark Results", api->GetWorkingDirectory() + "/benchmark.json",
+                                             "Benchmark results (*.json)" );
+    if( !fileName.isEmpty() ) m_pluginInterface->RunBenchmark( fileName, 10 );
+}
@@ -41,6 +41,11 @@ private slots:
     void on_currentViewComboBox_currentIndexChanged( int index );
     void on_periodSpinBox_valueChanged( int arg1 );
     void on_runButton_toggled( bool checked );
+    void on_recordPathButton_toggled( bool checked );
+    void on_clearPathButton_clicked();
+    void on_loadPathButton_clicked();
+    void on_savePathButton_clicked();
+    void on_runBenchmarkButton_clicked();
 
 private:
     FrameRateTesterPluginInterface * m_pluginInterface;
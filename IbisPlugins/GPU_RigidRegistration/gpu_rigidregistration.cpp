@@ -19,6 +19,8 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include <sstream>
 
+#include "ibisrigidtransform.h"
+
 class CommandIterationUpdateOpenCL : public itk::Command
 {
 public:
@@ -33,7 +35,6 @@ protected:
 public:
     typedef const GPU_RigidRegistration::OptimizerType * OptimizerPointer;
     typedef const GPU_RigidRegistration::GPUCostFunctionType * GPUConstCostFunctionPointer;
-    typedef GPU_RigidRegistration::ItkRigidTransformType::Pointer ItkRigidTransformPointer;
     vtkTransform * m_targetImageVtkTransform;
     vtkTransform * m_vtktransform;
     vtkTransform * m_parentTransform;
@@ -72,44 +73,25 @@ public:
 
         if( m_Debug ) *this->m_debugStream << "Optimizer Value:\t" << optimizer->GetCurrentValue() << std::endl;
 
-        ItkRigidTransformPointer itkTransform = GPU_RigidRegistration::ItkRigidTransformType::New();
-
-        GPU_RigidRegistration::ItkRigidTransformType::ParametersType params = optimizer->GetCurrentPosition();
-        GPU_RigidRegistration::ItkRigidTransformType::CenterType center     = metric->GetCenter();
-        itkTransform->SetCenter( center );
-        itkTransform->SetParameters( params );
-
-        vtkTransform * vtktransform = m_vtktransform;
-
-        GPU_RigidRegistration::ItkRigidTransformType::MatrixType matrix = itkTransform->GetMatrix();
-
-        GPU_RigidRegistration::ItkRigidTransformType::OffsetType offset = itkTransform->GetOffset();
-
-        vtkSmartPointer<vtkMatrix4x4> localMatrix_inv = vtkSmartPointer<vtkMatrix4x4>::New();
-
-        for( unsigned int i = 0; i < 3; i++ )
-        {
-            for( unsigned int j = 0; j < 3; j++ )
-            {
-                localMatrix_inv->SetElement( i, j, matrix.GetVnlMatrix().get( i, j ) );
-            }
-
-            localMatrix_inv->SetElement( i, 3, offset[i] );
-        }
-        localMatrix_inv->Invert();
-
-        vtkSmartPointer<vtkMatrix4x4> finalMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        // Inverse of the current Euler transform, composed without allocating or converting through ITK
+        const auto & position   = optimizer->GetCurrentPosition();
+        const auto metricCenter = metric->GetCenter();
+        double params[6], center[3], matrix[16];
+        for( unsigned int i = 0; i < 6; i++ ) params[i] = position[i];
+        for( unsigned int i = 0; i < 3; i++ ) center[i] = metricCenter[i];
+        IbisRigidTransform::RigidParametersToMatrix( params, center, matrix );
+        IbisRigidTransform::InvertRigid( matrix, matrix );
 
         if( m_parentTransform != 0 )
         {
-            vtkSmartPointer<vtkMatrix4x4> parentWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-            m_parentTransform->GetInverse( parentWorldMatrix );
-            finalMatrix->Multiply4x4( parentWorldMatrix, localMatrix_inv, localMatrix_inv );
+            double parentWorldMatrix[16];
+            vtkMatrix4x4::Invert( m_parentTransform->GetMatrix()->GetData(), parentWorldMatrix );
+            IbisRigidTransform::Compose( parentWorldMatrix, matrix, matrix );
         }
 
-        vtkMatrix4x4::Multiply4x4( localMatrix_inv, m_targetImageVtkTransform->GetMatrix(), localMatrix_inv );
-        vtktransform->SetMatrix( localMatrix_inv );
-        vtktransform->Modified();
+        IbisRigidTransform::Compose( matrix, m_targetImageVtkTransform->GetMatrix()->GetData(), matrix );
+        m_vtktransform->SetMatrix( matrix );
+        m_vtktransform->Modified();
     }
 };
 
@@ -133,6 +115,11 @@ GPU_RigidRegistration::GPU_RigidRegistration()
       m_itkTargetImage( nullptr )
 {
     m_samplingStrategy = SamplingStrategy::RANDOM;
+    m_samplingSeed     = 0;
+
+    m_finalMetricValue          = 0.0;
+    m_numberOfIterations        = 0;
+    m_numberOfMetricEvaluations = 0;
 }
 
 GPU_RigidRegistration::~GPU_RigidRegistration() {}
@@ -218,45 +205,6 @@ void GPU_RigidRegistration::runRegistration()
     sourceVtkTransform->GetInverse( finalMatrix );
     vtkMatrix4x4::Multiply4x4( targetVtkTransform->GetMatrix(), finalMatrix, finalMatrix );
 
-    ItkRigidTransformType::OffsetType offset;
-
-    vnl_matrix<double> M( 3, 3 );
-
-    for( unsigned int i = 0; i < 3; i++ )
-    {
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            M[i][j] = finalMatrix->GetElement( i, j );
-        }
-        offset[i] = finalMatrix->GetElement( i, 3 );
-    }
-
-    double angleX, angleY, angleZ;
-    angleX   = std::asin( M[2][1] );
-    double A = std::cos( angleX );
-    if( std::fabs( A ) > 0.00005 )
-    {
-        double x = M[2][2] / A;
-        double y = -M[2][0] / A;
-        angleY   = std::atan2( y, x );
-
-        x      = M[1][1] / A;
-        y      = -M[0][1] / A;
-        angleZ = std::atan2( y, x );
-    }
-    else
-    {
-        angleZ   = 0;
-        double x = M[0][0];
-        double y = M[1][0];
-        angleY   = std::atan2( y, x );
-    }
-
-    ItkRigidTransformType::ParametersType params = ItkRigidTransformType::ParametersType( 6 );
-    params[0]                                    = angleX;
-    params[1]                                    = angleY;
-    params[2]                                    = angleZ;
-
     ItkRigidTransformType::CenterType center;
     center[0] = itkTargetImage->GetOrigin()[0] +
                 itkTargetImage->GetSpacing()[0] * itkTargetImage->GetBufferedRegion().GetSize()[0] / 2.0;
@@ -265,19 +213,19 @@ void GPU_RigidRegistration::runRegistration()
     center[2] = itkTargetImage->GetOrigin()[2] +
                 itkTargetImage->GetSpacing()[2] * itkTargetImage->GetBufferedRegion().GetSize()[2] / 2.0;
 
-    for( unsigned int i = 0; i < 3; i++ )
+    double rigidParams[6];
+    IbisRigidTransform::MatrixToRigidParameters( finalMatrix->GetData(), center.GetDataPointer(), rigidParams );
+    ItkRigidTransformType::ParametersType params( 6 );
+    for( unsigned int i = 0; i < 6; i++ )
     {
-        params[i + 3] = offset[i] - center[i];
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            params[i + 3] += M[i][j] * center[j];
-        }
+        params[i] = rigidParams[i];
     }
 
     itkTransform->SetCenter( center );
     itkTransform->SetParameters( params );
 
     metric->SetSamplingStrategy( m_samplingStrategy );
+    metric->SetSeed( m_samplingSeed );
     metric->SetTransform( itkTransform );
     metric->SetNumberOfPixels( numberOfPixels );
     metric->SetPercentile( percentile );
@@ -317,6 +265,7 @@ void GPU_RigidRegistration::runRegistration()
     optimizer->SetNumberOfParents( 0 );
     optimizer->SetMaximumNumberOfIterations( 300 );
     optimizer->SetInitialSigma( initialSigma );
+    optimizer->SetSeed( m_samplingSeed );
 
     CommandIterationUpdateOpenCL::Pointer observer = CommandIterationUpdateOpenCL::New();
     observer->SetVtkTransform( m_resultTransform );
@@ -341,6 +290,10 @@ void GPU_RigidRegistration::runRegistration()
         std::cerr << err << std::endl;
     }
 
+    m_finalMetricValue          = optimizer->GetCurrentValue();
+    m_numberOfIterations        = optimizer->GetCurrentIteration();
+    m_numberOfMetricEvaluations = costFunction->GetNumberOfEvaluations();
+
     if( m_debug ) timer.Stop( "Registration" );
 
     if( m_debug )
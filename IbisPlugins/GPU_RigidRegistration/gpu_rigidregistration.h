@@ -14,7 +14,6 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #define GPU_RIGIDREGISTRATION_H
 
 #include <itkAmoebaOptimizer.h>
-#include <itkCMAEvolutionStrategyOptimizer.h>
 #include <itkEuler3DTransform.h>
 #include <itkImageMaskSpatialObject.h>
 #include <itkSPSAOptimizer.h>
@@ -25,11 +24,12 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include "imageobject.h"
 #include "itkGPU3DRigidSimilarityMetric.h"
+#include "itkSeededCMAEvolutionStrategyOptimizer.h"
 
 class GPU_RigidRegistration
 {
 public:
-    typedef itk::CMAEvolutionStrategyOptimizer OptimizerType;
+    typedef itk::SeededCMAEvolutionStrategyOptimizer OptimizerType;
 
     typedef itk::GPU3DRigidSimilarityMetric<IbisItkFloat3ImageType, IbisItkFloat3ImageType> GPUCostFunctionType;
     typedef GPUCostFunctionType::Pointer GPUCostFunctionPointer;
@@ -91,11 +91,21 @@ public:
     void SetSamplingStrategyToRandom() { this->m_samplingStrategy = SamplingStrategy::RANDOM; }
     void SetSamplingStrategyToGrid() { this->m_samplingStrategy = SamplingStrategy::GRID; }
     void SetSamplingStrategyToFull() { this->m_samplingStrategy = SamplingStrategy::FULL; }
+    void SetSamplingStrategyToStratified() { this->m_samplingStrategy = SamplingStrategy::STRATIFIED; }
     SamplingStrategy GetSamplingStrategy() { return this->m_samplingStrategy; }
+    // Seed of the random and stratified samplers and of the optimizer, use the same seed to get reproducible
+    // registrations
+    void SetSamplingSeed( unsigned int seed ) { this->m_samplingSeed = seed; }
+    unsigned int GetSamplingSeed() { return this->m_samplingSeed; }
 
     void SetTargetMask( ImageMaskPointer mask ) { this->m_targetSpatialObjectMask = mask; }
     void SetSourceMask( ImageMaskPointer mask ) { this->m_sourceSpatialObjectMask = mask; }
 
+    // Statistics of the last call to runRegistration()
+    double GetFinalMetricValue() { return m_finalMetricValue; }
+    unsigned int GetNumberOfIterations() { return m_numberOfIterations; }
+    unsigned int GetNumberOfMetricEvaluations() { return m_numberOfMetricEvaluations; }
+
 private:
     void updateTagsDistance();
 
@@ -123,6 +133,11 @@ private:
 
     vtkTransform * m_parentVtkTransform;
     SamplingStrategy m_samplingStrategy;
+    unsigned int m_samplingSeed;
+
+    double m_finalMetricValue;
+    unsigned int m_numberOfIterations;
+    unsigned int m_numberOfMetricEvaluations;
 };
 
 #endif
@@ -0,0 +1,497 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+// Command-line benchmark of GPU_RigidRegistration: applies a grid of known rigid
+// misalignments to a pair of aligned volumes and reports speed, capture range and accuracy.
+
+#include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
+#include <itkImageFileReader.h>
+#include <itkImageRegionIterator.h>
+#include <itkRegionOfInterestImageFilter.h>
+#include <itkTimeProbe.h>
+#include <vtkMath.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gpu_rigidregistration.h"
+
+namespace
+{
+struct BenchmarkParameters
+{
+    std::string fixedFileName;
+    std::string movingFileName;
+    std::string simulateFileName;
+    std::string outputFileName;
+    std::string format                  = "csv";
+    std::vector<std::string> strategies = { "random", "grid", "stratified" };
+    std::vector<double> rotations       = { 0.0, 2.0, 5.0, 10.0 };
+    std::vector<double> translations    = { 0.0, 2.0, 5.0, 10.0 };
+    unsigned int repeats                = 3;
+    unsigned int seed                   = 0;
+    unsigned int numberOfPixels         = 16000;
+    unsigned int orientationSelectivity = 32;
+    unsigned int populationSize         = 0;
+    double percentile                   = 0.8;
+    double initialSigma                 = 1.0;
+    double successThreshold             = 2.0;
+    bool useMask                        = false;
+};
+
+struct BenchmarkResult
+{
+    std::string backend;
+    std::string strategy;
+    double rotation;
+    double translation;
+    unsigned int repeat;
+    double initialTRE;
+    double finalTRE;
+    bool success;
+    double time;
+    unsigned int iterations;
+    unsigned int evaluations;
+    double metricValue;
+};
+
+void PrintUsage( const char * program )
+{
+    std::cerr << "Usage: " << program << " (--fixed <image> --moving <image> | --simulate <image>) [options]"
+              << std::endl
+              << "  --fixed <file>             target volume (e.g. MR), aligned with the moving volume" << std::endl
+              << "  --moving <file>            source volume (e.g. US)" << std::endl
+              << "  --simulate <file>          use this volume as target and a US-like volume simulated" << std::endl
+              << "                             from its gradients as source" << std::endl
+              << "  --strategies <list>        sampling strategies among random,grid,stratified,full" << std::endl
+              << "  --rotations <list>         rotation magnitudes in degrees (default 0,2,5,10)" << std::endl
+              << "  --translations <list>      translation magnitudes in mm (default 0,2,5,10)" << std::endl
+              << "  --repeats <n>              random directions per rotation/translation pair (default 3)" << std::endl
+              << "  --seed <n>                 seed of the perturbations, simulation and sampling (default 0)"
+              << std::endl
+              << "  --pixels <n>               number of sampled pixels (default 16000)" << std::endl
+              << "  --selectivity <n>          orientation selectivity (default 32)" << std::endl
+              << "  --population <n>           CMA-ES population size, 0 for default (default 0)" << std::endl
+              << "  --percentile <p>           gradient magnitude percentile (default 0.8)" << std::endl
+              << "  --sigma <s>                CMA-ES initial sigma (default 1.0)" << std::endl
+              << "  --use-mask                 only sample strong gradients" << std::endl
+              << "  --success <mm>             TRE below which a registration succeeds (default 2.0)" << std::endl
+              << "  --format <csv|json>        output format (default csv)" << std::endl
+              << "  --output <file>            output file (default standard output)" << std::endl;
+}
+
+std::vector<std::string> SplitList( const std::string & list )
+{
+    std::vector<std::string> items;
+    std::stringstream stream( list );
+    std::string item;
+    while( std::getline( stream, item, ',' ) )
+    {
+        if( !item.empty() ) items.push_back( item );
+    }
+    return items;
+}
+
+std::vector<double> SplitDoubleList( const std::string & list )
+{
+    std::vector<double> values;
+    for( const std::string & item : SplitList( list ) ) values.push_back( std::stod( item ) );
+    return values;
+}
+
+bool ParseArguments( int argc, char ** argv, BenchmarkParameters & params )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+        if( arg == "--use-mask" )
+        {
+            params.useMask = true;
+            continue;
+        }
+        if( i + 1 >= argc )
+        {
+            std::cerr << "Error: expecting a value after " << arg << " option" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        // std::stoul and std::stod throw on values that are not numbers
+        try
+        {
+            if( arg == "--fixed" )
+                params.fixedFileName = value;
+            else if( arg == "--moving" )
+                params.movingFileName = value;
+            else if( arg == "--simulate" )
+                params.simulateFileName = value;
+            else if( arg == "--strategies" )
+                params.strategies = SplitList( value );
+            else if( arg == "--rotations" )
+                params.rotations = SplitDoubleList( value );
+            else if( arg == "--translations" )
+                params.translations = SplitDoubleList( value );
+            else if( arg == "--repeats" )
+                params.repeats = std::stoul( value );
+            else if( arg == "--seed" )
+                params.seed = std::stoul( value );
+            else if( arg == "--pixels" )
+                params.numberOfPixels = std::stoul( value );
+            else if( arg == "--selectivity" )
+                params.orientationSelectivity = std::stoul( value );
+            else if( arg == "--population" )
+                params.populationSize = std::stoul( value );
+            else if( arg == "--percentile" )
+                params.percentile = std::stod( value );
+            else if( arg == "--sigma" )
+                params.initialSigma = std::stod( value );
+            else if( arg == "--success" )
+                params.successThreshold = std::stod( value );
+            else if( arg == "--format" )
+                params.format = value;
+            else if( arg == "--output" )
+                params.outputFileName = value;
+            else
+            {
+                std::cerr << "Error: unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        catch( std::exception & )
+        {
+            std::cerr << "Error: invalid value " << value << " for " << arg << " option" << std::endl;
+            return false;
+        }
+    }
+
+    bool pair = !params.fixedFileName.empty() && !params.movingFileName.empty();
+    if( pair == !params.simulateFileName.empty() )
+    {
+        std::cerr << "Error: specify either --fixed and --moving or --simulate" << std::endl;
+        return false;
+    }
+    if( params.format != "csv" && params.format != "json" )
+    {
+        std::cerr << "Error: unknown output format " << params.format << std::endl;
+        return false;
+    }
+    for( const std::string & strategy : params.strategies )
+    {
+        if( strategy != "random" && strategy != "grid" && strategy != "stratified" && strategy != "full" )
+        {
+            std::cerr << "Error: unknown sampling strategy " << strategy << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+IbisItkFloat3ImageType::Pointer ReadImage( const std::string & fileName )
+{
+    using ReaderType           = itk::ImageFileReader<IbisItkFloat3ImageType>;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( fileName );
+    try
+    {
+        reader->Update();
+    }
+    catch( itk::ExceptionObject & err )
+    {
+        std::cerr << "Cannot read " << fileName << std::endl;
+        std::cerr << err << std::endl;
+        return nullptr;
+    }
+    return reader->GetOutput();
+}
+
+// Builds a US-like volume from the target: the central half of the field of view, where
+// intensity follows the gradient magnitude (tissue interfaces) modulated by Rayleigh speckle.
+IbisItkFloat3ImageType::Pointer SimulateUltrasound( IbisItkFloat3ImageType::Pointer image, unsigned int seed )
+{
+    using GradientFilterType           = itk::GradientMagnitudeRecursiveGaussianImageFilter<IbisItkFloat3ImageType>;
+    GradientFilterType::Pointer filter = GradientFilterType::New();
+    filter->SetInput( image );
+    filter->SetSigma( image->GetSpacing()[0] );
+
+    IbisItkFloat3ImageType::RegionType region = image->GetLargestPossibleRegion();
+    IbisItkFloat3ImageType::SizeType size     = region.GetSize();
+    IbisItkFloat3ImageType::IndexType start   = region.GetIndex();
+    for( unsigned int d = 0; d < 3; ++d )
+    {
+        start[d] += size[d] / 4;
+        size[d] = std::max<IbisItkFloat3ImageType::SizeValueType>( 1, size[d] / 2 );
+    }
+    region.SetIndex( start );
+    region.SetSize( size );
+
+    using CropFilterType         = itk::RegionOfInterestImageFilter<IbisItkFloat3ImageType, IbisItkFloat3ImageType>;
+    CropFilterType::Pointer crop = CropFilterType::New();
+    crop->SetInput( filter->GetOutput() );
+    crop->SetRegionOfInterest( region );
+    crop->Update();
+
+    IbisItkFloat3ImageType::Pointer simulated = crop->GetOutput();
+    simulated->DisconnectPipeline();
+
+    std::mt19937 generator( seed );
+    std::uniform_real_distribution<double> uniform( std::numeric_limits<double>::min(), 1.0 );
+    itk::ImageRegionIterator<IbisItkFloat3ImageType> it( simulated, simulated->GetBufferedRegion() );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+        double speckle = std::sqrt( -2.0 * std::log( uniform( generator ) ) ) / std::sqrt( vtkMath::Pi() / 2.0 );
+        it.Set( static_cast<float>( it.Get() * speckle ) );
+    }
+    return simulated;
+}
+
+// Corners and center of the source volume, where the target registration error is measured
+std::vector<std::vector<double>> ComputeTargetPoints( IbisItkFloat3ImageType::Pointer image )
+{
+    IbisItkFloat3ImageType::RegionType region = image->GetLargestPossibleRegion();
+    std::vector<std::vector<double>> points;
+    for( unsigned int c = 0; c < 9; ++c )
+    {
+        IbisItkFloat3ImageType::PointType point;
+        itk::ContinuousIndex<double, 3> index;
+        for( unsigned int d = 0; d < 3; ++d )
+        {
+            double first = region.GetIndex()[d];
+            double last  = region.GetIndex()[d] + region.GetSize()[d] - 1;
+            index[d]     = c < 8 ? ( ( c >> d ) & 1 ? last : first ) : ( first + last ) / 2.0;
+        }
+        image->TransformContinuousIndexToPhysicalPoint( index, point );
+        points.push_back( { point[0], point[1], point[2] } );
+    }
+    return points;
+}
+
+double ComputeTRE( vtkTransform * transform, const std::vector<std::vector<double>> & points )
+{
+    double sum = 0.0;
+    for( const std::vector<double> & p : points )
+    {
+        double moved[3];
+        transform->TransformPoint( p.data(), moved );
+        sum += std::sqrt( vtkMath::Distance2BetweenPoints( p.data(), moved ) );
+    }
+    return sum / points.size();
+}
+
+void SetSamplingStrategy( GPU_RigidRegistration * registration, const std::string & strategy )
+{
+    if( strategy == "random" )
+        registration->SetSamplingStrategyToRandom();
+    else if( strategy == "grid" )
+        registration->SetSamplingStrategyToGrid();
+    else if( strategy == "stratified" )
+        registration->SetSamplingStrategyToStratified();
+    else
+        registration->SetSamplingStrategyToFull();
+}
+
+void WriteCSV( std::ostream & os, const std::vector<BenchmarkResult> & results )
+{
+    os << "backend,strategy,rotation_deg,translation_mm,repeat,initial_tre_mm,final_tre_mm,success,time_s,"
+          "iterations,metric_evaluations,evaluations_per_s,metric_value"
+       << std::endl;
+    for( const BenchmarkResult & r : results )
+    {
+        os << r.backend << "," << r.strategy << "," << r.rotation << "," << r.translation << "," << r.repeat << ","
+           << r.initialTRE << "," << r.finalTRE << "," << ( r.success ? 1 : 0 ) << "," << r.time << ","
+           << r.iterations << "," << r.evaluations << "," << ( r.time > 0 ? r.evaluations / r.time : 0.0 ) << ","
+           << r.metricValue << std::endl;
+    }
+}
+
+void WriteJSON( std::ostream & os, const BenchmarkParameters & params, const std::vector<BenchmarkResult> & results )
+{
+    os << "{" << std::endl << "  \"summary\": [" << std::endl;
+    for( unsigned int s = 0; s < params.strategies.size(); ++s )
+    {
+        unsigned int count = 0, successes = 0;
+        double time = 0.0, tre = 0.0;
+        unsigned int evaluations = 0;
+        for( const BenchmarkResult & r : results )
+        {
+            if( r.strategy != params.strategies[s] ) continue;
+            ++count;
+            successes += r.success ? 1 : 0;
+            time += r.time;
+            tre += r.finalTRE;
+            evaluations += r.evaluations;
+        }
+        os << "    { \"backend\": \"gpu-orientation\", \"strategy\": \"" << params.strategies[s]
+           << "\", \"registrations\": " << count
+           << ", \"success_rate\": " << ( count ? double( successes ) / count : 0.0 )
+           << ", \"mean_time_s\": " << ( count ? time / count : 0.0 )
+           << ", \"mean_final_tre_mm\": " << ( count ? tre / count : 0.0 )
+           << ", \"evaluations_per_s\": " << ( time > 0 ? evaluations / time : 0.0 ) << " }"
+           << ( s + 1 < params.strategies.size() ? "," : "" ) << std::endl;
+    }
+    os << "  ]," << std::endl << "  \"registrations\": [" << std::endl;
+    for( unsigned int i = 0; i < results.size(); ++i )
+    {
+        const BenchmarkResult & r = results[i];
+        os << "    { \"backend\": \"" << r.backend << "\", \"strategy\": \"" << r.strategy
+           << "\", \"rotation_deg\": " << r.rotation << ", \"translation_mm\": " << r.translation
+           << ", \"repeat\": " << r.repeat << ", \"initial_tre_mm\": " << r.initialTRE
+           << ", \"final_tre_mm\": " << r.finalTRE << ", \"success\": " << ( r.success ? "true" : "false" )
+           << ", \"time_s\": " << r.time << ", \"iterations\": " << r.iterations
+           << ", \"metric_evaluations\": " << r.evaluations
+           << ", \"evaluations_per_s\": " << ( r.time > 0 ? r.evaluations / r.time : 0.0 )
+           << ", \"metric_value\": " << r.metricValue << " }" << ( i + 1 < results.size() ? "," : "" ) << std::endl;
+    }
+    os << "  ]" << std::endl << "}" << std::endl;
+}
+}  // namespace
+
+int main( int argc, char ** argv )
+{
+    BenchmarkParameters params;
+    if( !ParseArguments( argc, argv, params ) )
+    {
+        PrintUsage( argv[0] );
+        return 1;
+    }
+
+    IbisItkFloat3ImageType::Pointer targetImage;
+    IbisItkFloat3ImageType::Pointer sourceImage;
+    if( params.simulateFileName.empty() )
+    {
+        targetImage = ReadImage( params.fixedFileName );
+        sourceImage = ReadImage( params.movingFileName );
+    }
+    else
+    {
+        targetImage = ReadImage( params.simulateFileName );
+        if( targetImage ) sourceImage = SimulateUltrasound( targetImage, params.seed );
+    }
+    if( !targetImage || !sourceImage ) return 1;
+
+    std::vector<std::vector<double>> targetPoints = ComputeTargetPoints( sourceImage );
+    double center[3];
+    for( unsigned int d = 0; d < 3; ++d ) center[d] = targetPoints.back()[d];
+
+    // Perturbations are drawn once so that every strategy sees the same misalignments
+    std::mt19937 generator( params.seed );
+    std::normal_distribution<double> direction( 0.0, 1.0 );
+    struct Perturbation
+    {
+        double rotation;
+        double translation;
+        unsigned int repeat;
+        vtkSmartPointer<vtkTransform> transform;
+    };
+    std::vector<Perturbation> perturbations;
+    for( double rotation : params.rotations )
+    {
+        for( double translation : params.translations )
+        {
+            for( unsigned int repeat = 0; repeat < params.repeats; ++repeat )
+            {
+                double axis[3]           = { direction( generator ), direction( generator ), direction( generator ) };
+                double translationDir[3] = { direction( generator ), direction( generator ), direction( generator ) };
+                vtkMath::Normalize( axis );
+                vtkMath::Normalize( translationDir );
+
+                vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+                transform->PostMultiply();
+                transform->Translate( -center[0], -center[1], -center[2] );
+                transform->RotateWXYZ( rotation, axis );
+                transform->Translate( center[0] + translation * translationDir[0],
+                                      center[1] + translation * translationDir[1],
+                                      center[2] + translation * translationDir[2] );
+                transform->Update();
+                perturbations.push_back( { rotation, translation, repeat, transform } );
+            }
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    for( const std::string & strategy : params.strategies )
+    {
+        for( const Perturbation & perturbation : perturbations )
+        {
+            vtkSmartPointer<vtkTransform> sourceTransform = vtkSmartPointer<vtkTransform>::New();
+            sourceTransform->SetMatrix( perturbation.transform->GetMatrix() );
+            vtkSmartPointer<vtkTransform> targetTransform = vtkSmartPointer<vtkTransform>::New();
+            vtkSmartPointer<vtkTransform> resultTransform = vtkSmartPointer<vtkTransform>::New();
+            resultTransform->SetMatrix( perturbation.transform->GetMatrix() );
+
+            GPU_RigidRegistration * rigidRegistrator = new GPU_RigidRegistration();
+            rigidRegistrator->SetNumberOfPixels( params.numberOfPixels );
+            rigidRegistrator->SetOrientationSelectivity( params.orientationSelectivity );
+            rigidRegistrator->SetPopulationSize( params.populationSize );
+            rigidRegistrator->SetInitialSigma( params.initialSigma );
+            rigidRegistrator->SetPercentile( params.percentile );
+            rigidRegistrator->SetUseMask( params.useMask );
+            rigidRegistrator->SetDebug( false, nullptr );
+            rigidRegistrator->SetSamplingSeed( params.seed );
+            SetSamplingStrategy( rigidRegistrator, strategy );
+            rigidRegistrator->SetItkSourceImage( sourceImage );
+            rigidRegistrator->SetItkTargetImage( targetImage );
+            rigidRegistrator->SetVtkTransform( resultTransform );
+            rigidRegistrator->SetSourceVtkTransform( sourceTransform );
+            rigidRegistrator->SetTargetVtkTransform( targetTransform );
+
+            itk::TimeProbe clock;
+            clock.Start();
+            rigidRegistrator->runRegistration();
+            clock.Stop();
+
+            // The pair is aligned, so the ground truth is the identity
+            BenchmarkResult result;
+            result.backend     = "gpu-orientation";
+            result.strategy    = strategy;
+            result.rotation    = perturbation.rotation;
+            result.translation = perturbation.translation;
+            result.repeat      = perturbation.repeat;
+            result.initialTRE  = ComputeTRE( perturbation.transform, targetPoints );
+            result.finalTRE    = ComputeTRE( resultTransform, targetPoints );
+            result.success     = result.finalTRE < params.successThreshold;
+            result.time        = clock.GetTotal();
+            result.iterations  = rigidRegistrator->GetNumberOfIterations();
+            result.evaluations = rigidRegistrator->GetNumberOfMetricEvaluations();
+            result.metricValue = rigidRegistrator->GetFinalMetricValue();
+            results.push_back( result );
+            delete rigidRegistrator;
+
+            std::cerr << strategy << " rot " << perturbation.rotation << " trans " << perturbation.translation
+                      << " #" << perturbation.repeat << ": TRE " << result.initialTRE << " -> " << result.finalTRE
+                      << " mm in " << result.time << " s" << std::endl;
+        }
+    }
+
+    std::ofstream outputFile;
+    if( !params.outputFileName.empty() )
+    {
+        outputFile.open( params.outputFileName );
+        if( !outputFile.is_open() )
+        {
+            std::cerr << "Cannot write " << params.outputFileName << std::endl;
+            return 1;
+        }
+    }
+    std::ostream & os = params.outputFileName.empty() ? std::cout : outputFile;
+    if( params.format == "json" )
+        WriteJSON( os, params, results );
+    else
+        WriteCSV( os, results );
+    return 0;
+}
@@ -52,16 +52,23 @@ public:
 
     itkSetObjectMacro( GPUMetric, GPUMetricType );
 
+    /** Number of calls to GetValue() since construction. */
+    itkGetConstMacro( NumberOfEvaluations, unsigned int );
+
     GPU3DRigidSimilarityMetric()
     {
         m_GPUMetric      = NULL;
-        m_EulerTransform = EulerTransformType::New();
-        m_Debug          = true;
+        m_EulerTransform  = EulerTransformType::New();
+        m_MetricTransform = MetricTransformType::New();
+        m_Debug           = true;
+
+        m_NumberOfEvaluations = 0;
     }
 
     double GetValue( const ParametersType & parameters ) const override
     {
         if( !m_GPUMetric ) itkExceptionMacro( << "GPUMetric has not been set!" );
+        ++m_NumberOfEvaluations;
 
         PointType center;
         center[0] = m_GPUMetric->GetFixedImage()->GetOrigin()[0] +
@@ -77,11 +84,10 @@ public:
         m_EulerTransform->SetCenter( center );
         m_EulerTransform->SetParameters( parameters );
 
-        MetricTransformPointer tempTransform = MetricTransformType::New();
-        tempTransform->SetMatrix( m_EulerTransform->GetMatrix() );
-        tempTransform->SetOffset( m_EulerTransform->GetOffset() );
+        m_MetricTransform->SetMatrix( m_EulerTransform->GetMatrix() );
+        m_MetricTransform->SetOffset( m_EulerTransform->GetOffset() );
 
-        m_GPUMetric->SetTransform( tempTransform );
+        m_GPUMetric->SetTransform( m_MetricTransform );
         m_GPUMetric->Update();
 
         return -m_GPUMetric->GetMetricValue();
@@ -113,7 +119,10 @@ public:
 private:
     typename GPUMetricType::Pointer m_GPUMetric;
     EulerTransformPointer m_EulerTransform;
+    // reused at each evaluation to avoid allocating a transform in the optimizer loop
+    MetricTransformPointer m_MetricTransform;
     PointType m_Center;
+    mutable unsigned int m_NumberOfEvaluations;
 
     bool m_Debug;
 };
@@ -31,6 +31,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <itkOpenCLUtil.h>
 #include <itkSampleToHistogramFilter.h>
 
+#include <memory>
+#include <random>
+#include <vector>
+
 namespace itk
 {
 template <class TFixedImage, class TMovingImage>
@@ -141,15 +145,22 @@ public:
 
     enum SamplingStrategyType
     {
-        RANDOM = 0,
-        GRID   = 1,
-        FULL   = 2
+        RANDOM     = 0,
+        GRID       = 1,
+        FULL       = 2,
+        STRATIFIED = 3
     };
 
     itkSetMacro( SamplingStrategy, SamplingStrategyType );
     void SetSamplingStrategyToRandom() { this->m_SamplingStrategy = RANDOM; }
     void SetSamplingStrategyToGrid() { this->m_SamplingStrategy = GRID; }
     void SetSamplingStrategyToFull() { this->m_SamplingStrategy = FULL; }
+    // One jittered sample per cell of a regular grid covering the fixed image (low discrepancy)
+    void SetSamplingStrategyToStratified() { this->m_SamplingStrategy = STRATIFIED; }
+
+    /** Seed of the random and stratified samplers. Identical seeds give identical samples. */
+    itkSetMacro( Seed, unsigned int );
+    itkGetConstMacro( Seed, unsigned int );
 
     using FixedImageMaskSpatialObjectType    = itk::ImageMaskSpatialObject<FixedImageDimension>;
     using FixedImageMaskSpatialObjectPointer = typename FixedImageMaskSpatialObjectType::Pointer;
@@ -174,6 +185,25 @@ public:
     using MovingImageMaskIteratorType = itk::ImageRegionConstIteratorWithIndex<MovingImageMaskType>;
     using MovingImageIteratorType     = itk::ImageRegionConstIteratorWithIndex<MovingImageType>;
 
+    /** Gradient samples selected in the fixed image. They only depend on the fixed image and
+     *  on the sampling parameters, so they can be computed once and shared between metrics
+     *  that register several moving images to the same fixed image. */
+    struct FixedSamplesType
+    {
+        unsigned int Blocks;
+        unsigned int Threads;
+        std::vector<InternalRealType> GradientSamples;
+        std::vector<InternalRealType> LocationSamples;
+    };
+    using FixedSamplesPointer = std::shared_ptr<const FixedSamplesType>;
+
+    /** When set, the fixed image gradient is not computed in Update() and these samples are used instead. */
+    void SetFixedSamples( FixedSamplesPointer samples ) { m_FixedSamples = samples; }
+    FixedSamplesPointer GetFixedSamples() const { return m_FixedSamples; }
+
+    /** Computes (if needed) and returns the fixed image gradient samples. Only the fixed image is required. */
+    FixedSamplesPointer ComputeFixedSamples( void );
+
     void Update( void );
 
     unsigned int NextPow2( unsigned int x );
@@ -187,6 +217,8 @@ protected:
     void PrintSelf( std::ostream & os, Indent indent ) const override;
 
     void ComputeFixedImageGradient( void );
+    void SampleFixedImageOffsets( unsigned int numberOfSamples, std::mt19937 & generator,
+                                  std::vector<unsigned int> & offsets );
     void ComputeMovingImageGradient( void );
     void CreateGPUVariablesForCostFunction( void );
     void UpdateGPUTransformVariables( void );
@@ -213,6 +245,7 @@ protected:
     unsigned int m_Threads;
 
     SamplingStrategyType m_SamplingStrategy;
+    unsigned int m_Seed;
 
     FixedImagePointer m_FixedImage;
     cl_mem m_FixedImageGPUBuffer;
@@ -241,6 +274,8 @@ protected:
 
     unsigned int m_NbrPixelsInMask;
 
+    FixedSamplesPointer m_FixedSamples;
+
     InternalRealType * m_cpuFixedGradientSamples;
     cl_mem m_gpuFixedGradientSamples;
 
@@ -23,6 +23,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <itkTimeProbe.h>
 #include <vnl/vnl_matrix.h>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include "GPUDiscreteGaussianGradientImageFilter.h"
 #include "GPUOrientationMatchingMatrixTransformationSparseMaskKernel.h"
 #include "itkGPUOrientationMatchingMatrixTransformationSparseMask.h"
@@ -72,6 +76,7 @@ GPUOrientationMatchingMatrixTransformationSparseMask<
     m_FixedImageMaskSpatialObject  = nullptr;
     m_MovingImageMaskSpatialObject = nullptr;
     SetSamplingStrategyToRandom();
+    m_Seed = 0;
 
     m_FixedImageGradientGPUBuffer  = NULL;
     m_FixedImageGPUBuffer          = NULL;
@@ -452,6 +457,10 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     FixedGradientMagnitudeSampleType::Pointer sample = FixedGradientMagnitudeSampleType::New();
     IdxSampleType::Pointer maskIdxSample             = IdxSampleType::New();
 
+    // Histogram and metric samples are drawn from the same seeded sequence so that
+    // two runs with the same seed select exactly the same fixed samples.
+    std::mt19937 generator( m_Seed );
+
     itk::TimeProbe clock;
     clock.Start();
 
@@ -492,62 +501,26 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     }
     else
     {
-        typename ImageSamplerType::Pointer imageSampler            = nullptr;
-        typename SampleContainerType::Pointer imageSampleContainer = SampleContainerType::New();
-        SampleType imageSample;
-        typename FixedImageType::RegionType bufferedRegion = m_FixedImage->GetBufferedRegion();
-        typename FixedImageType::IndexType imageIndex;
         unsigned int nbrOfPixelsForHistogram = 100000;
+        std::vector<unsigned int> sampleOffsets;
+        this->SampleFixedImageOffsets( nbrOfPixelsForHistogram, generator, sampleOffsets );
 
-        if( ( m_SamplingStrategy == RANDOM ) )
-        {
-            typename RandomImageSamplerType::Pointer temporaryImageSampler = RandomImageSamplerType::New();
-            temporaryImageSampler->SetNumberOfSamples( nbrOfPixelsForHistogram );
-            imageSampler = temporaryImageSampler;
-        }
-        else if( m_SamplingStrategy == GRID )
-        {
-            typename GridImageSamplerType::Pointer temporaryImageSampler = GridImageSamplerType::New();
-            temporaryImageSampler->SetNumberOfSamples( nbrOfPixelsForHistogram );
-            imageSampler = temporaryImageSampler;
-        }
-
-        imageSampler->SetInput( m_FixedImage );
-        imageSampler->SetInputImageRegion( bufferedRegion );
-
-        try
+        for( unsigned int i = 0; i < sampleOffsets.size(); ++i )
         {
-            imageSampler->Update();
-        }
-        catch( itk::ExceptionObject & err )
-        {
-            std::cerr << err << std::endl;
-            std::cerr << "Cannot grid sample the image" << std::endl;
-        }
-
-        imageSampleContainer = imageSampler->GetOutput();
-
-        for( unsigned int i = 0; i < imageSampleContainer->Size(); ++i )
-        {
-            imageSample = imageSampleContainer->ElementAt( i );
-            m_FixedImage->TransformPhysicalPointToIndex( imageSample.m_ImageCoordinates, imageIndex );
-            if( bufferedRegion.IsInside( imageIndex ) )
+            unsigned int idx                = sampleOffsets[i];
+            InternalRealType magnitudeValue = 0;
+            MeasurementVectorType tempSample;
+            for( unsigned int d = 0; d < FixedImageDimension; ++d )
             {
-                InternalRealType magnitudeValue = 0;
-                MeasurementVectorType tempSample;
-                unsigned int idx = static_cast<unsigned int>( m_FixedImage->ComputeOffset( imageIndex ) );
-                for( unsigned int d = 0; d < FixedImageDimension; ++d )
-                {
-                    magnitudeValue += pow( cpuFixedGradientBuffer[idx * 4 + d] / kernelNorms[d], 2.0 );
-                }
-                magnitudeValue = sqrt( magnitudeValue );
-                tempSample[0]  = magnitudeValue;
-                if( ( !m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)-1.0 ) ) ||
-                    ( m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)0.0 ) ) )
-                {
-                    sample->PushBack( tempSample );
-                    maskIdxSample->PushBack( idx );
-                }
+                magnitudeValue += pow( cpuFixedGradientBuffer[idx * 4 + d] / kernelNorms[d], 2.0 );
+            }
+            magnitudeValue = sqrt( magnitudeValue );
+            tempSample[0]  = magnitudeValue;
+            if( ( !m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)-1.0 ) ) ||
+                ( m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)0.0 ) ) )
+            {
+                sample->PushBack( tempSample );
+                maskIdxSample->PushBack( idx );
             }
         }
     }
@@ -582,11 +555,15 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     m_Threads = ( m_NumberOfPixels < maxThreads * 2 ) ? this->NextPow2( ( m_NumberOfPixels + 1 ) / 2 ) : maxThreads;
     m_Blocks  = ( m_NumberOfPixels + m_Threads - 1 ) / ( m_Threads );
 
-    m_cpuFixedGradientSamples = (InternalRealType *)malloc( m_Blocks * m_Threads * 4 * sizeof( InternalRealType ) );
-    memset( m_cpuFixedGradientSamples, (InternalRealType)0, 4 * m_Blocks * m_Threads * sizeof( InternalRealType ) );
+    std::shared_ptr<FixedSamplesType> fixedSamples = std::make_shared<FixedSamplesType>();
+    fixedSamples->Blocks                           = m_Blocks;
+    fixedSamples->Threads                          = m_Threads;
+    fixedSamples->GradientSamples.assign( 4 * m_Blocks * m_Threads, (InternalRealType)0 );
+    fixedSamples->LocationSamples.assign( 4 * m_Blocks * m_Threads, (InternalRealType)0 );
+    m_FixedSamples = fixedSamples;
 
-    m_cpuFixedLocationSamples = (InternalRealType *)malloc( m_Blocks * m_Threads * 4 * sizeof( InternalRealType ) );
-    memset( m_cpuFixedLocationSamples, (InternalRealType)0, 4 * m_Blocks * m_Threads * sizeof( InternalRealType ) );
+    m_cpuFixedGradientSamples = fixedSamples->GradientSamples.data();
+    m_cpuFixedLocationSamples = fixedSamples->LocationSamples.data();
 
     unsigned int numberOfSamples = m_Blocks * m_Threads;
 
@@ -634,25 +611,128 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     }
     else
     {
-        typename ImageSamplerType::Pointer imageSampler            = nullptr;
-        typename SampleContainerType::Pointer imageSampleContainer = SampleContainerType::New();
-        SampleType imageSample;
-        typename FixedImageType::RegionType bufferedRegion = m_FixedImage->GetBufferedRegion();
-        typename FixedImageType::IndexType imageIndex;
+        std::vector<unsigned int> sampleOffsets;
+        this->SampleFixedImageOffsets( m_NumberOfPixels, generator, sampleOffsets );
 
-        if( m_SamplingStrategy == RANDOM )
+        unsigned int pixelCntr = 0;
+        for( unsigned int i = 0; ( i < sampleOffsets.size() ) && ( pixelCntr < numberOfSamples ); ++i )
         {
-            typename RandomImageSamplerType::Pointer temporaryImageSampler = RandomImageSamplerType::New();
-            temporaryImageSampler->SetNumberOfSamples( m_NumberOfPixels );
-            imageSampler = temporaryImageSampler;
+            unsigned int idx = sampleOffsets[i];
+            if( ( !m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)-1.0 ) ) ||
+                ( m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)0.0 ) ) )
+            {
+                InternalRealType magnitudeValue = 0.0;
+                for( unsigned int d = 0; d < FixedImageDimension; ++d )
+                {
+                    magnitudeValue += pow( cpuFixedGradientBuffer[idx * 4 + d] / kernelNorms[d], 2.0 );
+                }
+                magnitudeValue = sqrt( magnitudeValue );
+                if( magnitudeValue > magnitudeThreshold )
+                {
+                    typename FixedImageType::PointType fixedLocation;
+                    this->m_FixedImage->TransformIndexToPhysicalPoint( m_FixedImage->ComputeIndex( idx ),
+                                                                       fixedLocation );
+                    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+                    {
+                        m_cpuFixedGradientSamples[4 * pixelCntr + d] = cpuFixedGradientBuffer[idx * 4 + d];
+                        m_cpuFixedLocationSamples[4 * pixelCntr + d] = (InternalRealType)fixedLocation[d];
+                    }
+                    m_cpuFixedLocationSamples[4 * pixelCntr + 3] = (InternalRealType)1.0;
+                    pixelCntr++;
+                }
+            }
         }
-        else if( m_SamplingStrategy == GRID )
+    }
+
+    clock.Stop();
+    if( m_Debug ) std::cerr << "Post-Processing Fixed Image Gradient took:\t" << clock.GetMean() << std::endl;
+
+    clReleaseKernel( m_GradientKernel );
+    clReleaseMemObject( m_FixedImageGradientGPUBuffer );
+    clReleaseMemObject( m_FixedImageGPUBuffer );
+    clReleaseMemObject( m_FixedImageMaskGPUBuffer );
+    m_FixedImageGradientGPUBuffer = NULL;
+    m_FixedImageGPUBuffer         = NULL;
+    m_FixedImageMaskGPUBuffer     = NULL;
+    for( int d = 0; d < FixedImageDimension; ++d )
+    {
+        clReleaseMemObject( m_GPUDerivOperatorBuffers[d] );
+    }
+    delete[] cpuFixedGradientBuffer;
+}
+
+/**
+ * Select about numberOfSamples pixels of the fixed image buffered region and return their buffer offsets.
+ * RANDOM and STRATIFIED only draw from generator, GRID uses a regular grid.
+ */
+template <class TFixedImage, class TMovingImage>
+void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingImage>::SampleFixedImageOffsets(
+    unsigned int numberOfSamples, std::mt19937 & generator, std::vector<unsigned int> & offsets )
+{
+    typename FixedImageType::RegionType bufferedRegion = m_FixedImage->GetBufferedRegion();
+    typename FixedImageType::SizeType size             = bufferedRegion.GetSize();
+    unsigned int numberOfPixels = static_cast<unsigned int>( bufferedRegion.GetNumberOfPixels() );
+
+    offsets.clear();
+    if( numberOfPixels == 0 || numberOfSamples == 0 ) return;
+    offsets.reserve( numberOfSamples );
+
+    if( m_SamplingStrategy == RANDOM )
+    {
+        std::uniform_int_distribution<unsigned int> pixel( 0, numberOfPixels - 1 );
+        for( unsigned int i = 0; i < numberOfSamples; ++i )
+        {
+            offsets.push_back( pixel( generator ) );
+        }
+    }
+    else if( m_SamplingStrategy == STRATIFIED )
+    {
+        // Split the region in ~numberOfSamples cells of equal size, along the axes with more than one pixel,
+        // and draw one pixel in each cell
+        unsigned int numberOfAxes = 0;
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
+        {
+            if( size[d] > 1 ) ++numberOfAxes;
+        }
+        double cellSize = std::pow( std::max( 1.0, double( numberOfPixels ) / double( numberOfSamples ) ),
+                                    1.0 / std::max( 1u, numberOfAxes ) );
+        unsigned int numberOfCells[FixedImageDimension];
+        unsigned int totalNumberOfCells = 1;
+        for( unsigned int d = 0; d < FixedImageDimension; ++d )
         {
-            typename GridImageSamplerType::Pointer temporaryImageSampler = GridImageSamplerType::New();
-            temporaryImageSampler->SetNumberOfSamples( m_NumberOfPixels );
-            imageSampler = temporaryImageSampler;
+            numberOfCells[d] = std::max( 1u, static_cast<unsigned int>( std::floor( size[d] / cellSize + 0.5 ) ) );
+            numberOfCells[d] = std::min( numberOfCells[d], static_cast<unsigned int>( size[d] ) );
+            totalNumberOfCells *= numberOfCells[d];
         }
 
+        // Cells are visited in random order, samples truncated by the caller still cover the whole region
+        std::vector<unsigned int> cells( totalNumberOfCells );
+        std::iota( cells.begin(), cells.end(), 0u );
+        std::shuffle( cells.begin(), cells.end(), generator );
+
+        std::uniform_real_distribution<double> jitter( 0.0, 1.0 );
+        for( unsigned int c = 0; c < totalNumberOfCells; ++c )
+        {
+            unsigned int cell   = cells[c];
+            unsigned int offset = 0;
+            unsigned int stride = 1;
+            for( unsigned int d = 0; d < FixedImageDimension; ++d )
+            {
+                unsigned int index = cell % numberOfCells[d];
+                cell /= numberOfCells[d];
+                unsigned int begin = static_cast<unsigned int>( index * size[d] / numberOfCells[d] );
+                unsigned int end   = static_cast<unsigned int>( ( index + 1 ) * size[d] / numberOfCells[d] );
+                unsigned int p     = begin + static_cast<unsigned int>( jitter( generator ) * ( end - begin ) );
+                offset += std::min( p, end - 1 ) * stride;
+                stride *= static_cast<unsigned int>( size[d] );
+            }
+            offsets.push_back( offset );
+        }
+    }
+    else if( m_SamplingStrategy == GRID )
+    {
+        typename GridImageSamplerType::Pointer imageSampler = GridImageSamplerType::New();
+        imageSampler->SetNumberOfSamples( numberOfSamples );
         imageSampler->SetInput( m_FixedImage );
         imageSampler->SetInputImageRegion( bufferedRegion );
 
@@ -664,11 +744,12 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
         {
             std::cerr << err << std::endl;
             std::cerr << "Cannot grid sample the image" << std::endl;
+            return;
         }
 
-        imageSampleContainer = imageSampler->GetOutput();
-
-        unsigned int pixelCntr = 0;
+        typename SampleContainerType::Pointer imageSampleContainer = imageSampler->GetOutput();
+        SampleType imageSample;
+        typename FixedImageType::IndexType imageIndex;
         for( unsigned int i = 0; i < imageSampleContainer->Size(); ++i )
         {
             if( imageSampleContainer->GetElementIfIndexExists( i, &imageSample ) )
@@ -676,50 +757,11 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
                 m_FixedImage->TransformPhysicalPointToIndex( imageSample.m_ImageCoordinates, imageIndex );
                 if( bufferedRegion.IsInside( imageIndex ) )
                 {
-                    unsigned int idx = static_cast<unsigned int>( m_FixedImage->ComputeOffset( imageIndex ) );
-                    if( ( !m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)-1.0 ) ) ||
-                        ( m_ComputeMask && ( cpuFixedGradientBuffer[idx * 4 + 3] > (InternalRealType)0.0 ) ) )
-                    {
-                        InternalRealType magnitudeValue = 0.0;
-                        for( unsigned int d = 0; d < FixedImageDimension; ++d )
-                        {
-                            magnitudeValue += pow( cpuFixedGradientBuffer[idx * 4 + d] / kernelNorms[d], 2.0 );
-                        }
-                        magnitudeValue = sqrt( magnitudeValue );
-                        if( magnitudeValue > magnitudeThreshold )
-                        {
-                            typename FixedImageType::PointType fixedLocation;
-                            this->m_FixedImage->TransformIndexToPhysicalPoint( m_FixedImage->ComputeIndex( idx ),
-                                                                               fixedLocation );
-                            for( unsigned int d = 0; d < FixedImageDimension; ++d )
-                            {
-                                m_cpuFixedGradientSamples[4 * pixelCntr + d] = cpuFixedGradientBuffer[idx * 4 + d];
-                                m_cpuFixedLocationSamples[4 * pixelCntr + d] = (InternalRealType)fixedLocation[d];
-                            }
-                            m_cpuFixedLocationSamples[4 * pixelCntr + 3] = (InternalRealType)1.0;
-                            pixelCntr++;
-                        }
-                    }
+                    offsets.push_back( static_cast<unsigned int>( m_FixedImage->ComputeOffset( imageIndex ) ) );
                 }
             }
         }
     }
-
-    clock.Stop();
-    if( m_Debug ) std::cerr << "Post-Processing Fixed Image Gradient took:\t" << clock.GetMean() << std::endl;
-
-    clReleaseKernel( m_GradientKernel );
-    clReleaseMemObject( m_FixedImageGradientGPUBuffer );
-    clReleaseMemObject( m_FixedImageGPUBuffer );
-    clReleaseMemObject( m_FixedImageMaskGPUBuffer );
-    m_FixedImageGradientGPUBuffer = NULL;
-    m_FixedImageGPUBuffer         = NULL;
-    m_FixedImageMaskGPUBuffer     = NULL;
-    for( int d = 0; d < FixedImageDimension; ++d )
-    {
-        clReleaseMemObject( m_GPUDerivOperatorBuffers[d] );
-    }
-    delete[] cpuFixedGradientBuffer;
 }
 
 /**
@@ -1066,6 +1108,28 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     OpenCLCheckError( errid, __FILE__, __LINE__, ITK_LOCATION );
 }
 
+/**
+ * Compute or reuse the fixed image gradient samples
+ */
+template <class TFixedImage, class TMovingImage>
+typename GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingImage>::FixedSamplesPointer
+GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingImage>::ComputeFixedSamples( void )
+{
+    if( !m_FixedSamples )
+    {
+        this->ComputeFixedImageGradient();
+    }
+    else
+    {
+        // samples were computed by another metric, the GPU buffers only read them
+        m_Blocks                  = m_FixedSamples->Blocks;
+        m_Threads                 = m_FixedSamples->Threads;
+        m_cpuFixedGradientSamples = const_cast<InternalRealType *>( m_FixedSamples->GradientSamples.data() );
+        m_cpuFixedLocationSamples = const_cast<InternalRealType *>( m_FixedSamples->LocationSamples.data() );
+    }
+    return m_FixedSamples;
+}
+
 /**
  * Update Metric Value
  */
@@ -1098,7 +1162,7 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
     if( !m_MovingImageGradientGPUImage )
     {
         if( m_Debug ) std::cout << "Preparing to compute image gradients.." << std::endl;
-        this->ComputeFixedImageGradient();
+        this->ComputeFixedSamples();
         this->ComputeMovingImageGradient();
 
         this->CreateGPUVariablesForCostFunction();
@@ -1115,7 +1179,7 @@ void GPUOrientationMatchingMatrixTransformationSparseMask<TFixedImage, TMovingIm
                                     "OrientationMatchingMetricSparseMask", "" );
     }
 
-    if( m_TransformMatrix == m_Transform->GetMatrix() && m_TransformOffset == m_TransformOffset )
+    if( m_TransformMatrix == m_Transform->GetMatrix() && m_TransformOffset == m_Transform->GetOffset() )
     {
         return;
     }
@@ -0,0 +1,52 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#ifndef ITKSEEDEDCMAEVOLUTIONSTRATEGYOPTIMIZER_H
+#define ITKSEEDEDCMAEVOLUTIONSTRATEGYOPTIMIZER_H
+
+#include <itkCMAEvolutionStrategyOptimizer.h>
+
+namespace itk
+{
+/** \class SeededCMAEvolutionStrategyOptimizer
+ * CMAEvolutionStrategyOptimizer drawing its offspring from its own random generator instead of the
+ * process-wide MersenneTwisterRandomVariateGenerator instance. Optimizers running in different threads
+ * do not share a generator and the same seed gives the same sequence of offsprings.
+ */
+class SeededCMAEvolutionStrategyOptimizer : public CMAEvolutionStrategyOptimizer
+{
+public:
+    typedef SeededCMAEvolutionStrategyOptimizer Self;
+    typedef CMAEvolutionStrategyOptimizer Superclass;
+    typedef SmartPointer<Self> Pointer;
+    typedef SmartPointer<const Self> ConstPointer;
+    itkNewMacro( Self );
+    itkTypeMacro( SeededCMAEvolutionStrategyOptimizer, CMAEvolutionStrategyOptimizer );
+
+    /** Seed of the generator, call before StartOptimization(). */
+    void SetSeed( unsigned int seed ) { this->m_RandomGenerator->SetSeed( seed ); }
+
+protected:
+    SeededCMAEvolutionStrategyOptimizer()
+    {
+        this->m_RandomGenerator = RandomGeneratorType::New();
+        this->m_RandomGenerator->SetSeed( 0 );
+    }
+    ~SeededCMAEvolutionStrategyOptimizer() override = default;
+
+private:
+    SeededCMAEvolutionStrategyOptimizer( const Self & );  // purposely not implemented
+    void operator=( const Self & );                      // purposely not implemented
+};
+
+}  // namespace itk
+
+#endif
@@ -4,6 +4,8 @@
 #include <vtkMatrix4x4.h>
 
 #include "ibisitkvtkconverter.h"
+#include "ibisrigidtransform.h"
+#include "instrumentation.h"
 
 GPU_VolumeReconstruction::GPU_VolumeReconstruction()
 {
@@ -50,60 +52,22 @@ void GPU_VolumeReconstruction::SetFixedSlice( int index, vtkImageData * slice, v
 
 void GPU_VolumeReconstruction::SetTransform( vtkMatrix4x4 * transformMatrix )
 {
-    // First convert to itk
+    // First convert to itk, rotation around the origin
+    const double center[3] = { 0.0, 0.0, 0.0 };
+    double rigidParams[6];
+    IbisRigidTransform::MatrixToRigidParameters( transformMatrix->GetData(), center, rigidParams );
+
     GPU_VolumeReconstruction::ItkRigidTransformType::Pointer itkTransform =
         GPU_VolumeReconstruction::ItkRigidTransformType::New();
-    GPU_VolumeReconstruction::ItkRigidTransformType::OffsetType offset;
-    vnl_matrix<double> M( 3, 3 );
-    for( unsigned int i = 0; i < 3; i++ )
-    {
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            M[i][j] = transformMatrix->GetElement( i, j );
-        }
-        offset[i] = transformMatrix->GetElement( i, 3 );
-    }
-
-    double angleX, angleY, angleZ;
-    angleX   = std::asin( M[2][1] );
-    double A = std::cos( angleX );
-    if( std::fabs( A ) > 0.00005 )
-    {
-        double x = M[2][2] / A;
-        double y = -M[2][0] / A;
-        angleY   = std::atan2( y, x );
-
-        x      = M[1][1] / A;
-        y      = -M[0][1] / A;
-        angleZ = std::atan2( y, x );
-    }
-    else
-    {
-        angleZ   = 0;
-        double x = M[0][0];
-        double y = M[1][0];
-        angleY   = std::atan2( y, x );
-    }
-
-    GPU_VolumeReconstruction::ItkRigidTransformType::ParametersType params =
-        GPU_VolumeReconstruction::ItkRigidTransformType::ParametersType( 6 );
-    params[0] = angleX;
-    params[1] = angleY;
-    params[2] = angleZ;
-
-    GPU_VolumeReconstruction::ItkRigidTransformType::CenterType center;
-    center.Fill( 0.0 );
-
-    for( unsigned int i = 0; i < 3; i++ )
+    GPU_VolumeReconstruction::ItkRigidTransformType::ParametersType params( 6 );
+    for( unsigned int i = 0; i < 6; i++ )
     {
-        params[i + 3] = offset[i] - center[i];
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            params[i + 3] += M[i][j] * center[j];
-        }
+        params[i] = rigidParams[i];
     }
 
-    itkTransform->SetCenter( center );
+    GPU_VolumeReconstruction::ItkRigidTransformType::CenterType itkCenter;
+    itkCenter.Fill( 0.0 );
+    itkTransform->SetCenter( itkCenter );
     itkTransform->SetParameters( params );
     // set transform in reconstructor
     m_VolReconstructor->SetTransform( itkTransform );
@@ -111,6 +75,7 @@ void GPU_VolumeReconstruction::SetTransform( vtkMatrix4x4 * transformMatrix )
 
 void GPU_VolumeReconstruction::run()
 {
+    IBIS_INSTRUMENT_SCOPE( "Volume reconstruction" );
     m_VolReconstructor->ReconstructVolume();
     m_reconstructedImage = m_VolReconstructor->GetReconstructedVolume();
 }
@@ -12,9 +12,18 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include "gpu_volumereconstructionplugininterface.h"
 
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
 #include <QtPlugin>
 
+#include "gpu_volumereconstruction.h"
 #include "gpu_volumereconstructionwidget.h"
+#include "ibisapi.h"
+#include "imageobject.h"
+#include "usacquisitionobject.h"
 
 GPU_VolumeReconstructionPluginInterface::GPU_VolumeReconstructionPluginInterface()
 {
@@ -32,3 +41,67 @@ QWidget * GPU_VolumeReconstructionPluginInterface::CreateFloatingWidget()
     widget->setAttribute( Qt::WA_DeleteOnClose, true );
     return widget;
 }
+
+bool GPU_VolumeReconstructionPluginInterface::RunBatchOperation( const QString & operation,
+                                                                 const QMap<QString, QString> & args )
+{
+    IbisAPI * ibisAPI = GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+
+    USAcquisitionObject * acquisition = nullptr;
+    if( args.contains( "object" ) )
+        acquisition = USAcquisitionObject::SafeDownCast( ibisAPI->GetObjectByName( args["object"] ) );
+    else
+    {
+        QList<USAcquisitionObject *> allAcquisitions;
+        ibisAPI->GetAllUSAcquisitionObjects( allAcquisitions );
+        if( allAcquisitions.size() > 0 ) acquisition = allAcquisitions[0];
+    }
+    if( !acquisition || acquisition->GetNumberOfSlices() == 0 )
+    {
+        ibisAPI->Warning( "Volume Reconstruction With GPU", "Need a US acquisition with at least one slice." );
+        return false;
+    }
+
+    float spacing            = args.value( "spacing", "1.0" ).toFloat();
+    unsigned int radius      = args.value( "radius", "0" ).toUInt();
+    bool useMask             = args.value( "mask", "0" ).toInt() != 0;
+    unsigned int nbrOfSlices = acquisition->GetNumberOfSlices();
+    if( spacing <= 0.0 )
+    {
+        ibisAPI->Warning( "Volume Reconstruction With GPU", "Volume spacing should be positive." );
+        return false;
+    }
+
+    // Same setup as GPU_VolumeReconstructionWidget, but wait for the reconstruction to finish
+    GPU_VolumeReconstruction * reconstructor = GPU_VolumeReconstruction::New();
+    reconstructor->SetNumberOfSlices( nbrOfSlices );
+    if( useMask ) reconstructor->SetFixedSliceMask( acquisition->GetMask() );
+    reconstructor->SetUSSearchRadius( radius );
+    reconstructor->SetVolumeSpacing( spacing );
+    reconstructor->SetKernelStdDev( spacing / 2.0 );
+
+    vtkSmartPointer<vtkMatrix4x4> sliceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkImageData> slice                = vtkSmartPointer<vtkImageData>::New();
+    for( unsigned int i = 0; i < nbrOfSlices; i++ )
+    {
+        acquisition->GetFrameData( i, slice, sliceTransformMatrix );
+        reconstructor->SetFixedSlice( i, slice, sliceTransformMatrix );
+    }
+    reconstructor->SetTransform( acquisition->GetLocalTransform()->GetMatrix() );
+    reconstructor->start();
+    reconstructor->wait();
+
+    vtkSmartPointer<ImageObject> reconstructedImage = vtkSmartPointer<ImageObject>::New();
+    reconstructedImage->SetName( "Reconstructed Volume" );
+    bool ok = reconstructedImage->SetItkImage( reconstructor->GetReconstructedImage() );
+    reconstructor->Delete();
+    if( !ok )
+    {
+        ibisAPI->Warning( "Volume Reconstruction With GPU", "Reconstruction failed." );
+        return false;
+    }
+    ibisAPI->AddObject( reconstructedImage, acquisition->GetParent()->GetParent() );
+    ibisAPI->SetCurrentObject( reconstructedImage );
+    return true;
+}
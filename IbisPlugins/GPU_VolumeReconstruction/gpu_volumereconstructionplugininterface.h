@@ -34,6 +34,11 @@ public:
 
     QWidget * CreateFloatingWidget() override;
 
+    // Batch processing: Reconstruct[:object=<acquisition name>,spacing=<mm>,radius=<voxels>,mask=<0|1>]
+    // Defaults to the first US acquisition of the scene, 1 mm spacing, radius 0 and no mask.
+    QStringList GetBatchOperations() override { return QStringList() << "Reconstruct"; }
+    bool RunBatchOperation( const QString & operation, const QMap<QString, QString> & args ) override;
+
 protected:
     GPU_VolumeReconstructionWidget * m_volumeReconstructionWidget;
 };
@@ -16,6 +16,8 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "generatorplugininterface.h"
 #include "serializer.h"
 
+class ImageObject;
+
 class LabelVolumeToSurfacesPluginInterface : public GeneratorPluginInterface
 {
     Q_OBJECT
@@ -33,6 +35,14 @@ public:
     QString GetMenuEntryString() override { return QString( "Extract surfaces from label volume" ); }
     bool CanRun() override;
     void Run() override;
+
+    // Batch processing: ExtractSurfaces[:object=<label volume name>], defaults to current object
+    QStringList GetBatchOperations() override { return QStringList() << "ExtractSurfaces"; }
+    bool RunBatchOperation( const QString & operation, const QMap<QString, QString> & args ) override;
+
+protected:
+    // Add one surface per label found in image as children of image
+    void ExtractSurfaces( ImageObject * image );
 };
 
 #endif
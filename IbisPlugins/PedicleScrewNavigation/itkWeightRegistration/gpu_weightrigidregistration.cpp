@@ -15,6 +15,8 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vnl/algo/vnl_real_eigensystem.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
 
+#include "ibisrigidtransform.h"
+
 class CommandIterationUpdateWeightOpenCL : public itk::Command
 {
 public:
@@ -29,14 +31,19 @@ protected:
 public:
     typedef const GPU_WeightRigidRegistration::OptimizerType * OptimizerPointer;
     typedef const GPU_WeightRigidRegistration::GPUCostFunctionType * GPUConstCostFunctionPointer;
-    typedef GPU_WeightRigidRegistration::ItkRigidTransformType::Pointer ItkRigidTransformPointer;
     vtkTransform * m_targetImageVtkTransform;
     vtkTransform * m_vtktransform;
     vtkTransform * m_parentTransform;
     bool m_Debug;
+    GPU_WeightRigidRegistration::IterationCallbackType m_iterationCallback;
 
     void SetDebug( bool debug ) { m_Debug = debug; }
 
+    void SetIterationCallback( GPU_WeightRigidRegistration::IterationCallbackType callback )
+    {
+        m_iterationCallback = callback;
+    }
+
     void SetVtkTransform( vtkTransform * vtktransform ) { m_vtktransform = vtktransform; }
 
     void SetTargetImageVtkTransform( vtkTransform * targetImageVtkTransform )
@@ -66,43 +73,29 @@ public:
                       << optimizer->GetCurrentValue() << " [ Intensity: " << metric->GetCurrentIntensityMetricValue()
                       << " + Gradient: " << metric->GetCurrentGradientMetricValue() << " ]" << std::endl;
 
-        ItkRigidTransformPointer itkTransform = GPU_WeightRigidRegistration::ItkRigidTransformType::New();
-
-        GPU_WeightRigidRegistration::ItkRigidTransformType::ParametersType params = optimizer->GetCurrentPosition();
-        GPU_WeightRigidRegistration::ItkRigidTransformType::CenterType center     = metric->GetCenter();
-        itkTransform->SetCenter( center );
-        itkTransform->SetParameters( params );
-
-        vtkTransform * vtktransform = m_vtktransform;
-
-        GPU_WeightRigidRegistration::ItkRigidTransformType::MatrixType matrix = itkTransform->GetMatrix();
+        // Inverse of the current Euler transform, composed without allocating or converting through ITK
+        const auto & position   = optimizer->GetCurrentPosition();
+        const auto metricCenter = metric->GetCenter();
+        double params[6], center[3], matrix[16];
+        for( unsigned int i = 0; i < 6; i++ ) params[i] = position[i];
+        for( unsigned int i = 0; i < 3; i++ ) center[i] = metricCenter[i];
+        IbisRigidTransform::RigidParametersToMatrix( params, center, matrix );
+        IbisRigidTransform::InvertRigid( matrix, matrix );
 
-        GPU_WeightRigidRegistration::ItkRigidTransformType::OffsetType offset = itkTransform->GetOffset();
-
-        vtkSmartPointer<vtkMatrix4x4> localMatrix_inv = vtkSmartPointer<vtkMatrix4x4>::New();
-
-        for( unsigned int i = 0; i < 3; i++ )
+        if( m_parentTransform != 0 )
         {
-            for( unsigned int j = 0; j < 3; j++ )
-            {
-                localMatrix_inv->SetElement( i, j, matrix.GetVnlMatrix().get( i, j ) );
-            }
-
-            localMatrix_inv->SetElement( i, 3, offset[i] );
+            double parentWorldMatrix[16];
+            vtkMatrix4x4::Invert( m_parentTransform->GetMatrix()->GetData(), parentWorldMatrix );
+            IbisRigidTransform::Compose( parentWorldMatrix, matrix, matrix );
         }
-        localMatrix_inv->Invert();
+        m_vtktransform->SetMatrix( matrix );
+        m_vtktransform->Modified();
 
-        vtkSmartPointer<vtkMatrix4x4> finalMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-
-        if( m_parentTransform != 0 )
+        if( m_iterationCallback &&
+            !m_iterationCallback( optimizer->GetCurrentIteration(), optimizer->GetCurrentValue() ) )
         {
-            vtkSmartPointer<vtkMatrix4x4> parentWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-            m_parentTransform->GetInverse( parentWorldMatrix );
-            finalMatrix->Multiply4x4( parentWorldMatrix, localMatrix_inv, localMatrix_inv );
+            const_cast<GPU_WeightRigidRegistration::OptimizerType *>( optimizer )->StopOptimization();
         }
-
-        vtktransform->SetMatrix( localMatrix_inv );
-        vtktransform->Modified();
     }
 };
 
@@ -124,12 +117,43 @@ GPU_WeightRigidRegistration::GPU_WeightRigidRegistration()
       m_targetSpatialObjectMask( nullptr ),
       m_lambdaMetricBalance( 0.5 ),
       m_orientationSamplingStrategy( OrientationSamplingStrategy::RANDOM ),
-      m_registrationMetricToUse( RegistrationMetricToUseType::INTENSITY )
+      m_orientationSamplingSeed( 0 ),
+      m_registrationMetricToUse( RegistrationMetricToUseType::INTENSITY ),
+      m_finalMetricValue( 0.0 ),
+      m_numberOfIterations( 0 )
 {
 }
 
 GPU_WeightRigidRegistration::~GPU_WeightRigidRegistration() {}
 
+GPU_WeightRigidRegistration::FixedGradientSamplesPointer GPU_WeightRigidRegistration::ComputeFixedGradientSamples()
+{
+    if( !m_itkTargetImage )
+    {
+        std::cerr << "Fixed image is invalid " << m_itkTargetImage << std::endl;
+        std::cerr << "Use SetItkTargetImage( )" << std::endl;
+        return nullptr;
+    }
+
+    GPUCostFunctionPointer costFunction = GPUCostFunctionType::New();
+    costFunction->SetFixedImage( m_itkTargetImage );
+    costFunction->SetOrientationSamplingStrategy( m_orientationSamplingStrategy );
+    costFunction->SetOrientationSamplingSeed( m_orientationSamplingSeed );
+    costFunction->SetOrientationPercentile( m_orientationPercentile );
+    costFunction->SetOrientationUseMask( m_useMask );
+    costFunction->SetOrientationSelectivity( m_orientationSelectivity );
+    costFunction->SetOrientationNumberOfPixels( m_orientationNumberOfPixels );
+    if( m_targetSpatialObjectMask )
+    {
+        costFunction->SetFixedSpatialObjectImageMask( m_targetSpatialObjectMask );
+        costFunction->SetOrientationUseMask( true );
+    }
+    costFunction->SetDebug( m_debug );
+
+    m_fixedGradientSamples = costFunction->ComputeOrientationFixedSamples();
+    return m_fixedGradientSamples;
+}
+
 void GPU_WeightRigidRegistration::runRegistration()
 {
     // Make sure all params have been specified
@@ -188,45 +212,6 @@ void GPU_WeightRigidRegistration::runRegistration()
     vtkSmartPointer<vtkMatrix4x4> finalMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
     sourceVtkTransform->GetInverse( finalMatrix );
 
-    ItkRigidTransformType::OffsetType offset;
-
-    vnl_matrix<double> M( 3, 3 );
-
-    for( unsigned int i = 0; i < 3; i++ )
-    {
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            M[i][j] = finalMatrix->GetElement( i, j );
-        }
-        offset[i] = finalMatrix->GetElement( i, 3 );
-    }
-
-    double angleX, angleY, angleZ;
-    angleX   = std::asin( M[2][1] );
-    double A = std::cos( angleX );
-    if( std::fabs( A ) > 0.00005 )
-    {
-        double x = M[2][2] / A;
-        double y = -M[2][0] / A;
-        angleY   = std::atan2( y, x );
-
-        x      = M[1][1] / A;
-        y      = -M[0][1] / A;
-        angleZ = std::atan2( y, x );
-    }
-    else
-    {
-        angleZ   = 0;
-        double x = M[0][0];
-        double y = M[1][0];
-        angleY   = std::atan2( y, x );
-    }
-
-    ItkRigidTransformType::ParametersType params = ItkRigidTransformType::ParametersType( 6 );
-    params[0]                                    = angleX;
-    params[1]                                    = angleY;
-    params[2]                                    = angleZ;
-
     ItkRigidTransformType::CenterType center;
     center[0] = itkTargetImage->GetOrigin()[0] +
                 itkTargetImage->GetSpacing()[0] * itkTargetImage->GetBufferedRegion().GetSize()[0] / 2.0;
@@ -235,13 +220,12 @@ void GPU_WeightRigidRegistration::runRegistration()
     center[2] = itkTargetImage->GetOrigin()[2] +
                 itkTargetImage->GetSpacing()[2] * itkTargetImage->GetBufferedRegion().GetSize()[2] / 2.0;
 
-    for( unsigned int i = 0; i < 3; i++ )
+    double rigidParams[6];
+    IbisRigidTransform::MatrixToRigidParameters( finalMatrix->GetData(), center.GetDataPointer(), rigidParams );
+    ItkRigidTransformType::ParametersType params( 6 );
+    for( unsigned int i = 0; i < 6; i++ )
     {
-        params[i + 3] = offset[i] - center[i];
-        for( unsigned int j = 0; j < 3; j++ )
-        {
-            params[i + 3] += M[i][j] * center[j];
-        }
+        params[i] = rigidParams[i];
     }
 
     itkTransform->SetCenter( center );
@@ -256,6 +240,7 @@ void GPU_WeightRigidRegistration::runRegistration()
 
     // set gradient orientation parameters
     costFunction->SetOrientationSamplingStrategy( m_orientationSamplingStrategy );
+    costFunction->SetOrientationSamplingSeed( m_orientationSamplingSeed );
     costFunction->SetOrientationPercentile( m_orientationPercentile );
     costFunction->SetOrientationUseMask( m_useMask );
     costFunction->SetOrientationSelectivity( m_orientationSelectivity );
@@ -266,10 +251,13 @@ void GPU_WeightRigidRegistration::runRegistration()
         costFunction->SetOrientationUseMask( true );
     }
 
+    costFunction->SetOrientationFixedSamples( m_fixedGradientSamples );
+
     costFunction->SetDebug( m_debug );
     costFunction->SetRegistrationMetricToUse( m_registrationMetricToUse );
 
     costFunction->UpdateMetrics();
+    m_fixedGradientSamples = costFunction->GetOrientationFixedSamples();
 
     if( m_debug )
     {
@@ -295,12 +283,14 @@ void GPU_WeightRigidRegistration::runRegistration()
     optimizer->SetNumberOfParents( populationSize / 2 );
     optimizer->SetMaximumNumberOfIterations( 300 );
     optimizer->SetInitialSigma( initialSigma );
+    optimizer->SetSeed( m_orientationSamplingSeed );
 
     CommandIterationUpdateWeightOpenCL::Pointer observer = CommandIterationUpdateWeightOpenCL::New();
     observer->SetVtkTransform( m_resultTransform );
     observer->SetTargetImageVtkTransform( targetVtkTransform );
     observer->SetParentTransform( m_parentVtkTransform );
     observer->SetDebug( m_debug );
+    observer->SetIterationCallback( m_iterationCallback );
     optimizer->AddObserver( itk::IterationEvent(), observer );
 
     if( m_debug ) std::cout << "Starting registration..." << std::endl;
@@ -318,6 +308,9 @@ void GPU_WeightRigidRegistration::runRegistration()
         std::cerr << err << std::endl;
     }
 
+    m_finalMetricValue   = optimizer->GetCurrentValue();
+    m_numberOfIterations = optimizer->GetCurrentIteration();
+
     if( m_debug ) timer.Stop( "Registration" );
 
     if( m_debug )
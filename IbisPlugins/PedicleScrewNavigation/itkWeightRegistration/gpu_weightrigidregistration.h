@@ -13,19 +13,21 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #ifndef GPU_WEIGHTRIGIDREGISTRATION_H
 #define GPU_WEIGHTRIGIDREGISTRATION_H
 
-#include <itkCMAEvolutionStrategyOptimizer.h>
 #include <itkEuler3DTransform.h>
 #include <vtkMatrix4x4.h>
 #include <vtkSmartPointer.h>
 #include <vtkTransform.h>
 
+#include <functional>
+
 #include "imageobject.h"
 #include "itkGPU3DRigidSimilarityWeightMetric.h"
+#include "itkSeededCMAEvolutionStrategyOptimizer.h"
 
 class GPU_WeightRigidRegistration
 {
 public:
-    typedef itk::CMAEvolutionStrategyOptimizer OptimizerType;
+    typedef itk::SeededCMAEvolutionStrategyOptimizer OptimizerType;
 
     typedef itk::GPU3DRigidSimilarityWeightMetric<IbisItkFloat3ImageType, IbisItkFloat3ImageType> GPUCostFunctionType;
     typedef GPUCostFunctionType::Pointer GPUCostFunctionPointer;
@@ -36,6 +38,11 @@ public:
     typedef ImageMaskType::Pointer ImageMaskPointer;
     typedef GPUCostFunctionType::SamplingStrategy OrientationSamplingStrategy;
     typedef GPUCostFunctionType::RegistrationMetricToUseType RegistrationMetricToUseType;
+    typedef GPUCostFunctionType::FixedSamplesPointer FixedGradientSamplesPointer;
+
+    // Called after each optimizer iteration with the iteration number and the current metric value.
+    // Returning false stops the optimization.
+    typedef std::function<bool( unsigned int, double )> IterationCallbackType;
 
     explicit GPU_WeightRigidRegistration();
     ~GPU_WeightRigidRegistration();
@@ -84,7 +91,15 @@ public:
     void SetSamplingStrategyToRandom() { this->m_orientationSamplingStrategy = OrientationSamplingStrategy::RANDOM; }
     void SetSamplingStrategyToGrid() { this->m_orientationSamplingStrategy = OrientationSamplingStrategy::GRID; }
     void SetSamplingStrategyToFull() { this->m_orientationSamplingStrategy = OrientationSamplingStrategy::FULL; }
+    void SetSamplingStrategyToStratified()
+    {
+        this->m_orientationSamplingStrategy = OrientationSamplingStrategy::STRATIFIED;
+    }
     OrientationSamplingStrategy GetSamplingStrategy() { return this->m_orientationSamplingStrategy; }
+    // Seed of the random and stratified samplers and of the optimizer, use the same seed to get reproducible
+    // registrations
+    void SetSamplingSeed( unsigned int seed ) { this->m_orientationSamplingSeed = seed; }
+    unsigned int GetSamplingSeed() { return this->m_orientationSamplingSeed; }
 
     void SetRegistrationMetricToIntensity()
     {
@@ -106,6 +121,16 @@ public:
     unsigned int GetPopulationSize() { return m_populationSize; }
     vtkTransform * GetResultTransform() { return m_resultTransform; }
 
+    // Gradient samples of the target image. When several sources are registered to the same
+    // target with the same parameters, compute them once and share them between registrations.
+    void SetFixedGradientSamples( FixedGradientSamplesPointer samples ) { this->m_fixedGradientSamples = samples; }
+    FixedGradientSamplesPointer GetFixedGradientSamples() { return m_fixedGradientSamples; }
+    FixedGradientSamplesPointer ComputeFixedGradientSamples();
+
+    void SetIterationCallback( IterationCallbackType callback ) { this->m_iterationCallback = callback; }
+    double GetFinalMetricValue() { return m_finalMetricValue; }
+    unsigned int GetNumberOfIterations() { return m_numberOfIterations; }
+
 private:
     void updateTagsDistance();
 
@@ -132,8 +157,14 @@ private:
     unsigned int m_orientationSelectivity;
     double m_lambdaMetricBalance;
     OrientationSamplingStrategy m_orientationSamplingStrategy;
+    unsigned int m_orientationSamplingSeed;
 
     RegistrationMetricToUseType m_registrationMetricToUse;
+
+    FixedGradientSamplesPointer m_fixedGradientSamples;
+    IterationCallbackType m_iterationCallback;
+    double m_finalMetricValue;
+    unsigned int m_numberOfIterations;
 };
 
 #endif
@@ -16,6 +16,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <itkEuler3DTransform.h>
 #include <itkSingleValuedCostFunction.h>
 
+#include "ibisrigidtransform.h"
 #include "itkGPUOrientationMatchingMatrixTransformationSparseMask.h"
 #include "itkGPUWeightMatchingMatrixTransformationSparseMask.h"
 
@@ -90,6 +91,7 @@ public:
     typedef itk::ImageMaskSpatialObject<3> ImageMaskType;
     typedef ImageMaskType::Pointer ImageMaskPointer;
     typedef typename GPUOrientationMetricType::SamplingStrategyType SamplingStrategy;
+    typedef typename GPUOrientationMetricType::FixedSamplesPointer FixedSamplesPointer;
 
     typedef itk::Euler3DTransform<double> EulerTransformType;
     typedef EulerTransformType::Pointer EulerTransformPointer;
@@ -106,9 +108,14 @@ public:
     itkSetMacro( OrientationSelectivity, unsigned int );
     itkSetMacro( OrientationUseMask, bool );
     itkSetMacro( OrientationSamplingStrategy, SamplingStrategy );
+    itkSetMacro( OrientationSamplingSeed, unsigned int );
 
     itkSetMacro( RegistrationMetricToUse, RegistrationMetricToUseType );
 
+    // Gradient samples of the fixed image, shared between metrics using the same fixed image
+    void SetOrientationFixedSamples( FixedSamplesPointer samples ) { m_OrientationFixedSamples = samples; }
+    FixedSamplesPointer GetOrientationFixedSamples() const { return m_OrientationFixedSamples; }
+
     itkSetMacro( Lambda, double );
 
     GPU3DRigidSimilarityWeightMetric()
@@ -116,6 +123,8 @@ public:
         m_GPUIntensityMetric   = NULL;
         m_GPUOrientationMetric = NULL;
         m_EulerTransform       = EulerTransformType::New();
+        m_IntensityTransform   = MetricTransformType::New();
+        m_GradientTransform    = MetricTransformType::New();
         m_Debug                = true;
         m_FixedImage           = 0;
         m_MovingImage          = 0;
@@ -127,6 +136,7 @@ public:
         m_OrientationSelectivity      = 32;
         m_OrientationUseMask          = true;
         m_OrientationSamplingStrategy = SamplingStrategy::RANDOM;
+        m_OrientationSamplingSeed     = 0;
 
         m_RegistrationMetricToUse = COMBINATION;
         m_Lambda                  = 0.5;
@@ -146,23 +156,38 @@ public:
 
         if( ( m_RegistrationMetricToUse == INTENSITY ) | ( m_RegistrationMetricToUse == COMBINATION ) )
         {
-            MetricTransformPointer intensityTransform = MetricTransformType::New();
-            intensityTransform->SetMatrix( m_EulerTransform->GetMatrix() );
-            intensityTransform->SetOffset( m_EulerTransform->GetOffset() );
-            intensityTransform->GetInverse( intensityTransform );
+            // rigid inverse, cheaper than the generic matrix inversion of GetInverse()
+            double matrix[16];
+            for( unsigned int i = 0; i < 3; ++i )
+            {
+                for( unsigned int j = 0; j < 3; ++j ) matrix[4 * i + j] = m_EulerTransform->GetMatrix()[i][j];
+                matrix[4 * i + 3] = m_EulerTransform->GetOffset()[i];
+                matrix[12 + i]    = 0.0;
+            }
+            matrix[15] = 1.0;
+            IbisRigidTransform::InvertRigid( matrix, matrix );
+
+            typename MetricTransformType::MatrixType inverseMatrix;
+            typename MetricTransformType::OutputVectorType inverseOffset;
+            for( unsigned int i = 0; i < 3; ++i )
+            {
+                for( unsigned int j = 0; j < 3; ++j ) inverseMatrix[i][j] = matrix[4 * i + j];
+                inverseOffset[i] = matrix[4 * i + 3];
+            }
+            m_IntensityTransform->SetMatrix( inverseMatrix );
+            m_IntensityTransform->SetOffset( inverseOffset );
 
-            m_GPUIntensityMetric->SetTransform( intensityTransform );
+            m_GPUIntensityMetric->SetTransform( m_IntensityTransform );
             m_GPUIntensityMetric->Update();
             CurrentIntensityMetricValue = (double)m_GPUIntensityMetric->GetMetricValue();
         }
 
         if( ( m_RegistrationMetricToUse == GRADIENT ) | ( m_RegistrationMetricToUse == COMBINATION ) )
         {
-            MetricTransformPointer gradientTransform = MetricTransformType::New();
-            gradientTransform->SetMatrix( m_EulerTransform->GetMatrix() );
-            gradientTransform->SetOffset( m_EulerTransform->GetOffset() );
+            m_GradientTransform->SetMatrix( m_EulerTransform->GetMatrix() );
+            m_GradientTransform->SetOffset( m_EulerTransform->GetOffset() );
 
-            m_GPUOrientationMetric->SetTransform( gradientTransform );
+            m_GPUOrientationMetric->SetTransform( m_GradientTransform );
             m_GPUOrientationMetric->Update();
 
             CurrentGradientMetricValue =
@@ -232,29 +257,53 @@ public:
         {
             m_EulerTransform->SetCenter( m_MetricTransform->GetCenter() );
 
-            m_GPUOrientationMetric->SetFixedImage( m_FixedImage );
+            this->ConfigureOrientationMetric();
             m_GPUOrientationMetric->SetMovingImage( m_MovingImage );
             m_GPUOrientationMetric->SetTransform( m_MetricTransform );
-            if( m_FixedSpatialObjectImageMask )
-            {
-                m_GPUOrientationMetric->SetFixedImageMaskSpatialObject( m_FixedSpatialObjectImageMask );
-                m_GPUOrientationMetric->SetUseFixedImageMask( true );
-            }
-            m_GPUOrientationMetric->SetSamplingStrategy( m_OrientationSamplingStrategy );
-            m_GPUOrientationMetric->SetNumberOfPixels( m_OrientationNumberOfPixels );
-            m_GPUOrientationMetric->SetPercentile( m_OrientationPercentile );
-            m_GPUOrientationMetric->SetN( m_OrientationSelectivity );
-            m_GPUOrientationMetric->SetComputeMask( m_OrientationUseMask );
-            m_GPUOrientationMetric->SetMaskThreshold( 0.5 );
-            m_GPUOrientationMetric->SetGradientScale( 1.0 );
             m_GPUOrientationMetric->Update();
+            m_OrientationFixedSamples = m_GPUOrientationMetric->GetFixedSamples();
         }
     }
 
+    // Computes the fixed image gradient samples without requiring a moving image,
+    // so that they can be shared with other metrics through SetOrientationFixedSamples().
+    FixedSamplesPointer ComputeOrientationFixedSamples()
+    {
+        if( !m_FixedImage ) itkExceptionMacro( << "Fixed Image has not been set!" );
+
+        if( !m_GPUOrientationMetric ) m_GPUOrientationMetric = GPUOrientationMetricType::New();
+
+        this->ConfigureOrientationMetric();
+        m_OrientationFixedSamples = m_GPUOrientationMetric->ComputeFixedSamples();
+        return m_OrientationFixedSamples;
+    }
+
 private:
+    void ConfigureOrientationMetric()
+    {
+        m_GPUOrientationMetric->SetFixedImage( m_FixedImage );
+        if( m_FixedSpatialObjectImageMask )
+        {
+            m_GPUOrientationMetric->SetFixedImageMaskSpatialObject( m_FixedSpatialObjectImageMask );
+            m_GPUOrientationMetric->SetUseFixedImageMask( true );
+        }
+        m_GPUOrientationMetric->SetSamplingStrategy( m_OrientationSamplingStrategy );
+        m_GPUOrientationMetric->SetSeed( m_OrientationSamplingSeed );
+        m_GPUOrientationMetric->SetNumberOfPixels( m_OrientationNumberOfPixels );
+        m_GPUOrientationMetric->SetPercentile( m_OrientationPercentile );
+        m_GPUOrientationMetric->SetN( m_OrientationSelectivity );
+        m_GPUOrientationMetric->SetComputeMask( m_OrientationUseMask );
+        m_GPUOrientationMetric->SetMaskThreshold( 0.5 );
+        m_GPUOrientationMetric->SetGradientScale( 1.0 );
+        m_GPUOrientationMetric->SetFixedSamples( m_OrientationFixedSamples );
+    }
+
     typename GPUIntensityMetricType::Pointer m_GPUIntensityMetric;
     typename GPUOrientationMetricType::Pointer m_GPUOrientationMetric;
     EulerTransformPointer m_EulerTransform;
+    // reused at each evaluation to avoid allocating transforms in the optimizer loop
+    MetricTransformPointer m_IntensityTransform;
+    MetricTransformPointer m_GradientTransform;
     PointType m_Center;
 
     bool m_Debug;
@@ -269,6 +318,8 @@ private:
     unsigned int m_OrientationSelectivity;
     bool m_OrientationUseMask;
     SamplingStrategy m_OrientationSamplingStrategy;
+    unsigned int m_OrientationSamplingSeed;
+    FixedSamplesPointer m_OrientationFixedSamples;
 
     RegistrationMetricToUseType m_RegistrationMetricToUse;
     double m_Lambda;
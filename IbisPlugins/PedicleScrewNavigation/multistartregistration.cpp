@@ -0,0 +1,214 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#include "multistartregistration.h"
+
+#include <vtkMatrix4x4.h>
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+MultiStartRegistration::MultiStartRegistration()
+    : m_numberOfStarts( 1 ),
+      m_maximumNumberOfThreads( 0 ),
+      m_rotationRange( 10.0 ),
+      m_translationRange( 10.0 ),
+      m_seed( 0 ),
+      m_pruningTolerance( 0.1 ),
+      m_pruningWarmupIterations( 20 ),
+      m_itkSourceImage( nullptr ),
+      m_itkTargetImage( nullptr ),
+      m_targetVtkTransform( nullptr ),
+      m_parentVtkTransform( nullptr ),
+      m_bestStartIndex( -1 )
+{
+}
+
+MultiStartRegistration::~MultiStartRegistration() {}
+
+void MultiStartRegistration::ComputePerturbedStarts( vtkTransform * initialTransform )
+{
+    // Perturbations are applied around the center of the target volume, which is also
+    // the center of rotation used by the metric.
+    double center[3];
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+        center[i] = m_itkTargetImage->GetOrigin()[i] +
+                    m_itkTargetImage->GetSpacing()[i] * m_itkTargetImage->GetBufferedRegion().GetSize()[i] / 2.0;
+    }
+    if( m_targetVtkTransform ) m_targetVtkTransform->TransformPoint( center, center );
+    if( m_parentVtkTransform ) m_parentVtkTransform->GetLinearInverse()->TransformPoint( center, center );
+
+    std::mt19937 generator( m_seed );
+    std::uniform_real_distribution<double> rotation( -m_rotationRange, m_rotationRange );
+    std::uniform_real_distribution<double> translation( -m_translationRange, m_translationRange );
+
+    m_results.clear();
+    m_results.resize( m_numberOfStarts );
+    for( unsigned int s = 0; s < m_numberOfStarts; ++s )
+    {
+        vtkSmartPointer<vtkTransform> start = vtkSmartPointer<vtkTransform>::New();
+        start->PostMultiply();
+        start->SetMatrix( initialTransform->GetMatrix() );
+        if( s > 0 )
+        {
+            start->Translate( -center[0], -center[1], -center[2] );
+            start->RotateX( rotation( generator ) );
+            start->RotateY( rotation( generator ) );
+            start->RotateZ( rotation( generator ) );
+            start->Translate( center[0] + translation( generator ), center[1] + translation( generator ),
+                              center[2] + translation( generator ) );
+        }
+        start->Update();
+
+        StartResult & result       = m_results[s];
+        result.startIndex          = s;
+        result.metricValue         = std::numeric_limits<double>::max();
+        result.numberOfIterations  = 0;
+        result.pruned              = false;
+        result.transform           = vtkSmartPointer<vtkTransform>::New();
+        result.transform->SetMatrix( start->GetMatrix() );
+    }
+}
+
+bool MultiStartRegistration::Run( vtkTransform * initialTransform )
+{
+    if( !initialTransform || !m_itkSourceImage || !m_itkTargetImage )
+    {
+        std::cerr << "MultiStartRegistration: images and initial transform must be set." << std::endl;
+        return false;
+    }
+
+    this->ComputePerturbedStarts( initialTransform );
+    m_currentValues.assign( m_numberOfStarts, std::numeric_limits<double>::max() );
+    m_bestStartIndex = -1;
+
+    unsigned int numberOfThreads =
+        m_maximumNumberOfThreads > 0 ? m_maximumNumberOfThreads : (unsigned int)QThread::idealThreadCount();
+    numberOfThreads = std::max( 1u, std::min( numberOfThreads, m_numberOfStarts ) );
+
+    // All starts share the same target, compute its gradient samples only once
+    if( !m_fixedGradientSamples )
+    {
+        GPU_WeightRigidRegistration * prototype = new GPU_WeightRigidRegistration();
+        if( m_setupFunction ) m_setupFunction( prototype );
+        prototype->SetItkTargetImage( m_itkTargetImage );
+        m_fixedGradientSamples = prototype->ComputeFixedGradientSamples();
+        delete prototype;
+    }
+
+    std::atomic<int> nextStart( 0 );
+    auto worker = [this, &nextStart]() {
+        int startIndex;
+        while( ( startIndex = nextStart++ ) < (int)m_numberOfStarts )
+        {
+            this->RunStart( startIndex );
+        }
+    };
+
+    std::vector<QThread *> threads;
+    for( unsigned int t = 1; t < numberOfThreads; ++t )
+    {
+        QThread * thread = QThread::create( worker );
+        thread->start();
+        threads.push_back( thread );
+    }
+    worker();
+    for( QThread * thread : threads )
+    {
+        thread->wait();
+        delete thread;
+    }
+
+    double bestValue = std::numeric_limits<double>::max();
+    for( const StartResult & result : m_results )
+    {
+        if( !result.pruned && result.metricValue < bestValue )
+        {
+            bestValue        = result.metricValue;
+            m_bestStartIndex = result.startIndex;
+        }
+    }
+    if( m_bestStartIndex < 0 ) return false;
+
+    initialTransform->SetMatrix( m_results[m_bestStartIndex].transform->GetMatrix() );
+    initialTransform->Modified();
+    return true;
+}
+
+void MultiStartRegistration::RunStart( int startIndex )
+{
+    StartResult & result = m_results[startIndex];
+
+    // vtkTransforms are not shared between threads
+    vtkSmartPointer<vtkTransform> targetTransform = vtkSmartPointer<vtkTransform>::New();
+    if( m_targetVtkTransform ) targetTransform->SetMatrix( m_targetVtkTransform->GetMatrix() );
+    vtkSmartPointer<vtkTransform> parentTransform;
+    if( m_parentVtkTransform )
+    {
+        parentTransform = vtkSmartPointer<vtkTransform>::New();
+        parentTransform->SetMatrix( m_parentVtkTransform->GetMatrix() );
+    }
+
+    GPU_WeightRigidRegistration * rigidRegistrator = new GPU_WeightRigidRegistration();
+    if( m_setupFunction ) m_setupFunction( rigidRegistrator );
+    // Each optimizer owns its random generator, starts do not share one between threads
+    rigidRegistrator->SetSamplingSeed( m_seed + startIndex );
+
+    rigidRegistrator->SetItkSourceImage( m_itkSourceImage );
+    rigidRegistrator->SetItkTargetImage( m_itkTargetImage );
+    rigidRegistrator->SetFixedGradientSamples( m_fixedGradientSamples );
+    rigidRegistrator->SetVtkTransform( result.transform );
+    rigidRegistrator->SetSourceVtkTransform( result.transform );
+    rigidRegistrator->SetTargetVtkTransform( targetTransform );
+    rigidRegistrator->SetParentVtkTransform( parentTransform );
+    rigidRegistrator->SetIterationCallback( [this, startIndex]( unsigned int iteration, double value ) {
+        return this->OnIteration( startIndex, iteration, value );
+    } );
+
+    try
+    {
+        rigidRegistrator->runRegistration();
+        result.metricValue        = rigidRegistrator->GetFinalMetricValue();
+        result.numberOfIterations = rigidRegistrator->GetNumberOfIterations();
+    }
+    catch( itk::ExceptionObject & err )
+    {
+        std::cerr << "MultiStartRegistration: start " << startIndex << " failed." << std::endl;
+        std::cerr << err << std::endl;
+        QMutexLocker lock( &m_mutex );
+        result.pruned = true;
+    }
+    delete rigidRegistrator;
+}
+
+bool MultiStartRegistration::OnIteration( int startIndex, unsigned int iteration, double value )
+{
+    QMutexLocker lock( &m_mutex );
+    m_currentValues[startIndex] = value;
+    if( iteration < m_pruningWarmupIterations ) return true;
+
+    // metric values are negated similarities, lower is better
+    double bestValue = *std::min_element( m_currentValues.begin(), m_currentValues.end() );
+    if( value > bestValue + m_pruningTolerance * std::fabs( bestValue ) )
+    {
+        m_results[startIndex].pruned = true;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#ifndef MULTISTARTREGISTRATION_H
+#define MULTISTARTREGISTRATION_H
+
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <QMutex>
+
+#include <functional>
+#include <vector>
+
+#include "gpu_weightrigidregistration.h"
+#include "imageobject.h"
+
+// Description:
+// Runs several GPU_WeightRigidRegistration from randomly perturbed initial poses
+// and keeps the pose that reaches the best final metric value. Start 0 always
+// uses the unperturbed initial pose. Starts run concurrently (each registration
+// owns its OpenCL context) and a start is stopped early when, after a few
+// iterations, its metric is clearly worse than the best start so far.
+// Starts share the gradient samples of the target and each start seeds its
+// optimizer with seed + start index, so starts are reproducible individually.
+// Pruning compares starts while they run and may differ between runs.
+class MultiStartRegistration
+{
+public:
+    // Used to apply the same parameters (metric, sampling, optimizer) to every start
+    typedef std::function<void( GPU_WeightRigidRegistration * )> SetupFunctionType;
+
+    struct StartResult
+    {
+        int startIndex;
+        double metricValue;
+        unsigned int numberOfIterations;
+        bool pruned;
+        vtkSmartPointer<vtkTransform> transform;
+    };
+
+    MultiStartRegistration();
+    ~MultiStartRegistration();
+
+    void SetNumberOfStarts( unsigned int n ) { m_numberOfStarts = n > 0 ? n : 1; }
+    unsigned int GetNumberOfStarts() { return m_numberOfStarts; }
+    // Maximum number of registrations running at the same time, 0 means QThread::idealThreadCount()
+    void SetMaximumNumberOfThreads( unsigned int n ) { m_maximumNumberOfThreads = n; }
+    // Perturbations are drawn uniformly in [-range, range] for each axis
+    void SetRotationRange( double degrees ) { m_rotationRange = degrees; }
+    void SetTranslationRange( double mm ) { m_translationRange = mm; }
+    // Seed of the perturbations, start i also seeds its optimizer with seed + i
+    void SetSeed( unsigned int seed ) { m_seed = seed; }
+    // A start is pruned if its metric is worse than the best one by more than tolerance * |best|
+    void SetPruningTolerance( double tolerance ) { m_pruningTolerance = tolerance; }
+    void SetPruningWarmupIterations( unsigned int n ) { m_pruningWarmupIterations = n; }
+
+    void SetSetupFunction( SetupFunctionType setup ) { m_setupFunction = setup; }
+    void SetItkSourceImage( IbisItkFloat3ImageType::Pointer image ) { m_itkSourceImage = image; }
+    void SetItkTargetImage( IbisItkFloat3ImageType::Pointer image ) { m_itkTargetImage = image; }
+    void SetTargetVtkTransform( vtkTransform * transform ) { m_targetVtkTransform = transform; }
+    void SetParentVtkTransform( vtkTransform * transform ) { m_parentVtkTransform = transform; }
+    // Gradient samples of the target shared by all starts, computed by Run() when not set
+    void SetFixedGradientSamples( GPU_WeightRigidRegistration::FixedGradientSamplesPointer samples )
+    {
+        m_fixedGradientSamples = samples;
+    }
+
+    // Runs all starts from initialTransform (LocalTransform of the source object) and
+    // writes the best resulting pose back to it. Returns false if no start could run.
+    bool Run( vtkTransform * initialTransform );
+
+    const std::vector<StartResult> & GetResults() { return m_results; }
+    int GetBestStartIndex() { return m_bestStartIndex; }
+
+private:
+    void ComputePerturbedStarts( vtkTransform * initialTransform );
+    void RunStart( int startIndex );
+    bool OnIteration( int startIndex, unsigned int iteration, double value );
+
+    unsigned int m_numberOfStarts;
+    unsigned int m_maximumNumberOfThreads;
+    double m_rotationRange;
+    double m_translationRange;
+    unsigned int m_seed;
+    double m_pruningTolerance;
+    unsigned int m_pruningWarmupIterations;
+
+    SetupFunctionType m_setupFunction;
+    IbisItkFloat3ImageType::Pointer m_itkSourceImage;
+    IbisItkFloat3ImageType::Pointer m_itkTargetImage;
+    vtkTransform * m_targetVtkTransform;
+    vtkTransform * m_parentVtkTransform;
+    GPU_WeightRigidRegistration::FixedGradientSamplesPointer m_fixedGradientSamples;
+
+    std::vector<StartResult> m_results;
+    std::vector<double> m_currentValues;
+    int m_bestStartIndex;
+    QMutex m_mutex;
+};
+
+#endif
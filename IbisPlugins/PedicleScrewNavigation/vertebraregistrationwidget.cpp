@@ -14,6 +14,13 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 
 #include "ui_vertebraregistrationwidget.h"
 
+#include <QListWidgetItem>
+#include <QTableWidgetItem>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+
 VertebraRegistrationWidget::VertebraRegistrationWidget( QWidget * parent )
     : QWidget( parent ),
       ui( new Ui::VertebraRegistrationWidget ),
@@ -27,7 +34,8 @@ VertebraRegistrationWidget::VertebraRegistrationWidget( QWidget * parent )
       m_optSelectivity( 32 ),
       m_optPercentile( 0.8 ),
       m_optPopulationSize( 60 ),
-      m_optInitialSigma( 1.0 )
+      m_optInitialSigma( 1.0 ),
+      m_optNumberOfStarts( 1 )
 {
     m_pluginInterface = 0;
     ui->setupUi( this );
@@ -96,6 +104,7 @@ void VertebraRegistrationWidget::UpdateUi()
         ui->usImageComboBox->clear();
         ui->ctImageComboBox->clear();
         ui->volumeComboBox->clear();
+        ui->batchLevelsListWidget->clear();
 
         const SceneManager::ObjectList & allObjects = ibisAPI->GetAllObjects();
         for( int i = 0; i < allObjects.size(); ++i )
@@ -107,6 +116,7 @@ void VertebraRegistrationWidget::UpdateUi()
                 {
                     ui->ctImageComboBox->addItem( current->GetName(), QVariant( current->GetObjectID() ) );
                     ui->volumeComboBox->addItem( current->GetName(), QVariant( current->GetObjectID() ) );
+                    this->AddBatchLevelItem( current );
                 }
                 else if( current->IsA( "USAcquisitionObject" ) )
                 {
@@ -156,9 +166,24 @@ void VertebraRegistrationWidget::UpdateUi()
     ui->optInitialSigmaComboBox->addItem( tr( "8.0" ), 8.0 );
     ui->optInitialSigmaComboBox->setCurrentIndex( 1 );
 
+    ui->optNumberOfStartsComboBox->addItem( tr( "1" ), 1 );
+    ui->optNumberOfStartsComboBox->addItem( tr( "2" ), 2 );
+    ui->optNumberOfStartsComboBox->addItem( tr( "4" ), 4 );
+    ui->optNumberOfStartsComboBox->addItem( tr( "8" ), 8 );
+    ui->optNumberOfStartsComboBox->addItem( tr( "16" ), 16 );
+    ui->optNumberOfStartsComboBox->setCurrentIndex( 0 );
+
     ui->advancedSettingsGroupBox->hide();
 }
 
+void VertebraRegistrationWidget::AddBatchLevelItem( SceneObject * imageObject )
+{
+    QListWidgetItem * item = new QListWidgetItem( imageObject->GetName(), ui->batchLevelsListWidget );
+    item->setData( Qt::UserRole, QVariant( imageObject->GetObjectID() ) );
+    item->setFlags( item->flags() | Qt::ItemIsUserCheckable );
+    item->setCheckState( Qt::Unchecked );
+}
+
 itk::Point<double, 3> VertebraRegistrationWidget::GetImageCenterPoint( IbisItkFloat3ImagePointer image )
 {
     IbisItkFloat3ImageType::PointType centerPoint;
@@ -592,62 +617,310 @@ bool VertebraRegistrationWidget::Register()
 
     if( ui->gradientAlignmentCheckBox->isChecked() )
     {
-        // Initialize parameters
-        GPU_WeightRigidRegistration * rigidRegistrator = new GPU_WeightRigidRegistration();
-        if( m_lambdaMetricBalance == 1.0 )
-            rigidRegistrator->SetRegistrationMetricToGradientOrientation();
-        else if( m_lambdaMetricBalance == 0 )
-            rigidRegistrator->SetRegistrationMetricToIntensity();
-        else
-            rigidRegistrator->SetRegistrationMetricToCombination();
-
-        rigidRegistrator->SetSamplingStrategyToRandom();
-        rigidRegistrator->SetUseMask( true );
-        if( m_optNumberOfPixels == 128000 )
+        vtkTransform * parentVtktransform = nullptr;
+        if( ctImageObject->GetParent() )
         {
-            rigidRegistrator->SetOrientationNumberOfPixels( itkTargetImage->GetRequestedRegion().GetNumberOfPixels() );
+            parentVtktransform = vtkTransform::SafeDownCast( ctImageObject->GetParent()->GetWorldTransform() );
+            Q_ASSERT_X( parentVtktransform, "VertebraRegistrationWidget::on_startRegistrationButton_clicked()",
+                        "Invalid transform" );
         }
-        else
+
+        // Run registration
+        ctImageObject->StartModifyingTransform();
+        double metricValue;
+        unsigned int numberOfIterations;
+        this->RegisterSource( itkSourceImage, itkTargetImage, nullptr, sourceVtkTransform, targetVtkTransform,
+                              parentVtktransform, 0, metricValue, numberOfIterations );
+        ctImageObject->FinishModifyingTransform();
+        ctImageObject->SetLocalTransform( sourceVtkTransform );
+    }
+
+    ibisAPI->StopProgress( progress );
+    return true;
+}
+
+void VertebraRegistrationWidget::ConfigureRegistration( GPU_WeightRigidRegistration * rigidRegistrator,
+                                                        IbisItkFloat3ImagePointer itkTargetImage )
+{
+    if( m_lambdaMetricBalance == 1.0 )
+        rigidRegistrator->SetRegistrationMetricToGradientOrientation();
+    else if( m_lambdaMetricBalance == 0 )
+        rigidRegistrator->SetRegistrationMetricToIntensity();
+    else
+        rigidRegistrator->SetRegistrationMetricToCombination();
+
+    rigidRegistrator->SetSamplingStrategyToRandom();
+    rigidRegistrator->SetUseMask( true );
+    if( m_optNumberOfPixels == 128000 )
+    {
+        rigidRegistrator->SetOrientationNumberOfPixels( itkTargetImage->GetRequestedRegion().GetNumberOfPixels() );
+    }
+    else
+    {
+        rigidRegistrator->SetOrientationNumberOfPixels( m_optNumberOfPixels );
+    }
+    rigidRegistrator->SetOrientationSelectivity( m_optSelectivity );
+    rigidRegistrator->SetOrientationPercentile( m_optPercentile );
+    rigidRegistrator->SetPopulationSize( m_optPopulationSize );
+    rigidRegistrator->SetInitialSigma( m_optInitialSigma );
+    rigidRegistrator->SetLambdaMetricBalance( m_lambdaMetricBalance );
+    rigidRegistrator->SetDebug( false );
+    rigidRegistrator->SetTargetMask( nullptr );
+}
+
+bool VertebraRegistrationWidget::RegisterSource( IbisItkFloat3ImagePointer itkSourceImage,
+                                                 IbisItkFloat3ImagePointer itkTargetImage,
+                                                 GPU_WeightRigidRegistration::FixedGradientSamplesPointer fixedSamples,
+                                                 vtkTransform * sourceTransform, vtkTransform * targetTransform,
+                                                 vtkTransform * parentTransform, unsigned int numberOfThreads,
+                                                 double & metricValue, unsigned int & numberOfIterations )
+{
+    if( m_optNumberOfStarts > 1 )
+    {
+        MultiStartRegistration multiStart;
+        multiStart.SetNumberOfStarts( m_optNumberOfStarts );
+        multiStart.SetMaximumNumberOfThreads( numberOfThreads );
+        multiStart.SetSetupFunction( [this, itkTargetImage]( GPU_WeightRigidRegistration * rigidRegistrator ) {
+            this->ConfigureRegistration( rigidRegistrator, itkTargetImage );
+        } );
+        multiStart.SetItkSourceImage( itkSourceImage );
+        multiStart.SetItkTargetImage( itkTargetImage );
+        multiStart.SetFixedGradientSamples( fixedSamples );
+        multiStart.SetTargetVtkTransform( targetTransform );
+        multiStart.SetParentVtkTransform( parentTransform );
+        if( !multiStart.Run( sourceTransform ) ) return false;
+
+        const MultiStartRegistration::StartResult & best = multiStart.GetResults()[multiStart.GetBestStartIndex()];
+        metricValue        = best.metricValue;
+        numberOfIterations = best.numberOfIterations;
+        return true;
+    }
+
+    GPU_WeightRigidRegistration * rigidRegistrator = new GPU_WeightRigidRegistration();
+    this->ConfigureRegistration( rigidRegistrator, itkTargetImage );
+
+    // Set image inputs
+    rigidRegistrator->SetItkSourceImage( itkSourceImage );
+    rigidRegistrator->SetItkTargetImage( itkTargetImage );
+    rigidRegistrator->SetFixedGradientSamples( fixedSamples );
+
+    // Set transform inputs
+    rigidRegistrator->SetVtkTransform( sourceTransform );
+    rigidRegistrator->SetSourceVtkTransform( sourceTransform );
+    rigidRegistrator->SetTargetVtkTransform( targetTransform );
+    rigidRegistrator->SetParentVtkTransform( parentTransform );
+
+    rigidRegistrator->runRegistration();
+    metricValue        = rigidRegistrator->GetFinalMetricValue();
+    numberOfIterations = rigidRegistrator->GetNumberOfIterations();
+    delete rigidRegistrator;
+    return true;
+}
+
+USAcquisitionObject * VertebraRegistrationWidget::GetSelectedUSAcquisition()
+{
+    IbisAPI * ibisAPI         = m_pluginInterface->GetIbisAPI();
+    int usAcquisitionObjectId = ui->usImageComboBox->itemData( ui->usImageComboBox->currentIndex() ).toInt();
+    if( usAcquisitionObjectId == SceneManager::InvalidId ) return nullptr;
+    return USAcquisitionObject::SafeDownCast( ibisAPI->GetObjectByID( usAcquisitionObjectId ) );
+}
+
+bool VertebraRegistrationWidget::RegisterBatch()
+{
+    IbisAPI * ibisAPI = m_pluginInterface->GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+
+    // Collect vertebra levels
+    std::vector<BatchLevel> levels;
+    for( int i = 0; i < ui->batchLevelsListWidget->count(); ++i )
+    {
+        QListWidgetItem * item = ui->batchLevelsListWidget->item( i );
+        if( item->checkState() != Qt::Checked ) continue;
+        ImageObject * ctImageObject =
+            ImageObject::SafeDownCast( ibisAPI->GetObjectByID( item->data( Qt::UserRole ).toInt() ) );
+        if( !ctImageObject ) continue;
+
+        BatchLevel level;
+        level.imageObjectId = ctImageObject->GetObjectID();
+        level.name          = ctImageObject->GetName();
+        level.itkImage      = ctImageObject->GetItkImage();
+        level.transform     = vtkSmartPointer<vtkTransform>::New();
+        level.transform->SetMatrix( ctImageObject->GetLocalTransform()->GetMatrix() );
+        if( ctImageObject->GetParent() )
         {
-            rigidRegistrator->SetOrientationNumberOfPixels( m_optNumberOfPixels );
+            level.parentTransform = vtkSmartPointer<vtkTransform>::New();
+            level.parentTransform->SetMatrix( ctImageObject->GetParent()->GetWorldTransform()->GetMatrix() );
         }
-        rigidRegistrator->SetOrientationSelectivity( m_optSelectivity );
-        rigidRegistrator->SetOrientationPercentile( m_optPercentile );
-        rigidRegistrator->SetPopulationSize( m_optPopulationSize );
-        rigidRegistrator->SetInitialSigma( m_optInitialSigma );
-        rigidRegistrator->SetLambdaMetricBalance( m_lambdaMetricBalance );
-        rigidRegistrator->SetDebug( false );
+        levels.push_back( level );
+    }
+    if( levels.empty() )
+    {
+        QMessageBox::information( this, "Vertebra Rigid Registration", "Select at least one vertebra level." );
+        return false;
+    }
 
-        // Set image inputs
-        rigidRegistrator->SetItkSourceImage( itkSourceImage );
-        rigidRegistrator->SetItkTargetImage( itkTargetImage );
+    USAcquisitionObject * usAcquisitionObject = this->GetSelectedUSAcquisition();
+    if( !usAcquisitionObject )
+    {
+        QMessageBox::information( this, "Vertebra Rigid Registration", "US acquisition not found." );
+        return false;
+    }
 
-        // Set transform inputs
-        rigidRegistrator->SetVtkTransform( sourceVtkTransform );
-        rigidRegistrator->SetSourceVtkTransform( sourceVtkTransform );
-        rigidRegistrator->SetTargetVtkTransform( targetVtkTransform );
+    // Reconstruction, initial alignment, gradient samples, then one step per level
+    int numberOfLevels         = (int)levels.size();
+    QProgressDialog * progress = ibisAPI->StartProgress( 3 + numberOfLevels, tr( "Batch registration" ) );
+    auto canceled              = [ibisAPI, progress]() {
+        if( !progress->wasCanceled() ) return false;
+        ibisAPI->StopProgress( progress );
+        QMessageBox::information( 0, "Vertebra Rigid Registration", "Process cancelled", 1, 0 );
+        return true;
+    };
+    progress->setLabelText( tr( "Reconstructing ultrasound volume..." ) );
+    qApp->processEvents();
+    if( canceled() ) return false;
 
-        rigidRegistrator->SetTargetMask( nullptr );
+    // The US volume is reconstructed once for all levels
+    QElapsedTimer timer;
+    timer.start();
+    QList<USAcquisitionObject *> secAcqList;
+    m_secondaryAcquisitions->getValidUSAcquisitions( secAcqList );
+    if( !this->CreateVolumeFromSlices( usAcquisitionObject, m_reconstructionResolution, secAcqList ) )
+    {
+        ibisAPI->StopProgress( progress );
+        return false;
+    }
+    double reconstructionTime = double( timer.elapsed() ) / 1000.0;
 
-        if( ctImageObject->GetParent() )
+    if( ui->addUltrasoundReconstructionCheckBox->isChecked() )
+    {
+        ImageObject * imobj = ImageObject::New();
+        imobj->SetItkImage( m_sparseUsVolume );
+        imobj->SetName( "Reconstructed US Volume" );
+        ibisAPI->AddObject( imobj );
+        imobj->ChooseColorTable( 1 );
+    }
+    IbisItkFloat3ImagePointer itkTargetImage = m_sparseUsVolume;
+
+    progress->setLabelText( tr( "Performing initial alignment..." ) );
+    ibisAPI->UpdateProgress( progress, 1 );
+    qApp->processEvents();
+    if( canceled() ) return false;
+    if( ui->initialAlignmentCheckBox->isChecked() )
+    {
+        for( BatchLevel & level : levels )
         {
-            vtkTransform * parentVtktransform =
-                vtkTransform::SafeDownCast( ctImageObject->GetParent()->GetWorldTransform() );
-            Q_ASSERT_X( parentVtktransform, "VertebraRegistrationWidget::on_startRegistrationButton_clicked()",
-                        "Invalid transform" );
-            rigidRegistrator->SetParentVtkTransform( parentVtktransform );
+            vtkTransform * levelTransform = level.transform;
+            this->PerformInitialAlignment( levelTransform, level.itkImage, m_inputImageList, m_usScanCenterPointList );
         }
+    }
 
-        // Run registration
-        ctImageObject->StartModifyingTransform();
+    double gradientTime = 0.0;
+    timer.restart();
+    if( ui->gradientAlignmentCheckBox->isChecked() )
+    {
+        progress->setLabelText( tr( "Computing ultrasound gradients..." ) );
+        ibisAPI->UpdateProgress( progress, 2 );
+        qApp->processEvents();
+        if( canceled() ) return false;
+
+        // The gradient samples of the US volume are shared by all levels
+        GPU_WeightRigidRegistration * prototype = new GPU_WeightRigidRegistration();
+        this->ConfigureRegistration( prototype, itkTargetImage );
+        prototype->SetItkTargetImage( itkTargetImage );
+        GPU_WeightRigidRegistration::FixedGradientSamplesPointer fixedSamples =
+            prototype->ComputeFixedGradientSamples();
+        delete prototype;
+        gradientTime = double( timer.elapsed() ) / 1000.0;
+
+        progress->setLabelText( tr( "Registering %1 levels..." ).arg( numberOfLevels ) );
+        ibisAPI->UpdateProgress( progress, 3 );
+        qApp->processEvents();
+        if( canceled() ) return false;
+
+        // Levels run in separate threads (each registration owns its OpenCL context and optimizer generator),
+        // the remaining cores are left to the starts of each level.
+        int idealThreadCount        = std::max( 1, QThread::idealThreadCount() );
+        int numberOfThreads         = std::max( 1, std::min( idealThreadCount, numberOfLevels ) );
+        unsigned int startThreads   = std::max( 1, idealThreadCount / numberOfThreads );
+        std::atomic<int> nextLevel( 0 );
+        std::atomic<int> levelsDone( 0 );
+        std::atomic<bool> stop( false );
+        auto worker = [this, &levels, &nextLevel, &levelsDone, &stop, itkTargetImage, fixedSamples, startThreads]() {
+            int levelIndex;
+            while( !stop && ( levelIndex = nextLevel++ ) < (int)levels.size() )
+            {
+                BatchLevel & level = levels[levelIndex];
+                QElapsedTimer levelTimer;
+                levelTimer.start();
+                vtkSmartPointer<vtkTransform> targetTransform = vtkSmartPointer<vtkTransform>::New();
+                this->RegisterSource( level.itkImage, itkTargetImage, fixedSamples, level.transform, targetTransform,
+                                      level.parentTransform, startThreads, level.metricValue,
+                                      level.numberOfIterations );
+                level.elapsedTime = double( levelTimer.elapsed() ) / 1000.0;
+                ++levelsDone;
+            }
+        };
 
-        rigidRegistrator->runRegistration();
+        timer.restart();
+        std::vector<QThread *> threads;
+        for( int t = 0; t < numberOfThreads; ++t )
+        {
+            QThread * thread = QThread::create( worker );
+            thread->start();
+            threads.push_back( thread );
+        }
 
-        ctImageObject->FinishModifyingTransform();
-        ctImageObject->SetLocalTransform( sourceVtkTransform );
+        // Keep the progress dialog responsive, a cancel stops before the next level
+        for( QThread * thread : threads )
+        {
+            while( !thread->wait( 100 ) )
+            {
+                ibisAPI->UpdateProgress( progress, 3 + levelsDone );
+                qApp->processEvents();
+                if( progress->wasCanceled() ) stop = true;
+            }
+            delete thread;
+        }
+        if( canceled() ) return false;
+    }
+    double registrationTime = double( timer.elapsed() ) / 1000.0;
+
+    // Apply results and report them together, levels removed from the scene during the registration are skipped
+    ui->batchResultsTableWidget->setRowCount( 0 );
+    QStringList removedLevels;
+    for( BatchLevel & level : levels )
+    {
+        ImageObject * imageObject = ImageObject::SafeDownCast( ibisAPI->GetObjectByID( level.imageObjectId ) );
+        if( !imageObject )
+        {
+            removedLevels.push_back( level.name );
+            continue;
+        }
+        imageObject->StartModifyingTransform();
+        imageObject->GetLocalTransform()->SetMatrix( level.transform->GetMatrix() );
+        imageObject->FinishModifyingTransform();
+
+        int row = ui->batchResultsTableWidget->rowCount();
+        ui->batchResultsTableWidget->insertRow( row );
+        ui->batchResultsTableWidget->setItem( row, 0, new QTableWidgetItem( imageObject->GetName() ) );
+        ui->batchResultsTableWidget->setItem( row, 1,
+                                              new QTableWidgetItem( QString::number( level.metricValue, 'f', 4 ) ) );
+        ui->batchResultsTableWidget->setItem( row, 2,
+                                              new QTableWidgetItem( QString::number( level.numberOfIterations ) ) );
+        ui->batchResultsTableWidget->setItem( row, 3,
+                                              new QTableWidgetItem( QString::number( level.elapsedTime, 'f', 2 ) ) );
     }
 
+    ui->batchTimingLabel->setText( tr( "Reconstruction: %1 s, gradients: %2 s, registration: %3 s" )
+                                       .arg( reconstructionTime, 0, 'f', 2 )
+                                       .arg( gradientTime, 0, 'f', 2 )
+                                       .arg( registrationTime, 0, 'f', 2 ) );
+
     ibisAPI->StopProgress( progress );
+    if( !removedLevels.isEmpty() )
+        QMessageBox::warning( this, "Vertebra Rigid Registration",
+                              tr( "Levels removed during the registration were not updated: %1" )
+                                  .arg( removedLevels.join( ", " ) ) );
     return true;
 }
 
@@ -707,6 +980,22 @@ void VertebraRegistrationWidget::on_startRegistrationButton_clicked()
     }
 }
 
+void VertebraRegistrationWidget::on_batchRegistrationButton_clicked()
+{
+    if( !m_isProcessing )
+    {
+        m_isProcessing = true;
+        QElapsedTimer timer;
+        timer.start();
+
+        bool processOK = this->RegisterBatch();
+
+        double elapsedTime = double( timer.elapsed() ) / 1000.0;
+        if( processOK ) ui->elapsedTimeLabel->setText( tr( "Time: " ) + QString::number( elapsedTime ) + tr( " s" ) );
+        m_isProcessing = false;
+    }
+}
+
 void VertebraRegistrationWidget::on_initialAlignmentCheckBox_stateChanged( int value )
 {
     ui->sweepDirectionComboBox->setEnabled( (bool)value );
@@ -775,6 +1064,7 @@ void VertebraRegistrationWidget::OnObjectAddedSlot( int imageObjectId )
             SceneObject * sceneObject = ibisApi->GetObjectByID( imageObjectId );
             if( sceneObject->IsA( "ImageObject" ) )
             {
+                this->AddBatchLevelItem( sceneObject );
                 if( ui->ctImageComboBox->count() == 0 )
                 {
                     ui->ctImageComboBox->addItem( sceneObject->GetName(), QVariant( imageObjectId ) );
@@ -850,6 +1140,15 @@ void VertebraRegistrationWidget::OnObjectRemovedSlot( int imageObjectId )
                 }
             }
 
+            for( int i = 0; i < ui->batchLevelsListWidget->count(); ++i )
+            {
+                if( ui->batchLevelsListWidget->item( i )->data( Qt::UserRole ).toInt() == imageObjectId )
+                {
+                    delete ui->batchLevelsListWidget->takeItem( i );
+                    break;
+                }
+            }
+
             if( ui->ctImageComboBox->count() == 0 )
             {
                 ui->ctImageComboBox->addItem( tr( "None" ), QVariant( IbisAPI::InvalidId ) );
@@ -1006,6 +1305,11 @@ void VertebraRegistrationWidget::on_optInitialSigmaComboBox_currentIndexChanged(
     m_optInitialSigma = ui->optInitialSigmaComboBox->itemData( value ).toDouble();
 }
 
+void VertebraRegistrationWidget::on_optNumberOfStartsComboBox_currentIndexChanged( int value )
+{
+    m_optNumberOfStarts = ui->optNumberOfStartsComboBox->itemData( value ).toInt();
+}
+
 void VertebraRegistrationWidget::on_advancedSettingsButton_clicked()
 {
     m_showAdvancedSettings = !m_showAdvancedSettings;
@@ -54,6 +54,7 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include "gpu_rigidregistration.h"
 #include "gpu_volumereconstruction.h"
 #include "gpu_weightrigidregistration.h"
+#include "multistartregistration.h"
 #include "pediclescrewnavigationplugininterface.h"
 #include "screwnavigationwidget.h"
 #include "screwproperties.h"
@@ -112,6 +113,32 @@ private:
                                        std::vector<itk::SmartPointer<IbisItkFloat3ImageType> >,
                                        std::vector<itk::Point<double, 3> >, vtkTransform * parent = 0 );
     bool Register();
+    void ConfigureRegistration( GPU_WeightRigidRegistration *, IbisItkFloat3ImagePointer );
+    // Registers a source image with the current settings, from several starts when requested. sourceTransform
+    // receives the result. fixedSamples may be null, numberOfThreads 0 uses all cores for the starts.
+    bool RegisterSource( IbisItkFloat3ImagePointer itkSourceImage, IbisItkFloat3ImagePointer itkTargetImage,
+                         GPU_WeightRigidRegistration::FixedGradientSamplesPointer fixedSamples,
+                         vtkTransform * sourceTransform, vtkTransform * targetTransform,
+                         vtkTransform * parentTransform, unsigned int numberOfThreads, double & metricValue,
+                         unsigned int & numberOfIterations );
+    USAcquisitionObject * GetSelectedUSAcquisition();
+
+    // Batch registration of several vertebra levels to the same US volume
+    // Levels keep the id of their image object, the object may be removed while the registration threads run.
+    // Threads only use the ITK image, fetched on the GUI thread.
+    struct BatchLevel
+    {
+        int imageObjectId = IbisAPI::InvalidId;
+        QString name;
+        IbisItkFloat3ImagePointer itkImage;
+        vtkSmartPointer<vtkTransform> transform;
+        vtkSmartPointer<vtkTransform> parentTransform;
+        double metricValue              = 0.0;
+        unsigned int numberOfIterations = 0;
+        double elapsedTime              = 0.0;
+    };
+    void AddBatchLevelItem( SceneObject * );
+    bool RegisterBatch();
 
     // Navigation functionality
     void StartNavigation();
@@ -147,6 +174,7 @@ private:
     int m_optPopulationSize;
     double m_optPercentile;
     double m_optInitialSigma;
+    int m_optNumberOfStarts;
 
     int m_it;
     SecondaryUSAcquisition * m_secondaryAcquisitions;
@@ -159,6 +187,7 @@ private slots:
     void on_initialAlignmentCheckBox_stateChanged( int );
     void on_sweepDirectionComboBox_currentIndexChanged( int );
     void on_startRegistrationButton_clicked();
+    void on_batchRegistrationButton_clicked();
 
     void on_navigateButton_clicked();
     void on_navigationWindowClosed();
@@ -175,6 +204,7 @@ private slots:
     void on_percentileDial_valueChanged( int );
     void on_optPopulationSizeComboBox_currentIndexChanged( int );
     void on_optInitialSigmaComboBox_currentIndexChanged( int );
+    void on_optNumberOfStartsComboBox_currentIndexChanged( int );
     void on_advancedSettingsButton_clicked();
     void on_addUSAcquisitionButton_clicked();
     void on_removeUSAcquisitionButton_clicked();
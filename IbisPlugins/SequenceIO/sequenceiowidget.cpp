@@ -170,43 +170,50 @@ bool SequenceIOWidget::ReadAcquisitionMetaData( QString filename, AcqProperties
     std::ifstream filereader( filename.toUtf8().constData(), std::ios::in | std::ios::binary );
     if( filereader.is_open() )
     {
+        // Only the header is read: it ends with ElementDataFile. Sequences have a few lines per frame, split each line
+        // once in a key and a value.
         std::string line;
         while( std::getline( filereader, line ) )
         {
-            QString qline( line.c_str() );
-            qline              = qline.trimmed();
-            QStringList tokens = qline.split( "=" );
-            if( tokens[0].trimmed().contains( "ObjectType" ) )
+            std::string::size_type separator = line.find( '=' );
+            if( separator == std::string::npos ) continue;
+            QString key   = QString::fromUtf8( line.data(), static_cast<int>( separator ) ).trimmed();
+            QString value = QString::fromUtf8( line.data() + separator + 1,
+                                               static_cast<int>( line.size() - separator - 1 ) )
+                                .trimmed();
+            if( key.contains( "ObjectType" ) )
             {
-                if( !tokens[1].trimmed().contains( "Image" ) ) return false;
+                if( !value.contains( "Image" ) ) return false;
             }
-            else if( tokens[0].trimmed() == "CompressedData" )
+            else if( key == "CompressedData" )
             {
-                if( tokens[1].trimmed().toLower() == "false" )
+                if( value.toLower() == "false" )
                     props->compressed = false;
                 else
                     props->compressed = true;
             }
-            else if( tokens[0].trimmed() == "CompressedDataSize" )
+            else if( key == "CompressedDataSize" )
             {
-                props->compressedDataSize = tokens[1].trimmed().toInt();
+                props->compressedDataSize = value.toInt();
             }
-            else if( tokens[0].trimmed().contains( "DimSize" ) )
+            else if( key.contains( "DimSize" ) )
             {
-                QStringList strdim        = tokens[1].trimmed().split( " " );
+                QStringList strdim = value.split( " " );
+                if( strdim.size() < 3 ) return false;
                 props->imageDimensions[0] = strdim[0].toInt();
                 props->imageDimensions[1] = strdim[1].toInt();
                 props->numberOfFrames     = strdim[2].toInt();
                 this->StartProgress( props->numberOfFrames, tr( "Reading Image MetaData" ) );
             }
-            else if( tokens[0].trimmed() == tr( "UltrasoundImageOrientation" ) )
+            else if( key == tr( "UltrasoundImageOrientation" ) )
             {
-                if( tokens[1].trimmed().contains( "U" ) ) props->flippedAxes[0] = true;
-                if( tokens[1].trimmed().contains( "N" ) ) props->flippedAxes[1] = true;
+                if( value.contains( "U" ) ) props->flippedAxes[0] = true;
+                if( value.contains( "N" ) ) props->flippedAxes[1] = true;
             }
-            else if( tokens[0].trimmed().contains( "CalibrationTransform" ) )
+            else if( key.contains( "CalibrationTransform" ) )
             {
-                QStringList strtransform = tokens[1].trimmed().split( " " );
+                QStringList strtransform = value.split( " " );
+                if( strtransform.size() < 16 ) continue;
                 int ii = 0, jj = 0;
                 for( int i = 0; i < 16; i++ )
                 {
@@ -216,33 +223,34 @@ bool SequenceIOWidget::ReadAcquisitionMetaData( QString filename, AcqProperties
                 }
                 props->isCalibrationFound = true;
             }
-            else if( tokens[0].trimmed().contains( "TimestampBaseline" ) )
+            else if( key.contains( "TimestampBaseline" ) )
             {
-                props->timestampBaseline = tokens[1].trimmed().toDouble();
+                props->timestampBaseline = value.toDouble();
             }
-            else if( tokens[0].trimmed().startsWith( "Seq_" ) )
+            else if( key.startsWith( "Seq_" ) )
             {
                 // metadata starting with Seq_ are tracking information (i.e., frame id, frame transform, frame status,
                 // timestamp, etc.)
 
-                QStringList frameinfo = tokens[0].trimmed().split( "_" );
+                QStringList frameinfo = key.split( "_" );
+                if( frameinfo.size() < 3 ) continue;
                 // update progress bar
                 if( frameinfo[2] == "FrameNumber" )
                 {
-                    this->UpdateProgress( tokens[1].toInt() );
+                    this->UpdateProgress( value.toInt() );
                 }
                 // collect unique transform names for GUI display
                 else if( frameinfo[2].endsWith( "Transform" ) )
                 {
                     // if new transform encountered add to dictionary
-                    if( !props->trackedTransformNames.contains( frameinfo[2].trimmed() ) )
-                        props->trackedTransformNames.append( frameinfo[2].trimmed() );
+                    if( !props->trackedTransformNames.contains( frameinfo[2] ) )
+                        props->trackedTransformNames.append( frameinfo[2] );
                 }
             }
-            else if( tokens[0].trimmed().contains( "ElementDataFile" ) )
+            else if( key.contains( "ElementDataFile" ) )
             {
                 // end of metadata
-                props->elementDataFile = tokens[1].trimmed();
+                props->elementDataFile = value;
                 break;
             }
         }
@@ -0,0 +1 @@
+DeclarePlugin( SurfaceRegistration YES DESCRIPTION "This plugin registers a point cloud to a surface with point-to-surface ICP" )
@@ -0,0 +1,269 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#include "pointtosurfaceicp.h"
+
+#include <vtkGenericCell.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPThreadLocalObject.h>
+#include <vtkSMPTools.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkTriangleFilter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+
+#include "ibisrigidtransform.h"
+
+PointToSurfaceICP::PointToSurfaceICP()
+    : m_maximumNumberOfIterations( 50 ),
+      m_tolerance( 1e-4 ),
+      m_inlierFraction( 0.9 ),
+      m_maximumDistance( 0.0 ),
+      m_maximumNumberOfPoints( 0 ),
+      m_seed( 0 ),
+      m_finalRMS( 0.0 ),
+      m_numberOfIterations( 0 ),
+      m_numberOfInliers( 0 )
+{
+    vtkMatrix4x4::Identity( m_initialMatrix );
+    m_finalTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+}
+
+PointToSurfaceICP::~PointToSurfaceICP() {}
+
+void PointToSurfaceICP::SetTargetSurface( vtkPolyData * surface )
+{
+    m_surface = nullptr;
+    m_locator = nullptr;
+    if( !surface || surface->GetNumberOfPoints() == 0 ) return;
+
+    vtkSmartPointer<vtkTriangleFilter> triangulate = vtkSmartPointer<vtkTriangleFilter>::New();
+    triangulate->SetInputData( surface );
+    triangulate->PassVertsOff();
+    triangulate->PassLinesOff();
+    triangulate->Update();
+    m_surface = triangulate->GetOutput();
+    if( m_surface->GetNumberOfCells() == 0 )
+    {
+        m_surface = nullptr;
+        return;
+    }
+
+    // Cells are built here, GetCell() and the locator queries are then thread safe
+    m_surface->BuildCells();
+    m_locator = vtkSmartPointer<vtkStaticCellLocator>::New();
+    m_locator->SetDataSet( m_surface );
+    m_locator->BuildLocator();
+}
+
+void PointToSurfaceICP::SetSourcePoints( vtkPoints * points ) { m_sourcePoints = points; }
+
+void PointToSurfaceICP::SetInitialTransform( vtkMatrix4x4 * matrix )
+{
+    if( matrix )
+        vtkMatrix4x4::DeepCopy( m_initialMatrix, matrix );
+    else
+        vtkMatrix4x4::Identity( m_initialMatrix );
+}
+
+vtkMatrix4x4 * PointToSurfaceICP::GetFinalTransform() { return m_finalTransform; }
+
+void PointToSurfaceICP::SelectSourcePoints()
+{
+    vtkIdType numberOfPoints = m_sourcePoints->GetNumberOfPoints();
+    std::vector<vtkIdType> ids( numberOfPoints );
+    std::iota( ids.begin(), ids.end(), 0 );
+    if( m_maximumNumberOfPoints > 0 && numberOfPoints > (vtkIdType)m_maximumNumberOfPoints )
+    {
+        std::vector<vtkIdType> sampled;
+        sampled.reserve( m_maximumNumberOfPoints );
+        std::sample( ids.begin(), ids.end(), std::back_inserter( sampled ), m_maximumNumberOfPoints,
+                     std::mt19937( m_seed ) );
+        ids.swap( sampled );
+    }
+
+    m_selectedPoints.resize( 3 * ids.size() );
+    for( size_t i = 0; i < ids.size(); ++i ) m_sourcePoints->GetPoint( ids[i], &m_selectedPoints[3 * i] );
+
+    m_transformedPoints.resize( m_selectedPoints.size() );
+    m_closestPoints.resize( m_selectedPoints.size() );
+    m_squaredDistances.resize( ids.size() );
+    m_inliers.resize( ids.size() );
+}
+
+void PointToSurfaceICP::FindCorrespondences( const double matrix[16] )
+{
+    // Each thread queries the locator with its own cell
+    vtkSMPThreadLocalObject<vtkGenericCell> cells;
+    vtkSMPTools::For( 0, (vtkIdType)m_squaredDistances.size(),
+                      [this, matrix, &cells]( vtkIdType begin, vtkIdType end ) {
+                          vtkGenericCell * cell = cells.Local();
+                          for( vtkIdType i = begin; i < end; ++i )
+                          {
+                              double * x = &m_transformedPoints[3 * i];
+                              IbisRigidTransform::TransformPoint( matrix, &m_selectedPoints[3 * i], x );
+
+                              vtkIdType cellId;
+                              int subId;
+                              m_locator->FindClosestPoint( x, &m_closestPoints[3 * i], cell, cellId, subId,
+                                                           m_squaredDistances[i] );
+                          }
+                      } );
+}
+
+double PointToSurfaceICP::SelectInliers()
+{
+    // Keep the closest pairs, rejecting those above the trimming threshold
+    size_t numberOfPairs = m_squaredDistances.size();
+    size_t numberKept    = std::max( (size_t)1, (size_t)std::ceil( m_inlierFraction * numberOfPairs ) );
+    numberKept           = std::min( numberKept, numberOfPairs );
+
+    std::vector<double> sorted( m_squaredDistances );
+    std::nth_element( sorted.begin(), sorted.begin() + ( numberKept - 1 ), sorted.end() );
+    double threshold = sorted[numberKept - 1];
+    if( m_maximumDistance > 0.0 ) threshold = std::min( threshold, m_maximumDistance * m_maximumDistance );
+
+    // Ties at the threshold could exceed numberKept, keep the first ones
+    double sum        = 0.0;
+    m_numberOfInliers = 0;
+    for( size_t i = 0; i < numberOfPairs; ++i )
+    {
+        m_inliers[i] = m_squaredDistances[i] <= threshold && m_numberOfInliers < numberKept;
+        if( m_inliers[i] )
+        {
+            sum += m_squaredDistances[i];
+            ++m_numberOfInliers;
+        }
+    }
+    return m_numberOfInliers > 0 ? std::sqrt( sum / m_numberOfInliers ) : 0.0;
+}
+
+bool PointToSurfaceICP::ComputeRigidUpdate( double update[16] )
+{
+    double sourceCentroid[3] = { 0.0, 0.0, 0.0 };
+    double targetCentroid[3] = { 0.0, 0.0, 0.0 };
+    size_t numberOfPairs     = m_inliers.size();
+    for( size_t i = 0; i < numberOfPairs; ++i )
+    {
+        if( !m_inliers[i] ) continue;
+        for( int k = 0; k < 3; ++k )
+        {
+            sourceCentroid[k] += m_transformedPoints[3 * i + k];
+            targetCentroid[k] += m_closestPoints[3 * i + k];
+        }
+    }
+    for( int k = 0; k < 3; ++k )
+    {
+        sourceCentroid[k] /= m_numberOfInliers;
+        targetCentroid[k] /= m_numberOfInliers;
+    }
+
+    // Cross-covariance of the centered pairs
+    double M[3][3] = { { 0.0 } };
+    for( size_t i = 0; i < numberOfPairs; ++i )
+    {
+        if( !m_inliers[i] ) continue;
+        double a[3], b[3];
+        for( int k = 0; k < 3; ++k )
+        {
+            a[k] = m_transformedPoints[3 * i + k] - sourceCentroid[k];
+            b[k] = m_closestPoints[3 * i + k] - targetCentroid[k];
+        }
+        for( int r = 0; r < 3; ++r )
+        {
+            for( int c = 0; c < 3; ++c ) M[r][c] += a[r] * b[c];
+        }
+    }
+
+    // Horn's symmetric matrix, the rotation is the eigenvector of the largest eigenvalue
+    double N0[4], N1[4], N2[4], N3[4];
+    double * N[4] = { N0, N1, N2, N3 };
+    N0[0]         = M[0][0] + M[1][1] + M[2][2];
+    N1[1]         = M[0][0] - M[1][1] - M[2][2];
+    N2[2]         = -M[0][0] + M[1][1] - M[2][2];
+    N3[3]         = -M[0][0] - M[1][1] + M[2][2];
+    N0[1] = N1[0] = M[1][2] - M[2][1];
+    N0[2] = N2[0] = M[2][0] - M[0][2];
+    N0[3] = N3[0] = M[0][1] - M[1][0];
+    N1[2] = N2[1] = M[0][1] + M[1][0];
+    N1[3] = N3[1] = M[2][0] + M[0][2];
+    N2[3] = N3[2] = M[1][2] + M[2][1];
+
+    double eigenvalues[4];
+    double V0[4], V1[4], V2[4], V3[4];
+    double * V[4] = { V0, V1, V2, V3 };
+    if( !vtkMath::JacobiN( N, 4, eigenvalues, V ) ) return false;
+
+    // JacobiN sorts eigenvalues in decreasing order, eigenvectors are the columns of V
+    double quaternion[4] = { V0[0], V1[0], V2[0], V3[0] };
+    IbisRigidTransform::QuaternionToMatrix( quaternion, update );
+    for( int r = 0; r < 3; ++r )
+    {
+        update[4 * r + 3] = targetCentroid[r];
+        for( int c = 0; c < 3; ++c ) update[4 * r + 3] -= update[4 * r + c] * sourceCentroid[c];
+    }
+    return true;
+}
+
+bool PointToSurfaceICP::Run()
+{
+    m_numberOfIterations = 0;
+    m_numberOfInliers    = 0;
+    m_finalRMS           = 0.0;
+    m_finalTransform->DeepCopy( m_initialMatrix );
+
+    if( !m_locator || !m_sourcePoints || m_sourcePoints->GetNumberOfPoints() < 3 )
+    {
+        std::cerr << "PointToSurfaceICP: a target surface and at least 3 source points are needed." << std::endl;
+        return false;
+    }
+
+    this->SelectSourcePoints();
+
+    double matrix[16];
+    std::copy( m_initialMatrix, m_initialMatrix + 16, matrix );
+
+    // Each pass evaluates the current pose, so the last pass only measures the final RMS
+    double previousRMS = -1.0;
+    while( true )
+    {
+        this->FindCorrespondences( matrix );
+        m_finalRMS = this->SelectInliers();
+        if( m_numberOfInliers < 3 )
+        {
+            std::cerr << "PointToSurfaceICP: not enough point pairs, increase the maximum distance." << std::endl;
+            return false;
+        }
+
+        if( previousRMS >= 0.0 && std::fabs( previousRMS - m_finalRMS ) <= m_tolerance * previousRMS ) break;
+        if( m_numberOfIterations >= m_maximumNumberOfIterations ) break;
+        if( m_iterationCallback && m_numberOfIterations > 0 &&
+            !m_iterationCallback( m_numberOfIterations, m_finalRMS ) )
+            break;
+        previousRMS = m_finalRMS;
+
+        double update[16];
+        if( !this->ComputeRigidUpdate( update ) ) break;
+        IbisRigidTransform::Compose( update, matrix, matrix );
+        ++m_numberOfIterations;
+    }
+
+    m_finalTransform->DeepCopy( matrix );
+    return true;
+}
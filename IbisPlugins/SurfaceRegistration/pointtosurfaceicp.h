@@ -0,0 +1,112 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#ifndef POINTTOSURFACEICP_H
+#define POINTTOSURFACEICP_H
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <functional>
+#include <vector>
+
+class vtkMatrix4x4;
+class vtkPoints;
+class vtkPolyData;
+class vtkStaticCellLocator;
+
+// Description:
+// Rigid point-to-surface ICP. Source points (e.g. a tracked pointer sweep or a stereo
+// surface) are matched to the closest points of a triangulated target surface.
+// The closest point on the triangles is found with a vtkStaticCellLocator built once
+// when the target is set. Correspondences
+// are computed in parallel (vtkSMPTools), the worst pairs are rejected (trimmed ICP)
+// and the rigid update is the closed form solution of Horn (unit quaternions).
+// All computations are done in the coordinates of the target surface: the initial and
+// final transforms map source point coordinates to target surface coordinates.
+class PointToSurfaceICP
+{
+public:
+    // Called after each iteration with the iteration number and the RMS distance of the inliers.
+    // Returning false stops the registration.
+    typedef std::function<bool( unsigned int, double )> IterationCallbackType;
+
+    PointToSurfaceICP();
+    ~PointToSurfaceICP();
+
+    // Triangulates the surface and builds the search structures. Only needs to be
+    // called again if the target surface changes.
+    void SetTargetSurface( vtkPolyData * surface );
+    void SetSourcePoints( vtkPoints * points );
+    void SetInitialTransform( vtkMatrix4x4 * matrix );
+
+    void SetMaximumNumberOfIterations( unsigned int n ) { m_maximumNumberOfIterations = n; }
+    unsigned int GetMaximumNumberOfIterations() { return m_maximumNumberOfIterations; }
+    // Registration stops when the RMS distance changes by less than tolerance * RMS
+    void SetTolerance( double tolerance ) { m_tolerance = tolerance; }
+    double GetTolerance() { return m_tolerance; }
+    // Fraction of the closest pairs kept at each iteration, in ]0, 1]
+    void SetInlierFraction( double fraction ) { m_inlierFraction = fraction; }
+    double GetInlierFraction() { return m_inlierFraction; }
+    // Pairs further apart than this distance are always rejected, 0 means no limit
+    void SetMaximumDistance( double distance ) { m_maximumDistance = distance; }
+    double GetMaximumDistance() { return m_maximumDistance; }
+    // Randomly subsample the source when it has more points, 0 means use all points
+    void SetMaximumNumberOfPoints( unsigned int n ) { m_maximumNumberOfPoints = n; }
+    unsigned int GetMaximumNumberOfPoints() { return m_maximumNumberOfPoints; }
+    void SetSeed( unsigned int seed ) { m_seed = seed; }
+
+    void SetIterationCallback( IterationCallbackType callback ) { m_iterationCallback = callback; }
+
+    // Returns false if the inputs are invalid or if not enough pairs were found
+    bool Run();
+
+    vtkMatrix4x4 * GetFinalTransform();
+    double GetFinalRMS() { return m_finalRMS; }
+    unsigned int GetNumberOfIterations() { return m_numberOfIterations; }
+    unsigned int GetNumberOfInliers() { return m_numberOfInliers; }
+
+private:
+    void SelectSourcePoints();
+    void FindCorrespondences( const double matrix[16] );
+    double SelectInliers();
+    bool ComputeRigidUpdate( double update[16] );
+
+    // Target surface
+    vtkSmartPointer<vtkPolyData> m_surface;
+    vtkSmartPointer<vtkStaticCellLocator> m_locator;
+
+    // Source
+    vtkSmartPointer<vtkPoints> m_sourcePoints;
+    std::vector<double> m_selectedPoints;
+    double m_initialMatrix[16];
+
+    // Per point buffers, reused between iterations
+    std::vector<double> m_transformedPoints;
+    std::vector<double> m_closestPoints;
+    std::vector<double> m_squaredDistances;
+    std::vector<unsigned char> m_inliers;
+
+    unsigned int m_maximumNumberOfIterations;
+    double m_tolerance;
+    double m_inlierFraction;
+    double m_maximumDistance;
+    unsigned int m_maximumNumberOfPoints;
+    unsigned int m_seed;
+    IterationCallbackType m_iterationCallback;
+
+    vtkSmartPointer<vtkMatrix4x4> m_finalTransform;
+    double m_finalRMS;
+    unsigned int m_numberOfIterations;
+    unsigned int m_numberOfInliers;
+};
+
+#endif
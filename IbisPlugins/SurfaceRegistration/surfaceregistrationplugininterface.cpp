@@ -0,0 +1,125 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#include "surfaceregistrationplugininterface.h"
+
+#include <vtkMatrix4x4.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <QtPlugin>
+#include <iostream>
+
+#include "ibisapi.h"
+#include "pointcloudobject.h"
+#include "pointsobject.h"
+#include "pointtosurfaceicp.h"
+#include "polydataobject.h"
+#include "surfaceregistrationwidget.h"
+
+SurfaceRegistrationPluginInterface::SurfaceRegistrationPluginInterface() {}
+
+SurfaceRegistrationPluginInterface::~SurfaceRegistrationPluginInterface() {}
+
+bool SurfaceRegistrationPluginInterface::CanRun() { return true; }
+
+QWidget * SurfaceRegistrationPluginInterface::CreateFloatingWidget()
+{
+    SurfaceRegistrationWidget * widget = new SurfaceRegistrationWidget;
+    widget->SetPluginInterface( this );
+    return widget;
+}
+
+bool SurfaceRegistrationPluginInterface::RunBatchOperation( const QString & operation,
+                                                            const QMap<QString, QString> & args )
+{
+    IbisAPI * ibisAPI = GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+    SceneObject * sourceObject    = ibisAPI->GetObjectByName( args.value( "source" ) );
+    PolyDataObject * targetObject = PolyDataObject::SafeDownCast( ibisAPI->GetObjectByName( args.value( "target" ) ) );
+    SceneObject * transformObject = sourceObject;
+    if( args.contains( "transform" ) ) transformObject = ibisAPI->GetObjectByName( args["transform"] );
+    vtkPoints * sourcePoints = GetSourcePoints( sourceObject );
+    if( !sourcePoints || sourcePoints->GetNumberOfPoints() < 3 || !targetObject || !targetObject->GetPolyData() ||
+        !transformObject )
+    {
+        ibisAPI->Warning( "Point to Surface Registration",
+                          "Register needs source points (at least 3), a target surface and a transform object." );
+        return false;
+    }
+
+    PointToSurfaceICP icp;
+    icp.SetTargetSurface( targetObject->GetPolyData() );
+    if( args.contains( "iterations" ) ) icp.SetMaximumNumberOfIterations( args["iterations"].toUInt() );
+    if( args.contains( "inliers" ) ) icp.SetInlierFraction( args["inliers"].toDouble() / 100.0 );
+    if( args.contains( "distance" ) ) icp.SetMaximumDistance( args["distance"].toDouble() );
+    if( args.contains( "points" ) ) icp.SetMaximumNumberOfPoints( args["points"].toUInt() );
+    if( !Register( icp, sourceObject, targetObject, transformObject ) )
+    {
+        ibisAPI->Warning( "Point to Surface Registration", "Registration failed" );
+        return false;
+    }
+    std::cout << "RMS " << icp.GetFinalRMS() << " mm on " << icp.GetNumberOfInliers() << " points, "
+              << icp.GetNumberOfIterations() << " iterations" << std::endl;
+    return true;
+}
+
+vtkPoints * SurfaceRegistrationPluginInterface::GetSourcePoints( SceneObject * source )
+{
+    if( PointCloudObject * pointCloud = PointCloudObject::SafeDownCast( source ) )
+        return pointCloud->GetPointCloudArray();
+    if( PointsObject * points = PointsObject::SafeDownCast( source ) ) return points->GetPoints();
+    return nullptr;
+}
+
+bool SurfaceRegistrationPluginInterface::Register( PointToSurfaceICP & icp, SceneObject * sourceObject,
+                                                   PolyDataObject * targetObject, SceneObject * transformObject )
+{
+    // ICP works in target surface coordinates: initial = target^-1 * source
+    vtkSmartPointer<vtkMatrix4x4> sourceWorld = vtkSmartPointer<vtkMatrix4x4>::New();
+    sourceWorld->DeepCopy( sourceObject->GetWorldTransform()->GetMatrix() );
+    vtkSmartPointer<vtkMatrix4x4> targetWorld = vtkSmartPointer<vtkMatrix4x4>::New();
+    targetWorld->DeepCopy( targetObject->GetWorldTransform()->GetMatrix() );
+    vtkSmartPointer<vtkMatrix4x4> targetWorldInverse = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert( targetWorld, targetWorldInverse );
+    vtkSmartPointer<vtkMatrix4x4> initial = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4( targetWorldInverse, sourceWorld, initial );
+
+    icp.SetSourcePoints( GetSourcePoints( sourceObject ) );
+    icp.SetInitialTransform( initial );
+    if( !icp.Run() ) return false;
+
+    // Correction in world coordinates: W = target * final * source^-1
+    vtkSmartPointer<vtkMatrix4x4> sourceWorldInverse = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert( sourceWorld, sourceWorldInverse );
+    vtkSmartPointer<vtkMatrix4x4> correction = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4( targetWorld, icp.GetFinalTransform(), correction );
+    vtkMatrix4x4::Multiply4x4( correction, sourceWorldInverse, correction );
+
+    // Apply it to the transform object: local' = parent^-1 * W * parent * local
+    vtkSmartPointer<vtkMatrix4x4> parentWorld = vtkSmartPointer<vtkMatrix4x4>::New();
+    if( transformObject->GetParent() )
+        parentWorld->DeepCopy( transformObject->GetParent()->GetWorldTransform()->GetMatrix() );
+    vtkSmartPointer<vtkMatrix4x4> parentWorldInverse = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert( parentWorld, parentWorldInverse );
+    vtkSmartPointer<vtkMatrix4x4> local = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Multiply4x4( parentWorldInverse, correction, local );
+    vtkMatrix4x4::Multiply4x4( local, parentWorld, local );
+    vtkMatrix4x4::Multiply4x4( local, transformObject->GetLocalTransform()->GetMatrix(), local );
+
+    transformObject->StartModifyingTransform();
+    transformObject->GetLocalTransform()->SetMatrix( local );
+    transformObject->GetLocalTransform()->Modified();
+    transformObject->FinishModifyingTransform();
+    return true;
+}
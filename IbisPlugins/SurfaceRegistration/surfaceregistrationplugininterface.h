@@ -0,0 +1,52 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef SURFACEREGISTRATIONPLUGININTERFACE_H
+#define SURFACEREGISTRATIONPLUGININTERFACE_H
+
+#include "toolplugininterface.h"
+
+class PointToSurfaceICP;
+class PolyDataObject;
+class SceneObject;
+class SurfaceRegistrationWidget;
+class vtkPoints;
+
+class SurfaceRegistrationPluginInterface : public ToolPluginInterface
+{
+    Q_OBJECT
+    Q_INTERFACES( IbisPlugin )
+    Q_PLUGIN_METADATA( IID "Ibis.SurfaceRegistrationPluginInterface" )
+
+public:
+    vtkTypeMacro( SurfaceRegistrationPluginInterface, ToolPluginInterface );
+
+    SurfaceRegistrationPluginInterface();
+    ~SurfaceRegistrationPluginInterface();
+    virtual QString GetPluginName() override { return QString( "SurfaceRegistration" ); }
+    bool CanRun() override;
+    QString GetMenuEntryString() override { return QString( "Point to Surface Registration" ); }
+
+    QWidget * CreateFloatingWidget() override;
+
+    // Batch processing: Register:source=<name>,target=<name>[,transform=<name>,iterations=<n>,inliers=<percent>,
+    // distance=<mm>,points=<n>]. The transform object defaults to the source.
+    QStringList GetBatchOperations() override { return QStringList() << "Register"; }
+    bool RunBatchOperation( const QString & operation, const QMap<QString, QString> & args ) override;
+
+    // Points of a PointCloudObject or PointsObject, nullptr for other objects
+    static vtkPoints * GetSourcePoints( SceneObject * source );
+    // Run icp from the points of source to the surface of target, the target surface has to be set
+    // already. On success, the correction is applied to the local transform of transformObject.
+    bool Register( PointToSurfaceICP & icp, SceneObject * source, PolyDataObject * target,
+                   SceneObject * transformObject );
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+
+#include "surfaceregistrationwidget.h"
+
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <QElapsedTimer>
+#include <QMessageBox>
+
+#include "ibisapi.h"
+#include "polydataobject.h"
+#include "surfaceregistrationplugininterface.h"
+#include "ui_surfaceregistrationwidget.h"
+
+SurfaceRegistrationWidget::SurfaceRegistrationWidget( QWidget * parent )
+    : QWidget( parent ), ui( new Ui::SurfaceRegistrationWidget ), m_pluginInterface( 0 ), m_icpTargetId( -1 ),
+      m_icpTargetMTime( 0 )
+{
+    ui->setupUi( this );
+    setWindowTitle( "Point to Surface Registration" );
+}
+
+SurfaceRegistrationWidget::~SurfaceRegistrationWidget() { delete ui; }
+
+void SurfaceRegistrationWidget::SetPluginInterface( SurfaceRegistrationPluginInterface * ifc )
+{
+    m_pluginInterface = ifc;
+    IbisAPI * ibisAPI = m_pluginInterface->GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+    connect( ibisAPI, SIGNAL( ObjectAdded( int ) ), this, SLOT( OnObjectAdded( int ) ) );
+    connect( ibisAPI, SIGNAL( ObjectRemoved( int ) ), this, SLOT( OnObjectRemoved( int ) ) );
+    UpdateUi();
+}
+
+void SurfaceRegistrationWidget::on_startButton_clicked()
+{
+    int sourceId          = ui->sourceComboBox->itemData( ui->sourceComboBox->currentIndex() ).toInt();
+    int targetId          = ui->targetComboBox->itemData( ui->targetComboBox->currentIndex() ).toInt();
+    int transformObjectId =
+        ui->transformObjectComboBox->itemData( ui->transformObjectComboBox->currentIndex() ).toInt();
+    if( sourceId == -1 || targetId == -1 || transformObjectId == -1 )
+    {
+        QMessageBox::information( this, "Point to Surface Registration",
+                                  "Need to specify source points, target surface and Transform Object before "
+                                  "processing" );
+        return;
+    }
+
+    IbisAPI * ibisAPI = m_pluginInterface->GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+    SceneObject * sourceObject    = ibisAPI->GetObjectByID( sourceId );
+    PolyDataObject * targetObject = PolyDataObject::SafeDownCast( ibisAPI->GetObjectByID( targetId ) );
+    SceneObject * transformObject = ibisAPI->GetObjectByID( transformObjectId );
+    Q_ASSERT_X( sourceObject && targetObject && transformObject, "SurfaceRegistrationWidget::on_startButton_clicked()",
+                "Invalid object" );
+
+    vtkPoints * sourcePoints = SurfaceRegistrationPluginInterface::GetSourcePoints( sourceObject );
+    vtkPolyData * surface    = targetObject->GetPolyData();
+    if( !sourcePoints || sourcePoints->GetNumberOfPoints() < 3 || !surface )
+    {
+        QMessageBox::information( this, "Point to Surface Registration",
+                                  "Source needs at least 3 points and target must have a surface." );
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if( targetId != m_icpTargetId || surface->GetMTime() != m_icpTargetMTime )
+    {
+        m_icp.SetTargetSurface( surface );
+        m_icpTargetId    = targetId;
+        m_icpTargetMTime = surface->GetMTime();
+    }
+
+    m_icp.SetMaximumNumberOfIterations( ui->iterationsSpinBox->value() );
+    m_icp.SetInlierFraction( ui->inlierPercentSpinBox->value() / 100.0 );
+    m_icp.SetMaximumDistance( ui->maximumDistanceSpinBox->value() );
+    m_icp.SetMaximumNumberOfPoints( ui->maximumPointsSpinBox->value() );
+    if( !m_pluginInterface->Register( m_icp, sourceObject, targetObject, transformObject ) )
+    {
+        ui->userFeedbackLabel->setText( "Registration failed" );
+        return;
+    }
+
+    QString feedbackString = QString( "RMS %1 mm on %2 points, %3 iterations in %4 secs" )
+                                 .arg( m_icp.GetFinalRMS(), 0, 'f', 3 )
+                                 .arg( m_icp.GetNumberOfInliers() )
+                                 .arg( m_icp.GetNumberOfIterations() )
+                                 .arg( qreal( timer.elapsed() ) / 1000.0 );
+    ui->userFeedbackLabel->setText( feedbackString );
+}
+
+void SurfaceRegistrationWidget::UpdateUi()
+{
+    ui->sourceComboBox->clear();
+    ui->targetComboBox->clear();
+
+    IbisAPI * ibisAPI = m_pluginInterface->GetIbisAPI();
+    Q_ASSERT( ibisAPI );
+    const QList<SceneObject *> & allObjects = ibisAPI->GetAllObjects();
+    for( int i = 0; i < allObjects.size(); ++i )
+    {
+        SceneObject * current = allObjects[i];
+        if( current != ibisAPI->GetSceneRoot() && current->IsListable() && !current->IsManagedByTracker() )
+        {
+            if( current->IsA( "PointCloudObject" ) || current->IsA( "PointsObject" ) )
+                ui->sourceComboBox->addItem( current->GetName(), QVariant( current->GetObjectID() ) );
+            else if( current->IsA( "PolyDataObject" ) )
+                ui->targetComboBox->addItem( current->GetName(), QVariant( current->GetObjectID() ) );
+        }
+    }
+
+    if( ui->sourceComboBox->count() == 0 ) ui->sourceComboBox->addItem( "None", QVariant( -1 ) );
+    if( ui->targetComboBox->count() == 0 ) ui->targetComboBox->addItem( "None", QVariant( -1 ) );
+    UpdateTransformObjects();
+}
+
+void SurfaceRegistrationWidget::UpdateTransformObjects()
+{
+    ui->transformObjectComboBox->clear();
+    int sourceId = ui->sourceComboBox->itemData( ui->sourceComboBox->currentIndex() ).toInt();
+    if( sourceId != -1 )
+    {
+        IbisAPI * ibisAPI = m_pluginInterface->GetIbisAPI();
+        Q_ASSERT( ibisAPI );
+        SceneObject * sourceObject = ibisAPI->GetObjectByID( sourceId );
+        if( sourceObject->CanEditTransformManually() )
+            ui->transformObjectComboBox->addItem( sourceObject->GetName(), QVariant( sourceId ) );
+        if( sourceObject->GetParent() && sourceObject->GetParent() != ibisAPI->GetSceneRoot() &&
+            sourceObject->GetParent()->CanEditTransformManually() )
+            ui->transformObjectComboBox->addItem( sourceObject->GetParent()->GetName(),
+                                                  QVariant( sourceObject->GetParent()->GetObjectID() ) );
+    }
+    if( ui->transformObjectComboBox->count() == 0 ) ui->transformObjectComboBox->addItem( "None", QVariant( -1 ) );
+}
+
+void SurfaceRegistrationWidget::on_sourceComboBox_activated( int index ) { UpdateTransformObjects(); }
+
+void SurfaceRegistrationWidget::OnObjectAdded( int objectId ) { UpdateUi(); }
+
+void SurfaceRegistrationWidget::OnObjectRemoved( int objectId )
+{
+    if( objectId == m_icpTargetId )
+    {
+        m_icp.SetTargetSurface( nullptr );
+        m_icpTargetId = -1;
+    }
+    UpdateUi();
+}
@@ -0,0 +1,57 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#ifndef SURFACEREGISTRATIONWIDGET_H
+#define SURFACEREGISTRATIONWIDGET_H
+
+#include <vtkType.h>
+
+#include <QWidget>
+
+#include "pointtosurfaceicp.h"
+
+class SurfaceRegistrationPluginInterface;
+
+namespace Ui
+{
+class SurfaceRegistrationWidget;
+}
+
+class SurfaceRegistrationWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SurfaceRegistrationWidget( QWidget * parent = 0 );
+    ~SurfaceRegistrationWidget();
+
+    void SetPluginInterface( SurfaceRegistrationPluginInterface * ifc );
+
+private:
+    void UpdateUi();
+    void UpdateTransformObjects();
+
+    Ui::SurfaceRegistrationWidget * ui;
+    SurfaceRegistrationPluginInterface * m_pluginInterface;
+
+    // Kept between runs so that the target search structures are only built once per surface
+    PointToSurfaceICP m_icp;
+    int m_icpTargetId;
+    vtkMTimeType m_icpTargetMTime;
+
+private slots:
+
+    void on_startButton_clicked();
+    void on_sourceComboBox_activated( int index );
+    void OnObjectAdded( int objectId );
+    void OnObjectRemoved( int objectId );
+};
+
+#endif
@@ -1163,6 +1163,7 @@ size_t vtkMultiImagePlaneWidget::AddInput( vtkImageData * in, vtkScalarsToColors
         inObjects.Texture->SetInterpolate( this->TextureInterpolate );
     else
         inObjects.Texture->SetInterpolate( 0 );
+    inObjects.Texture->SetMipmap( inObjects.Texture->GetInterpolate() != 0 );
     inObjects.Texture->SetColorModeToDirectScalars();
     inObjects.Texture->SetBlendingMode( vtkTexture::VTK_TEXTURE_BLENDING_MODE_ADD );
     inObjects.Texture->RepeatOff();
@@ -1606,6 +1607,7 @@ void vtkMultiImagePlaneWidget::SetTextureInterpolate( int interpolate )
             in.Texture->SetInterpolate( this->TextureInterpolate );
         else
             in.Texture->SetInterpolate( 0 );
+        in.Texture->SetMipmap( in.Texture->GetInterpolate() != 0 );
     }
 
     this->Modified();
@@ -235,8 +235,9 @@ public:
     // Description:
     // Specify whether to interpolate the texture or not. When off, the
     // reslice interpolation is nearest neighbour regardless of how the
-    // interpolation is set through the API. Set before setting the
-    // vtkImageData imput. Default is On.
+    // interpolation is set through the API. Interpolated textures are
+    // mipmapped: zoomed out planes are sampled from a pyramid of the
+    // resliced image. Set before setting the vtkImageData imput. Default is On.
     void SetTextureInterpolate( int );
     vtkGetMacro( TextureInterpolate, int );
     vtkBooleanMacro( TextureInterpolate, int );
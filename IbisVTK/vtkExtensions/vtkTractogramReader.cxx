@@ -0,0 +1,792 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+#define _CRT_SECURE_NO_WARNINGS
+#include "vtkTractogramReader.h"
+
+#include <vtkByteSwap.h>
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+vtkStandardNewMacro( vtkTractogramReader );
+
+namespace
+{
+// TrackVis and MRtrix files are read in blocks of this size, a block grows if a streamline doesn't fit
+const size_t BlockSize = 64 << 20;
+
+// Streamline in memory: address of its first point and number of points
+struct Record
+{
+    const char * data;
+    vtkIdType nbPoints;
+};
+
+// Number of points of a streamline of nb points kept with one point out of step, the last point is always kept
+inline vtkIdType NumberOfKeptPoints( vtkIdType nb, int step ) { return nb > 0 ? ( nb - 2 + step ) / step + 1 : 0; }
+
+long long GetFileSize( FILE * in )
+{
+#ifdef _WIN32
+    _fseeki64( in, 0, SEEK_END );
+    long long size = _ftelli64( in );
+#else
+    fseeko( in, 0, SEEK_END );
+    long long size = ftello( in );
+#endif
+    fseek( in, 0, SEEK_SET );
+    return size;
+}
+
+// Big endian values of legacy vtk files to native byte order
+template <class T>
+void SwapBigEndian( T * values, vtkIdType nb )
+{
+    vtkSMPTools::For( 0, nb, [values]( vtkIdType begin, vtkIdType end ) {
+        if( sizeof( T ) == 4 )
+            vtkByteSwap::Swap4BERange( values + begin, end - begin );
+        else
+            vtkByteSwap::Swap8BERange( values + begin, end - begin );
+    } );
+}
+
+//------------------------------------------------------------
+// Sequential read of a file in blocks. The bytes of a block that
+// are not consumed are moved to the beginning of the next one.
+//------------------------------------------------------------
+class Block
+{
+public:
+    Block( FILE * in, long long position ) : File( in ), Length( 0 ), Position( position )
+    {
+        this->Data.resize( BlockSize );
+    }
+
+    // Keep the bytes from consumed on and fill the block, return false when nothing more could be read
+    bool Next( size_t consumed )
+    {
+        size_t left = this->Length - consumed;
+        memmove( this->Data.data(), this->Data.data() + consumed, left );
+        if( left == this->Data.size() ) this->Data.resize( 2 * this->Data.size() );
+        size_t read = fread( this->Data.data() + left, 1, this->Data.size() - left, this->File );
+        this->Length = left + read;
+        this->Position += read;
+        return read > 0;
+    }
+
+    const char * Begin() { return this->Data.data(); }
+    size_t Size() { return this->Length; }
+    // Position in the file of the end of the block
+    long long GetPosition() { return this->Position; }
+
+private:
+    FILE * File;
+    std::vector<char> Data;
+    size_t Length;
+    long long Position;
+};
+
+//------------------------------------------------------------
+// Legacy vtk file loaded in memory. Ascii values are parsed in
+// place, binary values are big endian.
+//------------------------------------------------------------
+class LegacyInput
+{
+public:
+    LegacyInput() : Binary( false ), Pos( nullptr ), End( nullptr ) {}
+
+    bool Load( FILE * in, long long size )
+    {
+        if( size <= 0 ) return false;
+        this->Buffer.resize( size );
+        if( fread( this->Buffer.data(), 1, size, in ) != static_cast<size_t>( size ) ) return false;
+        this->Pos = this->Buffer.data();
+        this->End = this->Pos + size;
+        return true;
+    }
+
+    bool NextWord( std::string & word )
+    {
+        while( this->Pos < this->End && IsSpace( *this->Pos ) ) ++this->Pos;
+        const char * begin = this->Pos;
+        while( this->Pos < this->End && !IsSpace( *this->Pos ) ) ++this->Pos;
+        word.assign( begin, this->Pos );
+        return !word.empty();
+    }
+
+    // Binary data starts after the end of the line of its keyword
+    void SkipLine()
+    {
+        while( this->Pos < this->End && *this->Pos != '\n' ) ++this->Pos;
+        if( this->Pos < this->End ) ++this->Pos;
+    }
+
+    // Counts of the keyword lines are in ascii in binary files too
+    template <class T>
+    bool ReadCount( T & value )
+    {
+        while( this->Pos < this->End && IsSpace( *this->Pos ) ) ++this->Pos;
+        std::from_chars_result res = std::from_chars( this->Pos, this->End, value );
+        this->Pos                  = res.ptr;
+        return res.ec == std::errc();
+    }
+
+    template <class T>
+    bool ReadValues( T * values, vtkIdType nb )
+    {
+        if( this->Binary )
+        {
+            if( nb < 0 || static_cast<size_t>( nb ) * sizeof( T ) > static_cast<size_t>( this->End - this->Pos ) )
+                return false;
+            memcpy( values, this->Pos, nb * sizeof( T ) );
+            SwapBigEndian( values, nb );
+            this->Pos += nb * sizeof( T );
+            return true;
+        }
+        for( vtkIdType i = 0; i < nb; ++i )
+        {
+            while( this->Pos < this->End && IsSpace( *this->Pos ) ) ++this->Pos;
+            if( !this->ParseValue( values[i] ) ) return false;
+        }
+        return true;
+    }
+
+    template <class T>
+    bool ParseValue( T & value )
+    {
+#ifndef __cpp_lib_to_chars
+        // Floating point std::from_chars is missing from some standard libraries (e.g. Apple libc++),
+        // parse the word with a stream in the classic locale instead.
+        if constexpr( std::is_floating_point<T>::value )
+        {
+            const char * wordEnd = this->Pos;
+            while( wordEnd < this->End && !IsSpace( *wordEnd ) ) ++wordEnd;
+            std::istringstream stream( std::string( this->Pos, wordEnd ) );
+            stream.imbue( std::locale::classic() );
+            stream >> value;
+            if( stream.fail() ) return false;
+            this->Pos = stream.eof() ? wordEnd : this->Pos + static_cast<std::ptrdiff_t>( stream.tellg() );
+            return true;
+        }
+        else
+#endif
+        {
+            std::from_chars_result res = std::from_chars( this->Pos, this->End, value );
+            if( res.ec != std::errc() ) return false;
+            this->Pos = res.ptr;
+            return true;
+        }
+    }
+
+    // Skip lines up to an empty line, the end of METADATA
+    void SkipToEmptyLine()
+    {
+        while( this->Pos < this->End )
+        {
+            this->SkipLine();
+            const char * p = this->Pos;
+            while( p < this->End && ( *p == ' ' || *p == '\t' || *p == '\r' ) ) ++p;
+            if( p >= this->End || *p == '\n' ) return;
+        }
+    }
+
+    // True if a line after the current position starts with keyword
+    bool HasLineStartingWith( const std::string & keyword )
+    {
+        std::string pattern = "\n" + keyword;
+        const char * found  = std::search( this->Pos, this->End, pattern.begin(), pattern.end() );
+        return found != this->End;
+    }
+
+    // Save and restore the position to look ahead
+    const char * Tell() { return this->Pos; }
+    void Seek( const char * pos ) { this->Pos = pos; }
+
+    bool Binary;
+
+private:
+    static bool IsSpace( char c ) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    std::vector<char> Buffer;
+    const char * Pos;
+    const char * End;
+};
+
+// Points of POINTS as floats
+bool ReadLegacyPoints( LegacyInput & in, std::vector<float> & points )
+{
+    vtkIdType nb = 0;
+    std::string type;
+    if( !in.ReadCount( nb ) || nb < 0 || !in.NextWord( type ) ) return false;
+    in.SkipLine();
+    points.resize( 3 * nb );
+    if( type == "float" ) return in.ReadValues( points.data(), 3 * nb );
+    if( type != "double" ) return false;
+    std::vector<double> values( 3 * nb );
+    if( !in.ReadValues( values.data(), 3 * nb ) ) return false;
+    vtkSMPTools::For( 0, 3 * nb, [&]( vtkIdType begin, vtkIdType end ) {
+        for( vtkIdType i = begin; i < end; ++i ) points[i] = static_cast<float>( values[i] );
+    } );
+    return true;
+}
+
+// Array of OFFSETS or CONNECTIVITY, introduced in version 5.1
+bool ReadLegacyIds( LegacyInput & in, const char * keyword, vtkIdType nb, std::vector<vtkIdType> & ids )
+{
+    std::string word, type;
+    if( !in.NextWord( word ) || word != keyword || !in.NextWord( type ) ) return false;
+    in.SkipLine();
+    ids.resize( nb );
+    if( type == "vtktypeint64" )
+    {
+        std::vector<vtkTypeInt64> values( nb );
+        if( !in.ReadValues( values.data(), nb ) ) return false;
+        std::copy( values.begin(), values.end(), ids.begin() );
+        return true;
+    }
+    if( type == "vtktypeint32" )
+    {
+        std::vector<vtkTypeInt32> values( nb );
+        if( !in.ReadValues( values.data(), nb ) ) return false;
+        std::copy( values.begin(), values.end(), ids.begin() );
+        return true;
+    }
+    return false;
+}
+
+// Cells of LINES, VERTICES, POLYGONS or TRIANGLE_STRIPS as offsets and point ids
+bool ReadLegacyCells( LegacyInput & in, std::vector<vtkIdType> & offsets, std::vector<vtkIdType> & connectivity )
+{
+    vtkIdType nb, size;
+    if( !in.ReadCount( nb ) || !in.ReadCount( size ) || nb < 0 || size < 0 ) return false;
+    in.SkipLine();
+
+    const char * pos = in.Tell();
+    std::string word;
+    if( in.NextWord( word ) && word == "OFFSETS" )
+    {
+        in.Seek( pos );
+        if( !ReadLegacyIds( in, "OFFSETS", nb, offsets ) || !ReadLegacyIds( in, "CONNECTIVITY", size, connectivity ) )
+            return false;
+    }
+    else
+    {
+        // number of points of a cell followed by its point ids
+        in.Seek( pos );
+        std::vector<vtkTypeInt32> values( size );
+        if( !in.ReadValues( values.data(), size ) ) return false;
+        offsets.assign( 1, 0 );
+        connectivity.clear();
+        connectivity.reserve( std::max<vtkIdType>( 0, size - nb ) );
+        for( vtkIdType i = 0; i < size; i += values[i] + 1 )
+        {
+            if( values[i] < 0 || i + values[i] >= size ) return false;
+            connectivity.insert( connectivity.end(), values.begin() + i + 1, values.begin() + i + 1 + values[i] );
+            offsets.push_back( connectivity.size() );
+        }
+    }
+    if( offsets.empty() || offsets.front() != 0 || offsets.back() != static_cast<vtkIdType>( connectivity.size() ) )
+        return false;
+    for( size_t i = 1; i < offsets.size(); ++i )
+        if( offsets[i] < offsets[i - 1] ) return false;
+    return true;
+}
+
+template <class ArrayType>
+void SetLines( vtkCellArray * lines, const std::vector<vtkIdType> & offsetValues )
+{
+    typedef typename ArrayType::ValueType ValueType;
+    vtkIdType nbPoints                      = offsetValues.back();
+    vtkSmartPointer<ArrayType> offsets      = vtkSmartPointer<ArrayType>::New();
+    vtkSmartPointer<ArrayType> connectivity = vtkSmartPointer<ArrayType>::New();
+    offsets->SetNumberOfValues( offsetValues.size() );
+    connectivity->SetNumberOfValues( nbPoints );
+    for( size_t i = 0; i < offsetValues.size(); ++i ) offsets->SetValue( i, static_cast<ValueType>( offsetValues[i] ) );
+
+    // points of a streamline are consecutive
+    ValueType * pointIds = connectivity->GetPointer( 0 );
+    vtkSMPTools::For( 0, nbPoints, [pointIds]( vtkIdType begin, vtkIdType end ) {
+        for( vtkIdType i = begin; i < end; ++i ) pointIds[i] = static_cast<ValueType>( i );
+    } );
+    lines->SetData( offsets, connectivity );
+}
+}  // namespace
+
+//------------------------------------------------------------
+// Points and streamline offsets of the output. Streamlines are
+// appended a block at a time, the points kept are decoded in
+// parallel directly in the output point array.
+//------------------------------------------------------------
+class vtkTractogramReader::Output
+{
+public:
+    Output( int pointStep ) : PointStep( pointStep )
+    {
+        this->Points = vtkSmartPointer<vtkFloatArray>::New();
+        this->Points->SetNumberOfComponents( 3 );
+        this->Offsets.push_back( 0 );
+    }
+
+    // stride: bytes between two points of a record.
+    // decode( const char * point, float * xyz ): convert a point of a record, called from several threads.
+    template <class Decoder>
+    void Append( const std::vector<Record> & records, size_t stride, const Decoder & decode )
+    {
+        size_t first = this->Offsets.size() - 1;
+        for( size_t i = 0; i < records.size(); ++i )
+        {
+            vtkIdType nb = NumberOfKeptPoints( records[i].nbPoints, this->PointStep );
+            this->Offsets.push_back( this->Offsets.back() + nb );
+        }
+        vtkIdType firstPoint = this->Offsets[first];
+        vtkIdType nbPoints   = this->Offsets.back() - firstPoint;
+        if( nbPoints == 0 ) return;
+
+        // grows the array geometrically
+        float * points            = this->Points->WritePointer( 3 * firstPoint, 3 * nbPoints );
+        const vtkIdType * offsets = this->Offsets.data() + first;
+        int step                  = this->PointStep;
+        vtkSMPTools::For( 0, static_cast<vtkIdType>( records.size() ), [&]( vtkIdType begin, vtkIdType end ) {
+            for( vtkIdType r = begin; r < end; ++r )
+            {
+                float * xyz    = points + 3 * ( offsets[r] - firstPoint );
+                vtkIdType last = records[r].nbPoints - 1;
+                vtkIdType nb   = offsets[r + 1] - offsets[r];
+                for( vtkIdType j = 0; j < nb; ++j, xyz += 3 )
+                    decode( records[r].data + std::min( j * step, last ) * stride, xyz );
+            }
+        } );
+    }
+
+    void Finish( vtkPolyData * output )
+    {
+        this->Points->Squeeze();
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        points->SetData( this->Points );
+        output->SetPoints( points );
+
+        // 32 bits ids when possible to save memory
+        vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+        if( this->Offsets.back() <= VTK_INT_MAX )
+            SetLines<vtkTypeInt32Array>( lines, this->Offsets );
+        else
+            SetLines<vtkTypeInt64Array>( lines, this->Offsets );
+        output->SetLines( lines );
+    }
+
+private:
+    int PointStep;
+    vtkSmartPointer<vtkFloatArray> Points;
+    std::vector<vtkIdType> Offsets;
+};
+
+vtkTractogramReader::vtkTractogramReader()
+{
+    this->SetNumberOfInputPorts( 0 );
+    this->FileName                  = NULL;
+    this->StreamlineStep            = 1;
+    this->PointStep                 = 1;
+    this->NumberOfStreamlinesInFile = 0;
+    this->HasAttributes             = false;
+    this->FileSize                  = 0;
+}
+
+vtkTractogramReader::~vtkTractogramReader() { this->SetFileName( NULL ); }
+
+vtkTractogramReader::FileType vtkTractogramReader::GetFileType( FILE * in )
+{
+    char magic[16] = { 0 };
+    size_t nb      = fread( magic, 1, sizeof( magic ) - 1, in );
+    fseek( in, 0, SEEK_SET );
+    if( nb >= 5 && strncmp( magic, "TRACK", 5 ) == 0 ) return TrackVisFile;
+    if( nb >= 13 && strncmp( magic, "mrtrix tracks", 13 ) == 0 ) return MRtrixFile;
+    if( nb >= 14 && strncmp( magic, "# vtk DataFile", 14 ) == 0 ) return LegacyVtkFile;
+    return UnknownFile;
+}
+
+int vtkTractogramReader::CanReadFile( const char * fname )
+{
+    FILE * in = fopen( fname, "rb" );
+    if( in == NULL ) return 0;
+    FileType type = this->GetFileType( in );
+    fclose( in );
+    return type == UnknownFile ? 0 : 1;
+}
+
+int vtkTractogramReader::RequestData( vtkInformation * vtkNotUsed( request ),
+                                      vtkInformationVector ** vtkNotUsed( inputVector ),
+                                      vtkInformationVector * outputVector )
+{
+    vtkInformation * outInfo = outputVector->GetInformationObject( 0 );
+    vtkPolyData * output     = vtkPolyData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+
+    // all of the data in the first piece.
+    if( outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER() ) > 0 ) return 0;
+
+    if( !this->FileName )
+    {
+        vtkErrorMacro( << "A FileName must be specified." );
+        return 0;
+    }
+
+    FILE * in = fopen( this->FileName, "rb" );
+    if( in == NULL )
+    {
+        vtkErrorMacro( << "File " << this->FileName << " not found" );
+        return 0;
+    }
+
+    this->NumberOfStreamlinesInFile = 0;
+    this->HasAttributes             = false;
+    this->FileSize                  = GetFileSize( in );
+    Output out( this->PointStep );
+    bool ok = false;
+    switch( this->GetFileType( in ) )
+    {
+        case LegacyVtkFile:
+            ok = this->ReadLegacyVtk( in, out );
+            break;
+        case TrackVisFile:
+            ok = this->ReadTrackVis( in, out );
+            break;
+        case MRtrixFile:
+            ok = this->ReadMRtrix( in, out );
+            break;
+        default:
+            vtkErrorMacro( << this->FileName << " is not a tractogram file." );
+            break;
+    }
+    fclose( in );
+
+    // Files with attributes are left to vtkPolyDataReader, the output stays empty
+    if( this->HasAttributes ) return 1;
+    if( !ok )
+    {
+        vtkErrorMacro( << "Invalid or truncated tractogram file " << this->FileName );
+        return 0;
+    }
+    out.Finish( output );
+    return 1;
+}
+
+bool vtkTractogramReader::IsStreamlineKept() { return this->NumberOfStreamlinesInFile++ % this->StreamlineStep == 0; }
+
+//------------------------------------------------------------
+// Legacy vtk polydata, streamlines are the cells of LINES.
+// Attributes (POINT_DATA, CELL_DATA) are not read, the read
+// stops before decoding the file when there are any.
+//------------------------------------------------------------
+bool vtkTractogramReader::ReadLegacyVtk( FILE * file, Output & out )
+{
+    LegacyInput in;
+    if( !in.Load( file, this->FileSize ) ) return false;
+    this->UpdateProgress( 0.2 );
+
+    // version and title lines
+    in.SkipLine();
+    in.SkipLine();
+    std::string word;
+    if( !in.NextWord( word ) || ( word != "ASCII" && word != "BINARY" ) ) return false;
+    in.Binary = word == "BINARY";
+
+    // Scalars and colours would be lost, look for attributes before decoding anything. A match in
+    // binary values only sends the file to vtkPolyDataReader.
+    if( in.HasLineStartingWith( "POINT_DATA" ) || in.HasLineStartingWith( "CELL_DATA" ) )
+    {
+        this->HasAttributes = true;
+        return false;
+    }
+
+    std::vector<float> points;
+    std::vector<vtkIdType> offsets, connectivity, otherOffsets, otherConnectivity;
+    while( in.NextWord( word ) )
+    {
+        if( word == "DATASET" )
+        {
+            if( !in.NextWord( word ) || word != "POLYDATA" ) return false;
+        }
+        else if( word == "POINTS" )
+        {
+            if( !ReadLegacyPoints( in, points ) ) return false;
+            this->UpdateProgress( 0.5 );
+        }
+        else if( word == "LINES" )
+        {
+            if( !ReadLegacyCells( in, offsets, connectivity ) ) return false;
+        }
+        else if( word == "VERTICES" || word == "POLYGONS" || word == "TRIANGLE_STRIPS" )
+        {
+            if( !ReadLegacyCells( in, otherOffsets, otherConnectivity ) ) return false;
+        }
+        else if( word == "METADATA" )
+        {
+            in.SkipToEmptyLine();
+        }
+        else if( word == "POINT_DATA" || word == "CELL_DATA" )
+        {
+            this->HasAttributes = true;
+            return false;
+        }
+        else
+        {
+            vtkErrorMacro( << "Unsupported section " << word << " in " << this->FileName );
+            return false;
+        }
+    }
+
+    vtkIdType nbPoints = static_cast<vtkIdType>( points.size() / 3 );
+    for( size_t i = 0; i < connectivity.size(); ++i )
+        if( connectivity[i] < 0 || connectivity[i] >= nbPoints ) return false;
+    this->UpdateProgress( 0.7 );
+
+    // records are the point ids of the streamlines
+    std::vector<Record> records;
+    for( size_t i = 0; i + 1 < offsets.size(); ++i )
+    {
+        if( !this->IsStreamlineKept() ) continue;
+        Record record = { reinterpret_cast<const char *>( connectivity.data() + offsets[i] ),
+                          offsets[i + 1] - offsets[i] };
+        records.push_back( record );
+    }
+    const float * coords = points.data();
+    out.Append( records, sizeof( vtkIdType ), [coords]( const char * id, float * xyz ) {
+        vtkIdType pointId;
+        memcpy( &pointId, id, sizeof( vtkIdType ) );
+        memcpy( xyz, coords + 3 * pointId, 3 * sizeof( float ) );
+    } );
+    return true;
+}
+
+//------------------------------------------------------------
+// TrackVis: 1000 bytes header, then for each streamline the
+// number of points, the points (x, y, z and n_scalars floats)
+// and n_properties floats. Points are in voxmm: millimeters
+// from the corner of the volume. Values are in the byte order
+// of the machine that wrote the file, detected with hdr_size.
+//------------------------------------------------------------
+bool vtkTractogramReader::ReadTrackVis( FILE * in, Output & out )
+{
+    char header[1000];
+    if( fread( header, 1, sizeof( header ), in ) != sizeof( header ) ) return false;
+
+    int headerSize;
+    memcpy( &headerSize, header + 996, 4 );
+    bool swap = headerSize != 1000;
+    if( swap )
+    {
+        vtkByteSwap::SwapVoidRange( &headerSize, 1, 4 );
+        if( headerSize != 1000 ) return false;
+    }
+
+    float voxelSize[3], voxelToRas[16];
+    short nbScalars, nbProperties;
+    memcpy( voxelSize, header + 12, sizeof( voxelSize ) );
+    memcpy( &nbScalars, header + 36, 2 );
+    memcpy( &nbProperties, header + 238, 2 );
+    memcpy( voxelToRas, header + 440, sizeof( voxelToRas ) );
+    if( swap )
+    {
+        vtkByteSwap::SwapVoidRange( voxelSize, 3, 4 );
+        vtkByteSwap::SwapVoidRange( &nbScalars, 1, 2 );
+        vtkByteSwap::SwapVoidRange( &nbProperties, 1, 2 );
+        vtkByteSwap::SwapVoidRange( voxelToRas, 16, 4 );
+    }
+    if( nbScalars < 0 || nbProperties < 0 ) return false;
+
+    // voxmm to RAS: ras = voxelToRas * ( voxmm / voxelSize - 0.5 )
+    bool toRas = voxelToRas[15] != 0;
+    float matrix[12];
+    for( int r = 0; r < 3 && toRas; ++r )
+    {
+        matrix[4 * r + 3] = voxelToRas[4 * r + 3];
+        for( int c = 0; c < 3; ++c )
+        {
+            matrix[4 * r + c] = voxelToRas[4 * r + c] / ( voxelSize[c] != 0 ? voxelSize[c] : 1.0f );
+            matrix[4 * r + 3] -= 0.5f * voxelToRas[4 * r + c];
+        }
+    }
+    auto decode = [swap, toRas, &matrix]( const char * point, float * xyz ) {
+        float p[3];
+        memcpy( p, point, sizeof( p ) );
+        if( swap ) vtkByteSwap::SwapVoidRange( p, 3, 4 );
+        for( int r = 0; r < 3; ++r )
+        {
+            const float * row = matrix + 4 * r;
+            xyz[r]            = toRas ? row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3] : p[r];
+        }
+    };
+
+    size_t pointSize      = ( 3 + nbScalars ) * sizeof( float );
+    size_t propertiesSize = nbProperties * sizeof( float );
+    Block block( in, sizeof( header ) );
+    size_t consumed = 0;
+    std::vector<Record> records;
+    while( block.Next( consumed ) )
+    {
+        const char * data = block.Begin();
+        size_t size       = block.Size();
+        consumed          = 0;
+        records.clear();
+        while( consumed + 4 <= size )
+        {
+            int nb;
+            memcpy( &nb, data + consumed, 4 );
+            if( swap ) vtkByteSwap::SwapVoidRange( &nb, 1, 4 );
+            if( nb < 0 ) return false;
+            size_t recordSize = 4 + nb * pointSize + propertiesSize;
+            if( consumed + recordSize > size ) break;
+            if( this->IsStreamlineKept() )
+            {
+                Record record = { data + consumed + 4, nb };
+                records.push_back( record );
+            }
+            consumed += recordSize;
+        }
+        out.Append( records, pointSize, decode );
+        this->UpdateProgress( static_cast<double>( block.GetPosition() ) / this->FileSize );
+    }
+    // unconsumed bytes left at the end of the file are an incomplete streamline
+    return block.Size() == 0;
+}
+
+//------------------------------------------------------------
+// MRtrix: text header ending with END, the data starts at the
+// offset given by the file key. Points are triplets of floats
+// in RAS millimeters, streamlines end with a triplet of NaN and
+// the file ends with a triplet of Inf.
+//------------------------------------------------------------
+bool vtkTractogramReader::ReadMRtrix( FILE * in, Output & out )
+{
+    char line[4096];
+    long long offset = -1;
+    std::string dataType;
+    if( !fgets( line, sizeof( line ), in ) ) return false;
+    while( fgets( line, sizeof( line ), in ) )
+    {
+        std::string text( line );
+        text.erase( text.find_last_not_of( " \r\n" ) + 1 );
+        if( text == "END" ) break;
+        size_t colon = text.find( ':' );
+        if( colon == std::string::npos ) continue;
+        size_t start      = text.find_first_not_of( ' ', colon + 1 );
+        std::string key   = text.substr( 0, colon );
+        std::string value = start == std::string::npos ? std::string() : text.substr( start );
+        if( key == "file" && value.size() > 2 && value[0] == '.' )
+            std::from_chars( value.data() + 2, value.data() + value.size(), offset );
+        else if( key == "datatype" )
+            dataType = value;
+    }
+    if( offset < 0 || fseek( in, static_cast<long>( offset ), SEEK_SET ) != 0 ) return false;
+
+    bool bigEndian = dataType == "Float32BE" || dataType == "Float64BE";
+    bool isDouble  = dataType == "Float64LE" || dataType == "Float64BE";
+    if( !isDouble && dataType != "Float32LE" && dataType != "Float32BE" ) return false;
+    auto decode = [bigEndian, isDouble]( const char * point, float * xyz ) {
+        if( isDouble )
+        {
+            double p[3];
+            memcpy( p, point, sizeof( p ) );
+            if( bigEndian )
+                vtkByteSwap::Swap8BERange( p, 3 );
+            else
+                vtkByteSwap::Swap8LERange( p, 3 );
+            for( int i = 0; i < 3; ++i ) xyz[i] = static_cast<float>( p[i] );
+        }
+        else
+        {
+            memcpy( xyz, point, 3 * sizeof( float ) );
+            if( bigEndian )
+                vtkByteSwap::Swap4BERange( xyz, 3 );
+            else
+                vtkByteSwap::Swap4LERange( xyz, 3 );
+        }
+    };
+
+    size_t pointSize = 3 * ( isDouble ? sizeof( double ) : sizeof( float ) );
+    Block block( in, offset );
+    size_t consumed = 0;
+    bool finished   = false;
+    std::vector<Record> records;
+    while( !finished && block.Next( consumed ) )
+    {
+        const char * data   = block.Begin();
+        vtkIdType nbPoints  = static_cast<vtkIdType>( block.Size() / pointSize );
+        vtkIdType nbChunks  = std::max<vtkIdType>( 1, std::min<vtkIdType>( 1024, nbPoints / 65536 ) );
+        std::vector<std::vector<vtkIdType> > delimiters( nbChunks );
+        std::vector<vtkIdType> ends( nbChunks, -1 );
+
+        // Find the delimiters of the block in parallel, each chunk of the block has its own list
+        vtkSMPTools::For( 0, nbChunks, [&]( vtkIdType begin, vtkIdType end ) {
+            float xyz[3];
+            for( vtkIdType c = begin; c < end; ++c )
+            {
+                for( vtkIdType i = c * nbPoints / nbChunks; i < ( c + 1 ) * nbPoints / nbChunks; ++i )
+                {
+                    decode( data + i * pointSize, xyz );
+                    if( std::isnan( xyz[0] ) )
+                        delimiters[c].push_back( i );
+                    else if( std::isinf( xyz[0] ) )
+                    {
+                        ends[c] = i;
+                        break;
+                    }
+                }
+            }
+        } );
+
+        vtkIdType start = 0;
+        records.clear();
+        for( vtkIdType c = 0; c < nbChunks && !finished; ++c )
+        {
+            for( size_t i = 0; i < delimiters[c].size(); ++i )
+            {
+                Record record = { data + start * pointSize, delimiters[c][i] - start };
+                if( record.nbPoints > 0 && this->IsStreamlineKept() ) records.push_back( record );
+                start = delimiters[c][i] + 1;
+            }
+            finished = ends[c] >= 0;
+        }
+        out.Append( records, pointSize, decode );
+        consumed = start * pointSize;
+        this->UpdateProgress( static_cast<double>( block.GetPosition() ) / this->FileSize );
+    }
+    // a file being written by MRtrix has no end triplet yet, its last streamline may be incomplete
+    return true;
+}
+
+void vtkTractogramReader::PrintSelf( ostream & os, vtkIndent indent )
+{
+    this->Superclass::PrintSelf( os, indent );
+
+    os << indent << "File Name: " << ( this->FileName ? this->FileName : "(none)" ) << "\n";
+    os << indent << "Streamline Step: " << this->StreamlineStep << "\n";
+    os << indent << "Point Step: " << this->PointStep << "\n";
+    os << indent << "Number Of Streamlines In File: " << this->NumberOfStreamlinesInFile << "\n";
+}
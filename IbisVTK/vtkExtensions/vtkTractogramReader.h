@@ -0,0 +1,113 @@
+/*=========================================================================
+Ibis Neuronav
+Copyright (c) Simon Drouin, Anna Kochanowska, Louis Collins.
+All rights reserved.
+See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+=========================================================================*/
+// .NAME vtkTractogramReader - read streamlines from .fib, .trk and .tck files
+// .SECTION Description
+// vtkTractogramReader reads fiber tracking results saved as legacy vtk
+// polydata (.fib), TrackVis (.trk) or MRtrix (.tck) files. The output
+// has one line cell per streamline, the points of a streamline are
+// consecutive and stored as floats.
+//
+// TrackVis and MRtrix files are read in large blocks: the streamlines
+// complete in a block are located, then their points are decoded in
+// parallel (vtkSMPTools) directly in the output. Legacy vtk files are
+// loaded with a single read, POINTS and LINES are parsed in place and
+// other cells are ignored. Attributes (POINT_DATA, CELL_DATA) are not
+// read: the output of such files is empty and HasAttributes is set, they
+// have to be read with vtkPolyDataReader to keep their scalars and colours.
+//
+// StreamlineStep and PointStep subsample the streamlines while reading.
+// TrackVis points are transformed to RAS coordinates with the voxel to
+// RAS matrix of the header when it is set (version 2 files).
+// .SECTION See Also
+// vtkPolyDataReader
+
+#ifndef VTKTRACTOGRAMREADER_H
+#define VTKTRACTOGRAMREADER_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include <cstdio>
+
+class vtkTractogramReader : public vtkPolyDataAlgorithm
+{
+public:
+    static vtkTractogramReader * New();
+    vtkTypeMacro( vtkTractogramReader, vtkPolyDataAlgorithm );
+    virtual void PrintSelf( ostream & os, vtkIndent indent ) override;
+
+    // Description:
+    // Return 1 if the file is a TrackVis, MRtrix or legacy vtk polydata file.
+    int CanReadFile( const char * fname );
+
+    // Description:
+    // Specify file name of the tractogram.
+    vtkSetStringMacro( FileName );
+    vtkGetStringMacro( FileName );
+
+    // Description:
+    // Keep one streamline out of StreamlineStep. Default is 1, all streamlines.
+    vtkSetClampMacro( StreamlineStep, int, 1, VTK_INT_MAX );
+    vtkGetMacro( StreamlineStep, int );
+
+    // Description:
+    // Keep one point out of PointStep along each streamline, the last point
+    // of a streamline is always kept. Default is 1, all points.
+    vtkSetClampMacro( PointStep, int, 1, VTK_INT_MAX );
+    vtkGetMacro( PointStep, int );
+
+    // Description:
+    // Number of streamlines found in the file by the last read, including
+    // streamlines skipped because of StreamlineStep.
+    vtkGetMacro( NumberOfStreamlinesInFile, vtkIdType );
+
+    // Description:
+    // True if the last file read is a legacy vtk file with attributes,
+    // the output is then empty.
+    vtkGetMacro( HasAttributes, bool );
+
+protected:
+    // Description:
+    // Streamlines appended to the output, see vtkTractogramReader.cxx
+    class Output;
+
+    enum FileType
+    {
+        UnknownFile,
+        LegacyVtkFile,
+        TrackVisFile,
+        MRtrixFile
+    };
+    FileType GetFileType( FILE * in );
+
+    bool ReadLegacyVtk( FILE * in, Output & out );
+    bool ReadTrackVis( FILE * in, Output & out );
+    bool ReadMRtrix( FILE * in, Output & out );
+    bool IsStreamlineKept();
+
+    vtkTractogramReader();
+    ~vtkTractogramReader();
+
+    virtual int RequestData( vtkInformation * request, vtkInformationVector ** inputVector,
+                             vtkInformationVector * outputVector ) override;
+
+    char * FileName;
+    int StreamlineStep;
+    int PointStep;
+    vtkIdType NumberOfStreamlinesInFile;
+    bool HasAttributes;
+    long long FileSize;
+
+private:
+    vtkTractogramReader( const vtkTractogramReader & );  // Not implemented.
+    void operator=( const vtkTractogramReader & );       // Not implemented.
+};
+
+#endif
@@ -12,11 +12,13 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #define _CRT_SECURE_NO_WARNINGS
 #include "vtkMNIOBJReader.h"
 
+#include <vtkByteSwap.h>
 #include <vtkCellArray.h>
-#include <vtkDoubleArray.h>
+#include <vtkErrorCode.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
-#include <vtkIntArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkPoints.h>
@@ -25,8 +27,170 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkUnsignedCharArray.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
 vtkStandardNewMacro( vtkMNIOBJReader );
 
+//------------------------------------------------------------
+// Values of the file, read one after the other. In ascii files
+// values are separated by white spaces, in binary files they are
+// 4 bytes ints and floats (native byte order of the machine that
+// wrote the file) and colours are 4 unsigned chars (r, g, b, a).
+//------------------------------------------------------------
+class vtkMNIOBJReader::Input
+{
+public:
+    Input() : Binary( false ), SwapBytes( false ), Pos( nullptr ), End( nullptr ) {}
+
+    bool Load( FILE * in )
+    {
+        fseek( in, 0, SEEK_END );
+        long size = ftell( in );
+        fseek( in, 0, SEEK_SET );
+        if( size <= 0 ) return false;
+        this->Buffer.resize( size );
+        if( fread( this->Buffer.data(), 1, size, in ) != static_cast<size_t>( size ) ) return false;
+        this->Pos = this->Buffer.data();
+        this->End = this->Pos + size;
+        return true;
+    }
+
+    bool ReadInt( int & value )
+    {
+        if( this->Binary ) return this->ReadBinary( value );
+        if( !this->NextToken() ) return false;
+        std::from_chars_result res = std::from_chars( this->Pos, this->End, value );
+        this->Pos                  = res.ptr;
+        return res.ec == std::errc();
+    }
+
+    bool ReadFloat( float & value )
+    {
+        if( this->Binary ) return this->ReadBinary( value );
+        if( !this->NextToken() ) return false;
+#ifdef __cpp_lib_to_chars
+        std::from_chars_result res = std::from_chars( this->Pos, this->End, value );
+        this->Pos                  = res.ptr;
+        return res.ec == std::errc();
+#else
+        // Floating point std::from_chars is missing from some standard libraries (e.g. Apple libc++),
+        // parse the token with a stream in the classic locale instead.
+        const char * tokenEnd = this->Pos;
+        while( tokenEnd < this->End && !IsSpace( *tokenEnd ) ) ++tokenEnd;
+        std::istringstream stream( std::string( this->Pos, tokenEnd ) );
+        stream.imbue( std::locale::classic() );
+        stream >> value;
+        if( stream.fail() ) return false;
+        this->Pos = stream.eof() ? tokenEnd : this->Pos + static_cast<std::ptrdiff_t>( stream.tellg() );
+        return true;
+#endif
+    }
+
+    bool ReadFloats( float * values, long long nb )
+    {
+        if( this->Binary )
+        {
+            if( !this->CanHold( nb ) ) return false;
+            memcpy( values, this->Pos, nb * sizeof( float ) );
+            if( this->SwapBytes ) vtkByteSwap::SwapVoidRange( values, nb, sizeof( float ) );
+            this->Pos += nb * sizeof( float );
+            return true;
+        }
+        for( long long i = 0; i < nb; ++i )
+            if( !this->ReadFloat( values[i] ) ) return false;
+        return true;
+    }
+
+    template <class T>
+    bool ReadInts( T * values, long long nb )
+    {
+        int value;
+        for( long long i = 0; i < nb; ++i )
+        {
+            if( !this->ReadInt( value ) ) return false;
+            values[i] = value;
+        }
+        return true;
+    }
+
+    // Colour components in [0,1]
+    bool ReadColor( float rgba[4] )
+    {
+        unsigned char c[4];
+        if( !this->Binary ) return this->ReadFloats( rgba, 4 );
+        if( !this->ReadColor( c ) ) return false;
+        for( int i = 0; i < 4; ++i ) rgba[i] = c[i] / 255.0f;
+        return true;
+    }
+
+    bool ReadColor( unsigned char rgba[4] )
+    {
+        if( this->Binary )
+        {
+            if( this->End - this->Pos < 4 ) return false;
+            memcpy( rgba, this->Pos, 4 );
+            this->Pos += 4;
+            return true;
+        }
+        float c[4];
+        if( !this->ReadFloats( c, 4 ) ) return false;
+        for( int i = 0; i < 4; ++i )
+            rgba[i] = static_cast<unsigned char>( std::min( std::max( c[i], 0.0f ), 1.0f ) * 255 + 0.5f );
+        return true;
+    }
+
+    // Check that nb values can be left in the file before allocating memory for them
+    bool CanHold( long long nb ) { return nb >= 0 && nb * ( this->Binary ? 4 : 1 ) <= this->End - this->Pos; }
+
+    // Binary files are in the byte order of the machine that wrote them: swap bytes if it gives the only
+    // number of points consistent with the file size. offset: position of the number of points from here.
+    void DetectByteOrder( int offset, int bytesPerPoint )
+    {
+        if( this->End - this->Pos < offset + 4 ) return;
+        int nb;
+        memcpy( &nb, this->Pos + offset, 4 );
+        long long available = this->End - this->Pos - offset - 4;
+        if( nb >= 0 && static_cast<long long>( nb ) * bytesPerPoint <= available ) return;
+        vtkByteSwap::SwapVoidRange( &nb, 1, 4 );
+        this->SwapBytes = nb >= 0 && static_cast<long long>( nb ) * bytesPerPoint <= available;
+    }
+
+    // Object type, the first character of the file
+    char ReadChar() { return this->Pos < this->End ? *this->Pos++ : 0; }
+
+    bool Binary;
+    bool SwapBytes;
+
+private:
+    template <class T>
+    bool ReadBinary( T & value )
+    {
+        if( this->End - this->Pos < static_cast<long long>( sizeof( T ) ) ) return false;
+        memcpy( &value, this->Pos, sizeof( T ) );
+        if( this->SwapBytes ) vtkByteSwap::SwapVoidRange( &value, 1, sizeof( T ) );
+        this->Pos += sizeof( T );
+        return true;
+    }
+
+    static bool IsSpace( char c ) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    bool NextToken()
+    {
+        while( this->Pos < this->End && ( IsSpace( *this->Pos ) || *this->Pos == '+' ) ) ++this->Pos;
+        return this->Pos < this->End;
+    }
+
+    std::vector<char> Buffer;
+    const char * Pos;
+    const char * End;
+};
+
 // Description:
 // Instantiate object with NULL filename.
 vtkMNIOBJReader::vtkMNIOBJReader()
@@ -35,6 +199,7 @@ vtkMNIOBJReader::vtkMNIOBJReader()
     this->FileName = NULL;
     this->Property = vtkSmartPointer<vtkProperty>::New();
     this->NbPoints = 0;
+    this->NbItems  = 0;
     this->UseAlpha = true;
 }
 
@@ -49,25 +214,38 @@ vtkMNIOBJReader::~vtkMNIOBJReader()
 
 int vtkMNIOBJReader::CanReadFile( const char * fname )
 {
-    FILE * in = fopen( fname, "r" );
+    FILE * in = fopen( fname, "rb" );
 
     if( in == 0 )
     {
         return 0;
     }
 
-    char p;
-
-    // check file type
-    fscanf( in, "%c", &p );
+    // check file type, the header of binary files has to be read to tell them from other formats
+    unsigned char header[25] = { 0 };
+    size_t headerSize        = fread( header, 1, sizeof( header ), in );
+    fseek( in, 0, SEEK_END );
+    long long fileSize = ftell( in );
     fclose( in );
 
-    if( p != 'P' && p != 'L' )
-    {
-        return 0;
-    }
-
-    return 1;
+    char p = headerSize > 0 ? header[0] : 0;
+    if( p == 'P' || p == 'L' ) return 1;
+    if( p != 'p' && p != 'l' ) return 0;
+
+    // PLY files start with "ply"
+    if( headerSize >= 3 && strncmp( reinterpret_cast<const char *>( header ), "ply", 3 ) == 0 ) return 0;
+
+    // Binary objects: the number of points, after the surface properties (5 floats) of polygons or the thickness
+    // (1 float) of lines, has to fit in the file in one of the byte orders.
+    int offset        = p == 'p' ? 21 : 5;
+    int bytesPerPoint = p == 'p' ? 24 : 12;
+    if( headerSize < static_cast<size_t>( offset + 4 ) ) return 0;
+    int nb;
+    memcpy( &nb, header + offset, 4 );
+    long long available = fileSize - offset - 4;
+    if( nb >= 0 && static_cast<long long>( nb ) * bytesPerPoint <= available ) return 1;
+    vtkByteSwap::SwapVoidRange( &nb, 1, 4 );
+    return nb >= 0 && static_cast<long long>( nb ) * bytesPerPoint <= available ? 1 : 0;
 }
 
 /*-------------------------------------------------------------*/
@@ -106,34 +284,52 @@ int vtkMNIOBJReader::ReadFile( vtkPolyData * output )
     this->Property->DeepCopy( property );
     property->Delete();
 
+    this->SetErrorCode( vtkErrorCode::NoError );
     if( !this->FileName )
     {
         vtkErrorMacro( << "A FileName must be specified." );
+        this->SetErrorCode( vtkErrorCode::NoFileNameError );
         return 0;
     }
 
-    // open the file
-    FILE * in = fopen( this->FileName, "r" );
+    // Load the whole file, binary mode to keep binary values and to parse text in place
+    FILE * in = fopen( this->FileName, "rb" );
     if( in == NULL )
     {
         vtkErrorMacro( << "File " << this->FileName << " not found" );
+        this->SetErrorCode( vtkErrorCode::CannotOpenFileError );
+        return 0;
+    }
+    Input input;
+    bool loaded = input.Load( in );
+    fclose( in );
+    if( !loaded )
+    {
+        vtkErrorMacro( << "Can't read file " << this->FileName );
+        this->SetErrorCode( vtkErrorCode::PrematureEndOfFileError );
         return 0;
     }
 
-    // check file type
-    char p;
-    fscanf( in, "%c", &p );
+    // check file type, lower case types are binary
+    char p          = input.ReadChar();
     MniObjType type = mniPoly;
     switch( p )
     {
         case 'l':
+            input.Binary = true;
+            type         = mniLines;
+            break;
+        case 'p':
+            input.Binary = true;
+            type         = mniPoly;
+            break;
         case 'm':
         case 'f':
         case 'x':
-        case 'p':
         case 'q':
         case 't':
-            vtkErrorMacro( << "Binary .obj files are not supported." );
+            type = mniUnsupported;
+            vtkErrorMacro( << " This is not a MNI .obj polygon file." );
             break;
         case 'L':
             type = mniLines;
@@ -155,19 +351,24 @@ int vtkMNIOBJReader::ReadFile( vtkPolyData * output )
             break;
     }
 
+    bool ok = false;
     if( type == mniLines )
-    {
-        ReadLines( in, output );
-    }
+        ok = ReadLines( input, output );
     else if( type == mniPoly )
-    {
-        ReadPolygons( in, output );
-    }
+        ok = ReadPolygons( input, output );
     else
+    {
+        this->SetErrorCode( vtkErrorCode::UnrecognizedFileTypeError );
         return 0;
+    }
 
-    // close the file
-    fclose( in );
+    if( !ok )
+    {
+        vtkErrorMacro( << "Invalid or truncated MNI .obj file " << this->FileName );
+        this->SetErrorCode( vtkErrorCode::FileFormatError );
+        output->Initialize();
+        return 0;
+    }
     return 1;
 }
 
@@ -191,22 +392,25 @@ int vtkMNIOBJReader::ReadFile( vtkPolyData * output )
 // 		- (newline)
 // 		- indices
 //------------------------------------------------------------
-void vtkMNIOBJReader::ReadLines( FILE * in, vtkPolyData * output )
+bool vtkMNIOBJReader::ReadLines( Input & in, vtkPolyData * output )
 {
+    if( in.Binary ) in.DetectByteOrder( 4, 12 );
+
     float thickness = 1;
-    fscanf( in, "%f", &thickness );
+    if( !in.ReadFloat( thickness ) ) return false;
 
-    ReadPoints( in, output );
+    if( !ReadPoints( in, output ) ) return false;
+    this->UpdateProgress( 0.5 );
 
-    fscanf( in, "%d", &NbItems );
+    if( !in.ReadInt( NbItems ) ) return false;
 
-    ReadColors( in, output );
+    if( !ReadColors( in, output ) ) return false;
 
     // Read lines
-    vtkCellArray * cells = vtkCellArray::New();
-    ReadItems( in, cells );
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    if( !ReadItems( in, cells ) ) return false;
     output->SetLines( cells );
-    cells->Delete();
+    return true;
 }
 
 //------------------------------------------------------------
@@ -239,88 +443,76 @@ void vtkMNIOBJReader::ReadLines( FILE * in, vtkPolyData * output )
 //		glued together (8 polygons) or a regular subdivision of one of these.
 //		Surface normals for each point are computed, after reading file.
 //------------------------------------------------------------
-void vtkMNIOBJReader::ReadPolygons( FILE * in, vtkPolyData * output )
+bool vtkMNIOBJReader::ReadPolygons( Input & in, vtkPolyData * output )
 {
+    if( in.Binary ) in.DetectByteOrder( 20, 24 );
+
     // fill in Property coefficients
-    float ambient, diffuse, specular, specular_exp, opacity;
-    fscanf( in, "%f", &ambient );
-    fscanf( in, "%f", &diffuse );
-    fscanf( in, "%f", &specular );
-    fscanf( in, "%f", &specular_exp );
-    fscanf( in, "%f", &opacity );
-
-    this->Property->SetAmbient( ambient );
-    this->Property->SetDiffuse( diffuse );
-    this->Property->SetSpecular( specular );
-    this->Property->SetSpecularPower( specular_exp );
-    this->Property->SetOpacity( opacity );
-
-    ReadPoints( in, output );
-
-    // Read normals
-    double norms[3];
-    vtkDoubleArray * normals = vtkDoubleArray::New();
-    normals->SetNumberOfComponents( 3 );
-    normals->SetNumberOfTuples( NbPoints );
-    for( int j = 0; j < NbPoints; j++ )
-    {
-        fscanf( in, " %lf ", norms );
-        fscanf( in, " %lf ", norms + 1 );
-        fscanf( in, " %lf ", norms + 2 );
-        normals->SetTuple( j, norms );
-    }
-    this->GetOutput()->GetPointData()->SetNormals( normals );
-    normals->Delete();
+    float surfprop[5];
+    if( !in.ReadFloats( surfprop, 5 ) ) return false;
+
+    this->Property->SetAmbient( surfprop[0] );
+    this->Property->SetDiffuse( surfprop[1] );
+    this->Property->SetSpecular( surfprop[2] );
+    this->Property->SetSpecularPower( surfprop[3] );
+    this->Property->SetOpacity( surfprop[4] );
+
+    if( !ReadPoints( in, output ) ) return false;
+    this->UpdateProgress( 0.4 );
+
+    if( !ReadNormals( in, output ) ) return false;
+    this->UpdateProgress( 0.6 );
 
     // Read number of items
-    fscanf( in, "%d", &NbItems );
+    if( !in.ReadInt( NbItems ) ) return false;
 
     // Read colors
-    ReadColors( in, output );
+    if( !ReadColors( in, output ) ) return false;
+    this->UpdateProgress( 0.7 );
 
     // Read polygons
-    vtkCellArray * indexCells = vtkCellArray::New();
-    ReadItems( in, indexCells );
+    vtkSmartPointer<vtkCellArray> indexCells = vtkSmartPointer<vtkCellArray>::New();
+    if( !ReadItems( in, indexCells ) ) return false;
     output->SetPolys( indexCells );
-    indexCells->Delete();
+    return true;
 }
 
-void vtkMNIOBJReader::ReadPoints( FILE * in, vtkPolyData * output )
+bool vtkMNIOBJReader::ReadPoints( Input & in, vtkPolyData * output )
 {
-    // fill point coordinates in points
-    fscanf( in, "%d", &NbPoints );
-    double x, y, z;
-    vtkPoints * points = vtkPoints::New();
-    points->SetDataTypeToDouble();
-    points->SetNumberOfPoints( NbPoints );
-
-    for( int i = 0; i < NbPoints; i++ )
-    {
-        fscanf( in, " %lf ", &x );
-        fscanf( in, " %lf ", &y );
-        fscanf( in, " %lf ", &z );
-
-        points->SetPoint( i, x, y, z );
-    }
-
+    // fill point coordinates directly in a float array
+    if( !in.ReadInt( NbPoints ) || !in.CanHold( 3 * static_cast<long long>( NbPoints ) ) ) return false;
+    vtkSmartPointer<vtkFloatArray> coords = vtkSmartPointer<vtkFloatArray>::New();
+    coords->SetNumberOfComponents( 3 );
+    coords->SetNumberOfTuples( NbPoints );
+    if( !in.ReadFloats( coords->GetPointer( 0 ), 3 * static_cast<long long>( NbPoints ) ) ) return false;
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData( coords );
     output->SetPoints( points );
+    return true;
+}
 
-    points->Delete();
+bool vtkMNIOBJReader::ReadNormals( Input & in, vtkPolyData * output )
+{
+    if( !in.CanHold( 3 * static_cast<long long>( NbPoints ) ) ) return false;
+    vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+    normals->SetNumberOfComponents( 3 );
+    normals->SetNumberOfTuples( NbPoints );
+    if( !in.ReadFloats( normals->GetPointer( 0 ), 3 * static_cast<long long>( NbPoints ) ) ) return false;
+    output->GetPointData()->SetNormals( normals );
+    return true;
 }
 
-void vtkMNIOBJReader::ReadColors( FILE * in, vtkPolyData * output )
+bool vtkMNIOBJReader::ReadColors( Input & in, vtkPolyData * output )
 {
     // determine type of coloration
     int colorperpoint;
-    fscanf( in, "%d", &colorperpoint );
+    if( !in.ReadInt( colorperpoint ) ) return false;
 
     float rgba[4];
     if( colorperpoint == 0 )  // 1 color for all points
     {
-        fscanf( in, " %f ", rgba );
-        fscanf( in, " %f ", rgba + 1 );
-        fscanf( in, " %f ", rgba + 2 );
-        fscanf( in, " %f ", rgba + 3 );
+        if( !in.ReadColor( rgba ) ) return false;
 
         // set the color in Property
         this->Property->SetColor( rgba[0], rgba[1], rgba[2] );
@@ -328,73 +520,55 @@ void vtkMNIOBJReader::ReadColors( FILE * in, vtkPolyData * output )
     else if( colorperpoint == 1 )  // 1 color per item (line segment, triangle, etc. )
     {
         vtkErrorMacro( "Color per item not yet supported." );
-        return;
+        // skip the colors to read items
+        if( !in.CanHold( 4 * static_cast<long long>( NbItems ) ) ) return false;
+        for( int k = 0; k < NbItems; k++ )
+            if( !in.ReadColor( rgba ) ) return false;
     }
     else if( colorperpoint == 2 )  // 1 color per vertex
     {
-        vtkUnsignedCharArray * charColors = vtkUnsignedCharArray::New();
-        if( UseAlpha )
-            charColors->SetNumberOfComponents( 4 );
-        else
-            charColors->SetNumberOfComponents( 3 );
+        if( !in.CanHold( 4 * static_cast<long long>( NbPoints ) ) ) return false;
+        vtkSmartPointer<vtkUnsignedCharArray> charColors = vtkSmartPointer<vtkUnsignedCharArray>::New();
+        int nbComponents                                 = UseAlpha ? 4 : 3;
+        charColors->SetNumberOfComponents( nbComponents );
         charColors->SetNumberOfTuples( NbPoints );
 
+        unsigned char * colors = charColors->GetPointer( 0 );
+        unsigned char color[4];
         for( int k = 0; k < NbPoints; k++ )
         {
-            fscanf( in, " %f ", rgba );
-            fscanf( in, " %f ", rgba + 1 );
-            fscanf( in, " %f ", rgba + 2 );
-            fscanf( in, " %f ", rgba + 3 );
-            // transorm float values into approximate unsigned char values
-            if( UseAlpha )
-                charColors->SetTuple4( k, rgba[0] * 255, rgba[1] * 255, rgba[2] * 255, rgba[3] * 255 );
-            else
-                charColors->SetTuple3( k, rgba[0] * 255, rgba[1] * 255, rgba[2] * 255 );
+            if( !in.ReadColor( color ) ) return false;
+            memcpy( colors + k * nbComponents, color, nbComponents );
         }
         output->GetPointData()->SetScalars( charColors );
-        charColors->Delete();
     }
+    return true;
 }
 
-void vtkMNIOBJReader::ReadItems( FILE * in, vtkCellArray * indexCells )
+bool vtkMNIOBJReader::ReadItems( Input & in, vtkCellArray * indexCells )
 {
-    // read last index of each item
-    vtkIntArray * endIndices = vtkIntArray::New();
-    endIndices->SetNumberOfValues( NbItems );
-    int bufferInt;
-    for( int m = 0; m < NbItems; m++ )
-    {
-        fscanf( in, "%d", &bufferInt );
-        endIndices->SetValue( m, bufferInt );
-    }
-
-    // Read First item
-    int poly_indx;
-    int end_indx;
-    indexCells->InsertNextCell( endIndices->GetValue( 0 ) );
-    end_indx = endIndices->GetValue( 0 );
-    for( int s = 0; s < end_indx; s++ )
-    {
-        fscanf( in, "%d", &poly_indx );
-        indexCells->InsertCellPoint( poly_indx );
-    }
-
-    // Read other items
-    for( int n = 1; n < NbItems; n++ )
-    {
-        // get dimension of polygon n
-        end_indx = ( endIndices->GetValue( n ) - endIndices->GetValue( n - 1 ) );
-        // end_indx gives dimension of cell n
-        indexCells->InsertNextCell( end_indx );
-
-        // insert [end_indx] points in cell p of indexCells
-        for( int p = 0; p < end_indx; p++ )
-        {
-            fscanf( in, "%d", &poly_indx );
-            indexCells->InsertCellPoint( poly_indx );
-        }
-    }
-    endIndices->Delete();
+    // read last index of each item, cell offsets are the same with a leading 0
+    if( !in.CanHold( NbItems ) ) return false;
+    vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues( NbItems + 1 );
+    vtkIdType * offsetValues = offsets->GetPointer( 0 );
+    offsetValues[0]          = 0;
+    if( !in.ReadInts( offsetValues + 1, NbItems ) ) return false;
+    for( int n = 0; n < NbItems; n++ )
+        if( offsetValues[n + 1] < offsetValues[n] ) return false;
+
+    // read point indices of all items
+    vtkIdType nbIndices = offsetValues[NbItems];
+    if( !in.CanHold( nbIndices ) ) return false;
+    vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues( nbIndices );
+    vtkIdType * indices = connectivity->GetPointer( 0 );
+    if( !in.ReadInts( indices, nbIndices ) ) return false;
+    for( vtkIdType i = 0; i < nbIndices; i++ )
+        if( indices[i] < 0 || indices[i] >= NbPoints ) return false;
+
+    indexCells->SetData( offsets, connectivity );
+    return true;
 }
 
 void vtkMNIOBJReader::PrintSelf( ostream & os, vtkIndent indent )
@@ -14,6 +14,10 @@ See Copyright.txt or http://ibisneuronav.org/Copyright.html for details.
 // .SECTION Description
 // vtkMNIOBJReader is a source object that reads MNI .obj
 // files. The output of this source object is polygonal data.
+// Polygon ('P') and line ('L') objects are read in ascii and
+// binary ('p', 'l') formats. The file is loaded in memory with a
+// single read and values are parsed in place into float point,
+// normal and cell arrays.
 // .SECTION See Also
 
 #ifndef VTKMNIOBJREADER_H
@@ -46,12 +50,17 @@ public:
     vtkSetMacro( UseAlpha, bool );
 
 protected:
+    // Description:
+    // File content and read position, see vtkMNIOBJReader.cxx
+    class Input;
+
     virtual int ReadFile( vtkPolyData * output );
-    void ReadLines( FILE * in, vtkPolyData * output );
-    void ReadPolygons( FILE * in, vtkPolyData * output );
-    void ReadPoints( FILE * in, vtkPolyData * output );
-    void ReadColors( FILE * in, vtkPolyData * output );
-    void ReadItems( FILE * in, vtkCellArray * indexCells );
+    bool ReadLines( Input & in, vtkPolyData * output );
+    bool ReadPolygons( Input & in, vtkPolyData * output );
+    bool ReadPoints( Input & in, vtkPolyData * output );
+    bool ReadNormals( Input & in, vtkPolyData * output );
+    bool ReadColors( Input & in, vtkPolyData * output );
+    bool ReadItems( Input & in, vtkCellArray * indexCells );
 
     vtkMNIOBJReader();
     ~vtkMNIOBJReader();
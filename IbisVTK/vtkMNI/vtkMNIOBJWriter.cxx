@@ -11,38 +11,196 @@
 
 =========================================================================*/
 
+#define _CRT_SECURE_NO_WARNINGS
 #include "vtkMNIOBJWriter.h"
 
-#include <fstream>
-#include <ostream>
+#include <vtkCellArray.h>
+#include <vtkErrorCode.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkProperty.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
 
-#include "vtkCellArray.h"
-#include "vtkDoubleArray.h"
-#include "vtkIntArray.h"
-#include "vtkObjectFactory.h"
-#include "vtkPointData.h"
-#include "vtkPoints.h"
-#include "vtkPolyData.h"
-#include "vtkProperty.h"
-#include "vtkUnsignedCharArray.h"
-
-vtkCxxRevisionMacro( vtkMNIOBJWriter, "$Revision: 1.1 $" );
 vtkStandardNewMacro( vtkMNIOBJWriter );
 
-// Description:
-// Instantiate object with NULL filename.
-vtkMNIOBJWriter::vtkMNIOBJWriter()
+//------------------------------------------------------------
+// Values are formatted in a memory buffer written to the file
+// when full. In ascii files values are preceded by a space and
+// floats are written in the shortest form that reads back to
+// the same value. In binary files they are 4 bytes ints and
+// floats in native byte order and colours are 4 unsigned chars.
+//------------------------------------------------------------
+class vtkMNIOBJWriter::Output
 {
-    this->FileName = NULL;
-    this->Property = vtkProperty::New();
-    this->NbPoints = 0;
+public:
+    Output( FILE * out, bool binary ) : Binary( binary ), Failed( false ), File( out ), Length( 0 )
+    {
+        this->Buffer.resize( BufferSize );
+    }
+
+    void WriteChar( char c )
+    {
+        this->Reserve( 1 );
+        this->Buffer[this->Length++] = c;
+    }
+
+    template <class T>
+    void WriteValue( T value )
+    {
+        char * pos = this->Reserve( MaxValueSize );
+        if( this->Binary )
+        {
+            memcpy( pos, &value, sizeof( T ) );
+            this->Length += sizeof( T );
+            return;
+        }
+        *pos++ = ' ';
+#ifndef __cpp_lib_to_chars
+        // Floating point std::to_chars is missing from some standard libraries (e.g. Apple libc++),
+        // use a stream in the classic locale with enough digits to read back the same value.
+        if constexpr( std::is_floating_point<T>::value )
+        {
+            std::ostringstream stream;
+            stream.imbue( std::locale::classic() );
+            stream.precision( std::numeric_limits<T>::max_digits10 );
+            stream << value;
+            const std::string text = stream.str();
+            const size_t length    = std::min( text.size(), MaxValueSize - 1 );
+            memcpy( pos, text.data(), length );
+            this->Length = pos + length - this->Buffer.data();
+        }
+        else
+#endif
+        {
+            std::to_chars_result res = std::to_chars( pos, pos + MaxValueSize - 1, value );
+            this->Length             = res.ptr - this->Buffer.data();
+        }
+    }
+
+    void WriteInt( int value ) { this->WriteValue( value ); }
+    void WriteFloat( float value ) { this->WriteValue( value ); }
+
+    // In ascii, perLine values are written on each line
+    void WriteFloats( const float * values, vtkIdType nb, int perLine )
+    {
+        if( this->Binary )
+        {
+            this->WriteBytes( values, nb * sizeof( float ) );
+            return;
+        }
+        for( vtkIdType i = 0; i < nb; ++i )
+        {
+            this->WriteValue( values[i] );
+            if( ( i + 1 ) % perLine == 0 || i + 1 == nb ) this->NewLine();
+        }
+    }
+
+    template <class T>
+    void WriteInts( const T * values, vtkIdType nb, int perLine )
+    {
+        for( vtkIdType i = 0; i < nb; ++i )
+        {
+            this->WriteValue( static_cast<int>( values[i] ) );
+            if( ( i + 1 ) % perLine == 0 || i + 1 == nb ) this->NewLine();
+        }
+    }
+
+    // Colour components in [0,1]
+    void WriteColor( const float rgba[4] )
+    {
+        if( this->Binary )
+        {
+            char * pos = this->Reserve( 4 );
+            for( int i = 0; i < 4; ++i )
+                pos[i] = static_cast<unsigned char>( std::min( std::max( rgba[i], 0.0f ), 1.0f ) * 255 + 0.5f );
+            this->Length += 4;
+            return;
+        }
+        this->WriteFloats( rgba, 4, 4 );
+    }
+
+    void NewLine()
+    {
+        if( !this->Binary ) this->WriteChar( '\n' );
+    }
+
+    bool Flush()
+    {
+        if( this->Length > 0 && fwrite( this->Buffer.data(), 1, this->Length, this->File ) != this->Length )
+            this->Failed = true;
+        this->Length = 0;
+        return !this->Failed;
+    }
+
+    bool Binary;
+    bool Failed;
+
+private:
+    static const size_t BufferSize   = 1 << 20;
+    static const size_t MaxValueSize = 32;
+
+    char * Reserve( size_t nb )
+    {
+        if( this->Length + nb > this->Buffer.size() ) this->Flush();
+        return this->Buffer.data() + this->Length;
+    }
+
+    // Large blocks skip the buffer
+    void WriteBytes( const void * data, size_t nb )
+    {
+        if( nb > BufferSize / 2 )
+        {
+            this->Flush();
+            if( fwrite( data, 1, nb, this->File ) != nb ) this->Failed = true;
+            return;
+        }
+        memcpy( this->Reserve( nb ), data, nb );
+        this->Length += nb;
+    }
+
+    FILE * File;
+    std::vector<char> Buffer;
+    size_t Length;
+};
+
+// Pointer to the 3 component tuples of array as floats, converted in copy if needed
+static const float * GetFloatTuples( vtkDataArray * array, std::vector<float> & copy )
+{
+    vtkFloatArray * floats = vtkFloatArray::SafeDownCast( array );
+    if( floats ) return floats->GetPointer( 0 );
+    vtkIdType nb = array->GetNumberOfTuples();
+    copy.resize( 3 * nb );
+    double tuple[3];
+    for( vtkIdType i = 0; i < nb; ++i )
+    {
+        array->GetTuple( i, tuple );
+        copy[3 * i]     = static_cast<float>( tuple[0] );
+        copy[3 * i + 1] = static_cast<float>( tuple[1] );
+        copy[3 * i + 2] = static_cast<float>( tuple[2] );
+    }
+    return copy.data();
 }
 
-vtkMNIOBJWriter::vtkMNIOBJWriter( char * fname, bool aLine )
+vtkMNIOBJWriter::vtkMNIOBJWriter()
 {
-    this->FileName = fname;
-    this->Property = vtkProperty::New();
-    this->NbPoints = 0;
+    this->FileName = NULL;
+    this->Property = vtkSmartPointer<vtkProperty>::New();
+    this->Binary   = false;
 }
 
 vtkMNIOBJWriter::~vtkMNIOBJWriter()
@@ -51,19 +209,29 @@ vtkMNIOBJWriter::~vtkMNIOBJWriter()
     {
         delete[] this->FileName;
         this->FileName = NULL;
-        this->Property->Delete();
     }
 }
 
-void vtkMNIOBJWriter::Write( vtkPolyData * output )
+void vtkMNIOBJWriter::SetProperty( vtkProperty * prop )
 {
-    this->SetOutput( output );
-    Write();
+    this->Property = prop;
+    this->Modified();
 }
 
-void vtkMNIOBJWriter::Write()
+vtkProperty * vtkMNIOBJWriter::GetProperty() { return this->Property; }
+
+vtkPolyData * vtkMNIOBJWriter::GetInput() { return vtkPolyData::SafeDownCast( this->Superclass::GetInput() ); }
+
+int vtkMNIOBJWriter::FillInputPortInformation( int, vtkInformation * info )
+{
+    info->Set( vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData" );
+    return 1;
+}
+
+void vtkMNIOBJWriter::WriteData()
 {
-    if( this->GetOutput()->GetNumberOfCells() == 0 || this->GetOutput()->GetNumberOfPoints() == 0 )
+    vtkPolyData * input = this->GetInput();
+    if( !input || input->GetNumberOfPoints() == 0 )
     {
         vtkErrorMacro( << "No data. Empty Data Object." );
         return;
@@ -75,175 +243,169 @@ void vtkMNIOBJWriter::Write()
         return;
     }
 
-    std::string fileName = this->FileName;
-
-    std::ofstream out;
-    out.open( fileName.data(), ios::out | ios::trunc );
-    if( out.is_open() )
+    FILE * file = fopen( this->FileName, "wb" );
+    if( file == NULL )
     {
-        if( isALine )
-        {
-            std::cout << "!!!!! MNI line object writing has not been tested. Use at your own peril. !!!!!" << std::endl;
-            out << "L ";
-            WriteLines( out );
-        }
-        else
-        {
-            out << "P ";
-            WritePolygons( out );
-        }
-
-        out.close();
+        vtkErrorMacro( << "Can't open file " << this->FileName );
+        this->SetErrorCode( vtkErrorCode::CannotOpenFileError );
+        return;
     }
+
+    Output out( file, this->Binary );
+    if( input->GetNumberOfPolys() == 0 && input->GetNumberOfLines() > 0 )
+        this->WriteLines( out, input );
     else
+        this->WritePolygons( out, input );
+    bool ok = out.Flush();
+    if( fclose( file ) != 0 ) ok = false;
+
+    if( !ok )
     {
-        cout << "Unable to open file";
+        vtkErrorMacro( << "Error writing file " << this->FileName );
+        this->SetErrorCode( vtkErrorCode::OutOfDiskSpaceError );
     }
 }
 
-void vtkMNIOBJWriter::WriteLines( std::ostream & out )
+//------------------------------------------------------------
+// Line object, see the file description in vtkMNIOBJReader::ReadLines
+//------------------------------------------------------------
+void vtkMNIOBJWriter::WriteLines( Output & out, vtkPolyData * input )
 {
-    float thickness = 1;
-    out << thickness << std::endl;
+    out.WriteChar( this->Binary ? 'l' : 'L' );
 
-    WritePoints( out );
+    float thickness = 1;
+    out.WriteFloat( thickness );
 
-    out << NbItems << std::endl;
+    this->WritePoints( out, input );
+    this->UpdateProgress( 0.5 );
 
-    WriteColors( out );
+    out.WriteInt( static_cast<int>( input->GetLines()->GetNumberOfCells() ) );
+    out.NewLine();
 
-    out << std::endl;
+    this->WriteColors( out, input );
 
-    WriteItems( out );
+    this->WriteItems( out, input->GetLines() );
 }
 
-void vtkMNIOBJWriter::WritePolygons( std::ostream & out )
+//------------------------------------------------------------
+// Polygon object, see the file description in vtkMNIOBJReader::ReadPolygons.
+// Triangle strips, lines and vertices of the input are not written.
+//------------------------------------------------------------
+void vtkMNIOBJWriter::WritePolygons( Output & out, vtkPolyData * input )
 {
-    out << this->Property->GetAmbient() << " ";
-    out << this->Property->GetDiffuse() << " ";
-    out << this->Property->GetSpecular() << " ";
-    out << this->Property->GetSpecularPower() << " ";
-    out << this->Property->GetOpacity() << " ";
+    out.WriteChar( this->Binary ? 'p' : 'P' );
 
-    WritePoints( out );
+    out.WriteFloat( static_cast<float>( this->Property->GetAmbient() ) );
+    out.WriteFloat( static_cast<float>( this->Property->GetDiffuse() ) );
+    out.WriteFloat( static_cast<float>( this->Property->GetSpecular() ) );
+    out.WriteFloat( static_cast<float>( this->Property->GetSpecularPower() ) );
+    out.WriteFloat( static_cast<float>( this->Property->GetOpacity() ) );
 
-    out << std::endl;
-
-    vtkDoubleArray * normals = vtkDoubleArray::SafeDownCast( this->GetOutput()->GetPointData()->GetNormals() );
-    double norm[3];
-    for( int j = 0; j < NbPoints; j++ )
-    {
-        normals->GetTuple( j, norm );
-        out << norm[0] << " " << norm[1] << " " << norm[2] << std::endl;
-    }
+    this->WritePoints( out, input );
+    this->UpdateProgress( 0.4 );
 
-    out << std::endl;
+    this->WriteNormals( out, input );
+    this->UpdateProgress( 0.6 );
 
-    out << this->GetOutput()->GetPolys()->GetNumberOfCells() << std::endl;
+    out.WriteInt( static_cast<int>( input->GetPolys()->GetNumberOfCells() ) );
+    out.NewLine();
 
-    WriteColors( out );
+    this->WriteColors( out, input );
+    this->UpdateProgress( 0.7 );
 
-    out << std::endl;
+    this->WriteItems( out, input->GetPolys() );
+}
 
-    WriteItems( out );
+void vtkMNIOBJWriter::WritePoints( Output & out, vtkPolyData * input )
+{
+    vtkIdType nbPoints = input->GetNumberOfPoints();
+    out.WriteInt( static_cast<int>( nbPoints ) );
+    out.NewLine();
 
-    out << std::endl;
+    std::vector<float> copy;
+    out.WriteFloats( GetFloatTuples( input->GetPoints()->GetData(), copy ), 3 * nbPoints, 3 );
+    out.NewLine();
 }
 
-void vtkMNIOBJWriter::WritePoints( std::ostream & out )
+void vtkMNIOBJWriter::WriteNormals( Output & out, vtkPolyData * input )
 {
-    // fill point coordinates in points
-    double thePoint[3];
-    vtkPoints * points = this->GetOutput()->GetPoints();
-    NbPoints           = points->GetNumberOfPoints();
-
-    out << NbPoints << std::endl;
+    vtkIdType nbPoints                 = input->GetNumberOfPoints();
+    vtkSmartPointer<vtkDataArray> norm = input->GetPointData()->GetNormals();
+    if( !norm || norm->GetNumberOfTuples() != nbPoints || norm->GetNumberOfComponents() != 3 )
+    {
+        // Normals are required in polygon objects, compute them without splitting to keep input points
+        vtkSmartPointer<vtkPolyDataNormals> normalsFilter = vtkSmartPointer<vtkPolyDataNormals>::New();
+        normalsFilter->SetInputData( input );
+        normalsFilter->SplittingOff();
+        normalsFilter->ConsistencyOff();
+        normalsFilter->ComputeCellNormalsOff();
+        normalsFilter->Update();
+        norm = normalsFilter->GetOutput()->GetPointData()->GetNormals();
+    }
 
-    for( int i = 0; i < NbPoints; i++ )
+    std::vector<float> copy;
+    if( norm && norm->GetNumberOfTuples() == nbPoints )
+        out.WriteFloats( GetFloatTuples( norm, copy ), 3 * nbPoints, 3 );
+    else
     {
-        points->GetPoint( i, thePoint );
-        out << thePoint[0] << " " << thePoint[1] << " " << thePoint[2] << std::endl;
+        copy.assign( 3 * nbPoints, 0.0f );
+        out.WriteFloats( copy.data(), 3 * nbPoints, 3 );
     }
+    out.NewLine();
 }
 
-void vtkMNIOBJWriter::WriteColors( std::ostream & out )
+void vtkMNIOBJWriter::WriteColors( Output & out, vtkPolyData * input )
 {
-    vtkUnsignedCharArray * charColors =
-        vtkUnsignedCharArray::SafeDownCast( this->GetOutput()->GetPointData()->GetScalars() );
+    vtkIdType nbPoints           = input->GetNumberOfPoints();
+    vtkUnsignedCharArray * chars = vtkUnsignedCharArray::SafeDownCast( input->GetPointData()->GetScalars() );
+    int nbComponents             = chars ? chars->GetNumberOfComponents() : 0;
 
-    if( charColors == 0 )  // if there are no colours than just get whatever is in property
+    float rgba[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    if( ( nbComponents == 3 || nbComponents == 4 ) && chars->GetNumberOfTuples() == nbPoints )
     {
-        out << "0 ";
-
-        double rgba[4];
-        this->Property->GetColor( rgba );
-        out << rgba[0] << " " << rgba[1] << " " << rgba[2] << " 1" << std::endl;
-    }
-    else if( charColors->GetNumberOfComponents() == 4 )  // if there are colors, then write them out
-    {
-        int nTuples = charColors->GetNumberOfTuples();
-
-        if( nTuples != NbPoints ) return;
-        out << "2 ";
-
-        double * rgba;
-        for( int k = 0; k < NbPoints; k++ )
+        out.WriteInt( 2 );  // 1 color per vertex
+        const unsigned char * colors = chars->GetPointer( 0 );
+        for( vtkIdType k = 0; k < nbPoints; k++ )
         {
-            rgba = charColors->GetTuple4( k );
-            out << rgba[0] / 255 << " " << rgba[1] / 255 << " " << rgba[2] / 255 << " " << rgba[3] / 255 << std::endl;
+            for( int i = 0; i < nbComponents; ++i ) rgba[i] = colors[k * nbComponents + i] / 255.0f;
+            out.WriteColor( rgba );
         }
     }
+    else  // if there are no colours than just get whatever is in property
+    {
+        out.WriteInt( 0 );
+        double * color = this->Property->GetColor();
+        for( int i = 0; i < 3; ++i ) rgba[i] = static_cast<float>( color[i] );
+        out.WriteColor( rgba );
+    }
+    out.NewLine();
 }
 
-void vtkMNIOBJWriter::WriteItems( std::ostream & out )
+void vtkMNIOBJWriter::WriteItems( Output & out, vtkCellArray * cells )
 {
-    vtkCellArray * indexCells = this->GetOutput()->GetPolys();
-    std::cout << "Cells = " << indexCells->GetNumberOfCells() << std::endl;
-
-    vtkIdType numPoints     = 0;
-    vtkIdType nextNumPoints = 0;
-    vtkIdType * pointList;
-
-    // Write out end-index of the point list for polygons
-    indexCells->InitTraversal();
-    for( int s = 0; s < indexCells->GetNumberOfCells(); s++ )
+    // end index of each item is the offset of the next item
+    vtkIdType nbItems = cells->GetNumberOfCells();
+    if( cells->IsStorage64Bit() )
     {
-        indexCells->GetNextCell( nextNumPoints, pointList );
-        numPoints += nextNumPoints;
-
-        out << numPoints << " ";
-
-        if( ( s + 1 ) % 8 == 0 )
-        {
-            out << std::endl;
-        }
+        const vtkTypeInt64 * offsets = cells->GetOffsetsArray64()->GetPointer( 0 );
+        out.WriteInts( offsets + 1, nbItems, 8 );
+        out.NewLine();
+        out.WriteInts( cells->GetConnectivityArray64()->GetPointer( 0 ), offsets[nbItems], 8 );
     }
-
-    out << std::endl << std::endl;
-
-    // Write out the list of points that makes up the polygons
-    int eightCount = 0;
-    indexCells->InitTraversal();
-    for( int m = 0; m < indexCells->GetNumberOfCells(); m++ )
+    else
     {
-        indexCells->GetNextCell( numPoints, pointList );
-
-        for( int p = 0; p < numPoints; p++ )
-        {
-            out << pointList[p] << " ";
-            ++eightCount;
-
-            if( eightCount % 8 == 0 )
-            {
-                out << std::endl;
-            }
-        }
+        const vtkTypeInt32 * offsets = cells->GetOffsetsArray32()->GetPointer( 0 );
+        out.WriteInts( offsets + 1, nbItems, 8 );
+        out.NewLine();
+        out.WriteInts( cells->GetConnectivityArray32()->GetPointer( 0 ), offsets[nbItems], 8 );
     }
+    out.NewLine();
 }
 
-void vtkMNIOBJWriter::PrintSelf( std::ostream & os, vtkIndent indent )
+void vtkMNIOBJWriter::PrintSelf( ostream & os, vtkIndent indent )
 {
     this->Superclass::PrintSelf( os, indent );
 
     os << indent << "File Name: " << ( this->FileName ? this->FileName : "(none)" ) << "\n";
+    os << indent << "Binary: " << ( this->Binary ? "On" : "Off" ) << "\n";
 }
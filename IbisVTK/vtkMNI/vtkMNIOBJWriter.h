@@ -12,63 +12,76 @@
    PURPOSE.  See the above copyright notice for more information.
 
 =========================================================================*/
-// .NAME vtkMNIOBJWriter - read MNI .obj files
+
+// .NAME vtkMNIOBJWriter - write MNI .obj files
 // .SECTION Description
-// vtkMNIOBJWriter is a source object that writes MNI .obj
-// files. The input of this source object is polygonal data
-// and the output may or may not be junk.
+// vtkMNIOBJWriter writes polygonal data in MNI .obj files. Polygons are
+// written as a polygon object ('P'), an input with lines and no polygons
+// is written as a line object ('L'). Objects are written in ascii or in
+// binary ('p', 'l'), values are formatted in a memory buffer that is
+// flushed to the file in large blocks. Files are read back by
+// vtkMNIOBJReader.
 // .SECTION See Also
+// vtkMNIOBJReader
 
 #ifndef VTKMNIOBJWRITER_H
 #define VTKMNIOBJWRITER_H
 
-// VTK6 #include "vtkPolyDataSource.h"
-#include <fstream>
-#include <ostream>
-
-#include "vtkPolyDataAlgorithm.h"
+#include <vtkSmartPointer.h>
+#include <vtkWriter.h>
 
 class vtkProperty;
 class vtkCellArray;
 class vtkPolyData;
 
-class vtkMNIOBJWriter : public vtkPolyDataAlgorithm  // VTK6
+class vtkMNIOBJWriter : public vtkWriter
 {
 public:
     static vtkMNIOBJWriter * New();
-    vtkMNIOBJWriter( char * fname, bool aLine );
-    vtkTypeRevisionMacro( vtkMNIOBJWriter, vtkPolyDataAlgorithm );  // VTK6
-    void PrintSelf( ostream & os, vtkIndent indent );
-    void Write( vtkPolyData * output );
-    void Write();  // vtkPolyData *output);
+    vtkTypeMacro( vtkMNIOBJWriter, vtkWriter );
+    virtual void PrintSelf( ostream & os, vtkIndent indent ) override;
 
     // Description:
     // Specify file name of MNI .obj file.
     vtkSetStringMacro( FileName );
     vtkGetStringMacro( FileName );
 
-    void SetIsLine( bool itIs ) { isALine = itIs; }
-    bool GetIsLine() { return isALine; }
+    // Description:
+    // Write a binary object instead of ascii. Binary values are in the
+    // byte order of this machine. Default is ascii.
+    vtkSetMacro( Binary, bool );
+    vtkGetMacro( Binary, bool );
+    vtkBooleanMacro( Binary, bool );
 
     // Description:
-    // Return properties of MNI .obj file
-    void SetProperty( vtkProperty * prop ) { Property = prop; };
+    // Surface properties written in polygon objects. The color of the
+    // property is written when the input has no rgba point scalars.
+    void SetProperty( vtkProperty * prop );
+    vtkProperty * GetProperty();
+
+    vtkPolyData * GetInput();
 
 protected:
-    void WriteLines( std::ostream & out );
-    void WritePolygons( std::ostream & out );
-    void WritePoints( std::ostream & out );
-    void WriteColors( std::ostream & out );
-    void WriteItems( std::ostream & out );
+    // Description:
+    // Write buffer of the file, see vtkMNIOBJWriter.cxx
+    class Output;
 
     vtkMNIOBJWriter();
     ~vtkMNIOBJWriter();
-    vtkProperty * Property;
 
+    virtual void WriteData() override;
+    virtual int FillInputPortInformation( int port, vtkInformation * info ) override;
+
+    void WriteLines( Output & out, vtkPolyData * input );
+    void WritePolygons( Output & out, vtkPolyData * input );
+    void WritePoints( Output & out, vtkPolyData * input );
+    void WriteNormals( Output & out, vtkPolyData * input );
+    void WriteColors( Output & out, vtkPolyData * input );
+    void WriteItems( Output & out, vtkCellArray * cells );
+
+    vtkSmartPointer<vtkProperty> Property;
     char * FileName;
-    bool isALine;  // is not a Polygon
-    int NbPoints;
-    int NbItems;
+    bool Binary;
 
 private:
     vtkMNIOBJWriter( const vtkMNIOBJWriter & );  // Not implemented.